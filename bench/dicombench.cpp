@@ -0,0 +1,802 @@
+// 无界面性能测试：生成合成DICOM序列，按 MainWindow 的管线加载、切换切片、映射窗宽窗位、体绘制、等值面、核外分块存储
+// 和多时相电影回放，离屏渲染后把各阶段耗时以JSON输出到标准输出 (或 --output 指定的文件)，供CI和渲染节点跟踪性能回归。
+//
+// 用法: dicombench [--columns N] [--rows N] [--slices N] [--bits 8|12|16] [--dir 路径] [--keep]
+//                  [--samples N] [--frames N] [--size N] [--threads N] [--hardware] [--output 文件]
+//                  [--trace 文件] [--rle] [--phases N]
+
+#include "syntheticdicom.h"
+#include "paralleldicomreader.h"
+#include "dicomcodec.h"
+#include "seriesindexcache.h"
+#include "sliceextractor.h"
+#include "chunkedvolume.h"
+#include "windowlevel.h"
+#include "obliqueslicer.h"
+#include "slabprojector.h"
+#include "memoryfootprint.h"
+#include "cpuraycaster.h"
+#include "isosurfaceextractor.h"
+#include "bodycrop.h"
+#include "volumepreset.h"
+#include "tracer.h"
+
+#include <vtkActor.h>
+#include <vtkCamera.h>
+#include <vtkColorTransferFunction.h>
+#include <vtkImageActor.h>
+#include <vtkImageMapToWindowLevelColors.h>
+#include <vtkImageMapper3D.h>
+#include <vtkImageReslice.h>
+#include <vtkMatrix4x4.h>
+#include <vtkOutputWindow.h>
+#include <vtkPiecewiseFunction.h>
+#include <vtkPolyDataMapper.h>
+#include <vtkProperty.h>
+#include <vtkRenderWindow.h>
+#include <vtkRenderer.h>
+#include <vtkSmartVolumeMapper.h>
+#include <vtkVolume.h>
+#include <vtkVolumeProperty.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// 与 MainWindow 中的方向常量一致
+const int AXIAL_ORIENTATION = 2;
+const int SAGITTAL_ORIENTATION = 0;
+const int CORONAL_ORIENTATION = 1;
+
+const double ISOSURFACE_THRESHOLD = 200.0; // 体模中的骨骼为 300-900 HU
+const int CINE_FRAME_RATE = 20;            // 与 CinePlayer::DEFAULT_FRAME_RATE 一致
+
+struct Options {
+    SyntheticSeriesOptions series;
+    std::string dir;
+    bool keep = false;
+    int samples = 64;   // 每个方向切换切片的次数
+    int frames = 60;    // 体绘制帧数
+    int size = 512;     // 离屏窗口边长
+    int threads = 0;
+    bool hardware = false;
+    std::string output;
+    std::string trace;  // 同时导出 Chrome trace
+    int phases = 12;    // 电影回放测试的时相数，每个时相为主序列的 1/4 层
+};
+
+using Clock = std::chrono::steady_clock;
+
+double elapsedMs(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+struct Stats {
+    double mean = 0.0, p50 = 0.0, p95 = 0.0, max = 0.0;
+};
+
+Stats summarize(std::vector<double> samples) {
+    Stats s;
+    if (samples.empty()) {
+        return s;
+    }
+    std::sort(samples.begin(), samples.end());
+    for (double v : samples) {
+        s.mean += v;
+    }
+    s.mean /= samples.size();
+    s.p50 = samples[samples.size() / 2];
+    s.p95 = samples[std::min(samples.size() - 1, samples.size() * 95 / 100)];
+    s.max = samples.back();
+    return s;
+}
+
+std::string statsJson(const Stats &s) {
+    std::ostringstream out;
+    out << "{\"mean_ms\": " << s.mean << ", \"p50_ms\": " << s.p50
+        << ", \"p95_ms\": " << s.p95 << ", \"max_ms\": " << s.max << "}";
+    return out.str();
+}
+
+// 手工构造的 2x2、8 位无损JPEG：DC 表 0 只有一个 1 位的码 (差值类别 0)，四个样本都等于初始预测值 128；
+// 其后是同号的 AC 表 (Tc=1)，码对应类别 5。无损扫描只引用DC表，AC表若覆盖了DC表就会解出非零差值
+bool checkJpegAcTableIgnored() {
+    const unsigned char jpeg[] = {
+        0xFF, 0xD8,
+        0xFF, 0xC3, 0x00, 0x0B, 0x08, 0x00, 0x02, 0x00, 0x02, 0x01, 0x01, 0x11, 0x00,  // SOF3
+        0xFF, 0xC4, 0x00, 0x14, 0x00, 0x01, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x00,  // DHT DC 0
+        0xFF, 0xC4, 0x00, 0x14, 0x10, 0x01, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x05,  // DHT AC 0
+        0xFF, 0xDA, 0x00, 0x08, 0x01, 0x01, 0x00, 0x01, 0x00, 0x00,  // SOS，预测器 1
+        0x0F,  // 四个 "0" 码，其余位按规定填 1
+        0xFF, 0xD9,
+    };
+    PixelLayout layout;
+    layout.rows = 2;
+    layout.columns = 2;
+    layout.bitsAllocated = 8;
+    unsigned char out[4] = {0, 0, 0, 0};
+    try {
+        decodeJPEGLossless(reinterpret_cast<const char *>(jpeg), sizeof(jpeg), layout, reinterpret_cast<char *>(out));
+    } catch (const std::exception &) {
+        return false;
+    }
+    return std::all_of(out, out + 4, [](unsigned char v) { return v == 128; });
+}
+
+std::string jsonString(const std::string &value) {
+    std::string out = "\"";
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            out.push_back('\\');
+        }
+        out.push_back(c);
+    }
+    return out + "\"";
+}
+
+bool parseArguments(int argc, char *argv[], Options &options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto next = [&]() -> const char * { return i + 1 < argc ? argv[++i] : nullptr; };
+        auto nextInt = [&](int &value) {
+            const char *v = next();
+            if (v) value = std::atoi(v);
+            return v != nullptr;
+        };
+        bool ok = true;
+        if (arg == "--columns") ok = nextInt(options.series.columns);
+        else if (arg == "--rows") ok = nextInt(options.series.rows);
+        else if (arg == "--slices") ok = nextInt(options.series.slices);
+        else if (arg == "--bits") ok = nextInt(options.series.bitsStored);
+        else if (arg == "--samples") ok = nextInt(options.samples);
+        else if (arg == "--frames") ok = nextInt(options.frames);
+        else if (arg == "--size") ok = nextInt(options.size);
+        else if (arg == "--threads") ok = nextInt(options.threads);
+        else if (arg == "--phases") ok = nextInt(options.phases);
+        else if (arg == "--keep") options.keep = true;
+        else if (arg == "--hardware") options.hardware = true;
+        else if (arg == "--rle") options.series.rle = true;
+        else if (arg == "--dir") { const char *v = next(); ok = v; if (v) options.dir = v; }
+        else if (arg == "--output") { const char *v = next(); ok = v; if (v) options.output = v; }
+        else if (arg == "--trace") { const char *v = next(); ok = v; if (v) options.trace = v; }
+        else ok = false;
+        if (!ok) {
+            std::cerr << "无效参数: " << arg << std::endl;
+            return false;
+        }
+    }
+    options.series.threadCount = options.threads;
+    options.samples = std::max(1, options.samples);
+    options.frames = std::max(1, options.frames);
+    options.phases = std::max(2, options.phases);
+    return true;
+}
+
+// 与 MainWindow::setupReslice 相同的切片方向矩阵
+void setupReslice(vtkImageReslice *reslice, int orientation) {
+    static const double sagittal[16] = {0, 0, 1, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 1};
+    static const double coronal[16] = {1, 0, 0, 0, 0, 0, 1, 0, 0, 1, 0, 0, 0, 0, 0, 1};
+    vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    if (orientation == SAGITTAL_ORIENTATION) {
+        matrix->DeepCopy(sagittal);
+    } else if (orientation == CORONAL_ORIENTATION) {
+        matrix->DeepCopy(coronal);
+    }
+    reslice->SetOutputDimensionality(2);
+    reslice->SetInterpolationModeToLinear();
+    reslice->SetResliceAxes(matrix);
+}
+
+void setReslicePosition(vtkImageReslice *reslice, vtkImageData *image, int slice, int orientation) {
+    vtkMatrix4x4 *axes = reslice->GetResliceAxes();
+    axes->SetElement(orientation, 3, image->GetOrigin()[orientation] + image->GetSpacing()[orientation] * slice);
+    reslice->SetResliceAxes(axes);
+    reslice->Modified();
+}
+
+// 轴状面绕体数据中心、绕 Y 轴倾斜 degrees 度，平移方式与 MainWindow::setReslicePosition 的倾斜分支相同
+void setObliqueAxes(vtkMatrix4x4 *axes, vtkImageData *image, double degrees, double center[2]) {
+    double c[3];
+    for (int k = 0; k < 3; ++k) {
+        c[k] = image->GetOrigin()[k] + image->GetSpacing()[k] * (image->GetDimensions()[k] - 1) / 2.0;
+    }
+    const double a = degrees * 3.14159265358979323846 / 180.0;
+    const double r[3][3] = {{std::cos(a), 0.0, std::sin(a)}, {0.0, 1.0, 0.0}, {-std::sin(a), 0.0, std::cos(a)}};
+    center[0] = c[0];
+    center[1] = c[1];
+    axes->Identity();
+    for (int row = 0; row < 3; ++row) {
+        for (int col = 0; col < 3; ++col) {
+            axes->SetElement(row, col, r[row][col]);
+        }
+        axes->SetElement(row, 3, c[row] - r[row][0] * center[0] - r[row][1] * center[1]);
+    }
+    axes->Modified();
+}
+
+vtkSmartPointer<vtkRenderWindow> createOffscreenWindow(int size, vtkRenderer *renderer) {
+    vtkSmartPointer<vtkRenderWindow> window = vtkSmartPointer<vtkRenderWindow>::New();
+    window->SetOffScreenRendering(1);
+    window->SetSize(size, size);
+    window->AddRenderer(renderer);
+    renderer->SetBackground(0.1, 0.2, 0.4);
+    return window;
+}
+
+// ReportCapabilities 中的 "OpenGL renderer string" 一行，用于确认是否为软件渲染
+std::string glRendererName(vtkRenderWindow *window) {
+    const char *report = window->ReportCapabilities();
+    if (!report) {
+        return std::string();
+    }
+    const std::string text = report;
+    const std::string key = "OpenGL renderer string:";
+    const size_t begin = text.find(key);
+    if (begin == std::string::npos) {
+        return std::string();
+    }
+    const size_t end = text.find('\n', begin);
+    std::string name = text.substr(begin + key.size(), end == std::string::npos ? std::string::npos : end - begin - key.size());
+    name.erase(0, name.find_first_not_of(' '));
+    return name;
+}
+
+// 一次切片切换：更新切片输入并渲染一帧，返回每次切换的耗时
+template <typename ChangeSlice>
+std::vector<double> measureSliceChanges(int sliceCount, int samples, vtkRenderWindow *window, ChangeSlice &&changeSlice) {
+    std::vector<double> times;
+    times.reserve(samples);
+    changeSlice(0); // 预热，不计时
+    window->Render();
+    for (int k = 0; k < samples; ++k) {
+        const int slice = samples > 1 ? k * (sliceCount - 1) / (samples - 1) : 0;
+        const Clock::time_point start = Clock::now();
+        changeSlice(slice);
+        window->Render();
+        times.push_back(elapsedMs(start));
+    }
+    return times;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    Options options;
+    if (!parseArguments(argc, argv, options)) {
+        return 2;
+    }
+    vtkOutputWindow::SetGlobalWarningDisplay(0);
+    if (!options.trace.empty()) {
+        Tracer::instance().setThreadName("main");
+        Tracer::instance().setEnabled(true);
+    }
+
+    // 默认使用软件OpenGL，保证不同节点上的结果可比
+    if (!options.hardware) {
+#ifdef _WIN32
+        _putenv_s("LIBGL_ALWAYS_SOFTWARE", "1");
+#else
+        setenv("LIBGL_ALWAYS_SOFTWARE", "1", 1);
+#endif
+    }
+
+    const bool temporaryDir = options.dir.empty();
+    if (temporaryDir) {
+        options.dir = (std::filesystem::temp_directory_path() / ("dicombench_" + std::to_string(
+            Clock::now().time_since_epoch().count()))).u8string();
+    }
+
+    // --- 生成合成序列 ---
+    Clock::time_point start = Clock::now();
+    std::string error;
+    if (!writeSyntheticSeries(options.dir, options.series, &error)) {
+        std::cerr << "生成合成序列失败: " << error << std::endl;
+        return 1;
+    }
+    const double generateMs = elapsedMs(start);
+
+    // --- 加载：与 DicomLoader 相同的并行读取器 ---
+    start = Clock::now();
+    ParallelDICOMReader reader;
+    reader.setThreadCount(options.threads);
+    vtkSmartPointer<vtkImageData> image;
+    if (reader.scanDirectory(options.dir)) {
+        image = reader.readVolume();
+    }
+    const double loadMs = elapsedMs(start);
+    if (!image) {
+        std::cerr << "读取失败: " << reader.errorMessage() << std::endl;
+        return 1;
+    }
+    int dims[3];
+    image->GetDimensions(dims);
+    // 灰度范围：解码时统计的直方图与 VTK 扫描整个体数据对比
+    start = Clock::now();
+    double range[2];
+    image->GetScalarRange(range);
+    const double scanRangeMs = elapsedMs(start);
+    const VolumeHistogram &histogram = reader.histogram();
+    double autoWindow = 0.0, autoLevel = 0.0;
+    histogram.windowLevel(0.005, 0.995, autoWindow, autoLevel);
+    const bool histogramRangeMatches = histogram.minimum() == range[0] && histogram.maximum() == range[1];
+    const int64_t volumeBytes = MemoryFootprint::imageBytes(image);
+    const int64_t loadPeakBytes = MemoryFootprint::peakResidentBytes(); // 读取完成时的峰值，离屏渲染之前
+
+    // --- 切片切换：vtkImageReslice 管线与轴对齐快速路径 (提取 + SIMD 窗宽窗位) ---
+    const double window = 400.0, level = 40.0; // 软组织窗
+    const int orientations[3] = {AXIAL_ORIENTATION, SAGITTAL_ORIENTATION, CORONAL_ORIENTATION};
+    const char *names[3] = {"axial", "sagittal", "coronal"};
+    std::string sliceJson;
+    for (int i = 0; i < 3; ++i) {
+        const int orientation = orientations[i];
+        vtkSmartPointer<vtkRenderer> renderer = vtkSmartPointer<vtkRenderer>::New();
+        vtkSmartPointer<vtkRenderWindow> renderWindow = createOffscreenWindow(options.size, renderer);
+        vtkSmartPointer<vtkImageActor> actor = vtkSmartPointer<vtkImageActor>::New();
+        renderer->AddActor(actor);
+        renderer->GetActiveCamera()->ParallelProjectionOn();
+
+        vtkSmartPointer<vtkImageReslice> reslice = vtkSmartPointer<vtkImageReslice>::New();
+        setupReslice(reslice, orientation);
+        reslice->SetInputData(image);
+        vtkSmartPointer<vtkImageMapToWindowLevelColors> wl = vtkSmartPointer<vtkImageMapToWindowLevelColors>::New();
+        wl->SetWindow(window);
+        wl->SetLevel(level);
+        wl->SetInputConnection(reslice->GetOutputPort());
+        actor->GetMapper()->SetInputConnection(wl->GetOutputPort());
+        setReslicePosition(reslice, image, 0, orientation);
+        wl->Update();
+        renderer->ResetCamera();
+
+        const Stats resliceStats = summarize(measureSliceChanges(dims[orientation], options.samples, renderWindow,
+            [&](int slice) {
+                setReslicePosition(reslice, image, slice, orientation);
+            }));
+
+        SliceExtractor extractor;
+        extractor.setInput(image);
+        actor->SetInputData(mapWindowLevelToRGBA(extractor.extract(orientation, 0), window, level));
+        renderer->ResetCamera(); // 快速路径的输出原点与 vtkImageReslice 不同
+        const Stats fastStats = summarize(measureSliceChanges(dims[orientation], options.samples, renderWindow,
+            [&](int slice) {
+                actor->SetInputData(mapWindowLevelToRGBA(extractor.extract(orientation, slice), window, level));
+            }));
+
+        sliceJson += std::string(i ? ",\n" : "") + "    " + jsonString(names[i]) + ": {\"reslice\": "
+            + statsJson(resliceStats) + ", \"fast\": " + statsJson(fastStats) + "}";
+    }
+
+    // --- 厚层投影：100 层平板逐层滚动；MIP 每次重新归约，平均模式只加减移入和移出的一层 ---
+    std::string slabJson;
+    for (int i = 0; i < 3; ++i) {
+        const int orientation = orientations[i];
+        vtkSmartPointer<vtkRenderer> renderer = vtkSmartPointer<vtkRenderer>::New();
+        vtkSmartPointer<vtkRenderWindow> renderWindow = createOffscreenWindow(options.size, renderer);
+        vtkSmartPointer<vtkImageActor> actor = vtkSmartPointer<vtkImageActor>::New();
+        renderer->AddActor(actor);
+        renderer->GetActiveCamera()->ParallelProjectionOn();
+
+        const int thickness = std::min(100, dims[orientation]);
+        const int steps = std::max(1, std::min(options.samples, dims[orientation] - thickness + 1));
+        SlabProjector projector;
+        projector.setInput(image);
+        auto measureSlab = [&](SlabProjector::Mode mode) {
+            actor->SetInputData(mapWindowLevelToRGBA(projector.project(orientation, thickness / 2, thickness, mode),
+                                                     window, level));
+            renderer->ResetCamera();
+            return summarize(measureSliceChanges(steps, steps, renderWindow, [&](int step) {
+                vtkImageData *slab = projector.project(orientation, thickness / 2 + step, thickness, mode);
+                actor->SetInputData(mapWindowLevelToRGBA(slab, window, level));
+            }));
+        };
+        const Stats maxStats = measureSlab(SlabProjector::Maximum);
+        const Stats meanStats = measureSlab(SlabProjector::Mean);
+        slabJson += std::string(i ? ",\n" : "") + "    " + jsonString(names[i]) + ": {\"thickness\": "
+            + std::to_string(thickness) + ", \"mip\": " + statsJson(maxStats) + ", \"mean\": "
+            + statsJson(meanStats) + "}";
+    }
+
+    // --- 倾斜平面旋转：vtkImageReslice 与多线程重采样 (全分辨率 / 拖动时的半分辨率预览) ---
+    // 每次切换把轴状面的倾斜角增加一点，对应拖动旋转时的连续帧
+    std::string obliqueJson;
+    {
+        vtkSmartPointer<vtkRenderer> renderer = vtkSmartPointer<vtkRenderer>::New();
+        vtkSmartPointer<vtkRenderWindow> renderWindow = createOffscreenWindow(options.size, renderer);
+        vtkSmartPointer<vtkImageActor> actor = vtkSmartPointer<vtkImageActor>::New();
+        renderer->AddActor(actor);
+        renderer->GetActiveCamera()->ParallelProjectionOn();
+        const int steps = 90;
+        double center[2];
+
+        vtkSmartPointer<vtkImageReslice> reslice = vtkSmartPointer<vtkImageReslice>::New();
+        setupReslice(reslice, AXIAL_ORIENTATION);
+        reslice->SetInputData(image);
+        vtkSmartPointer<vtkImageMapToWindowLevelColors> wl = vtkSmartPointer<vtkImageMapToWindowLevelColors>::New();
+        wl->SetWindow(window);
+        wl->SetLevel(level);
+        wl->SetInputConnection(reslice->GetOutputPort());
+        actor->GetMapper()->SetInputConnection(wl->GetOutputPort());
+        setObliqueAxes(reslice->GetResliceAxes(), image, 1.0, center);
+        wl->Update();
+        renderer->ResetCamera();
+        const Stats resliceStats = summarize(measureSliceChanges(steps, options.samples, renderWindow,
+            [&](int step) {
+                setObliqueAxes(reslice->GetResliceAxes(), image, 1.0 + step, center);
+                reslice->Modified();
+            }));
+
+        ObliqueSlicer slicer;
+        slicer.setInput(image);
+        auto measureSlicer = [&](int resolutionStep) {
+            vtkSmartPointer<vtkMatrix4x4> axes = vtkSmartPointer<vtkMatrix4x4>::New();
+            setObliqueAxes(axes, image, 1.0, center);
+            actor->SetInputData(mapWindowLevelToRGBA(slicer.reslice(axes, center, resolutionStep), window, level));
+            renderer->ResetCamera();
+            return summarize(measureSliceChanges(steps, options.samples, renderWindow, [&](int step) {
+                setObliqueAxes(axes, image, 1.0 + step, center);
+                actor->SetInputData(mapWindowLevelToRGBA(slicer.reslice(axes, center, resolutionStep), window, level));
+            }));
+        };
+        const Stats fullStats = measureSlicer(1);
+        const Stats previewStats = measureSlicer(2);
+        obliqueJson = "{\"reslice\": " + statsJson(resliceStats) + ", \"full\": " + statsJson(fullStats)
+            + ", \"preview\": " + statsJson(previewStats) + "}";
+    }
+
+    // --- 体绘制：旋转相机连续渲染 ---
+    vtkSmartPointer<vtkRenderer> renderer = vtkSmartPointer<vtkRenderer>::New();
+    vtkSmartPointer<vtkRenderWindow> renderWindow = createOffscreenWindow(options.size, renderer);
+    vtkSmartPointer<vtkSmartVolumeMapper> mapper = vtkSmartPointer<vtkSmartVolumeMapper>::New();
+    mapper->SetBlendModeToComposite();
+    mapper->SetUseJittering(1);
+    mapper->SetSampleDistance(0.5);
+    mapper->SetInputData(image);
+    vtkSmartPointer<vtkVolumeProperty> property = vtkSmartPointer<vtkVolumeProperty>::New();
+    setupDefaultVolumeProperty(property, vtkSmartPointer<vtkColorTransferFunction>::New(),
+                               vtkSmartPointer<vtkPiecewiseFunction>::New());
+    vtkSmartPointer<vtkVolume> volume = vtkSmartPointer<vtkVolume>::New();
+    volume->SetMapper(mapper);
+    volume->SetProperty(property);
+    renderer->AddVolume(volume);
+    renderer->ResetCamera();
+    renderer->GetActiveCamera()->Zoom(1.5);
+
+    start = Clock::now();
+    renderWindow->Render(); // 首帧包含体数据上传
+    const double firstFrameMs = elapsedMs(start);
+    std::vector<double> frameTimes;
+    frameTimes.reserve(options.frames);
+    start = Clock::now();
+    for (int f = 0; f < options.frames; ++f) {
+        const Clock::time_point frameStart = Clock::now();
+        renderer->GetActiveCamera()->Azimuth(360.0 / options.frames);
+        renderWindow->Render();
+        frameTimes.push_back(elapsedMs(frameStart));
+    }
+    const double totalFrameMs = elapsedMs(start);
+    const Stats frameStats = summarize(frameTimes);
+    const std::string glRenderer = glRendererName(renderWindow);
+
+    // --- 自动裁剪：裁掉体外空气和检查床后，沿同样的相机轨迹再渲染一圈 ---
+    start = Clock::now();
+    BodyCropOptions cropOptions;
+    cropOptions.threadCount = options.threads;
+    int cropExtent[6] = {0, dims[0] - 1, 0, dims[1] - 1, 0, dims[2] - 1};
+    bool tableRemoved = false;
+    vtkSmartPointer<vtkImageData> cropped = findBodyExtent(image, cropOptions, cropExtent, &tableRemoved)
+        ? cropVolume(image, cropExtent, options.threads) : image;
+    const double cropMs = elapsedMs(start);
+    mapper->SetInputData(cropped);
+    renderWindow->Render(); // 重新上传体数据，不计入
+    std::vector<double> croppedFrameTimes;
+    for (int f = 0; f < options.frames; ++f) {
+        const Clock::time_point frameStart = Clock::now();
+        renderer->GetActiveCamera()->Azimuth(360.0 / options.frames);
+        renderWindow->Render();
+        croppedFrameTimes.push_back(elapsedMs(frameStart));
+    }
+    const Stats croppedFrameStats = summarize(croppedFrameTimes);
+    const int64_t croppedBytes = MemoryFootprint::imageBytes(cropped);
+    mapper->SetInputData(image);
+    cropped = nullptr;
+
+    // --- CPU 光线投射：同样的传输函数和相机轨迹，比较空域跳跃开/关 ---
+    const int cpuFrames = std::max(1, options.frames / 6);
+    CpuRaycaster raycaster;
+    raycaster.setInput(image);
+    raycaster.setProperty(property);
+    raycaster.setSampleDistance(0.5);
+    raycaster.setThreadCount(options.threads);
+    auto measureRaycast = [&](bool skipping, int64_t *samples) {
+        raycaster.setEmptySpaceSkipping(skipping);
+        std::vector<double> times;
+        *samples = 0;
+        for (int f = 0; f < cpuFrames; ++f) {
+            renderer->GetActiveCamera()->Azimuth(360.0 / cpuFrames);
+            const Clock::time_point frameStart = Clock::now();
+            raycaster.render(CpuRaycaster::viewFromCamera(renderer->GetActiveCamera()), options.size, options.size);
+            times.push_back(elapsedMs(frameStart));
+            *samples += raycaster.statistics().samples;
+        }
+        return summarize(times);
+    };
+    raycaster.render(CpuRaycaster::viewFromCamera(renderer->GetActiveCamera()), options.size, options.size); // 首帧构建分块最小/最大值，不计入
+    int64_t skipSamples = 0, fullSamples = 0;
+    const Stats skipStats = measureRaycast(true, &skipSamples);
+    const Stats fullStats = measureRaycast(false, &fullSamples);
+
+    // --- 等值面：多线程提取并抽取到默认预算，与单线程提取比较；网格代替体数据沿同样的相机轨迹渲染 ---
+    IsosurfaceExtractor isoExtractor;
+    isoExtractor.setThreadCount(1);
+    IsosurfaceExtractor::Statistics serialIso;
+    isoExtractor.extract(image, ISOSURFACE_THRESHOLD, &serialIso);
+    isoExtractor.setThreadCount(options.threads);
+    IsosurfaceExtractor::Statistics parallelIso;
+    vtkSmartPointer<vtkPolyData> mesh = isoExtractor.extract(image, ISOSURFACE_THRESHOLD, &parallelIso);
+    vtkSmartPointer<vtkPolyDataMapper> meshMapper = vtkSmartPointer<vtkPolyDataMapper>::New();
+    meshMapper->SetInputData(mesh);
+    meshMapper->ScalarVisibilityOff();
+    vtkSmartPointer<vtkActor> meshActor = vtkSmartPointer<vtkActor>::New();
+    meshActor->SetMapper(meshMapper);
+    meshActor->GetProperty()->SetColor(property->GetRGBTransferFunction()->GetColor(ISOSURFACE_THRESHOLD));
+    volume->SetVisibility(0);
+    renderer->AddActor(meshActor);
+    renderWindow->Render(); // 首帧上传网格，不计入
+    std::vector<double> meshFrameTimes;
+    start = Clock::now();
+    for (int f = 0; f < options.frames; ++f) {
+        const Clock::time_point frameStart = Clock::now();
+        renderer->GetActiveCamera()->Azimuth(360.0 / options.frames);
+        renderWindow->Render();
+        meshFrameTimes.push_back(elapsedMs(frameStart));
+    }
+    const double totalMeshMs = elapsedMs(start);
+    const Stats meshFrameStats = summarize(meshFrameTimes);
+    auto isoJson = [](const IsosurfaceExtractor::Statistics &s) {
+        std::ostringstream out;
+        out << "{\"extract_ms\": " << s.extractMs << ", \"decimate_ms\": " << s.decimateMs
+            << ", \"merge_ms\": " << s.mergeMs << ", \"slabs\": " << s.slabs << "}";
+        return out.str();
+    };
+
+    // --- 核外模式：流式构建分块存储，再用很小的块缓存经 SliceExtractor 切换切片 ---
+    // cold 每次先清空块缓存 (每层都要读一排块)，scroll 逐层滚动 (同一排块内的后续切片命中缓存)
+    const std::string storePath = options.dir + ".chunks";
+    ChunkedVolume::BuildOptions chunkOptions;
+    chunkOptions.fingerprint = directoryFingerprint(options.dir);
+    chunkOptions.threadCount = options.threads;
+    ParallelDICOMReader chunkReader;
+    chunkReader.setThreadCount(options.threads);
+    start = Clock::now();
+    const bool built = chunkReader.scanDirectory(options.dir)
+        && ChunkedVolume::build(chunkReader, storePath, chunkOptions, &error);
+    const double chunkBuildMs = elapsedMs(start);
+    std::shared_ptr<ChunkedVolume> store = built ? ChunkedVolume::open(storePath, chunkOptions.fingerprint, &error) : nullptr;
+    if (!store) {
+        std::cerr << "构建核外分块存储失败: " << error << std::endl;
+        return 1;
+    }
+    store->setThreadCount(options.threads);
+    // 块缓存只放得下两个最大切片平面所需的块
+    int chunkCounts[3];
+    for (int k = 0; k < 3; ++k) {
+        chunkCounts[k] = (dims[k] + ChunkedVolume::CHUNK_SIZE - 1) / ChunkedVolume::CHUNK_SIZE;
+    }
+    const int64_t planeChunks = std::max({chunkCounts[0] * chunkCounts[1], chunkCounts[0] * chunkCounts[2],
+                                          chunkCounts[1] * chunkCounts[2]});
+    const int64_t chunkCacheBytes = 2 * planeChunks * static_cast<int64_t>(store->elementBytes())
+        << (3 * ChunkedVolume::CHUNK_SHIFT);
+    store->setCacheBudget(chunkCacheBytes);
+    std::string outOfCoreJson;
+    for (int i = 0; i < 3; ++i) {
+        const int orientation = orientations[i];
+        SliceExtractor extractor;
+        extractor.setInput(image);
+        extractor.setChunkedVolume(store);
+        const int count = std::min(options.samples, dims[orientation]);
+        std::vector<double> cold, scroll;
+        for (int k = 0; k < count; ++k) {
+            store->setCacheBudget(0);
+            store->setCacheBudget(chunkCacheBytes);
+            const Clock::time_point sliceStart = Clock::now();
+            extractor.extract(orientation, static_cast<int>(static_cast<int64_t>(dims[orientation] - 1) * k / std::max(1, count - 1)));
+            cold.push_back(elapsedMs(sliceStart));
+        }
+        const int64_t readsBefore = store->statistics().chunkReads;
+        for (int k = 0; k < count; ++k) {
+            const Clock::time_point sliceStart = Clock::now();
+            extractor.extract(orientation, k);
+            scroll.push_back(elapsedMs(sliceStart));
+        }
+        outOfCoreJson += std::string(i ? ",\n" : "") + "      " + jsonString(names[i]) + ": {\"cold\": "
+            + statsJson(summarize(cold)) + ", \"scroll\": " + statsJson(summarize(scroll))
+            + ", \"scroll_chunk_reads\": " + std::to_string(store->statistics().chunkReads - readsBefore) + "}";
+    }
+    const int residentLevel = store->finestLevelWithin(volumeBytes / 8); // 相当于预算为体数据的 1/4，一半给驻留层
+    start = Clock::now();
+    vtkSmartPointer<vtkImageData> resident = store->readLevel(residentLevel);
+    const double residentReadMs = elapsedMs(start);
+    const int64_t residentBytes = MemoryFootprint::imageBytes(resident);
+    const int64_t storeBytes = store->fileBytes();
+    const int storeLevels = store->levels();
+    resident = nullptr;
+    store.reset();
+    {
+        std::error_code ec;
+        std::filesystem::remove(std::filesystem::u8path(storePath), ec);
+    }
+
+    // --- 多时相电影回放：写出 1/4 层数的多时相体模，检查读取器的时相分组并逐时相读入 ---
+    // 每帧按 CinePlayer 的方式准备三个方向的中间层 (提取 + 窗宽窗位)，再换上该时相的体数据渲染；
+    // 回放时准备在后台线程进行，准备或换帧任一超出帧间隔时该帧来不及显示，记为丢帧
+    const std::string cineDir = options.dir + "_cine";
+    SyntheticSeriesOptions cineOptions = options.series;
+    cineOptions.slices = std::max(2, options.series.slices / 4);
+    cineOptions.phases = options.phases;
+    if (!writeSyntheticSeries(cineDir, cineOptions, &error)) {
+        std::cerr << "生成多时相序列失败: " << error << std::endl;
+        return 1;
+    }
+    ParallelDICOMReader cineReader;
+    cineReader.setThreadCount(options.threads);
+    std::vector<vtkSmartPointer<vtkImageData>> phaseVolumes;
+    start = Clock::now();
+    if (cineReader.scanDirectory(cineDir)) {
+        for (int phase = 0; phase < cineReader.phaseCount(); ++phase) {
+            vtkSmartPointer<vtkImageData> phaseImage = cineReader.selectPhase(phase) ? cineReader.readVolume() : nullptr;
+            if (!phaseImage) {
+                break;
+            }
+            phaseVolumes.push_back(phaseImage);
+        }
+    }
+    const double cineLoadMs = elapsedMs(start);
+    if (phaseVolumes.empty() || static_cast<int>(phaseVolumes.size()) != cineReader.phaseCount()) {
+        std::cerr << "读取多时相序列失败: " << cineReader.errorMessage() << std::endl;
+        return 1;
+    }
+    const int cinePhases = static_cast<int>(phaseVolumes.size());
+    int cineDims[3];
+    phaseVolumes[0]->GetDimensions(cineDims);
+    const bool phasesGrouped = cinePhases == cineOptions.phases && cineDims[2] == cineOptions.slices;
+    const double firstTriggerMs = cineReader.phaseTriggerTime(0);
+    const double lastTriggerMs = cineReader.phaseTriggerTime(cinePhases - 1);
+
+    vtkSmartPointer<vtkRenderer> cineRenderer = vtkSmartPointer<vtkRenderer>::New();
+    vtkSmartPointer<vtkRenderWindow> cineWindow = createOffscreenWindow(options.size, cineRenderer);
+    vtkSmartPointer<vtkSmartVolumeMapper> cineMapper = vtkSmartPointer<vtkSmartVolumeMapper>::New();
+    cineMapper->SetBlendModeToComposite();
+    cineMapper->SetSampleDistance(0.5);
+    cineMapper->SetInputData(phaseVolumes[0]);
+    vtkSmartPointer<vtkVolume> cineVolume = vtkSmartPointer<vtkVolume>::New();
+    cineVolume->SetMapper(cineMapper);
+    cineVolume->SetProperty(property);
+    cineRenderer->AddVolume(cineVolume);
+    cineRenderer->ResetCamera();
+    cineRenderer->GetActiveCamera()->Zoom(1.5);
+    cineWindow->Render(); // 首帧上传第一个时相，不计入
+
+    const double frameBudgetMs = 1000.0 / CINE_FRAME_RATE;
+    const int cineFrames = 2 * cinePhases; // 回放两个周期
+    SliceExtractor cineExtractors[3];
+    std::vector<double> prepareTimes, presentTimes;
+    int droppedFrames = 0;
+    for (int f = 1; f <= cineFrames; ++f) {
+        vtkImageData *phaseImage = phaseVolumes[f % cinePhases];
+        Clock::time_point frameStart = Clock::now();
+        vtkSmartPointer<vtkImageData> prepared[3];
+        for (int o = 0; o < 3; ++o) {
+            cineExtractors[o].setInput(phaseImage);
+            prepared[o] = mapWindowLevelToRGBA(cineExtractors[o].extract(o, cineDims[o] / 2), window, level);
+        }
+        const double prepareMs = elapsedMs(frameStart);
+        frameStart = Clock::now();
+        cineMapper->SetInputData(phaseImage);
+        cineWindow->Render();
+        const double presentMs = elapsedMs(frameStart);
+        prepareTimes.push_back(prepareMs);
+        presentTimes.push_back(presentMs);
+        if (prepareMs > frameBudgetMs || presentMs > frameBudgetMs) {
+            ++droppedFrames;
+        }
+    }
+    const int64_t phaseBytes = MemoryFootprint::imageBytes(phaseVolumes[0]);
+    phaseVolumes.clear();
+
+    if (!options.keep) {
+        std::error_code ec;
+        std::filesystem::remove_all(std::filesystem::u8path(cineDir), ec);
+    }
+    if (temporaryDir && !options.keep) {
+        std::error_code ec;
+        std::filesystem::remove_all(std::filesystem::u8path(options.dir), ec);
+    }
+
+    if (!options.trace.empty() && !Tracer::instance().writeChromeTrace(options.trace, &error)) {
+        std::cerr << error << std::endl;
+    }
+
+    const bool jpegAcTableIgnored = checkJpegAcTableIgnored();
+
+    // --- 输出 ---
+    std::ostringstream json;
+    json << "{\n"
+         << "  \"series\": {\"columns\": " << options.series.columns << ", \"rows\": " << options.series.rows
+         << ", \"slices\": " << options.series.slices << ", \"bits_stored\": " << options.series.bitsStored
+         << ", \"rle\": " << (options.series.rle ? "true" : "false")
+         << ", \"scalar_range\": [" << range[0] << ", " << range[1] << "]},\n"
+         << "  \"threads\": " << reader.threadCount() << ",\n"
+         << "  \"software_gl\": " << (options.hardware ? "false" : "true") << ",\n"
+         << "  \"generate_ms\": " << generateMs << ",\n"
+         << "  \"load\": {\"total_ms\": " << loadMs << ", \"header_ms\": " << reader.headerSeconds() * 1000.0
+         << ", \"decode_ms\": " << reader.decodeSeconds() * 1000.0 << "},\n"
+         << "  \"codec\": {\"jpeg_ac_table_ignored\": " << (jpegAcTableIgnored ? "true" : "false") << "},\n"
+         << "  \"histogram\": {\"scan_range_ms\": " << scanRangeMs << ", \"range_matches\": "
+         << (histogramRangeMatches ? "true" : "false") << ", \"voxels\": " << histogram.total()
+         << ", \"auto_window\": " << autoWindow << ", \"auto_level\": " << autoLevel << "},\n"
+         << "  \"memory\": {\"volume_bytes\": " << volumeBytes << ", \"load_peak_bytes\": " << loadPeakBytes
+         << ", \"peak_bytes\": " << MemoryFootprint::peakResidentBytes() << "},\n"
+         << "  \"slice_change\": {\n" << sliceJson << "\n  },\n"
+         << "  \"slab_scroll\": {\n" << slabJson << "\n  },\n"
+         << "  \"oblique_rotation\": " << obliqueJson << ",\n"
+         << "  \"volume\": {\"first_frame_ms\": " << firstFrameMs << ", \"frames\": " << options.frames
+         << ", \"fps\": " << (totalFrameMs > 0.0 ? options.frames * 1000.0 / totalFrameMs : 0.0)
+         << ", \"frame\": " << statsJson(frameStats)
+         << ", \"gl_renderer\": " << jsonString(glRenderer)
+         << "},\n"
+         << "  \"body_crop\": {\"ms\": " << cropMs << ", \"extent\": [" << cropExtent[0] << ", " << cropExtent[1]
+         << ", " << cropExtent[2] << ", " << cropExtent[3] << ", " << cropExtent[4] << ", " << cropExtent[5] << "]"
+         << ", \"table_removed\": " << (tableRemoved ? "true" : "false")
+         << ", \"bytes\": [" << volumeBytes << ", " << croppedBytes << "]"
+         << ", \"frame\": " << statsJson(croppedFrameStats)
+         << ", \"render_speedup\": " << (croppedFrameStats.mean > 0.0 ? frameStats.mean / croppedFrameStats.mean : 0.0)
+         << "},\n"
+         << "  \"cpu_raycast\": {\"frames\": " << cpuFrames << ", \"skipping\": " << statsJson(skipStats)
+         << ", \"no_skipping\": " << statsJson(fullStats)
+         << ", \"samples_per_frame\": [" << skipSamples / cpuFrames << ", " << fullSamples / cpuFrames << "]"
+         << ", \"min_max_builds\": " << raycaster.statistics().minMaxBuilds << "},\n"
+         << "  \"isosurface\": {\"threshold\": " << ISOSURFACE_THRESHOLD
+         << ", \"parallel\": " << isoJson(parallelIso) << ", \"serial\": " << isoJson(serialIso)
+         << ", \"triangles\": [" << parallelIso.extractedTriangles << ", " << parallelIso.triangles << "]"
+         << ", \"triangle_budget\": " << isoExtractor.triangleBudget()
+         << ", \"fps\": " << (totalMeshMs > 0.0 ? options.frames * 1000.0 / totalMeshMs : 0.0)
+         << ", \"frame\": " << statsJson(meshFrameStats)
+         << ", \"volume_fps\": " << (totalFrameMs > 0.0 ? options.frames * 1000.0 / totalFrameMs : 0.0) << "},\n"
+         << "  \"out_of_core\": {\"build_ms\": " << chunkBuildMs << ", \"store_bytes\": " << storeBytes
+         << ", \"levels\": " << storeLevels << ", \"cache_bytes\": " << chunkCacheBytes << ",\n"
+         << "    \"slice_change\": {\n" << outOfCoreJson << "\n    },\n"
+         << "    \"resident_level\": " << residentLevel << ", \"resident_bytes\": " << residentBytes
+         << ", \"resident_read_ms\": " << residentReadMs << "},\n"
+         << "  \"cine\": {\"phases\": " << cinePhases << ", \"grouped\": " << (phasesGrouped ? "true" : "false")
+         << ", \"dimensions\": [" << cineDims[0] << ", " << cineDims[1] << ", " << cineDims[2] << "]"
+         << ", \"trigger_ms\": [" << firstTriggerMs << ", " << lastTriggerMs << "]"
+         << ", \"phase_bytes\": " << phaseBytes << ", \"load_ms\": " << cineLoadMs
+         << ", \"frame_rate\": " << CINE_FRAME_RATE << ", \"frames\": " << cineFrames
+         << ", \"prepare\": " << statsJson(summarize(prepareTimes))
+         << ", \"present\": " << statsJson(summarize(presentTimes))
+         << ", \"dropped\": " << droppedFrames << "}\n"
+         << "}\n";
+
+    if (options.output.empty()) {
+        std::cout << json.str();
+    } else {
+        std::ofstream out(std::filesystem::u8path(options.output));
+        out << json.str();
+        if (!out) {
+            std::cerr << "无法写入: " << options.output << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,316 @@
+#include "syntheticdicom.h"
+#include "parallelfor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+const char *CT_IMAGE_STORAGE = "1.2.840.10008.5.1.4.1.1.2";
+const char *EXPLICIT_VR_LITTLE_ENDIAN = "1.2.840.10008.1.2.1";
+const char *RLE_LOSSLESS = "1.2.840.10008.1.2.5";
+const char *UID_ROOT = "1.2.826.0.1.3680043.10.1027"; // 合成数据专用前缀
+
+// 按显式VR小端顺序追加数据元素
+class ElementWriter {
+public:
+    std::string bytes;
+
+    void addString(uint16_t group, uint16_t element, const char vr[2], std::string value) {
+        if (value.size() % 2) {
+            value.push_back(vr[0] == 'U' && vr[1] == 'I' ? '\0' : ' '); // UI 用NUL补齐，其余用空格
+        }
+        addHeader(group, element, vr, static_cast<uint32_t>(value.size()));
+        bytes += value;
+    }
+
+    void addUS(uint16_t group, uint16_t element, uint16_t value) {
+        addHeader(group, element, "US", 2);
+        put16(value);
+    }
+
+    void addUL(uint16_t group, uint16_t element, uint32_t value) {
+        addHeader(group, element, "UL", 4);
+        put32(value);
+    }
+
+    void addBinary(uint16_t group, uint16_t element, const char vr[2], const void *data, size_t length) {
+        addHeader(group, element, vr, static_cast<uint32_t>(length));
+        bytes.append(static_cast<const char *>(data), length);
+    }
+
+    // 封装像素数据：空的基本偏移表 + 单个片段 + 序列结束
+    void addEncapsulatedPixelData(const std::vector<char> &fragment) {
+        addHeader(0x7FE0, 0x0010, "OB", 0xFFFFFFFFu);
+        addItem(0xE000, nullptr, 0);
+        addItem(0xE000, fragment.data(), fragment.size());
+        addItem(0xE0DD, nullptr, 0);
+    }
+
+private:
+    void addItem(uint16_t element, const char *data, size_t length) {
+        put16(0xFFFE);
+        put16(element);
+        put32(static_cast<uint32_t>(length));
+        bytes.append(data, length);
+    }
+
+    void addHeader(uint16_t group, uint16_t element, const char vr[2], uint32_t length) {
+        put16(group);
+        put16(element);
+        bytes.push_back(vr[0]);
+        bytes.push_back(vr[1]);
+        const bool longLength = (vr[0] == 'O' && (vr[1] == 'B' || vr[1] == 'W'))
+            || (vr[0] == 'U' && (vr[1] == 'N' || vr[1] == 'T')) || (vr[0] == 'S' && vr[1] == 'Q');
+        if (longLength) {
+            put16(0);
+            put32(length);
+        } else {
+            put16(static_cast<uint16_t>(length));
+        }
+    }
+
+    void put16(uint16_t v) {
+        bytes.push_back(static_cast<char>(v & 0xFF));
+        bytes.push_back(static_cast<char>(v >> 8));
+    }
+
+    void put32(uint32_t v) {
+        put16(static_cast<uint16_t>(v & 0xFFFF));
+        put16(static_cast<uint16_t>(v >> 16));
+    }
+};
+
+// 整数哈希，生成可复现的噪声
+uint32_t hash3(uint32_t x, uint32_t y, uint32_t z) {
+    uint32_t h = x * 73856093u ^ y * 19349663u ^ z * 83492791u;
+    h ^= h >> 13;
+    h *= 0x5bd1e995u;
+    h ^= h >> 15;
+    return h;
+}
+
+bool insideEllipse(double x, double y, double cx, double cy, double rx, double ry) {
+    const double dx = (x - cx) / rx;
+    const double dy = (y - cy) / ry;
+    return dx * dx + dy * dy <= 1.0;
+}
+
+// 体模在 (x, y) ∈ [-1, 1]²、z ∈ [0, 1] 处的CT值 (HU)；vesselRadius 随时相变化
+double phantomHU(double x, double y, double z, uint32_t noise, double vesselRadius) {
+    if (y > -0.82 && y < -0.76 && std::abs(x) < 0.92) {
+        return 150.0 + static_cast<double>(noise % 21) - 10.0; // 检查床，与身体之间隔着空气
+    }
+    if (!insideEllipse(x, y, 0.0, 0.0, 0.85, 0.65)) {
+        return -1000.0; // 空气
+    }
+    double hu = insideEllipse(x, y, 0.0, 0.0, 0.78, 0.58) ? 40.0 : -100.0; // 软组织，外圈为脂肪
+    if (z > 0.2 && z < 0.9 && (insideEllipse(x, y, -0.38, 0.05, 0.26, 0.38)
+                               || insideEllipse(x, y, 0.38, 0.05, 0.26, 0.38))) {
+        hu = -850.0; // 双肺
+    }
+    if (insideEllipse(x, y, 0.0, -0.42, 0.1, 0.1)) {
+        hu = insideEllipse(x, y, 0.0, -0.42, 0.06, 0.06) ? 300.0 : 900.0; // 椎体：皮质骨包围松质骨
+    }
+    if (insideEllipse(x, y, 0.08, -0.12, vesselRadius, vesselRadius)) {
+        hu = 250.0; // 增强血管
+    }
+    return hu + static_cast<double>(noise % 21) - 10.0;
+}
+
+template <typename T>
+void fillSlice(T *out, const SyntheticSeriesOptions &options, int z, int phase, double slope, double intercept,
+               double maxStored) {
+    const double zn = options.slices > 1 ? static_cast<double>(z) / (options.slices - 1) : 0.5;
+    const double vesselRadius = 0.06 * (1.0 + 0.3 * std::sin(2.0 * 3.14159265358979 * phase / options.phases));
+    for (int r = 0; r < options.rows; ++r) {
+        const double y = 1.0 - 2.0 * (r + 0.5) / options.rows; // 第一行在上方
+        for (int c = 0; c < options.columns; ++c) {
+            const double x = 2.0 * (c + 0.5) / options.columns - 1.0;
+            const double hu = phantomHU(x, y, zn, hash3(c, r, z + phase * options.slices), vesselRadius);
+            double stored = std::floor((hu - intercept) / slope + 0.5);
+            if (maxStored > 0.0) {
+                stored = std::min(std::max(stored, 0.0), maxStored);
+            }
+            out[static_cast<size_t>(r) * options.columns + c] = static_cast<T>(stored);
+        }
+    }
+}
+
+std::string formatDS(double v) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.6g", v);
+    return text;
+}
+
+} // namespace
+
+// PackBits 编码一个字节段
+void packBits(const uint8_t *in, size_t n, std::vector<char> &out) {
+    size_t i = 0;
+    while (i < n) {
+        size_t run = 1;
+        while (i + run < n && run < 128 && in[i + run] == in[i]) {
+            ++run;
+        }
+        if (run > 1) {
+            out.push_back(static_cast<char>(1 - static_cast<int>(run)));
+            out.push_back(static_cast<char>(in[i]));
+            i += run;
+            continue;
+        }
+        size_t literal = 1;
+        while (i + literal < n && literal < 128
+               && !(i + literal + 1 < n && in[i + literal] == in[i + literal + 1])) {
+            ++literal;
+        }
+        out.push_back(static_cast<char>(literal - 1));
+        out.insert(out.end(), in + i, in + i + literal);
+        i += literal;
+    }
+}
+
+// RLE Lossless 编码单帧单通道像素 (小端存储)：每个字节平面一个段，高位字节在前
+std::vector<char> encodeRLE(const std::vector<char> &pixels, size_t count, int bytesPerSample) {
+    std::vector<char> out(64, 0);
+    std::vector<uint8_t> plane(count);
+    out[0] = static_cast<char>(bytesPerSample);
+    for (int segment = 0; segment < bytesPerSample; ++segment) {
+        const uint32_t offset = static_cast<uint32_t>(out.size());
+        for (int b = 0; b < 4; ++b) {
+            out[4 + segment * 4 + b] = static_cast<char>((offset >> (8 * b)) & 0xFF);
+        }
+        const int byteIndex = bytesPerSample - 1 - segment;
+        for (size_t i = 0; i < count; ++i) {
+            plane[i] = static_cast<uint8_t>(pixels[i * bytesPerSample + byteIndex]);
+        }
+        packBits(plane.data(), count, out);
+        if (out.size() % 2) {
+            out.push_back(0);
+        }
+    }
+    return out;
+}
+
+bool writeSyntheticSeries(const std::string &dirPath, const SyntheticSeriesOptions &options, std::string *error) {
+    auto fail = [error](const std::string &message) {
+        if (error) {
+            *error = message;
+        }
+        return false;
+    };
+    if (options.columns <= 0 || options.rows <= 0 || options.slices <= 0 || options.phases <= 0
+        || options.columns > 65535 || options.rows > 65535) {
+        return fail("体模尺寸无效");
+    }
+
+    int bitsAllocated, pixelRepresentation;
+    double slope, intercept, maxStored;
+    switch (options.bitsStored) {
+        case 8:  bitsAllocated = 8;  pixelRepresentation = 0; slope = 8.0; intercept = -1024.0; maxStored = 255.0; break;
+        case 12: bitsAllocated = 16; pixelRepresentation = 0; slope = 1.0; intercept = -1024.0; maxStored = 4095.0; break;
+        case 16: bitsAllocated = 16; pixelRepresentation = 1; slope = 1.0; intercept = 0.0; maxStored = 0.0; break;
+        default: return fail("不支持的位深: " + std::to_string(options.bitsStored));
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::u8path(dirPath), ec);
+    if (ec) {
+        return fail("无法创建目录: " + dirPath);
+    }
+
+    const std::string studyUID = std::string(UID_ROOT) + ".1";
+    const std::string seriesUID = std::string(UID_ROOT) + ".2." + std::to_string(options.columns) + "."
+        + std::to_string(options.rows) + "." + std::to_string(options.slices) + "." + std::to_string(options.bitsStored)
+        + (options.phases > 1 ? "." + std::to_string(options.phases) : std::string());
+    const size_t pixelBytes = static_cast<size_t>(options.columns) * options.rows * (bitsAllocated / 8);
+
+    try {
+        // 多时相序列按时相依次编号，第 i 个文件是第 i / slices 个时相的第 i % slices 层
+        parallelFor(0, options.slices * options.phases, [&](int i, int) {
+            const int z = i % options.slices;
+            const int phase = i / options.slices;
+            const std::string instanceUID = seriesUID + "." + std::to_string(i + 1);
+
+            ElementWriter meta;
+            meta.addBinary(0x0002, 0x0001, "OB", "\0\1", 2);
+            meta.addString(0x0002, 0x0002, "UI", CT_IMAGE_STORAGE);
+            meta.addString(0x0002, 0x0003, "UI", instanceUID);
+            meta.addString(0x0002, 0x0010, "UI", options.rle ? RLE_LOSSLESS : EXPLICIT_VR_LITTLE_ENDIAN);
+            meta.addString(0x0002, 0x0012, "UI", UID_ROOT);
+            ElementWriter group;
+            group.addUL(0x0002, 0x0000, static_cast<uint32_t>(meta.bytes.size()));
+
+            ElementWriter data;
+            data.addString(0x0008, 0x0016, "UI", CT_IMAGE_STORAGE);
+            data.addString(0x0008, 0x0018, "UI", instanceUID);
+            data.addString(0x0008, 0x0060, "CS", "CT");
+            data.addString(0x0010, 0x0010, "PN", "SYNTHETIC^PHANTOM");
+            data.addString(0x0018, 0x0050, "DS", formatDS(options.sliceThickness));
+            if (options.phases > 1) {
+                data.addString(0x0018, 0x1060, "DS", formatDS(phase * options.phaseInterval));
+            }
+            data.addString(0x0020, 0x000D, "UI", studyUID);
+            data.addString(0x0020, 0x000E, "UI", seriesUID);
+            data.addString(0x0020, 0x0013, "IS", std::to_string(i + 1));
+            data.addString(0x0020, 0x0032, "DS", formatDS(-0.5 * options.columns * options.pixelSpacing) + "\\"
+                + formatDS(-0.5 * options.rows * options.pixelSpacing) + "\\" + formatDS(z * options.sliceThickness));
+            data.addString(0x0020, 0x0037, "DS", "1\\0\\0\\0\\1\\0");
+            if (options.phases > 1) {
+                data.addString(0x0020, 0x0100, "IS", std::to_string(phase + 1));
+                data.addString(0x0020, 0x0105, "IS", std::to_string(options.phases));
+            }
+            data.addUS(0x0028, 0x0002, 1);
+            data.addString(0x0028, 0x0004, "CS", "MONOCHROME2");
+            data.addUS(0x0028, 0x0010, static_cast<uint16_t>(options.rows));
+            data.addUS(0x0028, 0x0011, static_cast<uint16_t>(options.columns));
+            data.addString(0x0028, 0x0030, "DS", formatDS(options.pixelSpacing) + "\\" + formatDS(options.pixelSpacing));
+            data.addUS(0x0028, 0x0100, static_cast<uint16_t>(bitsAllocated));
+            data.addUS(0x0028, 0x0101, static_cast<uint16_t>(options.bitsStored));
+            data.addUS(0x0028, 0x0102, static_cast<uint16_t>(options.bitsStored - 1));
+            data.addUS(0x0028, 0x0103, static_cast<uint16_t>(pixelRepresentation));
+            data.addString(0x0028, 0x1052, "DS", formatDS(intercept));
+            data.addString(0x0028, 0x1053, "DS", formatDS(slope));
+
+            std::vector<char> pixels(pixelBytes);
+            if (bitsAllocated == 8) {
+                fillSlice(reinterpret_cast<uint8_t *>(pixels.data()), options, z, phase, slope, intercept, maxStored);
+            } else if (pixelRepresentation) {
+                fillSlice(reinterpret_cast<int16_t *>(pixels.data()), options, z, phase, slope, intercept, maxStored);
+            } else {
+                fillSlice(reinterpret_cast<uint16_t *>(pixels.data()), options, z, phase, slope, intercept, maxStored);
+            }
+            if (options.rle) {
+                const size_t count = static_cast<size_t>(options.columns) * options.rows;
+                data.addEncapsulatedPixelData(encodeRLE(pixels, count, bitsAllocated / 8));
+            } else {
+                if (pixels.size() % 2) {
+                    pixels.push_back(0); // 元素长度必须为偶数
+                }
+                data.addBinary(0x7FE0, 0x0010, bitsAllocated == 8 ? "OB" : "OW", pixels.data(), pixels.size());
+            }
+
+            char name[32];
+            std::snprintf(name, sizeof(name), "IM%05d.dcm", i + 1);
+            std::ofstream out(std::filesystem::u8path(dirPath) / name, std::ios::binary);
+            const char preamble[128] = {};
+            out.write(preamble, sizeof(preamble));
+            out.write("DICM", 4);
+            out.write(group.bytes.data(), group.bytes.size());
+            out.write(meta.bytes.data(), meta.bytes.size());
+            out.write(data.bytes.data(), data.bytes.size());
+            if (!out) {
+                throw std::runtime_error(std::string("写入失败: ") + name);
+            }
+        }, options.threadCount);
+    } catch (const std::exception &e) {
+        return fail(e.what());
+    }
+    return true;
+}
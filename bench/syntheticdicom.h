@@ -0,0 +1,28 @@
+#ifndef SYNTHETICDICOM_H
+#define SYNTHETICDICOM_H
+
+#include <string>
+
+// 合成CT体模序列的参数
+struct SyntheticSeriesOptions {
+    int columns = 512;
+    int rows = 512;
+    int slices = 256;
+    int bitsStored = 16;        // 8、12 或 16
+    double pixelSpacing = 0.7;  // mm
+    double sliceThickness = 1.0;
+    int threadCount = 0;        // <=0 表示使用全部硬件线程
+    bool rle = false;           // 使用 RLE Lossless 传输语法封装像素数据
+    int phases = 1;             // 大于 1 时写出多时相序列，每个时相 slices 层，位置相同
+    double phaseInterval = 50.0; // 相邻时相的 TriggerTime 间隔 (ms)
+};
+
+// 在 dirPath 中写出一个显式VR小端的CT体模序列 (每层一个文件)，默认不压缩
+// 体模包含空气、软组织、脂肪、双肺、脊柱和血管，灰度按 bitsStored 选择存储方式和 Rescale：
+//   16: 有符号，直接存HU；12: 无符号，截距 -1024；8: 无符号，斜率 8，截距 -1024
+// 多时相序列带有 TriggerTime 和 TemporalPositionIdentifier，血管半径随时相搏动
+// 失败时返回false并写入error
+bool writeSyntheticSeries(const std::string &dirPath, const SyntheticSeriesOptions &options,
+                          std::string *error = nullptr);
+
+#endif // SYNTHETICDICOM_H
@@ -0,0 +1,319 @@
+#include "batchexporter.h"
+#include "paralleldicomreader.h"
+#include "sliceextractor.h"
+#include "windowlevel.h"
+#include "cpuraycaster.h"
+#include "volumepreset.h"
+#include "parallelfor.h"
+#include "tracer.h"
+
+#include <vtkAbstractArray.h>
+#include <vtkCamera.h>
+#include <vtkColorTransferFunction.h>
+#include <vtkPNGWriter.h>
+#include <vtkPiecewiseFunction.h>
+#include <vtkVolumeProperty.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+// 同时驻留的体数据字节数配额；没有其他序列占用时总是放行，单个超大序列不会永远等待
+class MemoryBudget {
+public:
+    explicit MemoryBudget(int64_t limit) : limit(limit), used(0) {}
+
+    void acquire(int64_t bytes) {
+        std::unique_lock<std::mutex> lock(mutex);
+        released.wait(lock, [&]() { return limit <= 0 || used == 0 || used + bytes <= limit; });
+        used += bytes;
+    }
+
+    void release(int64_t bytes) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            used -= bytes;
+        }
+        released.notify_all();
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable released;
+    int64_t limit;
+    int64_t used;
+};
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const char *const ORIENTATION_NAMES[3] = {"sagittal", "coronal", "axial"};
+const double BACKGROUND[3] = {0.1, 0.2, 0.4}; // 与三维视图的背景色一致
+
+double elapsedMs(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// 配额在作用域结束时归还，异常退出也不会泄漏
+class BudgetGuard {
+public:
+    BudgetGuard(MemoryBudget &budget, int64_t bytes) : budget(budget), bytes(bytes) { budget.acquire(bytes); }
+    ~BudgetGuard() { budget.release(bytes); }
+
+private:
+    MemoryBudget &budget;
+    int64_t bytes;
+};
+
+// 输出子目录名取序列目录名，重名时加上在列表中的序号
+std::vector<std::string> outputNames(const std::vector<std::string> &dirPaths) {
+    std::vector<std::string> names;
+    std::map<std::string, int> counts;
+    for (const std::string &dirPath : dirPaths) {
+        std::string name = fs::path(dirPath).lexically_normal().filename().string();
+        if (name.empty() || name == "." || name == "..") {
+            name = fs::path(dirPath).lexically_normal().parent_path().filename().string();
+        }
+        names.push_back(name.empty() ? "study" : name);
+        ++counts[names.back()];
+    }
+    for (size_t i = 0; i < names.size(); ++i) {
+        if (counts[names[i]] > 1) {
+            names[i] += "_" + std::to_string(i);
+        }
+    }
+    return names;
+}
+
+// 双线性缩放 RGBA 切片，长边为 size 像素，宽高比按像素间距换算成物理尺寸
+vtkSmartPointer<vtkImageData> scaleToPhysical(vtkImageData *rgba, int size) {
+    const int *dims = rgba->GetDimensions();
+    const double *spacing = rgba->GetSpacing();
+    const double width = dims[0] * spacing[0], height = dims[1] * spacing[1];
+    const double scale = size / std::max(width, height);
+    const int outWidth = std::max(1, static_cast<int>(std::lround(width * scale)));
+    const int outHeight = std::max(1, static_cast<int>(std::lround(height * scale)));
+
+    vtkSmartPointer<vtkImageData> out = vtkSmartPointer<vtkImageData>::New();
+    out->SetDimensions(outWidth, outHeight, 1);
+    out->AllocateScalars(VTK_UNSIGNED_CHAR, 4);
+    const unsigned char *in = static_cast<const unsigned char *>(rgba->GetScalarPointer());
+    unsigned char *dst = static_cast<unsigned char *>(out->GetScalarPointer());
+    const double sx = static_cast<double>(dims[0]) / outWidth, sy = static_cast<double>(dims[1]) / outHeight;
+    for (int y = 0; y < outHeight; ++y) {
+        const double fy = std::min(std::max((y + 0.5) * sy - 0.5, 0.0), dims[1] - 1.0);
+        const int y0 = static_cast<int>(fy), y1 = std::min(y0 + 1, dims[1] - 1);
+        const double ty = fy - y0;
+        for (int x = 0; x < outWidth; ++x) {
+            const double fx = std::min(std::max((x + 0.5) * sx - 0.5, 0.0), dims[0] - 1.0);
+            const int x0 = static_cast<int>(fx), x1 = std::min(x0 + 1, dims[0] - 1);
+            const double tx = fx - x0;
+            const unsigned char *p00 = in + (static_cast<size_t>(y0) * dims[0] + x0) * 4;
+            const unsigned char *p01 = in + (static_cast<size_t>(y0) * dims[0] + x1) * 4;
+            const unsigned char *p10 = in + (static_cast<size_t>(y1) * dims[0] + x0) * 4;
+            const unsigned char *p11 = in + (static_cast<size_t>(y1) * dims[0] + x1) * 4;
+            unsigned char *o = dst + (static_cast<size_t>(y) * outWidth + x) * 4;
+            for (int c = 0; c < 4; ++c) {
+                const double top = p00[c] + (p01[c] - p00[c]) * tx;
+                const double bottom = p10[c] + (p11[c] - p10[c]) * tx;
+                o[c] = static_cast<unsigned char>(top + (bottom - top) * ty + 0.5);
+            }
+        }
+    }
+    return out;
+}
+
+void writePng(vtkImageData *image, const fs::path &path) {
+    vtkSmartPointer<vtkPNGWriter> writer = vtkSmartPointer<vtkPNGWriter>::New();
+    writer->SetFileName(path.string().c_str());
+    writer->SetInputData(image);
+    writer->Write();
+    if (writer->GetErrorCode() != 0) {
+        throw std::runtime_error("无法写入 " + path.string());
+    }
+}
+
+// 与 vtkRenderer::ResetCamera 相同的取景 (默认相机沿 -Z 方向观察)，再按界面中的 Zoom(1.5) 放大
+void resetCamera(vtkCamera *camera, vtkImageData *image, double azimuth, double elevation) {
+    double bounds[6];
+    image->GetBounds(bounds);
+    double center[3], radius = 0.0;
+    for (int k = 0; k < 3; ++k) {
+        center[k] = (bounds[2 * k] + bounds[2 * k + 1]) / 2.0;
+        radius += (bounds[2 * k + 1] - bounds[2 * k]) * (bounds[2 * k + 1] - bounds[2 * k]);
+    }
+    radius = radius > 0.0 ? std::sqrt(radius) / 2.0 : 0.5;
+    const double angle = camera->GetViewAngle() * 3.14159265358979323846 / 180.0;
+    const double distance = radius / std::sin(angle / 2.0);
+    camera->SetFocalPoint(center);
+    camera->SetPosition(center[0], center[1], center[2] + distance);
+    camera->SetViewUp(0.0, 1.0, 0.0);
+    camera->SetParallelScale(radius);
+    camera->Zoom(1.5);
+    camera->Azimuth(azimuth);
+    camera->Elevation(elevation);
+    camera->OrthogonalizeViewUp();
+}
+
+} // namespace
+
+BatchExporter::BatchExporter(const BatchExportOptions &options)
+    : options(options), workers(options.workers), threads(options.threadsPerStudy), wallTime(0.0)
+{
+    const int hardware = defaultThreadCount();
+    if (workers <= 0) {
+        workers = std::max(1, hardware / 4); // 每个序列内部也是多线程，同时处理几个序列用来掩盖磁盘读取
+    }
+    if (threads <= 0) {
+        threads = std::max(1, hardware / workers);
+    }
+    this->options.size = std::max(16, options.size);
+}
+
+std::vector<BatchExportResult> BatchExporter::run(const std::vector<std::string> &dirPaths) {
+    TRACE_SCOPE("BatchExporter::run");
+    const Clock::time_point start = Clock::now();
+    std::vector<BatchExportResult> results(dirPaths.size());
+    const std::vector<std::string> names = outputNames(dirPaths);
+    for (size_t i = 0; i < dirPaths.size(); ++i) {
+        results[i].dirPath = dirPaths[i];
+        results[i].name = names[i];
+    }
+
+    MemoryBudget budget(options.memoryLimit);
+    std::mutex resultMutex;
+    int finished = 0;
+    parallelFor(0, static_cast<int>(results.size()), [&](int i, int) {
+        BatchExportResult &result = results[i];
+        try {
+            exportStudy(result, budget);
+        } catch (std::exception &e) {
+            result.ok = false;
+            result.error = e.what();
+        }
+        std::lock_guard<std::mutex> lock(resultMutex);
+        ++finished;
+        if (resultCallback) {
+            resultCallback(result, finished, static_cast<int>(results.size()));
+        }
+    }, workers);
+
+    wallTime = std::chrono::duration<double>(Clock::now() - start).count();
+    return results;
+}
+
+// 先写到 <名称>.partial 目录，全部成功后再改名，中途失败或被终止的序列不会被 skipExisting 误认为已完成
+void BatchExporter::exportStudy(BatchExportResult &result, MemoryBudget &budget) {
+    TRACE_SCOPE("BatchExporter::exportStudy");
+    const fs::path finalDir = fs::path(options.outputDir) / result.name;
+    if (options.skipExisting && fs::is_directory(finalDir)) {
+        result.ok = true;
+        result.skipped = true;
+        return;
+    }
+
+    Clock::time_point start = Clock::now();
+    ParallelDICOMReader reader;
+    reader.setThreadCount(threads);
+    if (!reader.scanDirectory(result.dirPath)) {
+        result.error = reader.errorMessage();
+        return;
+    }
+    const int *dims = reader.dimensions();
+    std::copy(dims, dims + 3, result.dimensions);
+    result.volumeBytes = static_cast<int64_t>(dims[0]) * dims[1] * dims[2] * reader.numberOfComponents()
+        * vtkAbstractArray::GetDataTypeSize(reader.scalarType());
+
+    // 体数据之外还有光线投射的分块最小/最大值、切片和输出图像，按体数据的 1/8 加上两张输出图估算
+    const int64_t size = options.size;
+    const double scanMs = elapsedMs(start);
+    start = Clock::now();
+    BudgetGuard guard(budget, result.volumeBytes + result.volumeBytes / 8 + size * size * 8);
+    result.waitMs = elapsedMs(start);
+
+    start = Clock::now();
+    vtkSmartPointer<vtkImageData> image = reader.readVolume();
+    if (!image) {
+        result.error = reader.errorMessage();
+        return;
+    }
+    result.loadMs = scanMs + elapsedMs(start);
+
+    double window = options.window, level = options.level;
+    if (window <= 0.0) {
+        if (!reader.histogram().empty()) {
+            reader.histogram().windowLevel(0.005, 0.995, window, level);
+        } else {
+            double range[2];
+            image->GetScalarRange(range);
+            window = std::max(1.0, range[1] - range[0]);
+            level = (range[1] + range[0]) / 2.0;
+        }
+    }
+
+    const fs::path workDir = fs::path(options.outputDir) / (result.name + ".partial");
+    std::error_code ec;
+    fs::remove_all(workDir, ec);
+    fs::create_directories(workDir);
+    std::vector<std::string> files;
+
+    start = Clock::now();
+    SliceExtractor extractor;
+    extractor.setInput(image);
+    extractor.setThreadCount(threads);
+    for (int axis = 0; axis < 3; ++axis) {
+        for (double position : options.slices[axis]) {
+            const int index = std::min(std::max(static_cast<int>(std::lround(position * (dims[axis] - 1))), 0),
+                                       dims[axis] - 1);
+            vtkSmartPointer<vtkImageData> rgba = mapWindowLevelToRGBA(extractor.extract(axis, index), window, level);
+            char fileName[64];
+            std::snprintf(fileName, sizeof(fileName), "%s_%04d.png", ORIENTATION_NAMES[axis], index);
+            writePng(scaleToPhysical(rgba, options.size), workDir / fileName);
+            files.push_back(fileName);
+        }
+    }
+    result.sliceMs = elapsedMs(start);
+
+    if (options.volume) {
+        start = Clock::now();
+        vtkSmartPointer<vtkVolumeProperty> property = vtkSmartPointer<vtkVolumeProperty>::New();
+        vtkSmartPointer<vtkPiecewiseFunction> opacity = vtkSmartPointer<vtkPiecewiseFunction>::New();
+        setupDefaultVolumeProperty(property, vtkSmartPointer<vtkColorTransferFunction>::New(), opacity);
+        if (options.opacity != 1.0) {
+            setDefaultOpacityPoints(opacity, options.opacity);
+        }
+        vtkSmartPointer<vtkCamera> camera = vtkSmartPointer<vtkCamera>::New();
+        resetCamera(camera, image, options.azimuth, options.elevation);
+
+        CpuRaycaster raycaster;
+        raycaster.setInput(image);
+        raycaster.setProperty(property);
+        raycaster.setSampleDistance(0.5); // 与三维视图的采样距离一致
+        raycaster.setThreadCount(threads);
+        raycaster.setBackground(BACKGROUND[0], BACKGROUND[1], BACKGROUND[2]);
+        vtkImageData *rendered = raycaster.render(CpuRaycaster::viewFromCamera(camera), options.size, options.size);
+        if (!rendered) {
+            result.error = "CPU光线投射无法渲染该序列 (只支持单分量体数据)";
+            return;
+        }
+        writePng(rendered, workDir / "volume.png");
+        files.push_back("volume.png");
+        result.volumeMs = elapsedMs(start);
+    }
+
+    fs::remove_all(finalDir, ec);
+    fs::rename(workDir, finalDir);
+    for (const std::string &file : files) {
+        result.files.push_back((finalDir / file).string());
+    }
+    result.ok = true;
+}
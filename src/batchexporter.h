@@ -0,0 +1,71 @@
+#ifndef BATCHEXPORTER_H
+#define BATCHEXPORTER_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+class MemoryBudget;
+
+// 无界面批量导出：为多个序列目录渲染正交切片和三维视图的 PNG
+// 每个序列由工作线程池中的一个线程完成读取、切片提取和 CPU 光线投射，不需要 OpenGL 上下文，
+// 在没有显示器的节点上也能并发运行。同时驻留的体数据总量受内存上限约束，
+// 超出时后面的序列等待前面的完成；单个序列超过上限时等其他序列全部完成后单独处理。
+struct BatchExportOptions {
+    std::string outputDir;
+    std::vector<double> slices[3]; // 各方向 (矢状、冠状、轴状) 导出的层位置，0-1 为相对位置
+    bool volume = true;            // 导出三维视图
+    int size = 512;                // 图像长边的像素数，切片按物理尺寸保持宽高比
+    double window = 0.0;           // 窗宽 <= 0 时按灰度百分位数自动设置
+    double level = 0.0;
+    double opacity = 1.0;          // 不透明度因子，与界面中的不透明度滑块相同
+    double azimuth = 0.0;          // 三维相机在默认视角基础上的旋转 (度)
+    double elevation = 0.0;
+    int workers = 0;               // 同时处理的序列数，0 表示硬件线程数的 1/4；实际并发还受 memoryLimit 约束
+    int threadsPerStudy = 0;       // 每个序列解码、切片提取和光线投射的线程数，0 表示平分硬件线程
+    int64_t memoryLimit = 0;       // 同时驻留的体数据字节数上限，0 表示不限制
+    bool skipExisting = false;     // 输出子目录已存在 (即上次已完整导出) 时跳过该序列
+};
+
+struct BatchExportResult {
+    std::string dirPath;
+    std::string name;          // 输出子目录名
+    bool ok = false;
+    bool skipped = false;
+    std::string error;
+    int dimensions[3] = {0, 0, 0};
+    int64_t volumeBytes = 0;
+    double loadMs = 0.0;
+    double sliceMs = 0.0;      // 所有切片的提取、窗宽窗位映射和写入
+    double volumeMs = 0.0;     // 光线投射和写入
+    double waitMs = 0.0;       // 等待内存配额的时间
+    std::vector<std::string> files;
+};
+
+class BatchExporter {
+public:
+    // 每完成一个序列调用一次 (已加锁，调用顺序即完成顺序)
+    using ResultCallback = std::function<void(const BatchExportResult &result, int finished, int total)>;
+
+    explicit BatchExporter(const BatchExportOptions &options);
+
+    void setResultCallback(ResultCallback callback) { resultCallback = std::move(callback); }
+    // 返回与 dirPaths 顺序一致的结果
+    std::vector<BatchExportResult> run(const std::vector<std::string> &dirPaths);
+
+    int workerCount() const { return workers; }
+    int threadsPerStudy() const { return threads; }
+    double wallSeconds() const { return wallTime; }
+
+private:
+    void exportStudy(BatchExportResult &result, MemoryBudget &budget);
+
+    BatchExportOptions options;
+    ResultCallback resultCallback;
+    int workers;
+    int threads;
+    double wallTime;
+};
+
+#endif // BATCHEXPORTER_H
@@ -0,0 +1,222 @@
+#include "bodycrop.h"
+#include "parallelfor.h"
+#include "tracer.h"
+
+#include <vtkSetGet.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+namespace {
+
+const double NOISE_FRACTION = 0.001;
+
+// 把阈值换成体素类型，整数体素用 floor 后的值比较结果不变，循环内不再转成 double
+template <typename T>
+T thresholdFor(double threshold) {
+    const double lo = static_cast<double>(std::numeric_limits<T>::lowest());
+    const double hi = static_cast<double>(std::numeric_limits<T>::max());
+    const double t = std::is_integral<T>::value ? std::floor(threshold) : threshold;
+    return static_cast<T>(std::min(std::max(t, lo), hi));
+}
+
+// rowCounts[z * ny + y] 为每层每行的前景体素数；columnCounts[线程][y * nx + x] 累加各层同一位置的前景体素数
+template <typename T>
+void countForeground(const T *in, const int dims[3], double threshold, std::vector<int> &rowCounts,
+                     std::vector<std::vector<int>> &columnCounts, int threadCount) {
+    const size_t nx = dims[0], nxy = nx * dims[1];
+    const T cut = thresholdFor<T>(threshold);
+    parallelFor(0, dims[2], [&](int z, int threadIndex) {
+        std::vector<int> &columns = columnCounts[threadIndex];
+        for (int y = 0; y < dims[1]; ++y) {
+            const T *row = in + z * nxy + y * nx;
+            int *column = columns.data() + y * nx;
+            int count = 0;
+            for (size_t x = 0; x < nx; ++x) {
+                const int inside = row[x] > cut ? 1 : 0;
+                column[x] += inside;
+                count += inside;
+            }
+            rowCounts[static_cast<size_t>(z) * dims[1] + y] = count;
+        }
+    }, threadCount);
+}
+
+int64_t noiseLevel(const std::vector<int64_t> &profile) {
+    const int64_t peak = profile.empty() ? 0 : *std::max_element(profile.begin(), profile.end());
+    return std::max<int64_t>(1, static_cast<int64_t>(peak * NOISE_FRACTION));
+}
+
+// 剖面中超过噪声水平的第一个和最后一个下标
+bool occupiedRange(const std::vector<int64_t> &profile, int &first, int &last) {
+    const int64_t noise = noiseLevel(profile);
+    first = -1;
+    for (int i = 0; i < static_cast<int>(profile.size()); ++i) {
+        if (profile[i] >= noise) {
+            first = first < 0 ? i : first;
+            last = i;
+        }
+    }
+    return first >= 0;
+}
+
+// 前后方向上被空气行隔开的几段中前景体素最多的一段 (身体)，其余为检查床等
+bool largestRun(const std::vector<int64_t> &profile, int &first, int &last, int &runs) {
+    const int64_t noise = noiseLevel(profile);
+    int64_t best = 0, sum = 0;
+    int start = -1;
+    runs = 0;
+    for (int i = 0; i <= static_cast<int>(profile.size()); ++i) {
+        const bool occupied = i < static_cast<int>(profile.size()) && profile[i] >= noise;
+        if (occupied) {
+            if (start < 0) {
+                start = i;
+                sum = 0;
+            }
+            sum += profile[i];
+        } else if (start >= 0) {
+            ++runs;
+            if (sum > best) {
+                best = sum;
+                first = start;
+                last = i - 1;
+            }
+            start = -1;
+        }
+    }
+    return runs > 0;
+}
+
+// histogram 非空时拷完一层就统计这一层，数据还在缓存中
+template <typename T>
+void copyExtent(const T *in, T *out, const int inDims[3], const int extent[6], int components, int threadCount,
+                VolumeHistogram *histogram, int scalarType) {
+    const size_t inRow = static_cast<size_t>(inDims[0]) * components;
+    const size_t inSlice = inRow * inDims[1];
+    const int outDims[3] = {extent[1] - extent[0] + 1, extent[3] - extent[2] + 1, extent[5] - extent[4] + 1};
+    const size_t outRow = static_cast<size_t>(outDims[0]) * components;
+    const size_t outSlice = outRow * outDims[1];
+    const int workers = std::min(threadCount > 0 ? threadCount : defaultThreadCount(), std::max(1, outDims[2]));
+    std::vector<VolumeHistogram::Partial> partials(histogram ? workers : 0);
+    parallelFor(0, outDims[2], [&](int z, int threadIndex) {
+        const T *src = in + (z + extent[4]) * inSlice + extent[2] * inRow + static_cast<size_t>(extent[0]) * components;
+        T *dst = out + z * outSlice;
+        for (int y = 0; y < outDims[1]; ++y) {
+            std::memcpy(dst + y * outRow, src + y * inRow, outRow * sizeof(T));
+        }
+        if (histogram) {
+            histogram->add(partials[threadIndex], dst, scalarType, outSlice);
+        }
+    }, workers);
+    for (const VolumeHistogram::Partial &partial : partials) {
+        histogram->merge(partial);
+    }
+}
+
+} // namespace
+
+bool findBodyExtent(vtkImageData *image, const BodyCropOptions &options, int extent[6], bool *tableRemoved) {
+    TRACE_SCOPE("findBodyExtent");
+    if (!image || image->GetScalarType() == VTK_VOID || image->GetNumberOfScalarComponents() != 1) {
+        return false;
+    }
+    int dims[3];
+    image->GetDimensions(dims);
+    const int threads = options.threadCount > 0 ? options.threadCount : defaultThreadCount();
+    std::vector<int> rowCounts(static_cast<size_t>(dims[1]) * dims[2]);
+    std::vector<std::vector<int>> columnCounts(std::min(threads, std::max(1, dims[2])),
+                                               std::vector<int>(static_cast<size_t>(dims[0]) * dims[1], 0));
+    const void *in = image->GetScalarPointer();
+    switch (image->GetScalarType()) {
+        vtkTemplateMacro(countForeground(static_cast<const VTK_TT *>(in), dims, options.threshold, rowCounts,
+                                         columnCounts, static_cast<int>(columnCounts.size())));
+        default:
+            return false;
+    }
+
+    std::vector<int64_t> yProfile(dims[1], 0);
+    for (int z = 0; z < dims[2]; ++z) {
+        for (int y = 0; y < dims[1]; ++y) {
+            yProfile[y] += rowCounts[static_cast<size_t>(z) * dims[1] + y];
+        }
+    }
+    int y0 = 0, y1 = 0, runs = 0;
+    if (options.removeTable ? !largestRun(yProfile, y0, y1, runs) : !occupiedRange(yProfile, y0, y1)) {
+        return false;
+    }
+
+    // 左右和头脚方向只统计保留下来的行，检查床比身体宽也不会撑大包围盒
+    std::vector<int64_t> zProfile(dims[2], 0), xProfile(dims[0], 0);
+    for (int z = 0; z < dims[2]; ++z) {
+        for (int y = y0; y <= y1; ++y) {
+            zProfile[z] += rowCounts[static_cast<size_t>(z) * dims[1] + y];
+        }
+    }
+    for (const std::vector<int> &columns : columnCounts) {
+        for (int y = y0; y <= y1; ++y) {
+            const int *column = columns.data() + static_cast<size_t>(y) * dims[0];
+            for (int x = 0; x < dims[0]; ++x) {
+                xProfile[x] += column[x];
+            }
+        }
+    }
+    int x0 = 0, x1 = 0, z0 = 0, z1 = 0;
+    if (!occupiedRange(xProfile, x0, x1) || !occupiedRange(zProfile, z0, z1)) {
+        return false;
+    }
+
+    const int lo[3] = {x0, y0, z0}, hi[3] = {x1, y1, z1};
+    for (int k = 0; k < 3; ++k) {
+        extent[2 * k] = std::max(0, lo[k] - options.margin);
+        extent[2 * k + 1] = std::min(dims[k] - 1, hi[k] + options.margin);
+    }
+    if (tableRemoved) {
+        *tableRemoved = runs > 1;
+    }
+    return true;
+}
+
+vtkSmartPointer<vtkImageData> cropVolume(vtkImageData *image, const int extent[6], int threadCount,
+                                         VolumeHistogram *histogram) {
+    TRACE_SCOPE("cropVolume");
+    if (!image || image->GetScalarType() == VTK_VOID) {
+        return nullptr;
+    }
+    int dims[3];
+    image->GetDimensions(dims);
+    double origin[3], spacing[3];
+    image->GetOrigin(origin);
+    image->GetSpacing(spacing);
+    int outDims[3];
+    for (int k = 0; k < 3; ++k) {
+        if (extent[2 * k] < 0 || extent[2 * k + 1] >= dims[k] || extent[2 * k] > extent[2 * k + 1]) {
+            return nullptr;
+        }
+        outDims[k] = extent[2 * k + 1] - extent[2 * k] + 1;
+        origin[k] += extent[2 * k] * spacing[k];
+    }
+
+    vtkSmartPointer<vtkImageData> output = vtkSmartPointer<vtkImageData>::New();
+    output->SetDimensions(outDims);
+    output->SetSpacing(spacing);
+    output->SetOrigin(origin);
+    output->AllocateScalars(image->GetScalarType(), image->GetNumberOfScalarComponents());
+
+    const int components = image->GetNumberOfScalarComponents();
+    const void *in = image->GetScalarPointer();
+    void *out = output->GetScalarPointer();
+    if (histogram) {
+        histogram->clear();
+    }
+    switch (image->GetScalarType()) {
+        vtkTemplateMacro(copyExtent(static_cast<const VTK_TT *>(in), static_cast<VTK_TT *>(out),
+                                    dims, extent, components, threadCount, histogram, image->GetScalarType()));
+        default:
+            return nullptr;
+    }
+    return output;
+}
@@ -0,0 +1,27 @@
+#ifndef BODYCROP_H
+#define BODYCROP_H
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+
+#include "volumehistogram.h"
+
+// 加载后自动裁掉病人体外的空气和检查床，缩小三维渲染和切片管线处理的体数据
+struct BodyCropOptions {
+    double threshold = -500.0; // 高于它的体素视为病人或检查床 (HU)，MR 等非 CT 数据通常整体高于阈值，不会被裁剪
+    bool removeTable = true;   // 丢弃与身体之间隔着空气的前后方向结构 (检查床)
+    int margin = 2;            // 包围盒四周保留的体素数
+    int threadCount = 0;
+};
+
+// 包含病人的体素范围 {x0, x1, y0, y1, z0, z1}；没有高于阈值的体素时返回 false
+// 各行/列的前景体素数少于最大值的千分之一时视为噪声
+bool findBodyExtent(vtkImageData *image, const BodyCropOptions &options, int extent[6], bool *tableRemoved = nullptr);
+
+// 复制 extent 内的体素；原点移到裁剪后的第一个体素，世界坐标不变
+// 输出是新分配的体数据，调用方释放 image 之前两者同时占用内存
+// histogram 非空时先清空计数 (保留范围)，再统计裁剪后的体素
+vtkSmartPointer<vtkImageData> cropVolume(vtkImageData *image, const int extent[6], int threadCount = 0,
+                                         VolumeHistogram *histogram = nullptr);
+
+#endif // BODYCROP_H
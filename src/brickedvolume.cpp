@@ -0,0 +1,141 @@
+#include "brickedvolume.h"
+#include "parallelfor.h"
+#include "tracer.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const int B = BrickedVolume::BRICK_SIZE;
+
+// 输出少于这个体素数时单线程提取
+const size_t PARALLEL_THRESHOLD = 1 << 18;
+
+// 矢状面：每个输出元素取自块内 x = lx 的一列，N 为编译期元素大小
+template <size_t N>
+void copyColumn(const unsigned char *brick, unsigned char *out, int lx, int rows, int cols,
+                size_t outStride, size_t elementSize) {
+    for (int lz = 0; lz < rows; ++lz) {
+        const unsigned char *src = brick + ((static_cast<size_t>(lz) * B) * B + lx) * elementSize;
+        unsigned char *dst = out + outStride * lz;
+        for (int ly = 0; ly < cols; ++ly) {
+            std::memcpy(dst + ly * N, src + static_cast<size_t>(ly) * B * N, N);
+        }
+    }
+}
+
+void copyColumnAny(const unsigned char *brick, unsigned char *out, int lx, int rows, int cols,
+                   size_t outStride, size_t elementSize) {
+    for (int lz = 0; lz < rows; ++lz) {
+        const unsigned char *src = brick + ((static_cast<size_t>(lz) * B) * B + lx) * elementSize;
+        unsigned char *dst = out + outStride * lz;
+        for (int ly = 0; ly < cols; ++ly) {
+            std::memcpy(dst + ly * elementSize, src + static_cast<size_t>(ly) * B * elementSize, elementSize);
+        }
+    }
+}
+
+} // namespace
+
+BrickedVolume::BrickedVolume(vtkImageData *image, int threadCount)
+    : type(image->GetScalarType()), components(image->GetNumberOfScalarComponents())
+{
+    TRACE_SCOPE("BrickedVolume::build");
+    image->GetDimensions(dims);
+    for (int i = 0; i < 3; ++i) {
+        bricks[i] = (dims[i] + B - 1) / B;
+    }
+    elementSize = static_cast<size_t>(image->GetScalarSize()) * components;
+    totalBytes = static_cast<size_t>(bricks[0]) * bricks[1] * bricks[2] * B * B * B * elementSize;
+    storage.reset(new unsigned char[totalBytes]); // 不预先清零，补0在拷贝时完成
+
+    const unsigned char *src = static_cast<const unsigned char *>(image->GetScalarPointer());
+    const size_t nx = dims[0], ny = dims[1];
+    const size_t rowBytes = B * elementSize;
+
+    // 每个任务负责一行块 (固定 by, bz)，按源数据顺序逐行读取
+    parallelFor(0, bricks[1] * bricks[2], [&](int task, int) {
+        const int by = task % bricks[1];
+        const int bz = task / bricks[1];
+        for (int lz = 0; lz < B; ++lz) {
+            const int z = bz * B + lz;
+            for (int ly = 0; ly < B; ++ly) {
+                const int y = by * B + ly;
+                const bool inside = z < dims[2] && y < dims[1];
+                const unsigned char *srcRow = inside ? src + ((static_cast<size_t>(z) * ny + y) * nx) * elementSize : nullptr;
+                for (int bx = 0; bx < bricks[0]; ++bx) {
+                    unsigned char *dst = const_cast<unsigned char *>(brick(bx, by, bz))
+                        + (static_cast<size_t>(lz) * B + ly) * rowBytes;
+                    const size_t count = inside ? std::min<size_t>(B, nx - static_cast<size_t>(bx) * B) : 0;
+                    if (count > 0) {
+                        std::memcpy(dst, srcRow + static_cast<size_t>(bx) * rowBytes, count * elementSize);
+                    }
+                    if (count < static_cast<size_t>(B)) {
+                        std::memset(dst + count * elementSize, 0, (B - count) * elementSize);
+                    }
+                }
+            }
+        }
+    }, threadCount);
+}
+
+void BrickedVolume::extractSlice(int axis, int index, void *out, int threadCount) const {
+    unsigned char *dst = static_cast<unsigned char *>(out);
+    const size_t nx = dims[0], ny = dims[1], nz = dims[2];
+    const int b = index >> BRICK_SHIFT;
+    const int l = index & BRICK_MASK;
+    const size_t rowBytes = B * elementSize;
+
+    const size_t outputSize = axis == 0 ? ny * nz : (axis == 1 ? nx * nz : nx * ny);
+    if (outputSize < PARALLEL_THRESHOLD) {
+        threadCount = 1;
+    }
+
+    switch (axis) {
+        case 2: // 轴状面：每个块贡献 32 行连续数据
+            parallelFor(0, bricks[1], [&](int by, int) {
+                const int rows = std::min(B, dims[1] - by * B);
+                for (int bx = 0; bx < bricks[0]; ++bx) {
+                    const int cols = std::min(B, dims[0] - bx * B);
+                    const unsigned char *src = brick(bx, by, b) + static_cast<size_t>(l) * B * rowBytes;
+                    for (int ly = 0; ly < rows; ++ly) {
+                        std::memcpy(dst + ((static_cast<size_t>(by) * B + ly) * nx + bx * B) * elementSize,
+                                    src + ly * rowBytes, cols * elementSize);
+                    }
+                }
+            }, threadCount);
+            break;
+        case 1: // 冠状面：块内 y = l 的那一行
+            parallelFor(0, bricks[2], [&](int bz, int) {
+                const int rows = std::min(B, dims[2] - bz * B);
+                for (int bx = 0; bx < bricks[0]; ++bx) {
+                    const int cols = std::min(B, dims[0] - bx * B);
+                    const unsigned char *src = brick(bx, b, bz) + static_cast<size_t>(l) * rowBytes;
+                    for (int lz = 0; lz < rows; ++lz) {
+                        std::memcpy(dst + ((static_cast<size_t>(bz) * B + lz) * nx + bx * B) * elementSize,
+                                    src + static_cast<size_t>(lz) * B * rowBytes, cols * elementSize);
+                    }
+                }
+            }, threadCount);
+            break;
+        case 0: // 矢状面：块内 x = l 的一列
+            parallelFor(0, bricks[2], [&](int bz, int) {
+                const int rows = std::min(B, dims[2] - bz * B);
+                for (int by = 0; by < bricks[1]; ++by) {
+                    const int cols = std::min(B, dims[1] - by * B);
+                    const unsigned char *src = brick(b, by, bz);
+                    unsigned char *o = dst + (static_cast<size_t>(bz) * B * ny + static_cast<size_t>(by) * B) * elementSize;
+                    const size_t outStride = ny * elementSize;
+                    switch (elementSize) {
+                        case 1: copyColumn<1>(src, o, l, rows, cols, outStride, elementSize); break;
+                        case 2: copyColumn<2>(src, o, l, rows, cols, outStride, elementSize); break;
+                        case 4: copyColumn<4>(src, o, l, rows, cols, outStride, elementSize); break;
+                        case 8: copyColumn<8>(src, o, l, rows, cols, outStride, elementSize); break;
+                        default: copyColumnAny(src, o, l, rows, cols, outStride, elementSize); break;
+                    }
+                }
+            }, threadCount);
+            break;
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef BRICKEDVOLUME_H
+#define BRICKEDVOLUME_H
+
+#include <cstddef>
+#include <memory>
+
+#include <vtkImageData.h>
+
+// 分块 (32³) 存储的体数据副本
+// 普通的x最快排列中，矢状面相邻体素相距一整行，冠状面相邻行相距一整层，
+// 滚动这两个方向时几乎每个体素都落在不同的缓存行和内存页上。
+// 分块后任一方向的切片都只访问少量连续的 64KB 块 (16位数据)，三个方向的访问代价接近。
+// 边缘不足一块的部分补0。块内和块间都是x最快、z最慢。
+class BrickedVolume {
+public:
+    static const int BRICK_SHIFT = 5;
+    static const int BRICK_SIZE = 1 << BRICK_SHIFT;
+    static const int BRICK_MASK = BRICK_SIZE - 1;
+
+    // 从线性排列的体数据并行拷贝构建
+    explicit BrickedVolume(vtkImageData *image, int threadCount = 0);
+
+    const int *dimensions() const { return dims; }
+    const int *brickCounts() const { return bricks; }
+    int scalarType() const { return type; }
+    int numberOfComponents() const { return components; }
+    size_t elementBytes() const { return elementSize; }
+    size_t memoryBytes() const { return totalBytes; }
+    const unsigned char *data() const { return storage.get(); }
+
+    // 体素 (x, y, z) 在分块存储中的元素序号，乘以 elementBytes() 即字节偏移
+    size_t elementIndex(int x, int y, int z) const {
+        const size_t brick = (static_cast<size_t>(z >> BRICK_SHIFT) * bricks[1] + (y >> BRICK_SHIFT)) * bricks[0]
+            + (x >> BRICK_SHIFT);
+        const size_t local = ((static_cast<size_t>(z & BRICK_MASK) << BRICK_SHIFT) + (y & BRICK_MASK)) << BRICK_SHIFT
+            | (x & BRICK_MASK);
+        return (brick << (3 * BRICK_SHIFT)) + local;
+    }
+    const unsigned char *brick(int bx, int by, int bz) const {
+        const size_t index = (static_cast<size_t>(bz) * bricks[1] + by) * bricks[0] + bx;
+        return storage.get() + (index << (3 * BRICK_SHIFT)) * elementSize;
+    }
+
+    // 提取正交切片，out 的排列与 SliceExtractor 的输出相同 (axis: 0=X, 1=Y, 2=Z)
+    void extractSlice(int axis, int index, void *out, int threadCount = 0) const;
+
+private:
+    int dims[3];
+    int bricks[3];
+    int type;
+    int components;
+    size_t elementSize;
+    size_t totalBytes;
+    std::unique_ptr<unsigned char[]> storage;
+};
+
+#endif // BRICKEDVOLUME_H
@@ -0,0 +1,655 @@
+#include "chunkedvolume.h"
+#include "paralleldicomreader.h"
+#include "parallelfor.h"
+#include "tracer.h"
+
+#include <vtkAbstractArray.h>
+#include <vtkSetGet.h>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX // windows.h 的 min/max 宏会破坏 std::min/std::max
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <type_traits>
+
+const int64_t ChunkedVolume::DEFAULT_CACHE_BYTES = 1024LL * 1024 * 1024;
+
+namespace {
+
+const char CHUNK_MAGIC[8] = {'D', 'V', 'C', 'H', 'U', 'N', 'K', 1};
+const uint64_t DATA_OFFSET = 4096; // 元数据头占一页，块从页边界开始
+const int CHUNK_SIZE = ChunkedVolume::CHUNK_SIZE;
+const int CHUNK_SHIFT = ChunkedVolume::CHUNK_SHIFT;
+const int CHUNK_MASK = CHUNK_SIZE - 1;
+
+// 存储文件的元数据头
+struct ChunkedHeader {
+    char magic[8];
+    uint64_t fingerprint;
+    int32_t dimensions[3];
+    int32_t scalarType;
+    int32_t components;
+    int32_t chunkSize;
+    int32_t levels;
+    int32_t reserved;
+    double spacing[3];
+    double origin[3];
+    uint64_t histogramOffset;
+    uint64_t histogramBytes;
+    uint64_t fileBytes;
+};
+
+// 各层的尺寸、块数和在文件中的偏移，构建和打开时由第0层尺寸推出
+struct Layout {
+    int levels = 0;
+    int dims[ChunkedVolume::MAX_LEVELS][3];
+    int counts[ChunkedVolume::MAX_LEVELS][3];
+    uint64_t offsets[ChunkedVolume::MAX_LEVELS];
+    uint64_t end = 0; // 最后一层之后，直方图从这里开始
+
+    uint64_t offset(int level, int cx, int cy, int cz, size_t chunkBytes) const {
+        const uint64_t index = (static_cast<uint64_t>(cz) * counts[level][1] + cy) * counts[level][0] + cx;
+        return offsets[level] + index * chunkBytes;
+    }
+    int chunksIn(int level) const { return counts[level][0] * counts[level][1] * counts[level][2]; }
+};
+
+// 每层各方向减半 (向上取整)，直到整层只剩一块
+Layout makeLayout(const int dims[3], size_t chunkBytes) {
+    Layout layout;
+    uint64_t offset = DATA_OFFSET;
+    int d[3] = {dims[0], dims[1], dims[2]};
+    for (int level = 0; level < ChunkedVolume::MAX_LEVELS; ++level) {
+        for (int k = 0; k < 3; ++k) {
+            layout.dims[level][k] = d[k];
+            layout.counts[level][k] = (d[k] + CHUNK_MASK) >> CHUNK_SHIFT;
+        }
+        layout.offsets[level] = offset;
+        offset += static_cast<uint64_t>(layout.chunksIn(level)) * chunkBytes;
+        layout.levels = level + 1;
+        if (std::max({d[0], d[1], d[2]}) <= CHUNK_SIZE) {
+            break;
+        }
+        for (int k = 0; k < 3; ++k) {
+            d[k] = std::max(1, (d[k] + 1) / 2);
+        }
+    }
+    layout.end = offset;
+    return layout;
+}
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// 由上一层 2x2x2 的 8 个源块 (缺失的方向重复最后一块) 平均出一块，源坐标超出上一层尺寸时取边缘体素
+template <typename T>
+void downsampleChunk(const std::vector<char> *sources[8], char *out, const int srcDims[3], const int dstDims[3],
+                     const int chunk[3], int components) {
+    T *dst = reinterpret_cast<T *>(out);
+    int limit[3];
+    for (int k = 0; k < 3; ++k) {
+        limit[k] = std::min(CHUNK_SIZE, dstDims[k] - (chunk[k] << CHUNK_SHIFT));
+    }
+    for (int z = 0; z < limit[2]; ++z) {
+        for (int y = 0; y < limit[1]; ++y) {
+            for (int x = 0; x < limit[0]; ++x) {
+                const int local[3] = {x, y, z};
+                for (int c = 0; c < components; ++c) {
+                    double sum = 0.0;
+                    for (int corner = 0; corner < 8; ++corner) {
+                        int which = 0, offset = 0;
+                        for (int k = 2; k >= 0; --k) {
+                            const int target = (chunk[k] << CHUNK_SHIFT) + local[k];
+                            const int src = std::min(2 * target + ((corner >> k) & 1), srcDims[k] - 1);
+                            which = which * 2 + ((src >> CHUNK_SHIFT) - 2 * chunk[k]);
+                            offset = offset * CHUNK_SIZE + (src & CHUNK_MASK);
+                        }
+                        // which 按 z、y、x 展开，与源块的排列相同
+                        sum += reinterpret_cast<const T *>(sources[which]->data())[static_cast<size_t>(offset) * components + c];
+                    }
+                    const double mean = sum / 8.0;
+                    dst[((static_cast<size_t>(z) * CHUNK_SIZE + y) * CHUNK_SIZE + x) * components + c] =
+                        std::is_integral<T>::value ? static_cast<T>(std::floor(mean + 0.5)) : static_cast<T>(mean);
+                }
+            }
+        }
+    }
+}
+
+} // namespace
+
+// --- 按偏移读写的文件，多个线程可以同时读写不同位置 ---
+
+class ChunkedVolume::File {
+public:
+    ~File() { close(); }
+
+    bool open(const std::string &path, bool create) {
+#ifdef _WIN32
+        handle = CreateFileW(std::filesystem::u8path(path).wstring().c_str(),
+                             create ? (GENERIC_READ | GENERIC_WRITE) : GENERIC_READ, FILE_SHARE_READ, nullptr,
+                             create ? CREATE_ALWAYS : OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+        return handle != INVALID_HANDLE_VALUE;
+#else
+        fd = create ? ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)
+                    : ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        return fd >= 0;
+#endif
+    }
+
+    bool read(uint64_t offset, void *data, size_t bytes) const {
+        char *p = static_cast<char *>(data);
+        while (bytes > 0) {
+#ifdef _WIN32
+            OVERLAPPED overlapped = {};
+            overlapped.Offset = static_cast<DWORD>(offset);
+            overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+            DWORD done = 0;
+            if (!ReadFile(handle, p, static_cast<DWORD>(std::min<size_t>(bytes, 1u << 30)), &done, &overlapped)
+                || done == 0) {
+                return false;
+            }
+#else
+            const ssize_t done = ::pread(fd, p, bytes, static_cast<off_t>(offset));
+            if (done <= 0) {
+                return false;
+            }
+#endif
+            p += done;
+            offset += done;
+            bytes -= done;
+        }
+        return true;
+    }
+
+    bool write(uint64_t offset, const void *data, size_t bytes) {
+        const char *p = static_cast<const char *>(data);
+        while (bytes > 0) {
+#ifdef _WIN32
+            OVERLAPPED overlapped = {};
+            overlapped.Offset = static_cast<DWORD>(offset);
+            overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+            DWORD done = 0;
+            if (!WriteFile(handle, p, static_cast<DWORD>(std::min<size_t>(bytes, 1u << 30)), &done, &overlapped)
+                || done == 0) {
+                return false;
+            }
+#else
+            const ssize_t done = ::pwrite(fd, p, bytes, static_cast<off_t>(offset));
+            if (done <= 0) {
+                return false;
+            }
+#endif
+            p += done;
+            offset += done;
+            bytes -= done;
+        }
+        return true;
+    }
+
+    int64_t size() const {
+#ifdef _WIN32
+        LARGE_INTEGER value;
+        return GetFileSizeEx(handle, &value) ? value.QuadPart : -1;
+#else
+        struct stat info;
+        return fstat(fd, &info) == 0 ? static_cast<int64_t>(info.st_size) : -1;
+#endif
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (handle != INVALID_HANDLE_VALUE) {
+            CloseHandle(handle);
+            handle = INVALID_HANDLE_VALUE;
+        }
+#else
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+#endif
+    }
+
+private:
+#ifdef _WIN32
+    HANDLE handle = INVALID_HANDLE_VALUE;
+#else
+    int fd = -1;
+#endif
+};
+
+// --- 构建 ---
+
+bool ChunkedVolume::build(ParallelDICOMReader &reader, const std::string &path, const BuildOptions &options,
+                          std::string *error) {
+    TRACE_SCOPE("ChunkedVolume::build");
+    const std::string partial = path + ".partial";
+    std::error_code ec;
+    auto fail = [&](const std::string &message) {
+        std::filesystem::remove(std::filesystem::u8path(partial), ec);
+        if (error) {
+            *error = message;
+        }
+        return false;
+    };
+    auto canceled = [&]() { return options.cancel && options.cancel->load(); };
+
+    if (!reader.beginStreaming()) {
+        return fail(reader.errorMessage());
+    }
+    const int *dims = reader.dimensions();
+    const int type = reader.scalarType();
+    const int components = reader.numberOfComponents();
+    const size_t elementSize = static_cast<size_t>(vtkAbstractArray::GetDataTypeSize(type)) * components;
+    const size_t chunkBytes = elementSize << (3 * CHUNK_SHIFT);
+    const Layout layout = makeLayout(dims, chunkBytes);
+    const int workers = options.threadCount > 0 ? options.threadCount : defaultThreadCount();
+
+    std::filesystem::create_directories(std::filesystem::u8path(path).parent_path(), ec);
+    File out;
+    if (!out.open(partial, true)) {
+        return fail("无法创建核外存储文件: " + partial);
+    }
+
+    try {
+        // 第0层：每次解码 32 层，切成一排块写出
+        const size_t sliceBytes = static_cast<size_t>(dims[0]) * dims[1] * elementSize;
+        std::vector<char> slab(sliceBytes * CHUNK_SIZE);
+        std::vector<std::vector<char>> buffers(workers, std::vector<char>(chunkBytes));
+        const int *counts = layout.counts[0];
+        for (int cz = 0; cz < counts[2]; ++cz) {
+            const int z0 = cz << CHUNK_SHIFT;
+            const int depth = std::min(CHUNK_SIZE, dims[2] - z0);
+            if (!reader.decodeRange(slab.data(), z0, z0 + depth)) {
+                out.close();
+                return fail(reader.wasCanceled() ? "已取消" : reader.errorMessage());
+            }
+            parallelFor(0, counts[0] * counts[1], [&](int i, int threadIndex) {
+                std::vector<char> &buffer = buffers[threadIndex];
+                std::fill(buffer.begin(), buffer.end(), 0);
+                const int cx = i % counts[0], cy = i / counts[0];
+                const int x0 = cx << CHUNK_SHIFT, y0 = cy << CHUNK_SHIFT;
+                const int width = std::min(CHUNK_SIZE, dims[0] - x0);
+                const int height = std::min(CHUNK_SIZE, dims[1] - y0);
+                for (int z = 0; z < depth; ++z) {
+                    for (int y = 0; y < height; ++y) {
+                        std::memcpy(buffer.data() + ((static_cast<size_t>(z) * CHUNK_SIZE + y) << CHUNK_SHIFT) * elementSize,
+                                    slab.data() + ((static_cast<size_t>(z) * dims[1] + y0 + y) * dims[0] + x0) * elementSize,
+                                    width * elementSize);
+                    }
+                }
+                if (!out.write(layout.offset(0, cx, cy, cz, chunkBytes), buffer.data(), chunkBytes)) {
+                    throw std::runtime_error("写入核外存储失败: " + partial);
+                }
+            }, workers);
+        }
+
+        // 金字塔：逐层由上一层的块平均得到，源块直接从刚写出的文件读回，内存中只有每个线程的 9 块
+        int total = 0, done = 0;
+        for (int level = 1; level < layout.levels; ++level) {
+            total += layout.chunksIn(level);
+        }
+        std::vector<std::vector<std::vector<char>>> sources(workers, std::vector<std::vector<char>>(8, std::vector<char>(chunkBytes)));
+        std::mutex progressMutex;
+        for (int level = 1; level < layout.levels; ++level) {
+            const int *counts = layout.counts[level];
+            const int *srcCounts = layout.counts[level - 1];
+            parallelFor(0, layout.chunksIn(level), [&](int i, int threadIndex) {
+                if (canceled()) {
+                    return;
+                }
+                const int chunk[3] = {i % counts[0], (i / counts[0]) % counts[1], i / (counts[0] * counts[1])};
+                const std::vector<char> *inputs[8];
+                for (int corner = 0; corner < 8; ++corner) {
+                    const int sx = std::min(2 * chunk[0] + (corner & 1), srcCounts[0] - 1);
+                    const int sy = std::min(2 * chunk[1] + ((corner >> 1) & 1), srcCounts[1] - 1);
+                    const int sz = std::min(2 * chunk[2] + ((corner >> 2) & 1), srcCounts[2] - 1);
+                    std::vector<char> &source = sources[threadIndex][corner];
+                    if (!out.read(layout.offset(level - 1, sx, sy, sz, chunkBytes), source.data(), chunkBytes)) {
+                        throw std::runtime_error("读取核外存储失败: " + partial);
+                    }
+                    inputs[corner] = &source;
+                }
+                std::vector<char> &buffer = buffers[threadIndex];
+                std::fill(buffer.begin(), buffer.end(), 0);
+                switch (type) {
+                    vtkTemplateMacro(downsampleChunk<VTK_TT>(inputs, buffer.data(), layout.dims[level - 1],
+                                                             layout.dims[level], chunk, components));
+                }
+                if (!out.write(layout.offset(level, chunk[0], chunk[1], chunk[2], chunkBytes), buffer.data(), chunkBytes)) {
+                    throw std::runtime_error("写入核外存储失败: " + partial);
+                }
+                if (options.progress) {
+                    std::lock_guard<std::mutex> lock(progressMutex);
+                    options.progress(++done, total, "构建分辨率金字塔");
+                }
+            }, workers);
+            if (canceled()) {
+                out.close();
+                return fail("已取消");
+            }
+        }
+    } catch (std::exception &e) {
+        out.close();
+        return fail(e.what());
+    }
+
+    // 直方图跟在最后一层之后，元数据头最后写入
+    const std::string histogram = reader.histogram().serialize();
+    ChunkedHeader header = {};
+    std::memcpy(header.magic, CHUNK_MAGIC, sizeof(CHUNK_MAGIC));
+    header.fingerprint = options.fingerprint;
+    for (int k = 0; k < 3; ++k) {
+        header.dimensions[k] = dims[k];
+        header.spacing[k] = reader.spacing()[k];
+        header.origin[k] = reader.origin()[k];
+    }
+    header.scalarType = type;
+    header.components = components;
+    header.chunkSize = CHUNK_SIZE;
+    header.levels = layout.levels;
+    header.histogramOffset = layout.end;
+    header.histogramBytes = histogram.size();
+    header.fileBytes = layout.end + histogram.size();
+    const bool written = out.write(layout.end, histogram.data(), histogram.size())
+        && out.write(0, &header, sizeof(header));
+    out.close();
+    if (!written) {
+        return fail("写入核外存储失败: " + partial);
+    }
+    std::filesystem::remove(std::filesystem::u8path(path), ec);
+    std::filesystem::rename(std::filesystem::u8path(partial), std::filesystem::u8path(path), ec);
+    if (ec) {
+        return fail("无法重命名核外存储文件: " + ec.message());
+    }
+    return true;
+}
+
+// --- 打开 ---
+
+ChunkedVolume::ChunkedVolume()
+    : file(new File), levelCount(0), type(VTK_VOID), components(1), elementSize(0), chunkBytes(0),
+      totalFileBytes(0), threads(0), cacheBytes(0), maxCacheBytes(DEFAULT_CACHE_BYTES)
+{
+}
+
+ChunkedVolume::~ChunkedVolume() = default;
+
+std::shared_ptr<ChunkedVolume> ChunkedVolume::open(const std::string &path, uint64_t fingerprint, std::string *error) {
+    auto fail = [&](const std::string &message) {
+        if (error) {
+            *error = message;
+        }
+        return nullptr;
+    };
+    std::shared_ptr<ChunkedVolume> volume(new ChunkedVolume());
+    if (!volume->file->open(path, false)) {
+        return fail("核外存储文件不存在: " + path);
+    }
+    ChunkedHeader header;
+    if (!volume->file->read(0, &header, sizeof(header))
+        || std::memcmp(header.magic, CHUNK_MAGIC, sizeof(CHUNK_MAGIC)) != 0
+        || header.chunkSize != CHUNK_SIZE || header.components < 1) {
+        return fail("核外存储文件格式不符: " + path);
+    }
+    if (header.fingerprint != fingerprint) {
+        return fail("序列目录已变化，核外存储需要重建");
+    }
+    const int typeSize = vtkAbstractArray::GetDataTypeSize(header.scalarType);
+    if (typeSize <= 0 || header.dimensions[0] < 1 || header.dimensions[1] < 1 || header.dimensions[2] < 1) {
+        return fail("核外存储文件格式不符: " + path);
+    }
+
+    volume->type = header.scalarType;
+    volume->components = header.components;
+    volume->elementSize = static_cast<size_t>(typeSize) * header.components;
+    volume->chunkBytes = volume->elementSize << (3 * CHUNK_SHIFT);
+    const int dims[3] = {header.dimensions[0], header.dimensions[1], header.dimensions[2]};
+    const Layout layout = makeLayout(dims, volume->chunkBytes);
+    if (layout.levels != header.levels || header.histogramOffset != layout.end
+        || volume->file->size() < static_cast<int64_t>(header.fileBytes)) {
+        return fail("核外存储文件不完整: " + path);
+    }
+    volume->levelCount = layout.levels;
+    for (int level = 0; level < layout.levels; ++level) {
+        for (int k = 0; k < 3; ++k) {
+            volume->levelDims[level][k] = layout.dims[level][k];
+            volume->chunkCounts[level][k] = layout.counts[level][k];
+        }
+        volume->levelOffsets[level] = layout.offsets[level];
+    }
+    for (int k = 0; k < 3; ++k) {
+        volume->volumeSpacing[k] = header.spacing[k];
+        volume->volumeOrigin[k] = header.origin[k];
+    }
+    volume->totalFileBytes = static_cast<int64_t>(header.fileBytes);
+
+    if (header.histogramBytes > 0) {
+        std::vector<char> bytes(header.histogramBytes);
+        if (!volume->file->read(header.histogramOffset, bytes.data(), bytes.size())
+            || !volume->valueHistogram.deserialize(bytes.data(), bytes.size())) {
+            volume->valueHistogram = VolumeHistogram();
+        }
+    }
+    return volume;
+}
+
+// --- 几何 ---
+
+void ChunkedVolume::levelDimensions(int level, int dims[3]) const {
+    level = std::max(0, std::min(level, levelCount - 1));
+    std::copy(levelDims[level], levelDims[level] + 3, dims);
+}
+
+void ChunkedVolume::levelGeometry(int level, double spacing[3], double origin[3]) const {
+    level = std::max(0, std::min(level, levelCount - 1));
+    const double scale = static_cast<double>(1 << level);
+    for (int k = 0; k < 3; ++k) {
+        spacing[k] = volumeSpacing[k] * scale;
+        origin[k] = volumeOrigin[k] + volumeSpacing[k] * (scale - 1.0) / 2.0;
+    }
+}
+
+int64_t ChunkedVolume::levelBytes(int level) const {
+    const int *d = levelDims[std::max(0, std::min(level, levelCount - 1))];
+    return static_cast<int64_t>(d[0]) * d[1] * d[2] * static_cast<int64_t>(elementSize);
+}
+
+int ChunkedVolume::finestLevelWithin(int64_t bytes) const {
+    for (int level = 0; level < levelCount; ++level) {
+        if (levelBytes(level) <= bytes) {
+            return level;
+        }
+    }
+    return levelCount - 1;
+}
+
+// --- 块缓存 ---
+
+void ChunkedVolume::setCacheBudget(int64_t bytes) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    maxCacheBytes = bytes;
+    evictLocked();
+}
+
+int64_t ChunkedVolume::cacheBudget() const {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    return maxCacheBytes;
+}
+
+int64_t ChunkedVolume::cachedBytes() const {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    return cacheBytes;
+}
+
+ChunkedVolume::Statistics ChunkedVolume::statistics() const {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    return stats;
+}
+
+void ChunkedVolume::evictLocked() const {
+    // 正在被切片提取使用的块由 shared_ptr 保持，淘汰只是不再缓存
+    while (cacheBytes > maxCacheBytes && !entries.empty()) {
+        cacheBytes -= static_cast<int64_t>(chunkBytes);
+        lookup.erase(entries.back().key);
+        entries.pop_back();
+    }
+}
+
+uint64_t ChunkedVolume::chunkOffset(int level, int cx, int cy, int cz) const {
+    const int *counts = chunkCounts[level];
+    return levelOffsets[level] + ((static_cast<uint64_t>(cz) * counts[1] + cy) * counts[0] + cx) * chunkBytes;
+}
+
+// 读取在锁外进行，多个线程可同时读取不同的块；两个线程同时未命中同一块时各读一次，只缓存一份
+ChunkedVolume::ChunkData ChunkedVolume::chunk(int level, int cx, int cy, int cz, bool cacheResult) const {
+    const int *counts = chunkCounts[level];
+    const uint64_t key = (static_cast<uint64_t>(level) << 56)
+        | ((static_cast<uint64_t>(cz) * counts[1] + cy) * counts[0] + cx);
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        auto it = lookup.find(key);
+        if (it != lookup.end()) {
+            ++stats.cacheHits;
+            entries.splice(entries.begin(), entries, it->second);
+            return it->second->data;
+        }
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    std::shared_ptr<std::vector<char>> data = std::make_shared<std::vector<char>>(chunkBytes);
+    if (!file->read(chunkOffset(level, cx, cy, cz), data->data(), chunkBytes)) {
+        throw std::runtime_error("读取核外存储失败");
+    }
+    const double ms = millisecondsSince(start);
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    ++stats.chunkReads;
+    stats.bytesRead += static_cast<int64_t>(chunkBytes);
+    stats.readMs += ms;
+    if (cacheResult && lookup.find(key) == lookup.end()) {
+        entries.push_front(CacheEntry{key, data});
+        lookup[key] = entries.begin();
+        cacheBytes += static_cast<int64_t>(chunkBytes);
+        evictLocked();
+    }
+    return data;
+}
+
+// --- 读取 ---
+
+// 只访问与平面相交的一排块，每块拷贝其中的一层 (轴状面、冠状面逐行拷贝，矢状面按步长收集)
+bool ChunkedVolume::extractSlice(int axis, int index, void *out, int level, std::string *error) const {
+    TRACE_SCOPE("ChunkedVolume::extractSlice");
+    if (axis < 0 || axis > 2 || level < 0 || level >= levelCount
+        || index < 0 || index >= levelDims[level][axis]) {
+        if (error) {
+            *error = "切片超出核外存储范围";
+        }
+        return false;
+    }
+    const int *dims = levelDims[level];
+    const int *counts = chunkCounts[level];
+    const int u = axis == 0 ? 1 : 0; // 输出的行方向
+    const int v = axis == 2 ? 1 : 2; // 输出的列方向
+    const int local = index & CHUNK_MASK;
+    unsigned char *dst = static_cast<unsigned char *>(out);
+    const size_t e = elementSize;
+
+    try {
+        parallelFor(0, counts[u] * counts[v], [&](int i, int) {
+            int c[3];
+            c[axis] = index >> CHUNK_SHIFT;
+            c[u] = i % counts[u];
+            c[v] = i / counts[u];
+            const ChunkData data = chunk(level, c[0], c[1], c[2], true);
+            const unsigned char *src = reinterpret_cast<const unsigned char *>(data->data());
+            const int u0 = c[u] << CHUNK_SHIFT, v0 = c[v] << CHUNK_SHIFT;
+            const int width = std::min(CHUNK_SIZE, dims[u] - u0);
+            const int height = std::min(CHUNK_SIZE, dims[v] - v0);
+            for (int j = 0; j < height; ++j) {
+                unsigned char *row = dst + (static_cast<size_t>(v0 + j) * dims[u] + u0) * e;
+                if (axis == 2) {
+                    std::memcpy(row, src + ((static_cast<size_t>(local) * CHUNK_SIZE + j) << CHUNK_SHIFT) * e, width * e);
+                } else if (axis == 1) {
+                    std::memcpy(row, src + ((static_cast<size_t>(j) * CHUNK_SIZE + local) << CHUNK_SHIFT) * e, width * e);
+                } else {
+                    for (int k = 0; k < width; ++k) {
+                        std::memcpy(row + k * e,
+                                    src + (((static_cast<size_t>(j) * CHUNK_SIZE + k) << CHUNK_SHIFT) + local) * e, e);
+                    }
+                }
+            }
+        }, threads);
+    } catch (std::exception &e) {
+        if (error) {
+            *error = e.what();
+        }
+        return false;
+    }
+    return true;
+}
+
+vtkSmartPointer<vtkImageData> ChunkedVolume::readLevel(int level, const std::atomic<bool> *cancel) const {
+    TRACE_SCOPE("ChunkedVolume::readLevel");
+    if (level < 0 || level >= levelCount) {
+        return nullptr;
+    }
+    const int *dims = levelDims[level];
+    const int *counts = chunkCounts[level];
+    double spacing[3], origin[3];
+    levelGeometry(level, spacing, origin);
+
+    vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+    image->SetDimensions(dims[0], dims[1], dims[2]);
+    image->SetSpacing(spacing);
+    image->SetOrigin(origin);
+    image->AllocateScalars(type, components);
+    unsigned char *base = static_cast<unsigned char *>(image->GetScalarPointer());
+    const size_t e = elementSize;
+
+    try {
+        parallelFor(0, counts[0] * counts[1] * counts[2], [&](int i, int) {
+            if (cancel && cancel->load()) {
+                return;
+            }
+            const int cx = i % counts[0], cy = (i / counts[0]) % counts[1], cz = i / (counts[0] * counts[1]);
+            const ChunkData data = chunk(level, cx, cy, cz, false);
+            const int x0 = cx << CHUNK_SHIFT, y0 = cy << CHUNK_SHIFT, z0 = cz << CHUNK_SHIFT;
+            const int width = std::min(CHUNK_SIZE, dims[0] - x0);
+            const int height = std::min(CHUNK_SIZE, dims[1] - y0);
+            const int depth = std::min(CHUNK_SIZE, dims[2] - z0);
+            for (int z = 0; z < depth; ++z) {
+                for (int y = 0; y < height; ++y) {
+                    std::memcpy(base + ((static_cast<size_t>(z0 + z) * dims[1] + y0 + y) * dims[0] + x0) * e,
+                                data->data() + ((static_cast<size_t>(z) * CHUNK_SIZE + y) << CHUNK_SHIFT) * e,
+                                width * e);
+                }
+            }
+        }, threads);
+    } catch (std::exception &) {
+        return nullptr;
+    }
+    if (cancel && cancel->load()) {
+        return nullptr;
+    }
+    return image;
+}
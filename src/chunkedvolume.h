@@ -0,0 +1,120 @@
+#ifndef CHUNKEDVOLUME_H
+#define CHUNKEDVOLUME_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+
+#include "volumehistogram.h"
+
+class ParallelDICOMReader;
+
+// 核外体数据：超出内存的序列按 32³ 分块保存在磁盘上的一个存储文件中
+// 文件包含全分辨率 (第0层) 和逐级 2x2x2 平均得到的金字塔，块内和块间都是x最快、z最慢 (与 BrickedVolume 相同)，
+// 边缘不足一块的部分补0。切片只读取与平面相交的块，读到的块放入按字节预算淘汰的 LRU 缓存，
+// 滚动时同一排块内的后续切片直接命中。三维视图使用能放进内存预算的最细一层。
+// 构建时按 32 层的层块流式解码，只占用一个层块的内存。所有读取方法线程安全。
+class ChunkedVolume {
+public:
+    static const int CHUNK_SHIFT = 5;
+    static const int CHUNK_SIZE = 1 << CHUNK_SHIFT;
+    static const int MAX_LEVELS = 8;
+    static const int64_t DEFAULT_CACHE_BYTES;
+
+    using ProgressCallback = std::function<void(int current, int total, const char *stage)>;
+
+    struct BuildOptions {
+        uint64_t fingerprint = 0; // 源目录指纹，打开时不一致则需要重建
+        int threadCount = 0;
+        ProgressCallback progress; // 构建金字塔时逐块汇报，解码阶段由读取器自己汇报
+        const std::atomic<bool> *cancel = nullptr;
+    };
+
+    struct Statistics {
+        int64_t chunkReads = 0; // 从磁盘读取的块
+        int64_t cacheHits = 0;
+        int64_t bytesRead = 0;
+        double readMs = 0.0;    // 各线程读取耗时之和
+    };
+
+    // 读取器已完成 scanDirectory；先写入 path.partial，完成后改名，中途失败或取消时删除
+    static bool build(ParallelDICOMReader &reader, const std::string &path, const BuildOptions &options,
+                      std::string *error = nullptr);
+    // 文件不存在、格式不符或指纹不一致时返回空指针
+    static std::shared_ptr<ChunkedVolume> open(const std::string &path, uint64_t fingerprint,
+                                               std::string *error = nullptr);
+
+    ~ChunkedVolume();
+
+    int levels() const { return levelCount; }
+    void levelDimensions(int level, int dims[3]) const;
+    const int *dimensions() const { return levelDims[0]; }
+    // 第 level 层的间距放大 2^level 倍，原点移到第一个 2^level 体素块的中心，世界坐标与第0层一致
+    void levelGeometry(int level, double spacing[3], double origin[3]) const;
+    int scalarType() const { return type; }
+    int numberOfComponents() const { return components; }
+    size_t elementBytes() const { return elementSize; }
+    int64_t levelBytes(int level) const; // 不含补齐部分，即读出为 vtkImageData 后的大小
+    int64_t fileBytes() const { return totalFileBytes; }
+    const VolumeHistogram &histogram() const { return valueHistogram; }
+    // 整层大小不超过 bytes 的最细一层，都超过时返回最粗一层
+    int finestLevelWithin(int64_t bytes) const;
+
+    void setCacheBudget(int64_t bytes);
+    int64_t cacheBudget() const;
+    int64_t cachedBytes() const;
+    void setThreadCount(int count) { threads = count; } // 0 表示硬件并发数
+    Statistics statistics() const;
+
+    // 把第 level 层的正交切片写入 out，排列与 SliceExtractor 的输出相同
+    // axis 为切片法线方向：0=矢状面(X)，1=冠状面(Y)，2=轴状面(Z)；读取失败时返回 false 并写入 error，out 的内容不确定
+    bool extractSlice(int axis, int index, void *out, int level = 0, std::string *error = nullptr) const;
+    // 读出整个第 level 层；读到的块不进缓存，不会挤掉切片正在使用的块。失败或取消时返回空指针
+    vtkSmartPointer<vtkImageData> readLevel(int level, const std::atomic<bool> *cancel = nullptr) const;
+
+private:
+    class File;
+    using ChunkData = std::shared_ptr<const std::vector<char>>;
+    struct CacheEntry {
+        uint64_t key;
+        ChunkData data;
+    };
+
+    ChunkedVolume();
+    ChunkData chunk(int level, int cx, int cy, int cz, bool cacheResult) const; // 读取失败时抛出 std::runtime_error
+    uint64_t chunkOffset(int level, int cx, int cy, int cz) const;
+    void evictLocked() const;
+
+    std::unique_ptr<File> file;
+    int levelCount;
+    int levelDims[MAX_LEVELS][3];
+    int chunkCounts[MAX_LEVELS][3];
+    uint64_t levelOffsets[MAX_LEVELS];
+    double volumeSpacing[3];
+    double volumeOrigin[3];
+    int type;
+    int components;
+    size_t elementSize;
+    size_t chunkBytes;
+    int64_t totalFileBytes;
+    VolumeHistogram valueHistogram;
+    int threads;
+
+    mutable std::mutex cacheMutex;
+    mutable std::list<CacheEntry> entries; // 表头为最近使用
+    mutable std::unordered_map<uint64_t, std::list<CacheEntry>::iterator> lookup;
+    mutable int64_t cacheBytes;
+    int64_t maxCacheBytes;
+    mutable Statistics stats;
+};
+
+#endif // CHUNKEDVOLUME_H
@@ -0,0 +1,248 @@
+#include "cineplayer.h"
+#include "memoryfootprint.h"
+#include "volumeresample.h"
+#include "windowlevel.h"
+#include "tracer.h"
+
+#include <algorithm>
+#include <chrono>
+
+qint64 CineSeries::bytes() const {
+    qint64 total = 0;
+    for (const vtkSmartPointer<vtkImageData> &phase : phases) {
+        total += MemoryFootprint::imageBytes(phase);
+    }
+    return total;
+}
+
+CinePlayer::CinePlayer(QObject *parent)
+    : QObject(parent), fps(DEFAULT_FRAME_RATE), lastFrameNumber(0),
+      backReady(false), pendingPhase(-1), generation(0),
+      viewWindow(400.0), viewLevel(40.0), viewFactor(1), stopping(false)
+{
+    std::fill(viewSlices, viewSlices + 3, -1);
+    frameTimer.setSingleShot(true);
+    frameTimer.setTimerType(Qt::PreciseTimer);
+    connect(&frameTimer, &QTimer::timeout, this, &CinePlayer::tick);
+    worker = std::thread(&CinePlayer::run, this);
+}
+
+CinePlayer::~CinePlayer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    worker.join();
+}
+
+void CinePlayer::setSeries(std::shared_ptr<const CineSeries> series) {
+    pause();
+    cine = series && series->count() > 0 ? series : nullptr;
+    front = Frame();
+    if (cine) {
+        front.phase = 0;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    preparing = cine;
+    proxies.assign(cine ? cine->count() : 0, nullptr);
+    stats = Statistics();
+    requestPrepareLocked(cine && cine->count() > 1 ? 1 : -1);
+}
+
+void CinePlayer::setView(const int slices[3], double window, double level, int volumeFactor) {
+    volumeFactor = std::max(1, volumeFactor);
+    std::lock_guard<std::mutex> lock(mutex);
+    if (std::equal(slices, slices + 3, viewSlices) && window == viewWindow && level == viewLevel
+        && volumeFactor == viewFactor) {
+        return;
+    }
+    std::copy(slices, slices + 3, viewSlices);
+    viewWindow = window;
+    viewLevel = level;
+    if (volumeFactor != viewFactor) {
+        viewFactor = volumeFactor;
+        proxies.assign(proxies.size(), nullptr);
+    }
+    // 已准备好的下一帧按旧视图生成，重新准备
+    if (cine && cine->count() > 1) {
+        requestPrepareLocked((front.phase + 1) % cine->count());
+    }
+}
+
+void CinePlayer::setFrameRate(int newFps) {
+    fps = std::max(1, std::min(newFps, 120));
+    if (isPlaying()) {
+        // 从当前时刻按新帧率重新计时
+        clock.start();
+        lastFrameNumber = 0;
+        scheduleNextFrame();
+    }
+}
+
+void CinePlayer::play() {
+    if (!cine || cine->count() < 2 || isPlaying()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats = Statistics();
+    }
+    clock.start();
+    lastFrameNumber = 0;
+    scheduleNextFrame();
+}
+
+void CinePlayer::pause() {
+    frameTimer.stop();
+}
+
+void CinePlayer::seek(int phase) {
+    if (!cine || phase < 0 || phase >= cine->count() || phase == front.phase) {
+        return;
+    }
+    front = Frame();
+    front.phase = phase;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        requestPrepareLocked((phase + 1) % cine->count());
+    }
+    if (isPlaying()) {
+        clock.start();
+        lastFrameNumber = 0;
+        scheduleNextFrame();
+    }
+    emit phaseChanged(phase);
+}
+
+CinePlayer::Statistics CinePlayer::statistics() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    Statistics result = stats;
+    if (isPlaying()) {
+        result.elapsedSeconds = clock.elapsed() / 1000.0;
+    }
+    return result;
+}
+
+qint64 CinePlayer::proxyBytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    qint64 total = 0;
+    for (const vtkSmartPointer<vtkImageData> &proxy : proxies) {
+        total += MemoryFootprint::imageBytes(proxy);
+    }
+    return total;
+}
+
+void CinePlayer::requestPrepareLocked(int phase) {
+    ++generation;
+    back = Frame();
+    backReady = false;
+    pendingPhase = phase;
+    if (phase >= 0) {
+        wake.notify_one();
+    }
+}
+
+// 按绝对时刻安排下一帧，定时器的误差不会逐帧累积
+void CinePlayer::scheduleNextFrame() {
+    const qint64 due = (lastFrameNumber + 1) * 1000 / fps;
+    frameTimer.start(static_cast<int>(std::max<qint64>(0, due - clock.elapsed())));
+}
+
+void CinePlayer::tick() {
+    const qint64 elapsed = clock.elapsed();
+    const qint64 frameNumber = elapsed * fps / 1000;
+    if (frameNumber <= lastFrameNumber) {
+        scheduleNextFrame(); // 定时器提前触发
+        return;
+    }
+    TRACE_SCOPE("CinePlayer::tick");
+    bool presented = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        // 界面线程忙于其他工作时错过的帧时刻
+        stats.dropped += static_cast<quint64>(frameNumber - lastFrameNumber - 1);
+        if (backReady) {
+            std::swap(front, back);
+            ++stats.presented;
+            presented = true;
+            requestPrepareLocked((front.phase + 1) % cine->count());
+        } else {
+            ++stats.dropped;
+            ++stats.notReady;
+        }
+        stats.elapsedSeconds = elapsed / 1000.0;
+    }
+    lastFrameNumber = frameNumber;
+    scheduleNextFrame();
+    if (presented) {
+        emit phaseChanged(front.phase);
+    }
+    emit statisticsChanged();
+}
+
+void CinePlayer::run() {
+    Tracer::instance().setThreadName("cine");
+    for (;;) {
+        std::shared_ptr<const CineSeries> series;
+        int phase;
+        int slices[3];
+        double window, level;
+        int factor;
+        vtkSmartPointer<vtkImageData> proxy;
+        unsigned int jobGeneration;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || pendingPhase >= 0; });
+            if (stopping) {
+                return;
+            }
+            series = preparing;
+            phase = pendingPhase;
+            pendingPhase = -1;
+            std::copy(viewSlices, viewSlices + 3, slices);
+            window = viewWindow;
+            level = viewLevel;
+            factor = viewFactor;
+            if (phase < static_cast<int>(proxies.size())) {
+                proxy = proxies[phase];
+            }
+            jobGeneration = generation;
+        }
+        if (!series || phase >= series->count()) {
+            continue;
+        }
+
+        TRACE_SCOPE("CinePlayer::prepare");
+        const auto start = std::chrono::steady_clock::now();
+        Frame frame;
+        frame.phase = phase;
+        vtkImageData *volume = series->phases[phase];
+        const int *dims = volume->GetDimensions();
+        for (int o = 0; o < 3; ++o) {
+            if (slices[o] < 0 || slices[o] >= dims[o]) {
+                continue;
+            }
+            extractors[o].setInput(volume);
+            frame.slices[o] = mapWindowLevelToRGBA(extractors[o].extract(o, slices[o]), window, level);
+        }
+        if (factor > 1 && !proxy) {
+            const int factors[3] = {factor, factor, factor};
+            proxy = decimateVolume(volume, factors);
+        }
+        frame.volume = factor > 1 ? proxy : vtkSmartPointer<vtkImageData>(volume);
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (factor > 1 && series == preparing && factor == viewFactor && phase < static_cast<int>(proxies.size())) {
+            proxies[phase] = proxy; // 只是切片或窗宽窗位变了时代理仍然可用
+        }
+        if (jobGeneration != generation) {
+            continue; // 准备期间序列或视图变了，新的请求已在排队
+        }
+        back = std::move(frame);
+        backReady = true;
+        stats.prepareMs = ms;
+        stats.maxPrepareMs = std::max(stats.maxPrepareMs, ms);
+    }
+}
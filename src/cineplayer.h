@@ -0,0 +1,117 @@
+#ifndef CINEPLAYER_H
+#define CINEPLAYER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+
+#include "sliceextractor.h"
+
+// 多时相序列 (心脏、灌注) 预载的各个时相，尺寸、间距和数据类型相同
+struct CineSeries {
+    std::vector<vtkSmartPointer<vtkImageData>> phases;
+    std::vector<double> triggerTimes; // 各时相的触发时间 (ms)，文件中没有时为 -1
+    int sourcePhases = 0;             // 序列中的时相数
+    int phaseStride = 1;              // 超出预算时隔几个时相预载一个，phases[k] 对应第 k * phaseStride 个时相
+
+    int count() const { return static_cast<int>(phases.size()); }
+    qint64 bytes() const;
+};
+
+// 多时相电影回放
+// 按固定帧率循环显示各时相，采用双缓冲：后台线程为下一个时相提取三个方向的当前切片并映射窗宽窗位，
+// 体数据超出显存时还按三维视图的抽取因子生成该时相的代理 (各时相只生成一次，之后复用)，写入后缓冲；
+// 帧时刻到达时只交换前后缓冲，界面线程换上图像和体绘制输入即可，不在帧内提取切片或重采样。
+// 到点时后缓冲还没准备好，或界面线程太忙错过了帧时刻，都记为丢帧，画面停留在当前时相而不跳相。
+class CinePlayer : public QObject {
+    Q_OBJECT
+
+public:
+    static const int DEFAULT_FRAME_RATE = 20;
+
+    // 一个时相准备好的显示内容
+    struct Frame {
+        int phase = -1;
+        vtkSmartPointer<vtkImageData> slices[3]; // 按方向编号的RGBA切片，该方向没有预先准备时为空
+        vtkSmartPointer<vtkImageData> volume;    // 三维视图的输入：该时相的体数据或抽取后的代理
+    };
+
+    struct Statistics {
+        quint64 presented = 0;   // 换上的新帧
+        quint64 dropped = 0;     // 没有换上新帧的帧时刻
+        quint64 notReady = 0;    // 其中后缓冲尚未准备好的
+        double prepareMs = 0.0;  // 最近一帧的准备耗时
+        double maxPrepareMs = 0.0;
+        double elapsedSeconds = 0.0; // 本次播放的时长
+    };
+
+    explicit CinePlayer(QObject *parent = nullptr);
+    ~CinePlayer();
+
+    // 停止播放并回到第一个时相；传入空指针时清空
+    void setSeries(std::shared_ptr<const CineSeries> series);
+    std::shared_ptr<const CineSeries> series() const { return cine; }
+    // 后台准备哪些切片：slices[o] 为该方向的层号，-1 表示不预先准备 (倾斜平面、厚层投影等由界面按原路径生成)
+    // volumeFactor 为三维视图输入的抽取因子，大于 1 时为各时相生成代理
+    void setView(const int slices[3], double window, double level, int volumeFactor = 1);
+
+    void setFrameRate(int fps);
+    int frameRate() const { return fps; }
+    void play();
+    void pause();
+    bool isPlaying() const { return frameTimer.isActive(); }
+    void seek(int phase); // 换到指定时相 (不经过双缓冲)，播放时从它继续
+    int currentPhase() const { return front.phase; }
+    const Frame &currentFrame() const { return front; }
+
+    Statistics statistics() const;
+    qint64 proxyBytes() const; // 已生成的各时相三维代理
+
+signals:
+    // 新的时相已换到前缓冲，界面据此换上 currentFrame() 中的切片和该时相的体数据
+    void phaseChanged(int phase);
+    void statisticsChanged(); // 每个帧时刻发出一次
+
+private slots:
+    void tick();
+
+private:
+    void requestPrepareLocked(int phase); // 作废后缓冲并让后台线程准备 phase
+    void scheduleNextFrame();
+    void run();
+
+    std::shared_ptr<const CineSeries> cine;
+    int fps;
+    QTimer frameTimer;
+    QElapsedTimer clock;
+    qint64 lastFrameNumber; // 本次播放中上一个已处理的帧时刻编号
+    Frame front;
+
+    mutable std::mutex mutex; // 保护以下与后台线程共享的状态
+    std::condition_variable wake;
+    std::shared_ptr<const CineSeries> preparing;
+    Frame back;
+    bool backReady;
+    int pendingPhase;         // 等待准备的时相，-1 表示没有
+    unsigned int generation;  // 序列或视图变化时加一，之前开始的准备结果作废
+    int viewSlices[3];
+    double viewWindow, viewLevel;
+    int viewFactor;
+    std::vector<vtkSmartPointer<vtkImageData>> proxies; // 按时相编号，viewFactor 大于 1 时使用
+    Statistics stats;
+    bool stopping;
+
+    SliceExtractor extractors[3]; // 只在后台线程中使用
+    std::thread worker;
+};
+
+#endif // CINEPLAYER_H
@@ -0,0 +1,561 @@
+#include "cpuraycaster.h"
+#include "brickedvolume.h"
+#include "parallelfor.h"
+#include "tracer.h"
+
+#include <vtkCamera.h>
+#include <vtkColorTransferFunction.h>
+#include <vtkPiecewiseFunction.h>
+#include <vtkVolumeProperty.h>
+#include <vtkSetGet.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const int ROWS_PER_TASK = 4;
+const float EARLY_TERMINATION_ALPHA = 0.99f;
+const int MAX_LEVELS = 16;
+
+// 渲染时只读的八叉树一层
+struct LevelView {
+    int counts[3];
+    int shift;
+    const unsigned char *visible;
+};
+
+// 一帧中所有光线共用的参数，坐标均已换算到体素索引空间
+struct RayContext {
+    int dims[3];
+    double spacing[3];
+    double origin[3];
+    double position[3];
+    double forward[3], right[3], up[3];
+    bool parallel;
+    double halfHeight; // 透视时为 tan(视角/2)，平行投影时为 parallelScale
+    int width, height, pixelStep;
+    double step; // 世界坐标中的采样距离
+
+    const float *lut;
+    double lutOffset, lutScale;
+
+    bool skipping;
+    LevelView levels[MAX_LEVELS];
+    int levelCount;
+
+    bool shade;
+    float ambient, diffuse, specular, specularPower;
+    float background[3];
+};
+
+void normalize(double v[3]) {
+    const double length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    if (length > 0.0) {
+        v[0] /= length;
+        v[1] /= length;
+        v[2] /= length;
+    }
+}
+
+void cross(const double a[3], const double b[3], double out[3]) {
+    out[0] = a[1] * b[2] - a[2] * b[1];
+    out[1] = a[2] * b[0] - a[0] * b[2];
+    out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+// 线性排列 (x 最快) 的体素
+template <typename T>
+struct LinearVoxels {
+    LinearVoxels(const T *data, const int dims[3])
+        : data(data), nx(dims[0]), nxy(static_cast<size_t>(dims[0]) * dims[1]) {}
+    T operator()(int x, int y, int z) const { return data[z * nxy + y * nx + x]; }
+
+    const T *data;
+    size_t nx, nxy;
+};
+
+// 32³ 分块副本中的体素：沿任意方向前进的光线都只访问少量连续的块，与切片提取共用同一份副本
+template <typename T>
+struct BrickedVoxels {
+    explicit BrickedVoxels(const BrickedVolume *bricked)
+        : bricked(bricked), data(reinterpret_cast<const T *>(bricked->data())) {}
+    T operator()(int x, int y, int z) const { return data[bricked->elementIndex(x, y, z)]; }
+
+    const BrickedVolume *bricked;
+    const T *data;
+};
+
+// 每块覆盖体素 [b << shift, (b + 1) << shift]，包含与下一块共享的边界体素，三线性插值不会读到块外
+template <typename T, typename Voxels>
+void blockMinMax(const Voxels &in, const int dims[3], const int counts[3], float *minOut, float *maxOut, int threads) {
+    const int size = 1 << CpuRaycaster::BLOCK_SHIFT;
+    parallelFor(0, counts[2] * counts[1], [&](int row, int) {
+        const int bz = row / counts[1], by = row % counts[1];
+        const int z0 = bz * size, z1 = std::min(z0 + size, dims[2] - 1);
+        const int y0 = by * size, y1 = std::min(y0 + size, dims[1] - 1);
+        for (int bx = 0; bx < counts[0]; ++bx) {
+            const int x0 = bx * size, x1 = std::min(x0 + size, dims[0] - 1);
+            T lo = in(x0, y0, z0), hi = lo;
+            for (int z = z0; z <= z1; ++z) {
+                for (int y = y0; y <= y1; ++y) {
+                    for (int x = x0; x <= x1; ++x) {
+                        const T v = in(x, y, z);
+                        lo = v < lo ? v : lo;
+                        hi = v > hi ? v : hi;
+                    }
+                }
+            }
+            const size_t index = static_cast<size_t>(row) * counts[0] + bx;
+            minOut[index] = static_cast<float>(lo);
+            maxOut[index] = static_cast<float>(hi);
+        }
+    }, threads);
+}
+
+template <typename Voxels>
+inline float trilinear(const Voxels &in, const int dims[3], const double p[3]) {
+    const int x = std::min(static_cast<int>(p[0]), dims[0] - 1);
+    const int y = std::min(static_cast<int>(p[1]), dims[1] - 1);
+    const int z = std::min(static_cast<int>(p[2]), dims[2] - 1);
+    const float fx = static_cast<float>(p[0] - x), fy = static_cast<float>(p[1] - y), fz = static_cast<float>(p[2] - z);
+    const int x1 = x + 1 < dims[0] ? x + 1 : x;
+    const int y1 = y + 1 < dims[1] ? y + 1 : y;
+    const int z1 = z + 1 < dims[2] ? z + 1 : z;
+    const float v000 = in(x, y, z), v100 = in(x1, y, z), v010 = in(x, y1, z), v110 = in(x1, y1, z);
+    const float v001 = in(x, y, z1), v101 = in(x1, y, z1), v011 = in(x, y1, z1), v111 = in(x1, y1, z1);
+    const float c00 = v000 + fx * (v100 - v000);
+    const float c10 = v010 + fx * (v110 - v010);
+    const float c01 = v001 + fx * (v101 - v001);
+    const float c11 = v011 + fx * (v111 - v011);
+    const float c0 = c00 + fy * (c10 - c00);
+    const float c1 = c01 + fy * (c11 - c01);
+    return c0 + fz * (c1 - c0);
+}
+
+// 最近体素处的中心差分梯度 (世界坐标)
+template <typename Voxels>
+inline void gradient(const Voxels &in, const int dims[3], const double spacing[3], const double p[3], float g[3]) {
+    const int c[3] = {
+        std::min(static_cast<int>(p[0] + 0.5), dims[0] - 1),
+        std::min(static_cast<int>(p[1] + 0.5), dims[1] - 1),
+        std::min(static_cast<int>(p[2] + 0.5), dims[2] - 1),
+    };
+    for (int k = 0; k < 3; ++k) {
+        const int lo = c[k] > 0 ? 1 : 0;
+        const int hi = c[k] + 1 < dims[k] ? 1 : 0;
+        if (lo + hi == 0) {
+            g[k] = 0.0f;
+            continue;
+        }
+        int a[3] = {c[0], c[1], c[2]}, b[3] = {c[0], c[1], c[2]};
+        a[k] += hi;
+        b[k] -= lo;
+        g[k] = static_cast<float>((static_cast<double>(in(a[0], a[1], a[2])) - in(b[0], b[1], b[2]))
+                                  / ((lo + hi) * spacing[k]));
+    }
+}
+
+// 光线在节点 (cell, level) 中的出口参数
+double cellExit(const RayContext &ctx, const LevelView &level, const int cell[3], const double oi[3], const double di[3]) {
+    double exit = 1e300;
+    for (int k = 0; k < 3; ++k) {
+        if (std::abs(di[k]) < 1e-12) {
+            continue;
+        }
+        const double lo = static_cast<double>(cell[k]) * (1 << level.shift);
+        const double hi = std::min(static_cast<double>(cell[k] + 1) * (1 << level.shift), ctx.dims[k] - 1.0);
+        exit = std::min(exit, ((di[k] > 0.0 ? hi : lo) - oi[k]) / di[k]);
+    }
+    return exit;
+}
+
+struct RayStats {
+    int64_t samples = 0;
+    int64_t skipped = 0;
+};
+
+template <typename Voxels>
+void castRay(const RayContext &ctx, const Voxels &in, double px, double py, unsigned char *pixel, RayStats &stats) {
+    const double aspect = static_cast<double>(ctx.width) / ctx.height;
+    const double sx = (2.0 * px / ctx.width - 1.0) * ctx.halfHeight * aspect;
+    const double sy = (2.0 * py / ctx.height - 1.0) * ctx.halfHeight;
+
+    double o[3], d[3];
+    for (int k = 0; k < 3; ++k) {
+        if (ctx.parallel) {
+            o[k] = ctx.position[k] + sx * ctx.right[k] + sy * ctx.up[k];
+            d[k] = ctx.forward[k];
+        } else {
+            o[k] = ctx.position[k];
+            d[k] = ctx.forward[k] + sx * ctx.right[k] + sy * ctx.up[k];
+        }
+    }
+    normalize(d);
+
+    // 换算到体素索引空间，参数 t 仍是世界坐标中的距离
+    double oi[3], di[3];
+    double t0 = 0.0, t1 = 1e300;
+    bool hit = true;
+    for (int k = 0; k < 3; ++k) {
+        oi[k] = (o[k] - ctx.origin[k]) / ctx.spacing[k];
+        di[k] = d[k] / ctx.spacing[k];
+        const double maxIndex = ctx.dims[k] - 1.0;
+        if (std::abs(di[k]) < 1e-12) {
+            hit = hit && oi[k] >= 0.0 && oi[k] <= maxIndex;
+            continue;
+        }
+        double a = -oi[k] / di[k];
+        double b = (maxIndex - oi[k]) / di[k];
+        if (a > b) {
+            std::swap(a, b);
+        }
+        t0 = std::max(t0, a);
+        t1 = std::min(t1, b);
+    }
+
+    float color[3] = {0.0f, 0.0f, 0.0f};
+    float alpha = 0.0f;
+    if (hit && t0 <= t1) {
+        const int64_t steps = static_cast<int64_t>((t1 - t0) / ctx.step);
+        int64_t k = 0;
+        while (k <= steps) {
+            const double t = t0 + k * ctx.step;
+            double p[3];
+            for (int a = 0; a < 3; ++a) {
+                p[a] = std::min(std::max(oi[a] + t * di[a], 0.0), ctx.dims[a] - 1.0);
+            }
+
+            if (ctx.skipping) {
+                const LevelView &leaf = ctx.levels[0];
+                int cell[3];
+                for (int a = 0; a < 3; ++a) {
+                    cell[a] = std::min(static_cast<int>(p[a]) >> leaf.shift, leaf.counts[a] - 1);
+                }
+                if (!leaf.visible[(static_cast<size_t>(cell[2]) * leaf.counts[1] + cell[1]) * leaf.counts[0] + cell[0]]) {
+                    // 向上找到仍不可见的最大节点，直接跳到它的出口之后的第一个采样点
+                    int level = 0;
+                    while (level + 1 < ctx.levelCount) {
+                        const LevelView &parent = ctx.levels[level + 1];
+                        const int up[3] = {cell[0] >> 1, cell[1] >> 1, cell[2] >> 1};
+                        if (parent.visible[(static_cast<size_t>(up[2]) * parent.counts[1] + up[1]) * parent.counts[0] + up[0]]) {
+                            break;
+                        }
+                        std::copy(up, up + 3, cell);
+                        ++level;
+                    }
+                    const double exit = cellExit(ctx, ctx.levels[level], cell, oi, di);
+                    const int64_t next = std::max(k + 1, static_cast<int64_t>(std::floor((exit - t0) / ctx.step)) + 1);
+                    stats.skipped += next - k;
+                    k = next;
+                    continue;
+                }
+            }
+
+            ++stats.samples;
+            const float value = trilinear(in, ctx.dims, p);
+            const int index = std::min(std::max(static_cast<int>((value - ctx.lutOffset) * ctx.lutScale + 0.5), 0),
+                                       CpuRaycaster::LUT_SIZE - 1);
+            const float *entry = ctx.lut + 4 * index;
+            if (entry[3] > 0.0f) {
+                float shade = 1.0f, highlight = 0.0f;
+                if (ctx.shade) {
+                    float g[3];
+                    gradient(in, ctx.dims, ctx.spacing, p, g);
+                    const float length = std::sqrt(g[0] * g[0] + g[1] * g[1] + g[2] * g[2]);
+                    // 头灯：光线方向与视线相反，半程向量与光线方向相同；双面光照
+                    const float ndotl = length > 0.0f
+                        ? std::abs(static_cast<float>(g[0] * d[0] + g[1] * d[1] + g[2] * d[2]) / length) : 1.0f;
+                    shade = ctx.ambient + ctx.diffuse * ndotl;
+                    highlight = ctx.specular * std::pow(ndotl, ctx.specularPower);
+                }
+                const float weight = (1.0f - alpha) * entry[3];
+                for (int c = 0; c < 3; ++c) {
+                    color[c] += weight * (entry[c] * shade + highlight);
+                }
+                alpha += weight;
+                if (alpha >= EARLY_TERMINATION_ALPHA) {
+                    break;
+                }
+            }
+            ++k;
+        }
+    }
+
+    for (int c = 0; c < 3; ++c) {
+        const float v = color[c] + (1.0f - alpha) * ctx.background[c];
+        pixel[c] = static_cast<unsigned char>(std::min(std::max(v, 0.0f), 1.0f) * 255.0f + 0.5f);
+    }
+    pixel[3] = 255;
+}
+
+template <typename Voxels>
+void castRays(const RayContext &ctx, const Voxels &in, unsigned char *out, int threads, std::vector<RayStats> &stats) {
+    const int step = ctx.pixelStep;
+    const int rows = (ctx.height + step - 1) / step;
+    const int tasks = (rows + ROWS_PER_TASK - 1) / ROWS_PER_TASK;
+    parallelFor(0, tasks, [&](int task, int threadIndex) {
+        RayStats &local = stats[threadIndex];
+        const int r1 = std::min(rows, (task + 1) * ROWS_PER_TASK);
+        for (int r = task * ROWS_PER_TASK; r < r1; ++r) {
+            const int j = r * step;
+            for (int i = 0; i < ctx.width; i += step) {
+                unsigned char *pixel = out + 4 * (static_cast<size_t>(j) * ctx.width + i);
+                castRay(ctx, in, i + 0.5 * step, j + 0.5 * step, pixel, local);
+                // 降低分辨率时把结果复制到同一块的其余像素
+                for (int y = j; y < std::min(j + step, ctx.height); ++y) {
+                    for (int x = i; x < std::min(i + step, ctx.width); ++x) {
+                        if (x != i || y != j) {
+                            std::copy(pixel, pixel + 4, out + 4 * (static_cast<size_t>(y) * ctx.width + x));
+                        }
+                    }
+                }
+            }
+        }
+    }, threads);
+}
+
+} // namespace
+
+CpuRaycaster::View CpuRaycaster::viewFromCamera(vtkCamera *camera) {
+    View view;
+    camera->GetPosition(view.position);
+    camera->GetFocalPoint(view.focalPoint);
+    camera->GetViewUp(view.viewUp);
+    view.viewAngle = camera->GetViewAngle();
+    view.parallel = camera->GetParallelProjection() != 0;
+    view.parallelScale = camera->GetParallelScale();
+    return view;
+}
+
+CpuRaycaster::CpuRaycaster()
+    : image(vtkSmartPointer<vtkImageData>::New()), sampleDistance(1.0), threads(0), skipping(true),
+      volumeTime(0), opacityTime(0), colorTime(0), lutSampleDistance(0.0)
+{
+    scalarRange[0] = scalarRange[1] = 0.0;
+    background[0] = background[1] = background[2] = 0.0;
+}
+
+void CpuRaycaster::setInput(vtkImageData *input) {
+    if (input != volume.GetPointer()) {
+        volume = input;
+        bricked.reset();
+        volumeTime = 0; // 下次渲染时重建
+    }
+}
+
+void CpuRaycaster::setBrickedVolume(std::shared_ptr<const BrickedVolume> brickedVolume) {
+    bricked = std::move(brickedVolume);
+}
+
+// 分块副本与输入的尺寸、类型一致时才从副本读取
+const BrickedVolume *CpuRaycaster::brickedInput() const {
+    if (!bricked || bricked->scalarType() != volume->GetScalarType() || bricked->numberOfComponents() != 1) {
+        return nullptr;
+    }
+    int dims[3];
+    volume->GetDimensions(dims);
+    return std::equal(dims, dims + 3, bricked->dimensions()) ? bricked.get() : nullptr;
+}
+
+void CpuRaycaster::setProperty(vtkVolumeProperty *volumeProperty) {
+    property = volumeProperty;
+}
+
+void CpuRaycaster::setBackground(double r, double g, double b) {
+    background[0] = r;
+    background[1] = g;
+    background[2] = b;
+}
+
+void CpuRaycaster::buildMinMax() {
+    TRACE_SCOPE("CpuRaycaster::buildMinMax");
+    int dims[3];
+    volume->GetDimensions(dims);
+    levels.clear();
+
+    Level leaf;
+    leaf.shift = BLOCK_SHIFT;
+    for (int k = 0; k < 3; ++k) {
+        leaf.counts[k] = std::max(1, (dims[k] - 2 + (1 << BLOCK_SHIFT)) >> BLOCK_SHIFT);
+    }
+    const size_t leafCount = static_cast<size_t>(leaf.counts[0]) * leaf.counts[1] * leaf.counts[2];
+    leaf.minValue.resize(leafCount);
+    leaf.maxValue.resize(leafCount);
+    const void *in = volume->GetScalarPointer();
+    if (const BrickedVolume *source = brickedInput()) {
+        switch (volume->GetScalarType()) {
+            vtkTemplateMacro(blockMinMax<VTK_TT>(BrickedVoxels<VTK_TT>(source), dims, leaf.counts,
+                                                 leaf.minValue.data(), leaf.maxValue.data(), threads));
+        }
+    } else {
+        switch (volume->GetScalarType()) {
+            vtkTemplateMacro(blockMinMax<VTK_TT>(LinearVoxels<VTK_TT>(static_cast<const VTK_TT *>(in), dims), dims,
+                                                 leaf.counts, leaf.minValue.data(), leaf.maxValue.data(), threads));
+        }
+    }
+    levels.push_back(std::move(leaf));
+
+    // 逐级合并 2x2x2 个子节点，直到只剩一个根节点
+    while (static_cast<int>(levels.size()) < MAX_LEVELS) {
+        const Level &child = levels.back();
+        if (child.counts[0] == 1 && child.counts[1] == 1 && child.counts[2] == 1) {
+            break;
+        }
+        Level parent;
+        parent.shift = child.shift + 1;
+        for (int k = 0; k < 3; ++k) {
+            parent.counts[k] = (child.counts[k] + 1) / 2;
+        }
+        const size_t count = static_cast<size_t>(parent.counts[0]) * parent.counts[1] * parent.counts[2];
+        parent.minValue.assign(count, 1e30f);
+        parent.maxValue.assign(count, -1e30f);
+        for (int z = 0; z < child.counts[2]; ++z) {
+            for (int y = 0; y < child.counts[1]; ++y) {
+                for (int x = 0; x < child.counts[0]; ++x) {
+                    const size_t from = (static_cast<size_t>(z) * child.counts[1] + y) * child.counts[0] + x;
+                    const size_t to = (static_cast<size_t>(z / 2) * parent.counts[1] + y / 2) * parent.counts[0] + x / 2;
+                    parent.minValue[to] = std::min(parent.minValue[to], child.minValue[from]);
+                    parent.maxValue[to] = std::max(parent.maxValue[to], child.maxValue[from]);
+                }
+            }
+        }
+        levels.push_back(std::move(parent));
+    }
+
+    scalarRange[0] = levels.back().minValue[0];
+    scalarRange[1] = levels.back().maxValue[0];
+    volumeTime = volume->GetMTime();
+    opacityTime = colorTime = 0; // 标量范围可能变了，查找表和可见性都要重建
+    ++stats.minMaxBuilds;
+}
+
+void CpuRaycaster::updateTables() {
+    vtkPiecewiseFunction *opacity = property->GetScalarOpacity();
+    vtkColorTransferFunction *color = property->GetRGBTransferFunction();
+    const bool opacityChanged = opacity->GetMTime() != opacityTime;
+    if (!opacityChanged && color->GetMTime() == colorTime && sampleDistance == lutSampleDistance) {
+        return;
+    }
+    TRACE_SCOPE("CpuRaycaster::updateTables");
+
+    const double lo = scalarRange[0];
+    const double hi = std::max(scalarRange[1], scalarRange[0] + 1.0);
+    std::vector<float> alphaTable(LUT_SIZE), rgbTable(3 * LUT_SIZE);
+    opacity->GetTable(lo, hi, LUT_SIZE, alphaTable.data());
+    color->GetTable(lo, hi, LUT_SIZE, rgbTable.data());
+
+    // 不透明度按采样距离相对 ScalarOpacityUnitDistance 校正
+    const double unit = property->GetScalarOpacityUnitDistance() > 0.0 ? property->GetScalarOpacityUnitDistance() : 1.0;
+    const double exponent = sampleDistance / unit;
+    lut.resize(4 * LUT_SIZE);
+    opaqueCount.assign(LUT_SIZE + 1, 0);
+    for (int i = 0; i < LUT_SIZE; ++i) {
+        const float a = std::min(std::max(alphaTable[i], 0.0f), 1.0f);
+        lut[4 * i] = rgbTable[3 * i];
+        lut[4 * i + 1] = rgbTable[3 * i + 1];
+        lut[4 * i + 2] = rgbTable[3 * i + 2];
+        lut[4 * i + 3] = static_cast<float>(1.0 - std::pow(1.0 - a, exponent));
+        opaqueCount[i + 1] = opaqueCount[i] + (a > 0.0f ? 1 : 0);
+    }
+
+    if (opacityChanged) {
+        // 节点的值域覆盖的查找表区间内只要有一项不透明度大于 0 就可能可见
+        const double scale = (LUT_SIZE - 1) / (hi - lo);
+        for (Level &level : levels) {
+            level.visible.resize(level.minValue.size());
+            for (size_t i = 0; i < level.visible.size(); ++i) {
+                const int first = std::max(0, static_cast<int>(std::floor((level.minValue[i] - lo) * scale)));
+                const int last = std::min(LUT_SIZE - 1, static_cast<int>(std::ceil((level.maxValue[i] - lo) * scale)));
+                level.visible[i] = first <= last && opaqueCount[last + 1] - opaqueCount[first] > 0;
+            }
+        }
+        ++stats.visibilityBuilds;
+    }
+
+    opacityTime = opacity->GetMTime();
+    colorTime = color->GetMTime();
+    lutSampleDistance = sampleDistance;
+}
+
+vtkImageData *CpuRaycaster::render(const View &view, int width, int height, int pixelStep) {
+    if (!volume || !property || volume->GetScalarType() == VTK_VOID || volume->GetNumberOfScalarComponents() != 1
+        || width <= 0 || height <= 0) {
+        return nullptr;
+    }
+    TRACE_SCOPE("CpuRaycaster::render");
+    if (volume->GetMTime() != volumeTime) {
+        buildMinMax();
+    }
+    updateTables();
+
+    int *outDims = image->GetDimensions();
+    if (outDims[0] != width || outDims[1] != height || image->GetScalarType() != VTK_UNSIGNED_CHAR) {
+        image->SetDimensions(width, height, 1);
+        image->AllocateScalars(VTK_UNSIGNED_CHAR, 4);
+    }
+
+    RayContext ctx;
+    volume->GetDimensions(ctx.dims);
+    volume->GetSpacing(ctx.spacing);
+    volume->GetOrigin(ctx.origin);
+    std::copy(view.position, view.position + 3, ctx.position);
+    for (int k = 0; k < 3; ++k) {
+        ctx.forward[k] = view.focalPoint[k] - view.position[k];
+    }
+    normalize(ctx.forward);
+    cross(ctx.forward, view.viewUp, ctx.right);
+    normalize(ctx.right);
+    cross(ctx.right, ctx.forward, ctx.up);
+    ctx.parallel = view.parallel;
+    ctx.halfHeight = view.parallel ? view.parallelScale : std::tan(view.viewAngle * 3.14159265358979323846 / 360.0);
+    ctx.width = width;
+    ctx.height = height;
+    ctx.pixelStep = std::max(1, pixelStep);
+    ctx.step = sampleDistance > 0.0 ? sampleDistance : 1.0;
+
+    ctx.lut = lut.data();
+    ctx.lutOffset = scalarRange[0];
+    ctx.lutScale = (LUT_SIZE - 1) / (std::max(scalarRange[1], scalarRange[0] + 1.0) - scalarRange[0]);
+    ctx.skipping = skipping;
+    ctx.levelCount = static_cast<int>(levels.size());
+    for (int i = 0; i < ctx.levelCount; ++i) {
+        std::copy(levels[i].counts, levels[i].counts + 3, ctx.levels[i].counts);
+        ctx.levels[i].shift = levels[i].shift;
+        ctx.levels[i].visible = levels[i].visible.data();
+    }
+
+    ctx.shade = property->GetShade() != 0;
+    ctx.ambient = static_cast<float>(property->GetAmbient());
+    ctx.diffuse = static_cast<float>(property->GetDiffuse());
+    ctx.specular = static_cast<float>(property->GetSpecular());
+    ctx.specularPower = static_cast<float>(property->GetSpecularPower());
+    for (int c = 0; c < 3; ++c) {
+        ctx.background[c] = static_cast<float>(background[c]);
+    }
+
+    const int threadCount = threads > 0 ? threads : defaultThreadCount();
+    std::vector<RayStats> perThread(threadCount);
+    const void *in = volume->GetScalarPointer();
+    unsigned char *out = static_cast<unsigned char *>(image->GetScalarPointer());
+    if (const BrickedVolume *source = brickedInput()) {
+        switch (volume->GetScalarType()) {
+            vtkTemplateMacro(castRays(ctx, BrickedVoxels<VTK_TT>(source), out, threadCount, perThread));
+        }
+    } else {
+        switch (volume->GetScalarType()) {
+            vtkTemplateMacro(castRays(ctx, LinearVoxels<VTK_TT>(static_cast<const VTK_TT *>(in), ctx.dims), out,
+                                      threadCount, perThread));
+        }
+    }
+
+    const int step = ctx.pixelStep;
+    stats.rays = static_cast<int64_t>((width + step - 1) / step) * ((height + step - 1) / step);
+    stats.samples = stats.skippedSteps = 0;
+    for (const RayStats &local : perThread) {
+        stats.samples += local.samples;
+        stats.skippedSteps += local.skipped;
+    }
+    image->Modified();
+    return image;
+}
@@ -0,0 +1,91 @@
+#ifndef CPURAYCASTER_H
+#define CPURAYCASTER_H
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class BrickedVolume;
+class vtkCamera;
+class vtkVolumeProperty;
+
+// 没有显卡时的 CPU 光线投射体绘制
+// 体数据按 8³ 分块记录最小/最大值，逐级合并成 min/max 八叉树；传输函数变化时只重新判断每个节点
+// 在当前不透明度下是否可见。光线落在不可见节点中时直接跳到该节点的出口，累计不透明度接近 1 时提前结束。
+// 分块的最小/最大值只在体数据变化时重建。合成顺序、不透明度校正和光照参数与 vtkVolumeProperty 一致。
+// 设置了 32³ 分块副本时，采样、梯度和最小/最大值都从副本读取，斜向的光线不再每步跨越整行或整层。
+class CpuRaycaster {
+public:
+    struct View {
+        double position[3];
+        double focalPoint[3];
+        double viewUp[3];
+        double viewAngle;     // 垂直视角 (度)
+        bool parallel;
+        double parallelScale; // 平行投影时视口高度的一半
+    };
+    static View viewFromCamera(vtkCamera *camera);
+
+    struct Statistics {
+        int64_t rays = 0;
+        int64_t samples = 0;      // 实际插值的采样点
+        int64_t skippedSteps = 0; // 因节点不可见跳过的采样步
+        int minMaxBuilds = 0;     // 分块最小/最大值的重建次数
+        int visibilityBuilds = 0; // 可见性的重新判断次数
+    };
+
+    CpuRaycaster();
+
+    void setInput(vtkImageData *volume); // 换成其他体数据时清除分块副本
+    void setBrickedVolume(std::shared_ptr<const BrickedVolume> bricked); // 必须由当前输入构建
+    void setProperty(vtkVolumeProperty *property); // 每次渲染时读取传输函数和光照参数
+    void setSampleDistance(double distance) { sampleDistance = distance; }
+    void setThreadCount(int count) { threads = count; } // 0 表示硬件并发数
+    int threadCount() const { return threads; }
+    void setEmptySpaceSkipping(bool enabled) { skipping = enabled; }
+    void setBackground(double r, double g, double b);
+
+    // 渲染 width x height 的 RGBA 图像 (第0行在底部)；pixelStep > 1 时每隔几个像素投射一条光线，其余像素复制
+    vtkImageData *render(const View &view, int width, int height, int pixelStep = 1);
+    vtkImageData *output() const { return image; }
+    const Statistics &statistics() const { return stats; }
+
+    static const int BLOCK_SHIFT = 3;
+    static const int LUT_SIZE = 4096;
+
+private:
+    struct Level {
+        int counts[3];
+        int shift; // 节点边长为 1 << shift 个体素
+        std::vector<float> minValue;
+        std::vector<float> maxValue;
+        std::vector<unsigned char> visible;
+    };
+
+    void buildMinMax();
+    const BrickedVolume *brickedInput() const; // 可用的分块副本，没有或与输入不符时为空
+    void updateTables(); // 传输函数或采样距离变化时更新查找表，不透明度变化时更新可见性
+
+    vtkSmartPointer<vtkImageData> volume;
+    std::shared_ptr<const BrickedVolume> bricked;
+    vtkSmartPointer<vtkVolumeProperty> property;
+    vtkSmartPointer<vtkImageData> image;
+    std::vector<Level> levels;
+    std::vector<float> lut;      // 每项 r, g, b, 校正后的不透明度
+    std::vector<int> opaqueCount; // 查找表中不透明度大于 0 的项数的前缀和
+
+    double scalarRange[2];
+    double sampleDistance;
+    double background[3];
+    int threads;
+    bool skipping;
+
+    vtkMTimeType volumeTime, opacityTime, colorTime;
+    double lutSampleDistance;
+    Statistics stats;
+};
+
+#endif // CPURAYCASTER_H
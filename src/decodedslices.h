@@ -0,0 +1,52 @@
+#ifndef DECODEDSLICES_H
+#define DECODEDSLICES_H
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+// 渐进加载时已解码完成的切片 (z 层)
+// 解码线程写完一层后调用 publish (release)，GUI线程用 contains (acquire) 确认后才读取该层的体素；
+// 未发布的层仍可能在写入，读取方改为显示全零的占位内容
+class DecodedSlices {
+public:
+    explicit DecodedSlices(int count)
+        : flags(new std::atomic<bool>[std::max(0, count)]), count(std::max(0, count)), published(0) {
+        for (int z = 0; z < this->count; ++z) {
+            flags[z].store(false, std::memory_order_relaxed);
+        }
+    }
+
+    int size() const { return count; }
+
+    void publish(int z) {
+        if (z >= 0 && z < count && !flags[z].exchange(true, std::memory_order_release)) {
+            published.fetch_add(1, std::memory_order_release);
+        }
+    }
+
+    bool contains(int z) const { return z >= 0 && z < count && flags[z].load(std::memory_order_acquire); }
+
+    // [first, last] 中的层是否都已解码
+    bool containsRange(int first, int last) const {
+        if (complete()) {
+            return true;
+        }
+        for (int z = first; z <= last; ++z) {
+            if (!contains(z)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    int decodedCount() const { return published.load(std::memory_order_acquire); }
+    bool complete() const { return decodedCount() == count; } // 全部层都已发布，整个体数据可以读取
+
+private:
+    std::unique_ptr<std::atomic<bool>[]> flags;
+    int count;
+    std::atomic<int> published;
+};
+
+#endif // DECODEDSLICES_H
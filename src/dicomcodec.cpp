@@ -0,0 +1,483 @@
+#include "dicomcodec.h"
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+const char *RLE_LOSSLESS = "1.2.840.10008.1.2.5";
+const char *JPEG_LOSSLESS_PROCESS14 = "1.2.840.10008.1.2.4.57";
+const char *JPEG_LOSSLESS_SV1 = "1.2.840.10008.1.2.4.70";
+
+uint16_t readU16LE(const uint8_t *p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t readU32LE(const uint8_t *p) {
+    return static_cast<uint32_t>(readU16LE(p)) | (static_cast<uint32_t>(readU16LE(p + 2)) << 16);
+}
+
+uint16_t readU16BE(const uint8_t *p) {
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+void writeSample(char *out, size_t index, int bytesPerSample, unsigned value) {
+    if (bytesPerSample == 1) {
+        out[index] = static_cast<char>(value & 0xFF);
+    } else {
+        out[index * 2] = static_cast<char>(value & 0xFF);
+        out[index * 2 + 1] = static_cast<char>((value >> 8) & 0xFF);
+    }
+}
+
+void checkLayout(const PixelLayout &layout) {
+    if (layout.rows <= 0 || layout.columns <= 0 || layout.samplesPerPixel <= 0
+        || (layout.bitsAllocated != 8 && layout.bitsAllocated != 16)) {
+        throw std::runtime_error("不支持的像素布局: BitsAllocated " + std::to_string(layout.bitsAllocated));
+    }
+}
+
+// --- RLE (PackBits) ---
+
+// 解码一个段到 count 个字节，输出间隔 stride
+void decodePackBits(const uint8_t *p, const uint8_t *end, uint8_t *out, size_t count, size_t stride) {
+    size_t written = 0;
+    while (written < count && p < end) {
+        const int n = static_cast<int8_t>(*p++);
+        if (n >= 0) {
+            size_t run = static_cast<size_t>(n) + 1;
+            if (run > static_cast<size_t>(end - p) || run > count - written) {
+                throw std::runtime_error("RLE 数据损坏");
+            }
+            for (size_t i = 0; i < run; ++i) {
+                out[(written++) * stride] = *p++;
+            }
+        } else if (n != -128) {
+            size_t run = static_cast<size_t>(1 - n);
+            if (p >= end || run > count - written) {
+                throw std::runtime_error("RLE 数据损坏");
+            }
+            const uint8_t value = *p++;
+            for (size_t i = 0; i < run; ++i) {
+                out[(written++) * stride] = value;
+            }
+        }
+    }
+    if (written < count) {
+        throw std::runtime_error("RLE 段长度不足");
+    }
+}
+
+// --- JPEG Lossless ---
+
+// 霍夫曼表：码长不超过 LOOKUP_BITS 的码字查表，其余逐位比较
+class HuffmanTable {
+public:
+    static const int LOOKUP_BITS = 9;
+
+    bool defined = false;
+
+    void build(const uint8_t counts[16], const uint8_t *symbols, int symbolCount) {
+        std::memcpy(values, symbols, symbolCount);
+        std::memset(lookupLength, 0, sizeof(lookupLength));
+        int code = 0;
+        int k = 0;
+        for (int length = 1; length <= 16; ++length) {
+            valuePointer[length] = k;
+            minCode[length] = code;
+            // 该长度的最后一个码字 code + counts - 1 必须能用 length 位表示 (JPEG F.2.2)，否则查表越界
+            if (code + counts[length - 1] > (1 << length)) {
+                throw std::runtime_error("JPEG 霍夫曼表无效");
+            }
+            for (int i = 0; i < counts[length - 1]; ++i, ++code, ++k) {
+                if (length <= LOOKUP_BITS) {
+                    const int shift = LOOKUP_BITS - length;
+                    for (int fill = 0; fill < (1 << shift); ++fill) {
+                        lookupLength[(code << shift) | fill] = static_cast<uint8_t>(length);
+                        lookupValue[(code << shift) | fill] = values[k];
+                    }
+                }
+            }
+            maxCode[length] = counts[length - 1] ? code - 1 : -1;
+            code <<= 1;
+        }
+        defined = true;
+    }
+
+    template <typename Reader>
+    int decode(Reader &reader) const {
+        const unsigned peek = reader.peek(LOOKUP_BITS);
+        if (lookupLength[peek]) {
+            reader.consume(lookupLength[peek]);
+            return lookupValue[peek];
+        }
+        for (int length = LOOKUP_BITS + 1; length <= 16; ++length) {
+            const int code = static_cast<int>(reader.peek(length));
+            if (code <= maxCode[length]) {
+                reader.consume(length);
+                return values[valuePointer[length] + code - minCode[length]];
+            }
+        }
+        throw std::runtime_error("JPEG 霍夫曼码无效");
+    }
+
+private:
+    uint8_t values[256] = {};
+    uint8_t lookupLength[1 << LOOKUP_BITS] = {};
+    uint8_t lookupValue[1 << LOOKUP_BITS] = {};
+    int maxCode[17] = {};
+    int minCode[17] = {};
+    int valuePointer[17] = {};
+};
+
+// 熵编码段的位读取器：处理 0xFF00 填充，遇到标记后补零
+class BitReader {
+public:
+    BitReader(const uint8_t *begin, const uint8_t *end) : p(begin), end(end) {}
+
+    unsigned peek(int n) {
+        if (bits < n) fill();
+        return static_cast<unsigned>(acc >> (64 - n));
+    }
+
+    void consume(int n) {
+        acc <<= n;
+        bits -= n;
+    }
+
+    unsigned read(int n) {
+        const unsigned v = peek(n);
+        consume(n);
+        return v;
+    }
+
+    // 丢弃剩余位，跳过下一个 RSTn 标记
+    void restart() {
+        while (p + 1 < end && !(p[0] == 0xFF && p[1] >= 0xD0 && p[1] <= 0xD7)) {
+            ++p;
+        }
+        if (p + 1 >= end) {
+            throw std::runtime_error("JPEG 缺少重启标记");
+        }
+        p += 2;
+        acc = 0;
+        bits = 0;
+        atMarker = false;
+    }
+
+private:
+    void fill() {
+        while (bits <= 56) {
+            uint8_t byte = 0;
+            if (!atMarker && p < end) {
+                byte = *p;
+                if (byte == 0xFF) {
+                    if (p + 1 < end && p[1] == 0x00) {
+                        p += 2;
+                    } else {
+                        atMarker = true; // 停在标记处，之后补零
+                        byte = 0;
+                    }
+                } else {
+                    ++p;
+                }
+            }
+            acc |= static_cast<uint64_t>(byte) << (56 - bits);
+            bits += 8;
+        }
+    }
+
+    const uint8_t *p;
+    const uint8_t *end;
+    uint64_t acc = 0;
+    int bits = 0;
+    bool atMarker = false;
+};
+
+struct FrameHeader {
+    int precision = 0;
+    int rows = 0;
+    int columns = 0;
+    int components = 0;
+    int componentIds[4] = {};
+};
+
+int decodeDifference(const HuffmanTable &table, BitReader &reader) {
+    const int ssss = table.decode(reader);
+    if (ssss == 0) {
+        return 0;
+    }
+    if (ssss == 16) {
+        return 32768;
+    }
+    if (ssss > 16) {
+        throw std::runtime_error("JPEG 差值类别无效");
+    }
+    const int v = static_cast<int>(reader.read(ssss));
+    return v < (1 << (ssss - 1)) ? v - (1 << ssss) + 1 : v;
+}
+
+// 解码一个包含所有分量的扫描
+void decodeLosslessScan(const uint8_t *p, const uint8_t *end, const FrameHeader &frame,
+                        const HuffmanTable tables[4], const int tableOfComponent[4],
+                        int predictor, int pointTransform, int restartInterval,
+                        const PixelLayout &layout, char *out) {
+    const int ns = frame.components;
+    const int columns = frame.columns;
+    const int bytesPerSample = layout.bitsAllocated / 8;
+    const int initial = 1 << (frame.precision - pointTransform - 1);
+
+    std::vector<int> previous(static_cast<size_t>(columns) * ns), current(previous.size());
+    BitReader reader(p, end);
+    int mcusInInterval = 0;
+    bool reset = true;  // 下一个样本使用初始预测值
+    int firstLine = 0;  // 扫描或重启间隔开始的行，只用左侧样本预测
+
+    for (int y = 0; y < frame.rows; ++y) {
+        for (int x = 0; x < columns; ++x) {
+            if (restartInterval && mcusInInterval == restartInterval) {
+                reader.restart();
+                mcusInInterval = 0;
+                reset = true;
+                firstLine = y;
+            }
+            for (int c = 0; c < ns; ++c) {
+                const size_t i = static_cast<size_t>(x) * ns + c;
+                int prediction;
+                if (reset) {
+                    prediction = initial;
+                } else if (y == firstLine) {
+                    prediction = current[i - ns];
+                } else if (x == 0) {
+                    prediction = previous[i];
+                } else {
+                    const int ra = current[i - ns];
+                    const int rb = previous[i];
+                    const int rc = previous[i - ns];
+                    switch (predictor) {
+                        case 1: prediction = ra; break;
+                        case 2: prediction = rb; break;
+                        case 3: prediction = rc; break;
+                        case 4: prediction = ra + rb - rc; break;
+                        case 5: prediction = ra + ((rb - rc) >> 1); break;
+                        case 6: prediction = rb + ((ra - rc) >> 1); break;
+                        default: prediction = (ra + rb) >> 1; break;
+                    }
+                }
+                current[i] = (prediction + decodeDifference(tables[tableOfComponent[c]], reader)) & 0xFFFF;
+            }
+            reset = false;
+            ++mcusInInterval;
+        }
+
+        const size_t rowBase = static_cast<size_t>(y) * columns * ns;
+        for (size_t i = 0; i < current.size(); ++i) {
+            writeSample(out, rowBase + i, bytesPerSample, static_cast<unsigned>(current[i]) << pointTransform);
+        }
+        current.swap(previous);
+    }
+}
+
+} // namespace
+
+bool isEncapsulatedTransferSyntax(const std::string &transferSyntaxUID) {
+    return transferSyntaxUID == RLE_LOSSLESS
+        || transferSyntaxUID == JPEG_LOSSLESS_PROCESS14
+        || transferSyntaxUID == JPEG_LOSSLESS_SV1;
+}
+
+// 条目结构: (FFFE,E000) 长度 值...，以 (FFFE,E0DD) 结束；第一个条目是基本偏移表
+void readEncapsulatedFrame(const char *data, size_t size, std::vector<char> &frame) {
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(data);
+    frame.clear();
+
+    size_t pos = 0;
+    auto readItem = [&](uint32_t &length) -> bool {
+        if (pos + 8 > size) {
+            throw std::runtime_error("封装像素数据被截断");
+        }
+        const uint16_t group = readU16LE(p + pos);
+        const uint16_t element = readU16LE(p + pos + 2);
+        length = readU32LE(p + pos + 4);
+        pos += 8;
+        if (group != 0xFFFE || (element != 0xE000 && element != 0xE0DD)) {
+            throw std::runtime_error("封装像素数据条目无效");
+        }
+        if (element == 0xE0DD) {
+            return false;
+        }
+        if (length > size - pos) {
+            throw std::runtime_error("封装像素数据被截断");
+        }
+        return true;
+    };
+
+    uint32_t length = 0;
+    if (!readItem(length)) {
+        throw std::runtime_error("缺少基本偏移表");
+    }
+    // 多帧文件只取第一帧：第二帧的偏移之后的片段不属于它
+    uint32_t secondFrame = UINT32_MAX;
+    if (length >= 8) {
+        secondFrame = readU32LE(p + pos + 4);
+    }
+    pos += length;
+
+    const size_t firstFragment = pos;
+    while (readItem(length)) {
+        if (pos - 8 - firstFragment >= secondFrame) {
+            break;
+        }
+        frame.insert(frame.end(), data + pos, data + pos + length);
+        pos += length;
+    }
+    if (frame.empty()) {
+        throw std::runtime_error("封装像素数据为空");
+    }
+}
+
+// 段顺序：每个样本从最高字节到最低字节各一段
+void decodeRLE(const char *data, size_t size, const PixelLayout &layout, char *out) {
+    checkLayout(layout);
+    if (size < 64) {
+        throw std::runtime_error("RLE 头不完整");
+    }
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(data);
+    const int bytesPerSample = layout.bitsAllocated / 8;
+    const uint32_t segments = readU32LE(p);
+    if (segments != static_cast<uint32_t>(layout.samplesPerPixel * bytesPerSample) || segments > 15) {
+        throw std::runtime_error("RLE 段数与像素格式不符");
+    }
+
+    const size_t pixels = static_cast<size_t>(layout.rows) * layout.columns;
+    const size_t stride = static_cast<size_t>(layout.samplesPerPixel) * bytesPerSample;
+    uint8_t *dest = reinterpret_cast<uint8_t *>(out);
+    for (uint32_t s = 0; s < segments; ++s) {
+        const uint32_t begin = readU32LE(p + 4 + 4 * s);
+        const uint32_t finish = s + 1 < segments ? readU32LE(p + 8 + 4 * s) : static_cast<uint32_t>(size);
+        if (begin < 64 || begin > finish || finish > size) {
+            throw std::runtime_error("RLE 段偏移无效");
+        }
+        const int sample = static_cast<int>(s) / bytesPerSample;
+        const int byteInSample = bytesPerSample - 1 - static_cast<int>(s) % bytesPerSample; // 小端输出
+        decodePackBits(p + begin, p + finish, dest + sample * bytesPerSample + byteInSample, pixels, stride);
+    }
+}
+
+void decodeJPEGLossless(const char *data, size_t size, const PixelLayout &layout, char *out) {
+    checkLayout(layout);
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(data);
+    const uint8_t *end = p + size;
+    if (size < 4 || p[0] != 0xFF || p[1] != 0xD8) {
+        throw std::runtime_error("不是JPEG数据 (缺少SOI)");
+    }
+    p += 2;
+
+    FrameHeader frame;
+    HuffmanTable tables[4];
+    int restartInterval = 0;
+
+    while (p + 4 <= end) {
+        if (p[0] != 0xFF) {
+            throw std::runtime_error("JPEG 标记无效");
+        }
+        while (p < end && *p == 0xFF) {
+            ++p; // 标记前可以有填充的 0xFF
+        }
+        if (p >= end) break;
+        const uint8_t marker = *p++;
+        if (marker == 0xD9) {
+            break; // EOI
+        }
+        if (p + 2 > end) break;
+        const uint16_t length = readU16BE(p);
+        if (length < 2 || p + length > end) {
+            throw std::runtime_error("JPEG 段长度无效");
+        }
+        const uint8_t *segment = p + 2;
+        const uint8_t *segmentEnd = p + length;
+
+        if (marker == 0xC3) { // SOF3：无损、霍夫曼编码
+            if (length < 8 + 3) { // 至少一个分量，读分量数之前先确认段够长
+                throw std::runtime_error("JPEG 帧头无效");
+            }
+            frame.precision = segment[0];
+            frame.rows = readU16BE(segment + 1);
+            frame.columns = readU16BE(segment + 3);
+            frame.components = segment[5];
+            if (frame.components < 1 || frame.components > 4 || length < 8 + 3 * frame.components) {
+                throw std::runtime_error("JPEG 帧头无效");
+            }
+            for (int c = 0; c < frame.components; ++c) {
+                frame.componentIds[c] = segment[6 + 3 * c];
+                if (segment[7 + 3 * c] != 0x11) {
+                    throw std::runtime_error("不支持子采样的无损JPEG");
+                }
+            }
+            if (frame.precision < 2 || frame.precision > 16 || frame.rows != layout.rows
+                || frame.columns != layout.columns || frame.components != layout.samplesPerPixel
+                || frame.precision > layout.bitsAllocated) {
+                throw std::runtime_error("JPEG 帧头与DICOM像素格式不符");
+            }
+        } else if ((marker >= 0xC0 && marker <= 0xCF) && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+            throw std::runtime_error("只支持无损JPEG (SOF3)");
+        } else if (marker == 0xC4) { // DHT
+            const uint8_t *q = segment;
+            while (q + 17 <= segmentEnd) {
+                const int tableClass = q[0] >> 4; // Tc：0=DC，1=AC
+                const int id = q[0] & 0x0F;
+                const uint8_t *counts = q + 1;
+                int total = 0;
+                for (int i = 0; i < 16; ++i) total += counts[i];
+                if (tableClass > 1 || id > 3 || total > 256 || q + 17 + total > segmentEnd) {
+                    throw std::runtime_error("JPEG 霍夫曼表无效");
+                }
+                // 无损扫描只引用DC表；同号的AC表不能覆盖它，跳过
+                if (tableClass == 0) {
+                    tables[id].build(counts, q + 17, total);
+                }
+                q += 17 + total;
+            }
+        } else if (marker == 0xDD) { // DRI
+            restartInterval = readU16BE(segment);
+        } else if (marker == 0xDA) { // SOS
+            const int ns = segment[0];
+            if (frame.components == 0 || ns != frame.components || length < 6 + 2 * ns) {
+                throw std::runtime_error("只支持包含所有分量的单次扫描");
+            }
+            int tableOfComponent[4];
+            for (int c = 0; c < ns; ++c) {
+                if (segment[1 + 2 * c] != frame.componentIds[c]) {
+                    throw std::runtime_error("JPEG 扫描分量顺序无效");
+                }
+                tableOfComponent[c] = segment[2 + 2 * c] >> 4;
+                if (tableOfComponent[c] > 3 || !tables[tableOfComponent[c]].defined) {
+                    throw std::runtime_error("JPEG 缺少霍夫曼表");
+                }
+            }
+            const int predictor = segment[1 + 2 * ns];
+            const int pointTransform = segment[3 + 2 * ns] & 0x0F;
+            if (predictor < 1 || predictor > 7 || pointTransform >= frame.precision) {
+                throw std::runtime_error("JPEG 预测器无效");
+            }
+            decodeLosslessScan(segmentEnd, end, frame, tables, tableOfComponent,
+                               predictor, pointTransform, restartInterval, layout, out);
+            return;
+        }
+        p = segmentEnd;
+    }
+    throw std::runtime_error("JPEG 数据中没有扫描");
+}
+
+void decodeEncapsulatedFrame(const std::string &transferSyntaxUID, const char *data, size_t size,
+                             const PixelLayout &layout, char *out) {
+    if (transferSyntaxUID == RLE_LOSSLESS) {
+        decodeRLE(data, size, layout, out);
+    } else if (transferSyntaxUID == JPEG_LOSSLESS_PROCESS14 || transferSyntaxUID == JPEG_LOSSLESS_SV1) {
+        decodeJPEGLossless(data, size, layout, out);
+    } else {
+        throw std::runtime_error("不支持的压缩传输语法: " + transferSyntaxUID);
+    }
+}
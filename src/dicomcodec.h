@@ -0,0 +1,32 @@
+#ifndef DICOMCODEC_H
+#define DICOMCODEC_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// 封装 (压缩) 像素数据的解码：RLE Lossless 与 JPEG Lossless (Process 14，含 SV1)
+// 只依赖标准库，可在多个线程中同时调用；数据损坏或不支持的参数抛出 std::runtime_error。
+// 输出与未压缩像素数据相同的布局：小端、按像素交错、行序自上而下。
+
+// 单帧的像素布局
+struct PixelLayout {
+    int rows = 0;
+    int columns = 0;
+    int samplesPerPixel = 1;
+    int bitsAllocated = 16;   // 8 或 16
+};
+
+bool isEncapsulatedTransferSyntax(const std::string &transferSyntaxUID); // 是否为本模块支持的压缩语法
+
+// 从像素数据元素的值 (第一个条目为偏移表) 中取出第一帧，多个片段拼接到 frame
+void readEncapsulatedFrame(const char *data, size_t size, std::vector<char> &frame);
+
+void decodeRLE(const char *data, size_t size, const PixelLayout &layout, char *out);
+void decodeJPEGLossless(const char *data, size_t size, const PixelLayout &layout, char *out);
+
+// 按传输语法选择解码器
+void decodeEncapsulatedFrame(const std::string &transferSyntaxUID, const char *data, size_t size,
+                             const PixelLayout &layout, char *out);
+
+#endif // DICOMCODEC_H
@@ -0,0 +1,457 @@
+#include "dicomloader.h"
+#include "paralleldicomreader.h"
+#include "seriesindexcache.h"
+#include "volumecache.h"
+#include "volumeresample.h"
+#include "bodycrop.h"
+#include "memoryfootprint.h"
+#include "tracer.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QStandardPaths>
+
+#include <vtkDICOMImageReader.h>
+#include <vtkDataArray.h>
+#include <vtkPointData.h>
+#include <vtkNew.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+const qint64 DicomLoader::DEFAULT_OUT_OF_CORE_BUDGET = 2LL * 1024 * 1024 * 1024;
+const qint64 DicomLoader::DEFAULT_CINE_BUDGET = 4LL * 1024 * 1024 * 1024;
+
+DicomLoader::DicomLoader(QObject *parent)
+    : QObject(parent), cancelRequested(false),
+      progressive(false), bodyCrop(false), volumeCacheEnabled(false), volumeCacheLimit(VolumeCache::DEFAULT_MAX_BYTES),
+      outOfCore(false), outOfCoreBudget(DEFAULT_OUT_OF_CORE_BUDGET),
+      cine(false), cineBudget(DEFAULT_CINE_BUDGET)
+{
+}
+
+void DicomLoader::setProgressive(bool enabled) {
+    progressive = enabled;
+}
+
+void DicomLoader::setBodyCrop(bool enabled) {
+    bodyCrop = enabled;
+}
+
+void DicomLoader::setVolumeCache(bool enabled, qint64 maxBytes) {
+    volumeCacheEnabled = enabled;
+    volumeCacheLimit = maxBytes;
+}
+
+void DicomLoader::setOutOfCore(bool enabled, qint64 memoryBudget) {
+    outOfCore = enabled;
+    outOfCoreBudget = memoryBudget;
+}
+
+void DicomLoader::setCine(bool enabled, qint64 memoryBudget) {
+    cine = enabled;
+    cineBudget = memoryBudget;
+}
+
+void DicomLoader::cancel() {
+    cancelRequested = true;
+}
+
+bool DicomLoader::isCanceled() const {
+    return cancelRequested;
+}
+
+// 序列索引缓存目录，位于系统缓存位置下
+QString DicomLoader::seriesIndexDir() {
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).filePath("series-index");
+}
+
+// 解码后体数据的缓存目录
+QString DicomLoader::volumeCacheDir() {
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).filePath("volumes");
+}
+
+// 核外分块存储目录，每个序列一个文件，文件名与体数据缓存一样取自目录路径的哈希
+QString DicomLoader::outOfCoreDir() {
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).filePath("chunked");
+}
+
+void DicomLoader::load(const QString &dirPath) {
+    Tracer::instance().setThreadName("loader");
+    TRACE_SCOPE("DicomLoader::load");
+    try {
+        // 体数据缓存命中时直接映射缓存文件，完全跳过DICOM解析
+        VolumeCache volumeCache(volumeCacheDir(), volumeCacheLimit);
+        if (volumeCacheEnabled) {
+            emit progress(0, 0, "映射体数据缓存");
+            VolumeHistogram histogram;
+            vtkSmartPointer<vtkImageData> cached = volumeCache.open(dirPath, &histogram);
+            if (cached) {
+                emitLoaded(cached, histogram, 0);
+                return;
+            }
+        }
+
+        // 文件头和像素解码都在线程池中并行执行，进度回调可能来自任意工作线程
+        // 目录未变化时由索引缓存直接给出切片顺序和几何信息，只重新解析变化的文件
+        SeriesIndexCache indexCache(seriesIndexDir().toStdString());
+        ParallelDICOMReader reader;
+        reader.setCancelFlag(&cancelRequested);
+        reader.setIndexCache(&indexCache);
+        reader.setProgressCallback([this](int current, int total, const char *stage) {
+            emit progress(current, total, QString::fromUtf8(stage));
+        });
+
+        bool scanned = reader.scanDirectory(dirPath.toStdString());
+        qint64 bytes = 0; // 一个时相解码后的大小
+        if (scanned) {
+            const int *dims = reader.dimensions();
+            bytes = static_cast<qint64>(dims[0]) * dims[1] * dims[2] * reader.numberOfComponents()
+                * vtkAbstractArray::GetDataTypeSize(reader.scalarType());
+        }
+        if (scanned && cine && reader.phaseCount() > 1 && bytes <= cineBudget) {
+            loadPhases(reader);
+            return;
+        }
+        if (scanned && outOfCore) {
+            if (bytes > outOfCoreBudget) {
+                loadOutOfCore(dirPath, reader);
+                return;
+            }
+        }
+        if (scanned && progressive) {
+            loadProgressive(dirPath, reader, volumeCache);
+            return;
+        }
+        vtkSmartPointer<vtkImageData> image = scanned ? reader.readVolume() : nullptr;
+
+        if (reader.wasCanceled()) {
+            emit canceled();
+        } else if (!image) {
+            emit failed(QString::fromStdString(reader.errorMessage()));
+        } else {
+            // 多时相序列不写入缓存：命中缓存时跳过了扫描，无从得知时相
+            if (volumeCacheEnabled && reader.phaseCount() == 1) {
+                emit progress(0, 0, "写入体数据缓存");
+                volumeCache.store(dirPath, image, &reader.histogram());
+            }
+            emitLoaded(image, reader.histogram(), reader.threadCount());
+        }
+
+    } catch (std::exception &e) {
+        emit failed(QString("加载DICOM序列时发生错误：%1").arg(e.what()));
+    }
+}
+
+// 渐进加载分三批解码同一个预分配的体数据：
+// 1. 中间层，切片视图立即可见；
+// 2. 沿z均匀抽取的层，组成低分辨率预览交给三维视图；
+// 3. 其余切片，按离中间层由近到远的顺序。
+// 每层写完后在 DecodedSlices 中发布，GUI线程只读取已发布的层，其余层显示为占位内容。
+void DicomLoader::loadProgressive(const QString &dirPath, ParallelDICOMReader &reader, const VolumeCache &volumeCache) {
+    using Clock = std::chrono::steady_clock;
+    vtkSmartPointer<vtkImageData> image = reader.allocateVolume(true);
+    if (!image) {
+        emit failed(QString::fromStdString(reader.errorMessage()));
+        return;
+    }
+    const int *dims = reader.dimensions();
+    const int total = dims[2];
+    auto published = std::make_shared<DecodedSlices>(total);
+    emit volumeAllocated(image, published);
+
+    std::atomic<int> decoded(0);
+    std::atomic<long long> lastEmit(0);
+    reader.setSliceCallback([&](int z) {
+        published->publish(z); // 在通知GUI线程之前发布
+        int count = ++decoded;
+        long long now = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now().time_since_epoch()).count();
+        long long last = lastEmit;
+        if ((count == 1 || now - last >= 100) && lastEmit.compare_exchange_strong(last, now)) {
+            emit slicesDecoded(count, total);
+        }
+    });
+
+    const int middle = (total - 1) / 2; // 与轴状面滑块的初始位置一致
+    const int stride = std::max(1, total / 64);
+    std::vector<int> preview, rest;
+    for (int z = 0; z < total; ++z) {
+        if (z == middle) continue;
+        (z % stride == 0 ? preview : rest).push_back(z);
+    }
+    std::sort(rest.begin(), rest.end(), [middle](int a, int b) { return std::abs(a - middle) < std::abs(b - middle); });
+
+    bool ok = reader.decodeSlices(image, std::vector<int>(1, middle));
+    if (ok) {
+        emit slicesDecoded(decoded, total);
+        ok = reader.decodeSlices(image, preview);
+    }
+    if (ok) {
+        const int f = std::max(1, std::max(dims[0], dims[1]) / 128);
+        const int factors[3] = {f, f, stride};
+        vtkSmartPointer<vtkImageData> lowRes = decimateVolume(image, factors, reader.threadCount());
+        if (lowRes) {
+            emit previewReady(lowRes);
+        }
+        ok = reader.decodeSlices(image, rest);
+    }
+
+    if (reader.wasCanceled()) {
+        emit canceled();
+    } else if (!ok) {
+        emit failed(QString::fromStdString(reader.errorMessage()));
+    } else {
+        emit slicesDecoded(total, total);
+        // 多时相序列不写入缓存：命中缓存时跳过了扫描，无从得知时相
+        if (volumeCacheEnabled && reader.phaseCount() == 1) {
+            emit progress(0, 0, "写入体数据缓存");
+            volumeCache.store(dirPath, image, &reader.histogram());
+        }
+        emitLoaded(image, reader.histogram(), reader.threadCount());
+    }
+}
+
+// 核外加载：目录未变化时直接打开已有的分块存储，否则按 32 层的层块流式解码构建，只占一个层块的内存
+// 块缓存和驻留的金字塔层各分到预算的一半；最粗一层很小，先交出去让切片和三维视图立即可用
+void DicomLoader::loadOutOfCore(const QString &dirPath, ParallelDICOMReader &reader) {
+    TRACE_SCOPE("DicomLoader::loadOutOfCore");
+    const QString cleanDir = QDir::cleanPath(dirPath);
+    const QByteArray key = QCryptographicHash::hash(cleanDir.toUtf8(), QCryptographicHash::Sha1).toHex();
+    const std::string path = QDir(outOfCoreDir()).filePath(QString::fromLatin1(key.left(16)) + ".chunks").toStdString();
+    const uint64_t fingerprint = directoryFingerprint(cleanDir.toStdString());
+
+    std::string error;
+    std::shared_ptr<ChunkedVolume> chunked = ChunkedVolume::open(path, fingerprint);
+    if (!chunked) {
+        ChunkedVolume::BuildOptions options;
+        options.fingerprint = fingerprint;
+        options.threadCount = reader.threadCount();
+        options.cancel = &cancelRequested;
+        options.progress = [this](int current, int total, const char *stage) {
+            emit progress(current, total, QString::fromUtf8(stage));
+        };
+        if (ChunkedVolume::build(reader, path, options, &error)) {
+            chunked = ChunkedVolume::open(path, fingerprint, &error);
+        }
+        if (!chunked) {
+            if (isCanceled()) {
+                emit canceled();
+            } else {
+                emit failed(QString("构建核外分块存储失败：%1").arg(QString::fromStdString(error)));
+            }
+            return;
+        }
+    }
+    chunked->setThreadCount(reader.threadCount());
+    chunked->setCacheBudget(outOfCoreBudget / 2);
+
+    const int coarsest = chunked->levels() - 1;
+    const int finest = chunked->finestLevelWithin(outOfCoreBudget / 2);
+    emit progress(0, 0, "读取分辨率金字塔");
+    vtkSmartPointer<vtkImageData> resident = chunked->readLevel(coarsest, &cancelRequested);
+    if (!resident) {
+        if (isCanceled()) {
+            emit canceled();
+        } else {
+            emit failed("读取核外分块存储失败");
+        }
+        return;
+    }
+    std::shared_ptr<const VolumeHistogram> histogram;
+    if (!chunked->histogram().empty()) {
+        histogram = std::make_shared<const VolumeHistogram>(chunked->histogram());
+    }
+    emit outOfCoreOpened(chunked, resident, histogram);
+
+    // 逐级换成更细的层；取消时保留已经读入的层
+    for (int level = coarsest - 1; level >= finest && !isCanceled(); --level) {
+        emit progress(coarsest - level, coarsest - finest, "读取分辨率金字塔");
+        resident = chunked->readLevel(level, &cancelRequested);
+        if (!resident) {
+            break;
+        }
+        emit residentLevelReady(resident, level);
+    }
+    emit outOfCoreFinished();
+}
+
+// 多时相序列逐个时相解码，每个时相一个体数据；全部时相超出预算时等间隔地隔相预载，仍覆盖整个周期
+// 各时相直方图的分箱相同 (读取器按全部时相的取值范围建立)，合并后的窗宽窗位对整个周期都合适
+void DicomLoader::loadPhases(ParallelDICOMReader &reader) {
+    TRACE_SCOPE("DicomLoader::loadPhases");
+    const int *dims = reader.dimensions();
+    const qint64 phaseBytes = static_cast<qint64>(dims[0]) * dims[1] * dims[2] * reader.numberOfComponents()
+        * vtkAbstractArray::GetDataTypeSize(reader.scalarType());
+    const int total = reader.phaseCount();
+    const int fit = static_cast<int>(std::max<qint64>(1, cineBudget / std::max<qint64>(1, phaseBytes)));
+    const int stride = (total + fit - 1) / fit;
+    const int count = (total + stride - 1) / stride;
+
+    auto series = std::make_shared<CineSeries>();
+    series->sourcePhases = total;
+    series->phaseStride = stride;
+    VolumeHistogram histogram;
+    int loadedPhases = 0;
+    reader.setProgressCallback([this, &loadedPhases, count](int current, int slices, const char *) {
+        emit progress(loadedPhases * slices + current, count * slices, "解码各时相");
+    });
+    for (int phase = 0; phase < total && !isCanceled(); phase += stride) {
+        vtkSmartPointer<vtkImageData> image = reader.selectPhase(phase) ? reader.readVolume() : nullptr;
+        if (!image) {
+            break;
+        }
+        if (loadedPhases == 0) {
+            histogram = reader.histogram();
+        } else if (!histogram.empty() && !histogram.merge(reader.histogram())) {
+            histogram = VolumeHistogram(); // 分箱不一致时放弃，窗宽窗位按体数据范围计算
+        }
+        series->phases.push_back(image);
+        series->triggerTimes.push_back(reader.phaseTriggerTime(phase));
+        ++loadedPhases;
+    }
+
+    if (reader.wasCanceled() || isCanceled()) {
+        emit canceled();
+    } else if (loadedPhases < count) {
+        emit failed(QString::fromStdString(reader.errorMessage()));
+    } else {
+        std::shared_ptr<const VolumeHistogram> shared;
+        if (!histogram.empty()) {
+            shared = std::make_shared<const VolumeHistogram>(std::move(histogram));
+        }
+        emit phasesLoaded(series, shared);
+    }
+}
+
+void DicomLoader::emitLoaded(vtkSmartPointer<vtkImageData> image, VolumeHistogram histogram, int threadCount) {
+    image = cropBody(image, threadCount, histogram);
+    std::shared_ptr<const VolumeHistogram> shared;
+    if (!histogram.empty()) {
+        shared = std::make_shared<const VolumeHistogram>(std::move(histogram));
+    }
+    emit loaded(image, shared);
+}
+
+// 找到病人的包围盒并复制出来；阈值以上的体素铺满整个体数据时原样返回
+// 裁剪时直方图在拷贝过程中按裁剪后的体素重新统计
+vtkSmartPointer<vtkImageData> DicomLoader::cropBody(vtkSmartPointer<vtkImageData> image, int threadCount,
+                                                    VolumeHistogram &histogram) {
+    if (!bodyCrop) {
+        return image;
+    }
+    TRACE_SCOPE("DicomLoader::cropBody");
+    emit progress(0, 0, "裁剪体外区域");
+    const auto start = std::chrono::steady_clock::now();
+    BodyCropOptions options;
+    options.threadCount = threadCount;
+    int extent[6];
+    int *dims = image->GetDimensions();
+    if (!findBodyExtent(image, options, extent)
+        || (extent[1] - extent[0] + 1 == dims[0] && extent[3] - extent[2] + 1 == dims[1]
+            && extent[5] - extent[4] + 1 == dims[2])) {
+        return image;
+    }
+    vtkSmartPointer<vtkImageData> cropped = cropVolume(image, extent, threadCount, histogram.empty() ? nullptr : &histogram);
+    if (!cropped) {
+        return image;
+    }
+    emit bodyCropped(MemoryFootprint::imageBytes(image), MemoryFootprint::imageBytes(cropped),
+                     std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    return cropped;
+}
+
+// 用 vtkDICOMImageReader 和并行读取器分别读取同一序列，比较耗时和输出是否一致
+void DicomLoader::compareReaders(const QString &dirPath) {
+    try {
+        using Clock = std::chrono::steady_clock;
+        const std::string path = dirPath.toStdString();
+
+        emit progress(0, 2, "vtkDICOMImageReader");
+        auto start = Clock::now();
+        vtkNew<vtkDICOMImageReader> vtkReader;
+        vtkReader->SetDirectoryName(path.c_str());
+        vtkReader->Update();
+        double vtkSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+        vtkImageData *expected = vtkReader->GetOutput();
+
+        if (cancelRequested) {
+            emit canceled();
+            return;
+        }
+
+        emit progress(1, 2, "ParallelDICOMReader");
+        ParallelDICOMReader reader;
+        reader.setCancelFlag(&cancelRequested);
+        start = Clock::now();
+        vtkSmartPointer<vtkImageData> actual = reader.scanDirectory(path) ? reader.readVolume() : nullptr;
+        double parallelSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        if (reader.wasCanceled()) {
+            emit canceled();
+            return;
+        }
+        if (!actual || !expected || expected->GetScalarType() == VTK_VOID) {
+            emit failed(QString("读取失败：%1").arg(QString::fromStdString(reader.errorMessage())));
+            return;
+        }
+        emit progress(2, 2, "比较输出");
+
+        // 逐体素比较
+        int *de = expected->GetDimensions();
+        int *da = actual->GetDimensions();
+        QString comparison;
+        if (de[0] != da[0] || de[1] != da[1] || de[2] != da[2]) {
+            comparison = QString("尺寸不一致：%1x%2x%3 / %4x%5x%6")
+                .arg(de[0]).arg(de[1]).arg(de[2]).arg(da[0]).arg(da[1]).arg(da[2]);
+        } else {
+            vtkDataArray *a = expected->GetPointData()->GetScalars();
+            vtkDataArray *b = actual->GetPointData()->GetScalars();
+            vtkIdType values = a->GetNumberOfTuples() * a->GetNumberOfComponents();
+            vtkIdType mismatches = 0;
+            if (a->GetDataType() == b->GetDataType()
+                && std::memcmp(a->GetVoidPointer(0), b->GetVoidPointer(0),
+                               static_cast<size_t>(values) * a->GetDataTypeSize()) == 0) {
+                mismatches = 0;
+            } else {
+                for (vtkIdType i = 0; i < values; ++i) {
+                    if (a->GetComponent(i / a->GetNumberOfComponents(), i % a->GetNumberOfComponents())
+                        != b->GetComponent(i / b->GetNumberOfComponents(), i % b->GetNumberOfComponents())) {
+                        ++mismatches;
+                    }
+                }
+            }
+            comparison = mismatches == 0
+                ? QString("体素完全一致")
+                : QString("%1 / %2 个体素不一致").arg(mismatches).arg(values);
+            if (expected->GetScalarType() != actual->GetScalarType()) {
+                comparison += QString("\n数据类型不同：%1 / %2")
+                    .arg(expected->GetScalarTypeAsString()).arg(actual->GetScalarTypeAsString());
+            }
+        }
+
+        double *se = expected->GetSpacing();
+        double *sa = actual->GetSpacing();
+        emit benchmarkFinished(QString(
+            "图像大小: %1x%2x%3\n"
+            "vtkDICOMImageReader: %4 s\n"
+            "ParallelDICOMReader (%5 线程): %6 s (文件头 %7 s, 解码 %8 s)\n"
+            "加速比: %9x\n"
+            "间距: (%10, %11, %12) / (%13, %14, %15)\n"
+            "%16")
+            .arg(da[0]).arg(da[1]).arg(da[2])
+            .arg(vtkSeconds, 0, 'f', 3)
+            .arg(reader.threadCount())
+            .arg(parallelSeconds, 0, 'f', 3)
+            .arg(reader.headerSeconds(), 0, 'f', 3)
+            .arg(reader.decodeSeconds(), 0, 'f', 3)
+            .arg(parallelSeconds > 0.0 ? vtkSeconds / parallelSeconds : 0.0, 0, 'f', 2)
+            .arg(se[0]).arg(se[1]).arg(se[2])
+            .arg(sa[0]).arg(sa[1]).arg(sa[2])
+            .arg(comparison));
+
+    } catch (std::exception &e) {
+        emit failed(QString("性能对比时发生错误：%1").arg(e.what()));
+    }
+}
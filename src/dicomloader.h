@@ -0,0 +1,105 @@
+#ifndef DICOMLOADER_H
+#define DICOMLOADER_H
+
+#include <QObject>
+#include <QString>
+#include <QMetaType>
+
+#include <atomic>
+#include <memory>
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+
+#include "volumehistogram.h"
+#include "chunkedvolume.h"
+#include "cineplayer.h"
+#include "decodedslices.h"
+
+class ParallelDICOMReader;
+class VolumeCache;
+
+// 在工作线程中读取DICOM序列
+// 使用 ParallelDICOMReader 多线程解析和解码，逐文件汇报进度，可在序列中途取消，
+// 读取完成后把完整的vtkImageData交回GUI线程
+class DicomLoader : public QObject {
+    Q_OBJECT
+
+public:
+    static const qint64 DEFAULT_OUT_OF_CORE_BUDGET;
+    static const qint64 DEFAULT_CINE_BUDGET;
+
+    explicit DicomLoader(QObject *parent = nullptr);
+
+    void cancel();            // 请求取消，可从任意线程调用
+    bool isCanceled() const;
+
+    // 启用后优先映射已解码的体数据缓存，未命中时读取完成后写入缓存
+    void setVolumeCache(bool enabled, qint64 maxBytes);
+    // 渐进加载：先给出已清零的体数据和中间层，再给出抽取预览，最后补全其余切片
+    void setProgressive(bool enabled);
+    // 读取完成后裁掉病人体外的空气和检查床 (体数据缓存中保存的仍是完整体数据)
+    void setBodyCrop(bool enabled);
+    // 核外模式：解码后的体数据超出 memoryBudget 时不整体读入内存，改为构建或打开磁盘上的分块存储
+    void setOutOfCore(bool enabled, qint64 memoryBudget);
+    // 多时相序列预载全部时相用于电影回放；总量超出 memoryBudget 时隔相预载，单个时相都放不下时按普通序列读取第一个时相
+    void setCine(bool enabled, qint64 memoryBudget);
+
+    static QString seriesIndexDir(); // 序列索引缓存所在目录
+    static QString volumeCacheDir(); // 体数据缓存所在目录
+    static QString outOfCoreDir();   // 核外分块存储所在目录
+
+public slots:
+    void load(const QString &dirPath); // 在工作线程中执行
+    void compareReaders(const QString &dirPath); // 与 vtkDICOMImageReader 对比耗时和输出
+
+signals:
+    void progress(int current, int total, const QString &stage); // 每个文件汇报一次
+    // histogram 为最终体数据 (裁剪后) 的灰度直方图，解码时顺带统计；没有时为空指针
+    void loaded(vtkSmartPointer<vtkImageData> image, std::shared_ptr<const VolumeHistogram> histogram);
+    void failed(const QString &message);
+    void canceled();
+    void benchmarkFinished(const QString &report);
+
+    // 渐进加载信号，image 在 loaded 之前会被工作线程继续写入，只有 decoded 中已发布的层可以读取
+    void volumeAllocated(vtkSmartPointer<vtkImageData> image, std::shared_ptr<const DecodedSlices> decoded);
+    void slicesDecoded(int decoded, int total); // 节流，最多约每100ms一次
+    void previewReady(vtkSmartPointer<vtkImageData> preview);
+
+    void bodyCropped(qint64 originalBytes, qint64 croppedBytes, double milliseconds); // 在 loaded 之前发出
+
+    // 核外加载代替 loaded：先给出分块存储和最粗的金字塔层，随后逐级给出更细的层，
+    // 直到放得进预算的最细一层，最后发出 outOfCoreFinished (中途取消时也会发出)
+    void outOfCoreOpened(std::shared_ptr<ChunkedVolume> volume, vtkSmartPointer<vtkImageData> resident,
+                         std::shared_ptr<const VolumeHistogram> histogram);
+    void residentLevelReady(vtkSmartPointer<vtkImageData> resident, int level);
+    void outOfCoreFinished();
+
+    // 多时相序列代替 loaded：全部预载的时相 (不裁剪体外区域)，histogram 为各时相合并后的直方图
+    void phasesLoaded(std::shared_ptr<const CineSeries> series, std::shared_ptr<const VolumeHistogram> histogram);
+
+private:
+    void loadProgressive(const QString &dirPath, ParallelDICOMReader &reader, const VolumeCache &volumeCache);
+    void loadOutOfCore(const QString &dirPath, ParallelDICOMReader &reader);
+    void loadPhases(ParallelDICOMReader &reader);
+    vtkSmartPointer<vtkImageData> cropBody(vtkSmartPointer<vtkImageData> image, int threadCount, VolumeHistogram &histogram);
+    void emitLoaded(vtkSmartPointer<vtkImageData> image, VolumeHistogram histogram, int threadCount);
+
+    std::atomic<bool> cancelRequested;
+    bool progressive;
+    bool bodyCrop;
+    bool volumeCacheEnabled;
+    qint64 volumeCacheLimit;
+    bool outOfCore;
+    qint64 outOfCoreBudget;
+    bool cine;
+    qint64 cineBudget;
+};
+
+Q_DECLARE_METATYPE(vtkSmartPointer<vtkImageData>)
+Q_DECLARE_METATYPE(std::shared_ptr<const VolumeHistogram>)
+Q_DECLARE_METATYPE(std::shared_ptr<ChunkedVolume>)
+Q_DECLARE_METATYPE(std::shared_ptr<const CineSeries>)
+Q_DECLARE_METATYPE(std::shared_ptr<const DecodedSlices>)
+
+#endif // DICOMLOADER_H
@@ -0,0 +1,307 @@
+#include "dicomparser.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+const uint32_t UNDEFINED_LENGTH = 0xFFFFFFFFu;
+
+const char *IMPLICIT_VR_LITTLE_ENDIAN = "1.2.840.10008.1.2";
+const char *EXPLICIT_VR_LITTLE_ENDIAN = "1.2.840.10008.1.2.1";
+const char *EXPLICIT_VR_BIG_ENDIAN = "1.2.840.10008.1.2.2";
+const char *DEFLATED_EXPLICIT_VR_LITTLE_ENDIAN = "1.2.840.10008.1.2.1.99";
+
+// 显式VR下使用4字节长度的VR
+bool hasLongLength(const char vr[2]) {
+    static const char *longVRs[] = {"OB", "OD", "OF", "OL", "OV", "OW", "SQ", "SV", "UC", "UN", "UR", "UT", "UV"};
+    for (const char *v : longVRs) {
+        if (vr[0] == v[0] && vr[1] == v[1]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool looksLikeVR(const char vr[2]) {
+    return vr[0] >= 'A' && vr[0] <= 'Z' && vr[1] >= 'A' && vr[1] <= 'Z';
+}
+
+uint16_t readU16(const char *p) {
+    return static_cast<uint16_t>(static_cast<unsigned char>(p[0]) | (static_cast<unsigned char>(p[1]) << 8));
+}
+
+uint32_t readU32(const char *p) {
+    return static_cast<uint32_t>(readU16(p)) | (static_cast<uint32_t>(readU16(p + 2)) << 16);
+}
+
+// 去掉字符串值两端的空格和NUL填充
+std::string trimValue(const std::string &value) {
+    size_t begin = value.find_first_not_of(std::string(" \0", 2));
+    if (begin == std::string::npos) {
+        return std::string();
+    }
+    size_t end = value.find_last_not_of(std::string(" \0", 2));
+    return value.substr(begin, end - begin + 1);
+}
+
+// 解析以反斜杠分隔的多值DS/IS字段
+int parseNumbers(const std::string &value, double *out, int maxCount) {
+    int count = 0;
+    std::stringstream stream(value);
+    std::string item;
+    while (count < maxCount && std::getline(stream, item, '\\')) {
+        item = trimValue(item);
+        if (item.empty()) {
+            break;
+        }
+        out[count++] = std::atof(item.c_str());
+    }
+    return count;
+}
+
+// 顺序读取数据元素的文件头流
+class HeaderStream {
+public:
+    explicit HeaderStream(std::ifstream &in) : in(in) {}
+
+    bool explicitVR = true;
+
+    struct Element {
+        uint16_t group = 0;
+        uint16_t element = 0;
+        char vr[2] = {0, 0};
+        uint32_t length = 0;
+    };
+
+    bool readElement(Element &e) {
+        char tag[4];
+        if (!in.read(tag, 4)) {
+            return false;
+        }
+        e.group = readU16(tag);
+        e.element = readU16(tag + 2);
+        e.vr[0] = e.vr[1] = 0;
+
+        char buf[4];
+        // 条目和定界符没有VR，长度总是4字节
+        if (e.group == 0xFFFE) {
+            if (!in.read(buf, 4)) return false;
+            e.length = readU32(buf);
+            return true;
+        }
+        // 文件元信息组总是显式VR
+        if (e.group == 0x0002 || explicitVR) {
+            if (!in.read(e.vr, 2)) return false;
+            if (hasLongLength(e.vr)) {
+                if (!in.read(buf, 2) || !in.read(buf, 4)) return false; // 2字节保留 + 4字节长度
+                e.length = readU32(buf);
+            } else {
+                if (!in.read(buf, 2)) return false;
+                e.length = readU16(buf);
+            }
+        } else {
+            if (!in.read(buf, 4)) return false;
+            e.length = readU32(buf);
+        }
+        return true;
+    }
+
+    bool skip(uint32_t length) {
+        return static_cast<bool>(in.seekg(length, std::ios::cur));
+    }
+
+    bool readValue(uint32_t length, std::string &value) {
+        value.resize(length);
+        return length == 0 || static_cast<bool>(in.read(&value[0], length));
+    }
+
+    // 跳过未定义长度的序列，直到序列定界符
+    bool skipSequence() {
+        Element e;
+        while (readElement(e)) {
+            if (e.group == 0xFFFE && e.element == 0xE0DD) {
+                return true;
+            }
+            if (e.group == 0xFFFE && e.element == 0xE000) {
+                if (e.length == UNDEFINED_LENGTH) {
+                    if (!skipItem()) return false;
+                } else if (!skip(e.length)) {
+                    return false;
+                }
+            } else {
+                return false;
+            }
+        }
+        return false;
+    }
+
+    // 跳过未定义长度的条目，直到条目定界符
+    bool skipItem() {
+        Element e;
+        while (readElement(e)) {
+            if (e.group == 0xFFFE && e.element == 0xE00D) {
+                return true;
+            }
+            if (e.length == UNDEFINED_LENGTH) {
+                if (!skipSequence()) return false;
+            } else if (!skip(e.length)) {
+                return false;
+            }
+        }
+        return false;
+    }
+
+    std::ifstream &in;
+};
+
+void setError(std::string *error, const std::string &message) {
+    if (error) {
+        *error = message;
+    }
+}
+
+} // namespace
+
+bool isNativeTransferSyntax(const std::string &transferSyntaxUID) {
+    return transferSyntaxUID.empty()
+        || transferSyntaxUID == IMPLICIT_VR_LITTLE_ENDIAN
+        || transferSyntaxUID == EXPLICIT_VR_LITTLE_ENDIAN;
+}
+
+bool parseDicomHeader(const std::string &fileName, DicomSliceInfo &info, std::string *error) {
+    info = DicomSliceInfo();
+    info.fileName = fileName;
+
+    std::ifstream in(std::filesystem::u8path(fileName), std::ios::binary);
+    if (!in) {
+        setError(error, "无法打开文件");
+        return false;
+    }
+
+    // 128字节前导 + "DICM"；没有前导的旧文件直接从数据集开始
+    char preamble[132];
+    if (in.read(preamble, 132) && std::memcmp(preamble + 128, "DICM", 4) == 0) {
+        in.seekg(132);
+    } else {
+        in.clear();
+        in.seekg(0);
+    }
+
+    HeaderStream stream(in);
+    bool datasetStarted = false;
+    HeaderStream::Element e;
+    std::string value;
+
+    while (true) {
+        std::streampos elementStart = in.tellg();
+        char peek[6];
+        if (!in.read(peek, 6)) {
+            break;
+        }
+        in.seekg(elementStart);
+
+        // 进入数据集时根据传输语法确定VR方式；缺少元信息时按VR字符猜测
+        if (!datasetStarted && readU16(peek) != 0x0002) {
+            datasetStarted = true;
+            if (info.transferSyntaxUID == EXPLICIT_VR_BIG_ENDIAN
+                || info.transferSyntaxUID == DEFLATED_EXPLICIT_VR_LITTLE_ENDIAN) {
+                setError(error, "不支持的传输语法: " + info.transferSyntaxUID);
+                return false;
+            }
+            if (info.transferSyntaxUID.empty()) {
+                stream.explicitVR = looksLikeVR(peek + 4);
+            } else {
+                stream.explicitVR = info.transferSyntaxUID != IMPLICIT_VR_LITTLE_ENDIAN;
+            }
+        }
+
+        if (!stream.readElement(e)) {
+            break;
+        }
+
+        // 像素数据：记录位置后停止解析
+        if (e.group == 0x7FE0 && e.element == 0x0010) {
+            info.pixelDataOffset = static_cast<uint64_t>(in.tellg());
+            info.pixelDataLength = e.length;
+            break;
+        }
+
+        if (e.length == UNDEFINED_LENGTH) {
+            if (!stream.skipSequence()) {
+                setError(error, "序列结构损坏");
+                return false;
+            }
+            continue;
+        }
+
+        const uint32_t tag = (static_cast<uint32_t>(e.group) << 16) | e.element;
+        const bool wanted =
+            tag == 0x00020010 || tag == 0x0020000E || tag == 0x00200013 || tag == 0x00200032
+            || tag == 0x00200037 || tag == 0x00280002 || tag == 0x00280010 || tag == 0x00280011
+            || tag == 0x00280030 || tag == 0x00180050 || tag == 0x00280100 || tag == 0x00280103
+            || tag == 0x00281052 || tag == 0x00281053 || tag == 0x00200100 || tag == 0x00181060;
+
+        if (!wanted || e.length > 1024) {
+            if (!stream.skip(e.length)) {
+                break;
+            }
+            continue;
+        }
+        if (!stream.readValue(e.length, value)) {
+            break;
+        }
+
+        double numbers[6];
+        switch (tag) {
+            case 0x00020010: info.transferSyntaxUID = trimValue(value); break;
+            case 0x0020000E: info.seriesInstanceUID = trimValue(value); break;
+            case 0x00200013:
+                if (parseNumbers(value, numbers, 1) == 1) info.instanceNumber = static_cast<int>(numbers[0]);
+                break;
+            case 0x00200100:
+                if (parseNumbers(value, numbers, 1) == 1) info.temporalPositionIdentifier = static_cast<int>(numbers[0]);
+                break;
+            case 0x00181060:
+                if (parseNumbers(value, numbers, 1) == 1) info.triggerTime = numbers[0];
+                break;
+            case 0x00200032: parseNumbers(value, info.imagePosition, 3); break;
+            case 0x00200037: parseNumbers(value, info.imageOrientation, 6); break;
+            case 0x00280030: parseNumbers(value, info.pixelSpacing, 2); break;
+            case 0x00180050:
+                if (parseNumbers(value, numbers, 1) == 1) info.sliceThickness = numbers[0];
+                break;
+            case 0x00281052:
+                if (parseNumbers(value, numbers, 1) == 1) info.rescaleIntercept = numbers[0];
+                break;
+            case 0x00281053:
+                if (parseNumbers(value, numbers, 1) == 1) info.rescaleSlope = numbers[0];
+                break;
+            default:
+                // US 类型的整数字段
+                if (value.size() >= 2) {
+                    int us = readU16(value.data());
+                    if (tag == 0x00280002) info.samplesPerPixel = us;
+                    else if (tag == 0x00280010) info.rows = us;
+                    else if (tag == 0x00280011) info.columns = us;
+                    else if (tag == 0x00280100) info.bitsAllocated = us;
+                    else if (tag == 0x00280103) info.pixelRepresentation = us;
+                }
+                break;
+        }
+    }
+
+    if (info.pixelDataOffset == 0) {
+        setError(error, "未找到像素数据");
+        return false;
+    }
+    if (info.rows <= 0 || info.columns <= 0) {
+        setError(error, "图像尺寸无效");
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,40 @@
+#ifndef DICOMPARSER_H
+#define DICOMPARSER_H
+
+#include <cstdint>
+#include <string>
+
+// 单个DICOM切片文件的头信息，只包含重建体数据所需的字段
+struct DicomSliceInfo {
+    std::string fileName;          // UTF-8 路径
+    std::string transferSyntaxUID;
+    std::string seriesInstanceUID;
+
+    int rows = 0;
+    int columns = 0;
+    int samplesPerPixel = 1;
+    int bitsAllocated = 16;
+    int pixelRepresentation = 0;   // 0 无符号, 1 有符号
+    int instanceNumber = 0;
+    int temporalPositionIdentifier = 0; // (0020,0100)，0 表示文件中没有
+    double triggerTime = -1.0;          // (0018,1060) ms，负值表示文件中没有
+
+    double pixelSpacing[2] = {1.0, 1.0}; // 行间距, 列间距
+    double sliceThickness = 1.0;
+    double imagePosition[3] = {0.0, 0.0, 0.0};
+    double imageOrientation[6] = {1.0, 0.0, 0.0, 0.0, 1.0, 0.0};
+    double rescaleSlope = 1.0;
+    double rescaleIntercept = 0.0;
+
+    uint64_t pixelDataOffset = 0;  // 像素数据在文件中的偏移
+    uint64_t pixelDataLength = 0;  // 原始长度，封装格式为 0xFFFFFFFF
+};
+
+// 只解析文件头，遇到像素数据元素即停止，不读取像素内容
+// 支持隐式/显式VR小端格式；失败时返回false并写入error
+bool parseDicomHeader(const std::string &fileName, DicomSliceInfo &info, std::string *error = nullptr);
+
+// 是否为未压缩的像素数据 (隐式/显式VR小端)
+bool isNativeTransferSyntax(const std::string &transferSyntaxUID);
+
+#endif // DICOMPARSER_H
@@ -0,0 +1,111 @@
+#include "isosurfacebuilder.h"
+#include "tracer.h"
+
+IsosurfaceBuilder::IsosurfaceBuilder(IsosurfaceCache &cache, QObject *parent)
+    : QObject(parent), cache(cache), pending(false), generation(0), readyRequest(0), stopping(false)
+{
+    worker = std::thread(&IsosurfaceBuilder::run, this);
+}
+
+// 正在提取的阈值做完才能退出
+IsosurfaceBuilder::~IsosurfaceBuilder() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    worker.join();
+}
+
+unsigned int IsosurfaceBuilder::request(vtkImageData *input, const IsosurfaceKey &requestKey,
+                                        const std::vector<double> &requestThresholds,
+                                        const IsosurfaceExtractor &requestExtractor) {
+    std::lock_guard<std::mutex> lock(mutex);
+    volume = input;
+    key = requestKey;
+    thresholds = requestThresholds;
+    extractor = requestExtractor;
+    pending = true;
+    ready.clear();
+    wake.notify_one();
+    return ++generation;
+}
+
+void IsosurfaceBuilder::cancel() {
+    std::lock_guard<std::mutex> lock(mutex);
+    volume = nullptr; // 不再持有已卸下的体数据
+    pending = false;
+    ready.clear();
+    ++generation;
+}
+
+bool IsosurfaceBuilder::takeResult(unsigned int request, std::vector<Surface> &surfaces) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (request != generation || readyRequest != request) {
+        return false;
+    }
+    surfaces = std::move(ready);
+    ready.clear();
+    readyRequest = 0;
+    return true;
+}
+
+void IsosurfaceBuilder::run() {
+    Tracer::instance().setThreadName("isosurface");
+    for (;;) {
+        vtkSmartPointer<vtkImageData> input;
+        IsosurfaceKey jobKey;
+        std::vector<double> jobThresholds;
+        IsosurfaceExtractor jobExtractor;
+        unsigned int jobGeneration;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || pending; });
+            if (stopping) {
+                return;
+            }
+            input = volume;
+            jobKey = key;
+            jobThresholds = thresholds;
+            jobExtractor = extractor;
+            jobGeneration = generation;
+            pending = false;
+        }
+
+        TRACE_SCOPE("IsosurfaceBuilder::build");
+        std::vector<Surface> surfaces;
+        bool superseded = false;
+        for (double threshold : jobThresholds) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                superseded = stopping || jobGeneration != generation;
+            }
+            if (superseded) {
+                break;
+            }
+            Surface surface;
+            surface.threshold = threshold;
+            jobKey.threshold = threshold;
+            surface.mesh = cache.find(jobKey);
+            surface.cached = surface.mesh.GetPointer() != nullptr;
+            if (!surface.cached) {
+                surface.mesh = jobExtractor.extract(input, threshold, &surface.stats);
+                cache.insert(jobKey, surface.mesh); // 作废的请求提取的网格也留在缓存中，切回来时可以直接用
+            }
+            surfaces.push_back(surface);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            superseded = superseded || stopping || jobGeneration != generation;
+            if (!superseded) {
+                ready = std::move(surfaces);
+                readyRequest = jobGeneration;
+                volume = nullptr;
+            }
+        }
+        if (!superseded) {
+            emit meshesReady(jobGeneration);
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef ISOSURFACEBUILDER_H
+#define ISOSURFACEBUILDER_H
+
+#include <QObject>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+#include <vtkPolyData.h>
+
+#include "isosurfaceextractor.h"
+
+// 在后台线程中提取等值面，界面线程在提取期间保持响应
+// 每次请求给出体数据和全部阈值，缓存中没有的网格由后台线程提取并放入缓存；
+// 全部阈值就绪后发出 meshesReady，界面线程用 takeResult 取走网格再换上演员。
+// 新的请求或 cancel 会作废尚未完成的请求，正在提取的那个阈值做完后丢弃结果。
+class IsosurfaceBuilder : public QObject {
+    Q_OBJECT
+
+public:
+    // 一个阈值的网格
+    struct Surface {
+        double threshold = 0.0;
+        vtkSmartPointer<vtkPolyData> mesh;
+        bool cached = false; // 取自缓存，stats 无意义
+        IsosurfaceExtractor::Statistics stats;
+    };
+
+    explicit IsosurfaceBuilder(IsosurfaceCache &cache, QObject *parent = nullptr);
+    ~IsosurfaceBuilder();
+
+    // 返回请求编号；key 中的阈值不用填写，extractor 的线程数和三角形预算在请求时复制
+    unsigned int request(vtkImageData *volume, const IsosurfaceKey &key, const std::vector<double> &thresholds,
+                         const IsosurfaceExtractor &extractor);
+    void cancel();
+    // 取走编号为 request 的结果，已被新的请求作废时返回 false
+    bool takeResult(unsigned int request, std::vector<Surface> &surfaces);
+
+signals:
+    void meshesReady(unsigned int request); // 在后台线程中发出，连接到界面线程的对象时自动排队
+
+private:
+    void run();
+
+    IsosurfaceCache &cache;
+
+    mutable std::mutex mutex; // 保护以下与后台线程共享的状态
+    std::condition_variable wake;
+    vtkSmartPointer<vtkImageData> volume;
+    IsosurfaceKey key;
+    std::vector<double> thresholds;
+    IsosurfaceExtractor extractor;
+    bool pending;             // 有尚未开始的请求
+    unsigned int generation;  // 每次请求或取消加一，旧请求的结果作废
+    unsigned int readyRequest;
+    std::vector<Surface> ready;
+    bool stopping;
+
+    std::thread worker;
+};
+
+#endif // ISOSURFACEBUILDER_H
@@ -0,0 +1,238 @@
+#include "isosurfaceextractor.h"
+#include "parallelfor.h"
+#include "tracer.h"
+
+#include <vtkAppendPolyData.h>
+#include <vtkDataArray.h>
+#include <vtkDecimatePro.h>
+#include <vtkFlyingEdges3D.h>
+#include <vtkPointData.h>
+#include <vtkPolyDataNormals.h>
+#include <vtkStaticCleanPolyData.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+const int64_t IsosurfaceExtractor::DEFAULT_TRIANGLE_BUDGET;
+const size_t IsosurfaceCache::DEFAULT_MAX_BYTES = 256 * 1024 * 1024;
+
+namespace {
+
+const int MIN_SLAB_CELLS = 8; // 每个层块至少包含的体素层间隔
+
+using Clock = std::chrono::steady_clock;
+
+double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// 第 z0 到 z1 层 (含) 组成的层块，标量直接引用体数据内存，世界坐标与体数据一致
+vtkSmartPointer<vtkImageData> makeSlab(vtkImageData *volume, int z0, int z1) {
+    int dims[3], extent[6];
+    volume->GetDimensions(dims);
+    volume->GetExtent(extent);
+
+    vtkSmartPointer<vtkImageData> slab = vtkSmartPointer<vtkImageData>::New();
+    slab->SetExtent(extent[0], extent[1], extent[2], extent[3], extent[4] + z0, extent[4] + z1);
+    slab->SetOrigin(volume->GetOrigin());
+    slab->SetSpacing(volume->GetSpacing());
+    slab->SetDirectionMatrix(volume->GetDirectionMatrix());
+
+    vtkDataArray *source = volume->GetPointData()->GetScalars();
+    vtkSmartPointer<vtkDataArray> scalars = vtkSmartPointer<vtkDataArray>::Take(source->NewInstance());
+    const int components = source->GetNumberOfComponents();
+    const size_t sliceValues = static_cast<size_t>(dims[0]) * dims[1] * components;
+    scalars->SetNumberOfComponents(components);
+    // save=1 表示数组不负责释放
+    scalars->SetVoidArray(static_cast<unsigned char *>(volume->GetScalarPointer())
+                              + static_cast<size_t>(volume->GetScalarSize()) * sliceValues * z0,
+                          static_cast<vtkIdType>(sliceValues * (z1 - z0 + 1)), 1);
+    slab->GetPointData()->SetScalars(scalars);
+    return slab;
+}
+
+} // namespace
+
+IsosurfaceExtractor::IsosurfaceExtractor()
+    : threads(0), budget(DEFAULT_TRIANGLE_BUDGET)
+{
+}
+
+vtkSmartPointer<vtkPolyData> IsosurfaceExtractor::extract(vtkImageData *volume, double threshold,
+                                                          Statistics *stats) const {
+    TRACE_SCOPE("IsosurfaceExtractor::extract");
+    Statistics local;
+    Statistics &s = stats ? *stats : local;
+    s = Statistics();
+
+    vtkSmartPointer<vtkPolyData> mesh = vtkSmartPointer<vtkPolyData>::New();
+    if (!volume || volume->GetScalarType() == VTK_VOID || !volume->GetPointData()->GetScalars()) {
+        return mesh;
+    }
+    int dims[3];
+    volume->GetDimensions(dims);
+    if (dims[0] < 2 || dims[1] < 2 || dims[2] < 2) {
+        return mesh;
+    }
+
+    // 每个线程约两个层块，骨骼集中的层块三角形多，动态领取时负载更均衡
+    // (VTK 默认的 Sequential SMP 后端下 vtkFlyingEdges3D 本身是单线程的)
+    const int threadCount = threads > 0 ? threads : defaultThreadCount();
+    const int cells = dims[2] - 1;
+    const int slabCount = std::max(1, std::min(threadCount * 2, cells / MIN_SLAB_CELLS));
+    s.slabs = slabCount;
+    s.threads = std::min(threadCount, slabCount);
+    std::vector<vtkSmartPointer<vtkPolyData>> pieces(slabCount);
+
+    Clock::time_point start = Clock::now();
+    parallelFor(0, slabCount, [&](int i, int) {
+        TRACE_SCOPE("IsosurfaceExtractor::slab");
+        vtkSmartPointer<vtkFlyingEdges3D> surface = vtkSmartPointer<vtkFlyingEdges3D>::New();
+        surface->SetInputData(makeSlab(volume, cells * i / slabCount, cells * (i + 1) / slabCount));
+        surface->SetValue(0, threshold);
+        surface->ComputeNormalsOff(); // 层块边界处只能单侧差分，合并后再统一计算
+        surface->ComputeGradientsOff();
+        surface->ComputeScalarsOff();
+        surface->Update();
+        pieces[i] = surface->GetOutput();
+    }, threadCount);
+    s.extractMs = millisecondsSince(start);
+    for (const vtkSmartPointer<vtkPolyData> &piece : pieces) {
+        s.extractedTriangles += piece->GetNumberOfPolys();
+    }
+    if (s.extractedTriangles == 0) {
+        return mesh;
+    }
+
+    // 各层块按相同比例抽取，三角形多的层块分到的预算也多
+    start = Clock::now();
+    if (budget > 0 && s.extractedTriangles > budget) {
+        const double reduction = 1.0 - static_cast<double>(budget) / s.extractedTriangles;
+        parallelFor(0, slabCount, [&](int i, int) {
+            if (pieces[i]->GetNumberOfPolys() == 0) {
+                return;
+            }
+            TRACE_SCOPE("IsosurfaceExtractor::decimate");
+            vtkSmartPointer<vtkDecimatePro> decimate = vtkSmartPointer<vtkDecimatePro>::New();
+            decimate->SetInputData(pieces[i]);
+            decimate->SetTargetReduction(reduction);
+            decimate->PreserveTopologyOff();
+            decimate->SplittingOff();                 // 分裂会在网格内部产生重复顶点
+            decimate->BoundaryVertexDeletionOff();    // 保留层块边界上的顶点，合并后接缝严密
+            decimate->Update();
+            pieces[i] = decimate->GetOutput();
+        }, threadCount);
+    }
+    s.decimateMs = millisecondsSince(start);
+
+    start = Clock::now();
+    {
+        TRACE_SCOPE("IsosurfaceExtractor::merge");
+        vtkSmartPointer<vtkAppendPolyData> append = vtkSmartPointer<vtkAppendPolyData>::New();
+        for (const vtkSmartPointer<vtkPolyData> &piece : pieces) {
+            append->AddInputData(piece);
+        }
+        vtkSmartPointer<vtkStaticCleanPolyData> clean = vtkSmartPointer<vtkStaticCleanPolyData>::New();
+        clean->SetInputConnection(append->GetOutputPort());
+        clean->SetTolerance(0.0); // 只合并相邻层块在接缝处坐标相同的顶点
+        vtkSmartPointer<vtkPolyDataNormals> normals = vtkSmartPointer<vtkPolyDataNormals>::New();
+        normals->SetInputConnection(clean->GetOutputPort());
+        normals->SplittingOff();
+        normals->ConsistencyOff(); // FlyingEdges 输出的三角形朝向已经一致
+        normals->ComputeCellNormalsOff();
+        normals->Update();
+        mesh->ShallowCopy(normals->GetOutput());
+    }
+    s.mergeMs = millisecondsSince(start);
+    s.triangles = mesh->GetNumberOfPolys();
+    return mesh;
+}
+
+// --- 网格缓存 ---
+
+bool IsosurfaceKey::operator==(const IsosurfaceKey &other) const {
+    return study == other.study && std::equal(dimensions, dimensions + 3, other.dimensions)
+        && threshold == other.threshold && triangleBudget == other.triangleBudget;
+}
+
+IsosurfaceCache::IsosurfaceCache(size_t maxBytes)
+    : maxBytes(maxBytes), totalBytes(0)
+{
+}
+
+size_t IsosurfaceCache::meshBytes(vtkPolyData *mesh) {
+    return mesh ? static_cast<size_t>(mesh->GetActualMemorySize()) * 1024 : 0; // GetActualMemorySize 以 KiB 为单位
+}
+
+vtkSmartPointer<vtkPolyData> IsosurfaceCache::find(const IsosurfaceKey &key) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+        if (it->key == key) {
+            entries.splice(entries.begin(), entries, it);
+            return it->mesh;
+        }
+    }
+    return nullptr;
+}
+
+void IsosurfaceCache::insert(const IsosurfaceKey &key, vtkSmartPointer<vtkPolyData> mesh) {
+    if (!mesh) {
+        return;
+    }
+    const size_t size = meshBytes(mesh);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+        if (it->key == key) {
+            totalBytes -= it->bytes;
+            entries.erase(it);
+            break;
+        }
+    }
+    entries.push_front(Entry{key, mesh, size});
+    totalBytes += size;
+    evictLocked();
+}
+
+void IsosurfaceCache::evictLocked() {
+    // 至少保留刚插入的一个
+    while (totalBytes > maxBytes && entries.size() > 1) {
+        totalBytes -= entries.back().bytes;
+        entries.pop_back();
+    }
+}
+
+void IsosurfaceCache::removeStudy(const std::string &study) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto it = entries.begin(); it != entries.end();) {
+        if (it->key.study == study) {
+            totalBytes -= it->bytes;
+            it = entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void IsosurfaceCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    totalBytes = 0;
+}
+
+void IsosurfaceCache::setMaxBytes(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    maxBytes = bytes;
+    evictLocked();
+}
+
+size_t IsosurfaceCache::bytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return totalBytes;
+}
+
+size_t IsosurfaceCache::count() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
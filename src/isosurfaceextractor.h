@@ -0,0 +1,90 @@
+#ifndef ISOSURFACEEXTRACTOR_H
+#define ISOSURFACEEXTRACTOR_H
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+#include <vtkPolyData.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+
+// 多线程等值面提取
+// 体数据沿 z 方向切成若干层块，各线程分别对自己的层块运行 vtkFlyingEdges3D 并抽取到三角形预算，
+// 层块直接引用体数据内存，相邻层块共享边界上的一层体素。抽取时保留层块边界上的顶点，
+// 合并后按坐标去重，接缝处不会出现裂缝；法向量在合并后的网格上计算，避免层块边界处的单侧差分。
+class IsosurfaceExtractor {
+public:
+    struct Statistics {
+        double extractMs = 0.0;       // 各层块的等值面提取
+        double decimateMs = 0.0;      // 各层块的抽取
+        double mergeMs = 0.0;         // 合并、去重和计算法向量
+        int64_t extractedTriangles = 0;
+        int64_t triangles = 0;        // 抽取后的三角形数
+        int slabs = 0;
+        int threads = 0;
+    };
+
+    static const int64_t DEFAULT_TRIANGLE_BUDGET = 500000;
+
+    IsosurfaceExtractor();
+
+    void setThreadCount(int count) { threads = count; } // 0 表示硬件并发数
+    int threadCount() const { return threads; }
+    void setTriangleBudget(int64_t triangles) { budget = triangles; } // 0 表示不抽取
+    int64_t triangleBudget() const { return budget; }
+
+    // 阈值为体数据的标量值 (CT 即 HU)；没有体数据或等值面为空时返回空网格
+    vtkSmartPointer<vtkPolyData> extract(vtkImageData *volume, double threshold, Statistics *stats = nullptr) const;
+
+private:
+    int threads;
+    int64_t budget;
+};
+
+// 等值面网格的缓存键：检查、体数据尺寸 (区分低分辨率副本和裁剪前后)、阈值和三角形预算
+struct IsosurfaceKey {
+    std::string study;
+    int dimensions[3];
+    double threshold;
+    int64_t triangleBudget;
+
+    bool operator==(const IsosurfaceKey &other) const;
+};
+
+// 已提取网格的 LRU 缓存，总大小超过上限时淘汰最久未用的网格。切换阈值或检查后再切回时不必重新提取。
+class IsosurfaceCache {
+public:
+    static const size_t DEFAULT_MAX_BYTES;
+
+    explicit IsosurfaceCache(size_t maxBytes = DEFAULT_MAX_BYTES);
+
+    vtkSmartPointer<vtkPolyData> find(const IsosurfaceKey &key); // 命中时移到最近使用
+    void insert(const IsosurfaceKey &key, vtkSmartPointer<vtkPolyData> mesh);
+    void removeStudy(const std::string &study); // 关闭检查时丢弃它的所有网格
+    void clear();
+
+    void setMaxBytes(size_t bytes);
+    size_t bytes() const;
+    size_t count() const;
+
+    static size_t meshBytes(vtkPolyData *mesh);
+
+private:
+    struct Entry {
+        IsosurfaceKey key;
+        vtkSmartPointer<vtkPolyData> mesh;
+        size_t bytes;
+    };
+
+    void evictLocked();
+
+    mutable std::mutex mutex;
+    std::list<Entry> entries; // 表头为最近使用，网格个数很少，线性查找即可
+    size_t maxBytes;
+    size_t totalBytes;
+};
+
+#endif // ISOSURFACEEXTRACTOR_H
@@ -3,6 +3,9 @@
 
 int main(int argc, char *argv[]) {
     QApplication a(argc, argv);
+    // 设置组织和应用名，QSettings 和缓存目录都依赖这两个值
+    QCoreApplication::setOrganizationName("DICOMViewer");
+    QCoreApplication::setApplicationName("DICOMViewer");
     MainWindow w;
     w.show();
     return a.exec();
@@ -5,38 +5,172 @@
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QDebug>
+#include <QSettings>
+#include <QInputDialog>
+#include <QElapsedTimer>
+#include <QSignalBlocker>
+#include <QPainter>
+
+#include "windowlevel.h"
+#include "volumepreset.h"
+#include "tracer.h"
 #include <vtkImageData.h>
 #include <vtkMatrix4x4.h>
 #include <vtkCamera.h>
-#include <vtkNamedColors.h>
 #include <vtkImageMapper3D.h> // For vtkImageActor's mapper
+#include <vtkImageProperty.h>
+#include <vtkCommand.h>
+#include <vtkTransform.h>
 
 #include <vtkOutputWindow.h>
 #include <vtkObject.h>
+#include <vtkPolyDataMapper.h>
+#include <vtkProperty.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
 
 // 轴位、矢状位、冠状位的方向常量
 const int AXIAL_ORIENTATION = 2;    // Z-axis slice
 const int SAGITTAL_ORIENTATION = 0; // X-axis slice
 const int CORONAL_ORIENTATION = 1;  // Y-axis slice
 
+namespace {
+
+// CT 常用窗宽窗位 (HU)
+struct WindowLevelPreset {
+    const char *name;
+    double window;
+    double level;
+};
+const WindowLevelPreset WINDOW_LEVEL_PRESETS[] = {
+    {"肺窗",   1500, -600},
+    {"骨窗",   1800,  400},
+    {"软组织窗", 400,   40},
+    {"脑窗",     80,   40},
+};
+
+// 各方向切片平面内的 (u, v) 轴，与 setupReslice 中 ResliceAxes 的前两列相同
+const int PLANE_AXES[3][2] = {{1, 2}, {0, 2}, {0, 1}};
+
+const int OBLIQUE_PREVIEW_STEP = 2;         // 拖动旋转时倾斜平面以一半分辨率重采样
+const double ROTATE_DEGREES_PER_VIEW = 180.0; // 拖过整个视图对应的旋转角度
+
+const int MAX_SLAB_THICKNESS = 200;
+
+const qint64 DEFAULT_LOD_PROXY_BUDGET = 512LL * 1024 * 1024;
+
+struct SlabModeEntry {
+    const char *name;
+    SlabProjector::Mode mode;
+};
+const SlabModeEntry SLAB_MODES[] = {
+    {"最大密度投影 (MIP)",   SlabProjector::Maximum},
+    {"最小密度投影 (MinIP)", SlabProjector::Minimum},
+    {"平均密度投影",         SlabProjector::Mean},
+};
+
+const int SURFACE_BENCHMARK_FRAMES = 36; // 帧率对比时绕视图旋转一周的帧数
+
+// 逗号分隔的等值面阈值，去重后从低到高排列；含无法解析的项时返回空
+std::vector<double> parseThresholds(const QString &text) {
+    std::vector<double> thresholds;
+    for (const QString &item : text.split(',', Qt::SkipEmptyParts)) {
+        bool ok = false;
+        const double value = item.trimmed().toDouble(&ok);
+        if (!ok) {
+            return {};
+        }
+        thresholds.push_back(value);
+    }
+    std::sort(thresholds.begin(), thresholds.end());
+    thresholds.erase(std::unique(thresholds.begin(), thresholds.end()), thresholds.end());
+    return thresholds;
+}
+
+QString formatThresholds(const std::vector<double> &thresholds) {
+    QStringList items;
+    for (double threshold : thresholds) {
+        items << QString::number(threshold);
+    }
+    return items.join(", ");
+}
+
+// 切片滑块旁的厚层层数
+QSpinBox *createSlabSpinBox() {
+    QSpinBox *spin = new QSpinBox();
+    spin->setRange(1, MAX_SLAB_THICKNESS);
+    spin->setValue(1);
+    spin->setSuffix(" 层");
+    spin->setToolTip("厚层投影层数，1 为单层切片");
+    return spin;
+}
+
+} // namespace
 
 MainWindow::MainWindow(QWidget *parent)
-    : QMainWindow(parent)
+    : QMainWindow(parent), slicePrefetcher(sliceCache), isosurfaceBuilder(isosurfaceCache)
 {
     // 禁用所有VTK警告弹出窗口
     vtkOutputWindow::SetGlobalWarningDisplay(0); // 禁用VTK警告弹窗
+    qRegisterMetaType<vtkSmartPointer<vtkImageData>>(); // 跨线程传递体数据
+    qRegisterMetaType<std::shared_ptr<const VolumeHistogram>>();
+    qRegisterMetaType<std::shared_ptr<ChunkedVolume>>();
+    qRegisterMetaType<std::shared_ptr<const CineSeries>>();
+    qRegisterMetaType<std::shared_ptr<const DecodedSlices>>();
+    cinePlayer = new CinePlayer(this);
+    loadThread = nullptr;
+    dicomLoader = nullptr;
+    activeStudy = -1;
+    loadingStudy = -1;
+    workspace.setBudget(QSettings().value("workspace/memoryBudget", StudyWorkspace::DEFAULT_BUDGET_BYTES).toLongLong());
+    previewShown = false;
+    windowLevelPending = false;
+    partialVolumeAttached = false;
+    residentLevel = 0;
+    isosurfaceRequest = 0;
+    isosurfaceSource = nullptr;
+    windowLevelDragging = false;
+    dragStartWindow = dragStartLevel = 0.0;
+    rotatingOrientation = -1;
+    lastSliceIndex[0] = lastSliceIndex[1] = lastSliceIndex[2] = -1;
+    sliceCache.setMaxBytes(QSettings().value("sliceCache/maxBytes",
+        static_cast<qulonglong>(SliceImageCache::DEFAULT_MAX_BYTES)).toULongLong());
     initializeVTK();  // 初始化VTK对象
     setupUI();
     setupVTKColorAndOpacity();
     setup3DView();
     setupSliceViews();
+    setupRenderScheduler();
     connectSignalsSlots();
+    cinePlayer->setFrameRate(cineFrameRateSpin->value());
+
+    // DICOMVIEWER_TRACE=1 启动时开始跟踪；设为文件路径时退出时还会写入该文件
+    Tracer::instance().setThreadName("main");
+    const QString traceEnv = qEnvironmentVariable("DICOMVIEWER_TRACE");
+    if (!traceEnv.isEmpty() && traceEnv != "0") {
+        if (traceEnv != "1") {
+            traceOutputPath = traceEnv;
+        }
+        traceAction->setChecked(true);
+    }
 
     setWindowTitle("DICOM 三维重建与切片查看器");
     resize(1200, 1000);
 }
 
-MainWindow::~MainWindow() {}
+MainWindow::~MainWindow() {
+    // 关闭窗口时停止仍在运行的加载线程
+    if (dicomLoader) {
+        dicomLoader->cancel();
+    }
+    finishLoading();
+
+    if (!traceOutputPath.isEmpty()) {
+        Tracer::instance().writeChromeTrace(traceOutputPath.toStdString());
+    }
+}
 
 void MainWindow::setupUI() {
     // --- 主布局 ---
@@ -49,9 +183,127 @@ void MainWindow::setupUI() {
     fileMenu = new QMenu("文件(&F)", menuBar);
     openDICOMAction = new QAction("打开 DICOM 文件夹", this);
     fileMenu->addAction(openDICOMAction);
+    fileMenu->addSeparator();
+    volumeCacheAction = new QAction("缓存解码后的体数据", this);
+    volumeCacheAction->setCheckable(true);
+    volumeCacheAction->setChecked(QSettings().value("volumeCache/enabled", false).toBool());
+    volumeCacheLimitAction = new QAction("体数据缓存上限...", this);
+    clearVolumeCacheAction = new QAction("清空体数据缓存", this);
+    fileMenu->addAction(volumeCacheAction);
+    fileMenu->addAction(volumeCacheLimitAction);
+    fileMenu->addAction(clearVolumeCacheAction);
+    progressiveLoadAction = new QAction("渐进式加载", this);
+    progressiveLoadAction->setCheckable(true);
+    progressiveLoadAction->setChecked(QSettings().value("loading/progressive", true).toBool());
+    fileMenu->addAction(progressiveLoadAction);
+    bodyCropAction = new QAction("自动裁剪体外区域", this);
+    bodyCropAction->setCheckable(true);
+    bodyCropAction->setChecked(QSettings().value("loading/bodyCrop", false).toBool());
+    fileMenu->addAction(bodyCropAction);
+    outOfCoreAction = new QAction("超出内存预算时分块加载 (核外模式)", this);
+    outOfCoreAction->setCheckable(true);
+    outOfCoreAction->setChecked(QSettings().value("loading/outOfCore", false).toBool());
+    outOfCoreBudgetAction = new QAction("核外模式内存预算...", this);
+    clearOutOfCoreAction = new QAction("清空核外分块存储", this);
+    fileMenu->addAction(outOfCoreAction);
+    fileMenu->addAction(outOfCoreBudgetAction);
+    fileMenu->addAction(clearOutOfCoreAction);
+    cineAction = new QAction("多时相序列预载全部时相 (电影回放)", this);
+    cineAction->setCheckable(true);
+    cineAction->setChecked(QSettings().value("loading/cine", true).toBool());
+    cineBudgetAction = new QAction("多时相预载内存预算...", this);
+    fileMenu->addAction(cineAction);
+    fileMenu->addAction(cineBudgetAction);
+    fileMenu->addSeparator();
+    memoryBudgetAction = new QAction("工作区内存预算...", this);
+    memoryUsageAction = new QAction("工作区内存占用...", this);
+    fileMenu->addAction(memoryBudgetAction);
+    fileMenu->addAction(memoryUsageAction);
     menuBar->addMenu(fileMenu);
+    toolsMenu = new QMenu("工具(&T)", menuBar);
+    benchmarkReaderAction = new QAction("读取性能对比...", this);
+    toolsMenu->addAction(benchmarkReaderAction);
+    benchmarkSliceAction = new QAction("切片提取性能对比", this);
+    toolsMenu->addAction(benchmarkSliceAction);
+    toolsMenu->addSeparator();
+    brickedLayoutAction = new QAction("分块内存布局 (矢状/冠状面)", this);
+    brickedLayoutAction->setCheckable(true);
+    brickedLayoutAction->setChecked(QSettings().value("slices/brickedLayout", false).toBool());
+    toolsMenu->addAction(brickedLayoutAction);
+    renderStatsAction = new QAction("渲染统计...", this);
+    toolsMenu->addAction(renderStatsAction);
+    lodTargetAction = new QAction("三维交互目标帧时间...", this);
+    toolsMenu->addAction(lodTargetAction);
+    lodProxyBudgetAction = new QAction("三维代理体数据预算...", this);
+    toolsMenu->addAction(lodProxyBudgetAction);
+    cpuRaycastAction = new QAction("CPU 光线投射体绘制", this);
+    cpuRaycastAction->setCheckable(true);
+    cpuRaycastAction->setChecked(QSettings().value("rendering/cpuRaycast", false).toBool());
+    toolsMenu->addAction(cpuRaycastAction);
+    cpuThreadsAction = new QAction("CPU 渲染线程数...", this);
+    toolsMenu->addAction(cpuThreadsAction);
+    isosurfaceAction = new QAction("等值面模式 (代替体绘制)", this);
+    isosurfaceAction->setCheckable(true);
+    isosurfaceAction->setChecked(QSettings().value("rendering/isosurface", false).toBool());
+    toolsMenu->addAction(isosurfaceAction);
+    isosurfaceThresholdsAction = new QAction("等值面阈值...", this);
+    toolsMenu->addAction(isosurfaceThresholdsAction);
+    isosurfaceBudgetAction = new QAction("等值面三角形预算...", this);
+    toolsMenu->addAction(isosurfaceBudgetAction);
+    benchmarkSurfaceAction = new QAction("等值面与体绘制帧率对比", this);
+    toolsMenu->addAction(benchmarkSurfaceAction);
+    toolsMenu->addSeparator();
+    traceAction = new QAction("记录性能跟踪", this);
+    traceAction->setCheckable(true);
+    toolsMenu->addAction(traceAction);
+    exportTraceAction = new QAction("导出性能跟踪...", this);
+    toolsMenu->addAction(exportTraceAction);
+    traceOverlayAction = new QAction("显示帧耗时叠加层", this);
+    traceOverlayAction->setCheckable(true);
+    toolsMenu->addAction(traceOverlayAction);
+    toolsMenu->addSeparator();
+    rotatePlaneAction = new QAction("拖动旋转切片平面", this);
+    rotatePlaneAction->setCheckable(true);
+    toolsMenu->addAction(rotatePlaneAction);
+    resetPlanesAction = new QAction("恢复正交切片方向", this);
+    toolsMenu->addAction(resetPlanesAction);
+    menuBar->addMenu(toolsMenu);
+    windowLevelMenu = new QMenu("窗宽窗位(&W)", menuBar);
+    for (const WindowLevelPreset &preset : WINDOW_LEVEL_PRESETS) {
+        QAction *action = windowLevelMenu->addAction(
+            QString("%1 (W %2 / L %3)").arg(preset.name).arg(preset.window).arg(preset.level));
+        connect(action, &QAction::triggered, this, [this, preset]() {
+            setWindowLevel(preset.window, preset.level);
+        });
+    }
+    connect(windowLevelMenu->addAction("自动 (0.5%-99.5% 百分位数)"), &QAction::triggered, this, &MainWindow::autoWindowLevel);
+    connect(windowLevelMenu->addAction("全灰度范围"), &QAction::triggered, this, &MainWindow::resetWindowLevel);
+    windowLevelMenu->addSeparator();
+    windowLevelLookupAction = new QAction("在纹理映射阶段应用窗宽窗位", this);
+    windowLevelLookupAction->setCheckable(true);
+    windowLevelLookupAction->setChecked(QSettings().value("windowLevel/lookupMode", false).toBool());
+    windowLevelMenu->addAction(windowLevelLookupAction);
+    menuBar->addMenu(windowLevelMenu);
+    slabMenu = new QMenu("厚层投影(&P)", menuBar);
+    slabModeGroup = new QActionGroup(this);
+    const int savedSlabMode = QSettings().value("slices/slabMode", SlabProjector::Maximum).toInt();
+    for (const SlabModeEntry &entry : SLAB_MODES) {
+        QAction *action = slabMenu->addAction(entry.name);
+        action->setCheckable(true);
+        action->setData(entry.mode);
+        action->setChecked(entry.mode == savedSlabMode);
+        slabModeGroup->addAction(action);
+    }
+    menuBar->addMenu(slabMenu);
     this->setMenuBar(menuBar);
 
+    // --- 检查标签页 ---
+    studyTabs = new QTabBar();
+    studyTabs->setTabsClosable(true);
+    studyTabs->setExpanding(false);
+    studyTabs->setDocumentMode(true);
+    studyTabs->hide();
+
     // --- 渲染窗口 ---
     // 3D 视图
     qvtkWidget3D = new QVTKOpenGLNativeWidget();
@@ -61,6 +313,31 @@ void MainWindow::setupUI() {
     opacitySlider3D->setValue(30); // 默认值
     opacityLabel->setFixedHeight(20); // 设置固定高度
     opacityLabel->setAlignment(Qt::AlignCenter); // 文字居中
+    histogramLabel = new QLabel();
+    histogramLabel->setFixedHeight(48);
+    histogramLabel->setScaledContents(true);
+    histogramLabel->setToolTip("灰度直方图 (对数刻度) 与不透明度曲线");
+
+    // 电影回放：播放/暂停、时相、帧率和回放统计
+    cineBar = new QWidget();
+    cinePlayButton = new QPushButton("播放");
+    cinePhaseSlider = new QSlider(Qt::Horizontal);
+    cinePhaseLabel = new QLabel();
+    cinePhaseLabel->setMinimumWidth(140);
+    cineFrameRateSpin = new QSpinBox();
+    cineFrameRateSpin->setRange(1, 120);
+    cineFrameRateSpin->setValue(QSettings().value("cine/frameRate", CinePlayer::DEFAULT_FRAME_RATE).toInt());
+    cineFrameRateSpin->setSuffix(" fps");
+    cineFrameRateSpin->setToolTip("回放帧率");
+    cineStatsLabel = new QLabel();
+    QHBoxLayout *cineLayout = new QHBoxLayout(cineBar);
+    cineLayout->setContentsMargins(0, 0, 0, 0);
+    cineLayout->addWidget(cinePlayButton);
+    cineLayout->addWidget(cinePhaseSlider, 1);
+    cineLayout->addWidget(cinePhaseLabel);
+    cineLayout->addWidget(cineFrameRateSpin);
+    cineLayout->addWidget(cineStatsLabel);
+    cineBar->hide();
    
     // 切片视图
     qvtkWidgetAxial = new QVTKOpenGLNativeWidget();
@@ -72,7 +349,11 @@ void MainWindow::setupUI() {
     QVBoxLayout* axialLayout = new QVBoxLayout();
     axialLayout->addWidget(axialLabel);
     axialLayout->addWidget(qvtkWidgetAxial);
-    axialLayout->addWidget(axialSlider);
+    axialSlabSpin = createSlabSpinBox();
+    QHBoxLayout* axialSliderLayout = new QHBoxLayout();
+    axialSliderLayout->addWidget(axialSlider);
+    axialSliderLayout->addWidget(axialSlabSpin);
+    axialLayout->addLayout(axialSliderLayout);
 
     qvtkWidgetSagittal = new QVTKOpenGLNativeWidget();
     sagittalLabel = new QLabel("矢状位 (Sagittal): N/A");
@@ -83,7 +364,11 @@ void MainWindow::setupUI() {
     QVBoxLayout* sagittalLayout = new QVBoxLayout();
     sagittalLayout->addWidget(sagittalLabel);
     sagittalLayout->addWidget(qvtkWidgetSagittal);
-    sagittalLayout->addWidget(sagittalSlider);
+    sagittalSlabSpin = createSlabSpinBox();
+    QHBoxLayout* sagittalSliderLayout = new QHBoxLayout();
+    sagittalSliderLayout->addWidget(sagittalSlider);
+    sagittalSliderLayout->addWidget(sagittalSlabSpin);
+    sagittalLayout->addLayout(sagittalSliderLayout);
 
     qvtkWidgetCoronal = new QVTKOpenGLNativeWidget();
     coronalLabel = new QLabel("冠状位 (Coronal): N/A");
@@ -93,7 +378,11 @@ void MainWindow::setupUI() {
     QVBoxLayout* coronalLayout = new QVBoxLayout();
     coronalLayout->addWidget(coronalLabel);
     coronalLayout->addWidget(qvtkWidgetCoronal);
-    coronalLayout->addWidget(coronalSlider);
+    coronalSlabSpin = createSlabSpinBox();
+    QHBoxLayout* coronalSliderLayout = new QHBoxLayout();
+    coronalSliderLayout->addWidget(coronalSlider);
+    coronalSliderLayout->addWidget(coronalSlabSpin);
+    coronalLayout->addLayout(coronalSliderLayout);
 
     // --- 布局安排 ---
     // 上部3D,和不透明度滑块，下部三个切片视图
@@ -104,16 +393,36 @@ void MainWindow::setupUI() {
     //mainLayout->addLayout(sliceViewsLayout, 1, 1); // 切片视图在右下
 
     // 主布局
-    mainLayout->addWidget(qvtkWidget3D, 0, 0, 2, 3);
-    mainLayout->addWidget(opacityLabel, 2, 0, 1, 3);
-    mainLayout->addWidget(opacitySlider3D, 3, 0, 1, 3);
-    mainLayout->addLayout(sliceViewsLayout, 4, 0, 1, 3);
+    mainLayout->addWidget(studyTabs, 0, 0, 1, 3);
+    mainLayout->addWidget(qvtkWidget3D, 1, 0, 2, 3);
+    mainLayout->addWidget(opacityLabel, 3, 0, 1, 3);
+    mainLayout->addWidget(histogramLabel, 4, 0, 1, 3);
+    mainLayout->addWidget(opacitySlider3D, 5, 0, 1, 3);
+    mainLayout->addWidget(cineBar, 6, 0, 1, 3);
+    mainLayout->addLayout(sliceViewsLayout, 7, 0, 1, 3);
+
+    // 帧耗时叠加层，浮在三维视图左上角
+    traceOverlay = new QLabel(qvtkWidget3D);
+    traceOverlay->setStyleSheet("background: rgba(0, 0, 0, 160); color: white; font-family: monospace; padding: 4px;");
+    traceOverlay->setAttribute(Qt::WA_TransparentForMouseEvents);
+    traceOverlay->move(8, 8);
+    traceOverlay->hide();
+
+    // --- 状态栏：加载进度与取消 ---
+    loadProgressBar = new QProgressBar();
+    loadProgressBar->setMaximumWidth(300);
+    cancelLoadButton = new QPushButton("取消加载");
+    lodLabel = new QLabel("三维: 全分辨率"); // 当前体绘制细节层次
+    statusBar()->addPermanentWidget(lodLabel);
+    statusBar()->addPermanentWidget(loadProgressBar);
+    statusBar()->addPermanentWidget(cancelLoadButton);
+    loadProgressBar->hide();
+    cancelLoadButton->hide();
 }
 
 void MainWindow::initializeVTK() {
     try {
     // 初始化VTK智能指针
-    dicomReader = vtkSmartPointer<vtkDICOMImageReader>::New();
     loadedImageData = nullptr;
 
     // 3D渲染相关
@@ -126,6 +435,8 @@ void MainWindow::initializeVTK() {
     style3D = vtkSmartPointer<vtkInteractorStyleTrackballCamera>::New();
     axes3D = vtkSmartPointer<vtkAxesActor>::New();
     orientationMarkerWidget3D = vtkSmartPointer<vtkOrientationMarkerWidget>::New();
+    cpuRaycastMapper = vtkSmartPointer<vtkImageMapper>::New();
+    cpuRaycastActor = vtkSmartPointer<vtkActor2D>::New();
 
     // 轴状面相关
     rendererAxial = vtkSmartPointer<vtkRenderer>::New();
@@ -159,42 +470,8 @@ void MainWindow::initializeVTK() {
 
 // 为体绘制设置颜色和不透明度传输函数
 void MainWindow::setupVTKColorAndOpacity() {
-    // 通常CT数据，骨骼是高密度值，软组织是中低密度值
-    opacityTransferFunction->AddPoint(0,    0.0); // 完全透明
-    opacityTransferFunction->AddPoint(500,  0.15); // 这是软组织开始显现的值
-    opacityTransferFunction->AddPoint(1000, 0.3);
-    opacityTransferFunction->AddPoint(1150, 0.5);  // 这是骨骼开始显现的值
-    opacityTransferFunction->AddPoint(2000, 0.8);
-
-    // 颜色传输函数 (Color Transfer Function - CTF)
-    vtkSmartPointer<vtkNamedColors> colors = vtkSmartPointer<vtkNamedColors>::New();
-    colorTransferFunction->AddRGBPoint(0,    
-                                        colors->GetColor3d("Black").GetRed(), 
-                                        colors->GetColor3d("Black").GetGreen(), 
-                                        colors->GetColor3d("Black").GetBlue()
-                                        ); // 完全透明对应黑色
-    colorTransferFunction->AddRGBPoint(500,  
-                                        colors->GetColor3d("Brown").GetRed() * 0.5, 
-                                        colors->GetColor3d("Brown").GetGreen() * 0.5, 
-                                        colors->GetColor3d("Brown").GetBlue() * 0.5
-                                        ); // 软组织颜色
-    colorTransferFunction->AddRGBPoint(1000, 
-                                        colors->GetColor3d("Ivory").GetRed() * 0.8, 
-                                        colors->GetColor3d("Ivory").GetGreen() * 0.8, 
-                                        colors->GetColor3d("Ivory").GetBlue() * 0.8
-                                        ); // 中等密度组织颜色
-    colorTransferFunction->AddRGBPoint(1150, 
-                                        colors->GetColor3d("White").GetRed(), 
-                                        colors->GetColor3d("White").GetGreen(), 
-                                        colors->GetColor3d("White").GetBlue()
-                                        ); // 骨骼颜色
-    volumeProperty->SetColor(colorTransferFunction);// 设置颜色传输函数
-    volumeProperty->SetScalarOpacity(opacityTransferFunction);// 设置不透明度传输函数
-    volumeProperty->SetInterpolationTypeToLinear(); // 线性插值
-    volumeProperty->ShadeOn(); // 开启阴影
-    volumeProperty->SetAmbient(0.4);// 环境光
-    volumeProperty->SetDiffuse(0.6);// 漫反射
-    volumeProperty->SetSpecular(0.2);// 镜面反射
+    // 通常CT数据，骨骼是高密度值，软组织是中低密度值；批量导出使用同一组参数
+    setupDefaultVolumeProperty(volumeProperty, colorTransferFunction, opacityTransferFunction);
 }
 
 // 设置三维重建视图的渲染器和交互样式
@@ -210,15 +487,48 @@ void MainWindow::setup3DView() {
 
     // 设置体绘制映射器
     volumeMapper->SetBlendModeToComposite(); // 混合模式
-    volumeMapper->SetInputConnection(dicomReader->GetOutputPort()); // 数据源在打开文件后设置
+    // 数据源在加载完成后由 setVolumeData 设置
     //性能优化
     volumeMapper->SetUseJittering(1); // 使用抖动来减少体绘制的锯齿，减少伪影
     volumeMapper->SetSampleDistance(0.5); // 采样距离，控制体绘制的细节，平衡精度
 
+    // 交互时降低画质，松开后恢复上面的设置
+    volumeLod.reset(new VolumeLodController(volumeMapper, renderer3D));
+    volumeLod->attach(style3D, qvtkWidget3D->renderWindow());
+    volumeLod->setTargetFrameTime(QSettings().value("lod/targetFrameMs", 50).toDouble());
+    volumeLod->setProxyBudget(QSettings().value("lod/proxyBudget", DEFAULT_LOD_PROXY_BUDGET).toLongLong());
+    volumeLod->setLevelChangedCallback([this](int, const QString &description) {
+        lodLabel->setText(QString("三维: %1").arg(description));
+    });
+    volumeLod->setRenderCallback([this]() {
+        renderScheduler->requestRender(view3D);
+    });
+
     // 设置体素
     volume->SetMapper(volumeMapper);
     volume->SetProperty(volumeProperty);
 
+    // CPU 光线投射：渲染器每次开始渲染时按当前相机重新投射，结果由二维演员铺满视图，代替体绘制
+    cpuRaycaster.setProperty(volumeProperty);
+    cpuRaycaster.setBackground(0.1, 0.2, 0.4);
+    cpuRaycaster.setThreadCount(QSettings().value("rendering/cpuThreads", 0).toInt());
+    cpuRaycastMapper->SetInputData(cpuRaycaster.output());
+    cpuRaycastMapper->SetColorWindow(255.0); // 输出已是 RGBA，恒等映射
+    cpuRaycastMapper->SetColorLevel(127.5);
+    cpuRaycastActor->SetMapper(cpuRaycastMapper);
+    renderer3D->AddActor2D(cpuRaycastActor);
+    renderer3D->AddObserver(vtkCommand::StartEvent, this, &MainWindow::renderCpuRaycast);
+
+    // 等值面模式：显示按阈值提取并抽取过的网格，颜色取自体绘制的颜色传输函数
+    isosurfaceExtractor.setThreadCount(cpuRaycaster.threadCount());
+    isosurfaceExtractor.setTriangleBudget(QSettings().value("isosurface/triangleBudget",
+        static_cast<qlonglong>(IsosurfaceExtractor::DEFAULT_TRIANGLE_BUDGET)).toLongLong());
+    isosurfaceThresholds = parseThresholds(QSettings().value("isosurface/thresholds", "300").toString());
+    if (isosurfaceThresholds.empty()) {
+        isosurfaceThresholds.push_back(300.0); // 骨骼
+    }
+    update3DMode();
+
     // 添加坐标轴指示器
     orientationMarkerWidget3D->SetOutlineColor(0.9300, 0.5700, 0.1300);
     orientationMarkerWidget3D->SetOrientationMarker(axes3D);
@@ -275,11 +585,27 @@ void MainWindow::setupSliceViews() {
     actorCoronal->GetMapper()->SetInputConnection(wlCoronal->GetOutputPort());
     rendererCoronal->AddActor(actorCoronal);
     qvtkWidgetCoronal->renderWindow()->GetInteractor()->SetInteractorStyle(styleCoronal);
+
+    // 左键拖动调节窗宽窗位，'r' 键恢复全灰度范围；由这里处理而不是交给样式修改图像属性
+    for (vtkInteractorStyleImage *style : {styleAxial.GetPointer(), styleSagittal.GetPointer(), styleCoronal.GetPointer()}) {
+        style->AddObserver(vtkCommand::StartWindowLevelEvent, this, &MainWindow::onWindowLevelStart);
+        style->AddObserver(vtkCommand::WindowLevelEvent, this, &MainWindow::onWindowLevelDrag);
+        style->AddObserver(vtkCommand::EndWindowLevelEvent, this, &MainWindow::onWindowLevelEnd);
+        style->AddObserver(vtkCommand::ResetWindowLevelEvent, this, &MainWindow::onWindowLevelReset);
+    }
+
+    // 旋转切片平面模式下左键拖动改为旋转平面，观察者优先于交互样式并在处理后中止事件
+    for (QVTKOpenGLNativeWidget *widget : {qvtkWidgetAxial, qvtkWidgetSagittal, qvtkWidgetCoronal}) {
+        vtkRenderWindowInteractor *interactor = widget->renderWindow()->GetInteractor();
+        interactor->AddObserver(vtkCommand::LeftButtonPressEvent, this, &MainWindow::onPlaneRotateStart, 1.0f);
+        interactor->AddObserver(vtkCommand::MouseMoveEvent, this, &MainWindow::onPlaneRotateMove, 1.0f);
+        interactor->AddObserver(vtkCommand::LeftButtonReleaseEvent, this, &MainWindow::onPlaneRotateEnd, 1.0f);
+    }
 }
 
 // 设置切片重采样器的矩阵
 void MainWindow::setupReslice(vtkSmartPointer<vtkImageReslice> reslice, int orientation) {
-    reslice->SetInputConnection(dicomReader->GetOutputPort()); // 数据加载后设置
+    // 输入数据在加载完成后由 setVolumeData 设置
     reslice->SetOutputDimensionality(2); // 输出二维图像
     reslice->SetInterpolationModeToLinear(); // 线性插值
 
@@ -321,121 +647,1706 @@ void MainWindow::setupReslice(vtkSmartPointer<vtkImageReslice> reslice, int orie
     reslice->SetResliceAxes(matrix);
 }
 
+// 所有视图的渲染都经过调度器，每个显示帧最多渲染一次
+void MainWindow::setupRenderScheduler() {
+    renderScheduler = new RenderScheduler(this);
+    view3D = renderScheduler->addView(qvtkWidget3D->renderWindow());
+    viewAxial = renderScheduler->addView(qvtkWidgetAxial->renderWindow());
+    viewSagittal = renderScheduler->addView(qvtkWidgetSagittal->renderWindow());
+    viewCoronal = renderScheduler->addView(qvtkWidgetCoronal->renderWindow());
+}
+
 // 连接信号和槽
 void MainWindow::connectSignalsSlots() {
     connect(openDICOMAction, &QAction::triggered, this, &MainWindow::openDICOMFolder);
+    connect(benchmarkReaderAction, &QAction::triggered, this, &MainWindow::benchmarkReaders);
+    connect(benchmarkSliceAction, &QAction::triggered, this, &MainWindow::benchmarkSliceExtraction);
+    connect(brickedLayoutAction, &QAction::toggled, this, &MainWindow::setBrickedLayoutEnabled);
+    connect(renderStatsAction, &QAction::triggered, this, &MainWindow::showRenderStatistics);
+    connect(lodTargetAction, &QAction::triggered, this, &MainWindow::setLodTargetFrameTime);
+    connect(lodProxyBudgetAction, &QAction::triggered, this, &MainWindow::setLodProxyBudget);
+    connect(cpuRaycastAction, &QAction::toggled, this, &MainWindow::setCpuRaycastEnabled);
+    connect(cpuThreadsAction, &QAction::triggered, this, &MainWindow::setCpuRaycastThreads);
+    connect(isosurfaceAction, &QAction::toggled, this, &MainWindow::setIsosurfaceEnabled);
+    connect(isosurfaceThresholdsAction, &QAction::triggered, this, &MainWindow::setIsosurfaceThresholds);
+    connect(isosurfaceBudgetAction, &QAction::triggered, this, &MainWindow::setIsosurfaceTriangleBudget);
+    connect(benchmarkSurfaceAction, &QAction::triggered, this, &MainWindow::benchmarkSurfaceRendering);
+    connect(volumeCacheAction, &QAction::toggled, this, &MainWindow::setVolumeCacheEnabled);
+    connect(volumeCacheLimitAction, &QAction::triggered, this, &MainWindow::setVolumeCacheLimit);
+    connect(clearVolumeCacheAction, &QAction::triggered, this, &MainWindow::clearVolumeCache);
+    connect(progressiveLoadAction, &QAction::toggled, this, [](bool enabled) {
+        QSettings().setValue("loading/progressive", enabled);
+    });
+    connect(bodyCropAction, &QAction::toggled, this, [](bool enabled) {
+        QSettings().setValue("loading/bodyCrop", enabled);
+    });
+    connect(outOfCoreAction, &QAction::toggled, this, [](bool enabled) {
+        QSettings().setValue("loading/outOfCore", enabled);
+    });
+    connect(outOfCoreBudgetAction, &QAction::triggered, this, &MainWindow::setOutOfCoreBudget);
+    connect(clearOutOfCoreAction, &QAction::triggered, this, &MainWindow::clearOutOfCoreStore);
+    connect(cineAction, &QAction::toggled, this, [](bool enabled) {
+        QSettings().setValue("loading/cine", enabled);
+    });
+    connect(cineBudgetAction, &QAction::triggered, this, &MainWindow::setCineBudget);
+    connect(cinePlayButton, &QPushButton::clicked, this, &MainWindow::toggleCinePlayback);
+    connect(cinePhaseSlider, &QSlider::valueChanged, cinePlayer, &CinePlayer::seek);
+    connect(cineFrameRateSpin, QOverload<int>::of(&QSpinBox::valueChanged), this, [this](int fps) {
+        QSettings().setValue("cine/frameRate", fps);
+        cinePlayer->setFrameRate(fps);
+    });
+    connect(cinePlayer, &CinePlayer::phaseChanged, this, &MainWindow::onCinePhaseChanged);
+    connect(cinePlayer, &CinePlayer::statisticsChanged, this, &MainWindow::updateCineStatistics);
+    connect(&isosurfaceBuilder, &IsosurfaceBuilder::meshesReady, this, &MainWindow::onIsosurfacesReady);
+    connect(memoryBudgetAction, &QAction::triggered, this, &MainWindow::setMemoryBudget);
+    connect(memoryUsageAction, &QAction::triggered, this, &MainWindow::showMemoryUsage);
+    connect(studyTabs, &QTabBar::currentChanged, this, &MainWindow::switchStudy);
+    connect(studyTabs, &QTabBar::tabCloseRequested, this, &MainWindow::closeStudy);
+    connect(windowLevelLookupAction, &QAction::toggled, this, &MainWindow::setWindowLevelLookupMode);
+    connect(traceAction, &QAction::toggled, this, &MainWindow::setTracingEnabled);
+    connect(exportTraceAction, &QAction::triggered, this, &MainWindow::exportTrace);
+    connect(traceOverlayAction, &QAction::toggled, this, &MainWindow::setTraceOverlayVisible);
+    connect(resetPlanesAction, &QAction::triggered, this, &MainWindow::resetSlicePlanes);
+    connect(renderScheduler, &RenderScheduler::frameFinished, this, &MainWindow::updateTraceOverlay);
     connect(opacitySlider3D, &QSlider::valueChanged, this, &MainWindow::update3DOpacity);
 
     connect(axialSlider, &QSlider::valueChanged, this, &MainWindow::updateAxialSlice);
     connect(sagittalSlider, &QSlider::valueChanged, this, &MainWindow::updateSagittalSlice);
     connect(coronalSlider, &QSlider::valueChanged, this, &MainWindow::updateCoronalSlice);
+    connect(axialSlabSpin, QOverload<int>::of(&QSpinBox::valueChanged), this, [this]() {
+        updateSliceView(AXIAL_ORIENTATION);
+    });
+    connect(sagittalSlabSpin, QOverload<int>::of(&QSpinBox::valueChanged), this, [this]() {
+        updateSliceView(SAGITTAL_ORIENTATION);
+    });
+    connect(coronalSlabSpin, QOverload<int>::of(&QSpinBox::valueChanged), this, [this]() {
+        updateSliceView(CORONAL_ORIENTATION);
+    });
+    connect(slabModeGroup, &QActionGroup::triggered, this, [this](QAction *action) {
+        QSettings().setValue("slices/slabMode", action->data().toInt());
+        updateSliceView(AXIAL_ORIENTATION);
+        updateSliceView(SAGITTAL_ORIENTATION);
+        updateSliceView(CORONAL_ORIENTATION);
+    });
+
+    connect(cancelLoadButton, &QPushButton::clicked, this, &MainWindow::cancelLoading);
 }
 
-// 打开DICOM文件夹并加载数据
-void MainWindow::openDICOMFolder() {
-    //QMessageBox::information(this, "调试信息", "已点击加载DICOM文件按钮！");
-    QString dirPath = QFileDialog::getExistingDirectory(
+QString MainWindow::chooseDICOMFolder() {
+    return QFileDialog::getExistingDirectory(
         this,
         "选择包含DICOM序列的文件夹",
         QDir::homePath(),
         QFileDialog::ShowDirsOnly
     );
-    
+}
+
+// 打开DICOM文件夹，作为新的检查标签页在工作线程中加载；已经打开的目录直接切换过去
+void MainWindow::openDICOMFolder() {
+    //QMessageBox::information(this, "调试信息", "已点击加载DICOM文件按钮！");
+    if (loadThread) {
+        return; // 上一个序列仍在加载
+    }
+
+    QString dirPath = chooseDICOMFolder();
+    if (dirPath.isEmpty()) {
+        return;
+    }
+    int index = workspace.find(dirPath);
+    if (index >= 0) {
+        studyTabs->setCurrentIndex(index);
+        return;
+    }
+
+    saveViewState();
+    index = workspace.add(dirPath);
+    {
+        QSignalBlocker blocker(studyTabs);
+        studyTabs->addTab(workspace.study(index).title);
+        studyTabs->setCurrentIndex(index);
+    }
+    activeStudy = loadingStudy = index;
+    updateStudyTabs();
+    startLoaderThread(dirPath, &DicomLoader::load);
+}
+
+// 选择一个序列，分别用两种读取器读取并报告加速比
+void MainWindow::benchmarkReaders() {
+    if (loadThread) {
+        return;
+    }
+
+    QString dirPath = chooseDICOMFolder();
     if (dirPath.isEmpty()) {
         return;
     }
+    startLoaderThread(dirPath, &DicomLoader::compareReaders);
+}
+
+void MainWindow::onBenchmarkFinished(const QString &report) {
+    finishLoading();
+    QMessageBox::information(this, "读取性能对比", report);
+}
+
+void MainWindow::setVolumeCacheEnabled(bool enabled) {
+    QSettings().setValue("volumeCache/enabled", enabled);
+}
+
+void MainWindow::setVolumeCacheLimit() {
+    const qint64 gigabyte = 1024LL * 1024 * 1024;
+    qint64 current = QSettings().value("volumeCache/maxBytes", VolumeCache::DEFAULT_MAX_BYTES).toLongLong();
+    bool ok = false;
+    int limit = QInputDialog::getInt(this, "体数据缓存上限", "缓存上限 (GB):",
+                                     static_cast<int>(current / gigabyte), 1, 4096, 1, &ok);
+    if (ok) {
+        QSettings().setValue("volumeCache/maxBytes", limit * gigabyte);
+        VolumeCache(DicomLoader::volumeCacheDir(), limit * gigabyte).evict();
+    }
+}
+
+void MainWindow::clearVolumeCache() {
+    VolumeCache(DicomLoader::volumeCacheDir(), 0).clear();
+    statusBar()->showMessage("体数据缓存已清空", 3000);
+}
+
+// 解码后大于预算的序列进入核外模式；块缓存和驻留的金字塔层各占一半
+void MainWindow::setOutOfCoreBudget() {
+    const qint64 megabyte = 1024LL * 1024;
+    const qint64 current = QSettings().value("outOfCore/memoryBudget", DicomLoader::DEFAULT_OUT_OF_CORE_BUDGET).toLongLong();
+    bool ok = false;
+    int budget = QInputDialog::getInt(this, "核外模式内存预算", "单个序列的内存预算 (MB):",
+                                      static_cast<int>(current / megabyte), 64, 1024 * 1024, 256, &ok);
+    if (ok) {
+        QSettings().setValue("outOfCore/memoryBudget", budget * megabyte);
+    }
+}
+
+// 多时相序列全部时相之和超出预算时隔相预载
+void MainWindow::setCineBudget() {
+    const qint64 megabyte = 1024LL * 1024;
+    const qint64 current = QSettings().value("cine/memoryBudget", DicomLoader::DEFAULT_CINE_BUDGET).toLongLong();
+    bool ok = false;
+    int budget = QInputDialog::getInt(this, "多时相预载内存预算", "全部时相的内存预算 (MB):",
+                                      static_cast<int>(current / megabyte), 64, 1024 * 1024, 256, &ok);
+    if (ok) {
+        QSettings().setValue("cine/memoryBudget", budget * megabyte);
+    }
+}
+
+// 正在使用的存储文件在 Windows 上删不掉，下次加载时按指纹判断是否重建
+void MainWindow::clearOutOfCoreStore() {
+    if (loadThread) {
+        return;
+    }
+    const bool removed = QDir(DicomLoader::outOfCoreDir()).removeRecursively();
+    statusBar()->showMessage(removed ? "核外分块存储已清空" : "部分分块存储正在使用，未能删除", 3000);
+}
+
+// 读取器移到工作线程，GUI线程只接收进度和最终结果
+void MainWindow::startLoaderThread(const QString &dirPath, void (DicomLoader::*job)(const QString &),
+                                   bool allowProgressive) {
+    dicomLoader = new DicomLoader();
+    dicomLoader->setVolumeCache(volumeCacheAction->isChecked(),
+        QSettings().value("volumeCache/maxBytes", VolumeCache::DEFAULT_MAX_BYTES).toLongLong());
+    dicomLoader->setProgressive(allowProgressive && progressiveLoadAction->isChecked());
+    dicomLoader->setBodyCrop(bodyCropAction->isChecked());
+    dicomLoader->setOutOfCore(outOfCoreAction->isChecked(),
+        QSettings().value("outOfCore/memoryBudget", DicomLoader::DEFAULT_OUT_OF_CORE_BUDGET).toLongLong());
+    dicomLoader->setCine(cineAction->isChecked(),
+        QSettings().value("cine/memoryBudget", DicomLoader::DEFAULT_CINE_BUDGET).toLongLong());
+    bodyCropSummary.clear();
+    loadThread = new QThread(this);
+    dicomLoader->moveToThread(loadThread);
+
+    DicomLoader *loader = dicomLoader;
+    connect(loadThread, &QThread::started, loader, [loader, job, dirPath]() { (loader->*job)(dirPath); });
+    connect(loader, &DicomLoader::progress, this, &MainWindow::onLoadProgress);
+    connect(loader, &DicomLoader::loaded, this, &MainWindow::onVolumeLoaded);
+    connect(loader, &DicomLoader::failed, this, &MainWindow::onLoadFailed);
+    connect(loader, &DicomLoader::canceled, this, &MainWindow::onLoadCanceled);
+    connect(loader, &DicomLoader::benchmarkFinished, this, &MainWindow::onBenchmarkFinished);
+    connect(loader, &DicomLoader::volumeAllocated, this, &MainWindow::onVolumeAllocated);
+    connect(loader, &DicomLoader::slicesDecoded, this, &MainWindow::onSlicesDecoded);
+    connect(loader, &DicomLoader::previewReady, this, &MainWindow::onPreviewReady);
+    connect(loader, &DicomLoader::bodyCropped, this, &MainWindow::onBodyCropped);
+    connect(loader, &DicomLoader::outOfCoreOpened, this, &MainWindow::onOutOfCoreOpened);
+    connect(loader, &DicomLoader::residentLevelReady, this, &MainWindow::onResidentLevelReady);
+    connect(loader, &DicomLoader::outOfCoreFinished, this, &MainWindow::onOutOfCoreFinished);
+    connect(loader, &DicomLoader::phasesLoaded, this, &MainWindow::onPhasesLoaded);
+
+    openDICOMAction->setEnabled(false);
+    benchmarkReaderAction->setEnabled(false);
+    studyTabs->setEnabled(false); // 加载期间不切换检查
+    loadProgressBar->setRange(0, 0);
+    loadProgressBar->setValue(0);
+    loadProgressBar->show();
+    cancelLoadButton->setEnabled(true);
+    cancelLoadButton->show();
+    statusBar()->showMessage(QString("正在加载：%1").arg(dirPath));
+
+    loadThread->start();
+}
+
+void MainWindow::onLoadProgress(int current, int total, const QString &stage) {
+    loadProgressBar->setRange(0, total);
+    loadProgressBar->setValue(current);
+    loadProgressBar->setFormat(QString("%1 %v/%m").arg(stage));
+}
+
+void MainWindow::onVolumeLoaded(vtkSmartPointer<vtkImageData> image, std::shared_ptr<const VolumeHistogram> histogram) {
+    finishLoading();
+    outOfCoreVolume.reset();
+    setCineSeries(nullptr);
+
+    const int study = loadingStudy;
+    loadingStudy = -1;
+    const bool reload = study >= 0 && workspace.study(study).hasViewState;
+    if (study >= 0) {
+        workspace.setImage(study, image, histogram);
+    }
 
     try {
-        QApplication::setOverrideCursor(Qt::WaitCursor);
-        
-        // 清理之前的数据
-        if (loadedImageData) {
-            loadedImageData = nullptr;
+        // 被释放的检查重新加载完成：恢复离开时的浏览状态
+        if (reload) {
+            setVolumeData(image, histogram);
+            restoreViewState(workspace.study(study));
+            applyMemoryBudget();
+            statusBar()->showMessage(QString("已重新加载：%1 %2").arg(workspace.study(study).title, bodyCropSummary), 3000);
+            return;
         }
-        
-        // 配置和更新DICOM读取器
-        dicomReader = vtkSmartPointer<vtkDICOMImageReader>::New();
-        dicomReader->SetDirectoryName(dirPath.toStdString().c_str());
-        dicomReader->Update();
-
-        loadedImageData = dicomReader->GetOutput();
-        if (!loadedImageData || loadedImageData->GetScalarType() == VTK_VOID) {
-            QApplication::restoreOverrideCursor();
-            QMessageBox::warning(this, "错误", "无法读取DICOM数据或数据为空!");
+
+        // 渐进加载时用户可能已经在浏览切片，不再弹出模态提示 (裁剪后换成了新的体数据，也按渐进加载处理)
+        if (image == loadedImageData.GetPointer() || partialVolumeAttached) {
+            setVolumeData(image, histogram);
+            applyMemoryBudget();
+            statusBar()->showMessage("DICOM序列加载完成 " + bodyCropSummary, 5000);
             return;
         }
+        setVolumeData(image, histogram);
+        applyMemoryBudget();
 
-        // 输出数据信息
         int* dimensions = loadedImageData->GetDimensions();
-        //qDebug() << "DICOM序列维度:" << dimensions[0] << "x" << dimensions[1] << "x" << dimensions[2];
+        QMessageBox::information(this, "成功", 
+            QString("DICOM序列加载完成!\n图像大小: %1x%2x%3%4")
+            .arg(dimensions[0])
+            .arg(dimensions[1])
+            .arg(dimensions[2])
+            .arg(bodyCropSummary.isEmpty() ? QString() : "\n" + bodyCropSummary));
 
-        // 更新体绘制管线
-        volumeMapper->SetInputConnection(dicomReader->GetOutputPort());
-        volume->SetMapper(volumeMapper);
-        if (renderer3D->GetVolumes()->GetNumberOfItems() == 0) {
-            renderer3D->AddVolume(volume);
-        }
+    } catch (std::exception& e) {
+        QMessageBox::critical(this, "错误", 
+            QString("加载DICOM序列时发生错误：%1").arg(e.what()));
+    }
+}
 
-        // 更新切片视图管线
-        resliceAxial->SetInputConnection(dicomReader->GetOutputPort());
-        resliceSagittal->SetInputConnection(dicomReader->GetOutputPort());
-        resliceCoronal->SetInputConnection(dicomReader->GetOutputPort());
+// 核外加载：切片视图从分块存储读取全分辨率切片，三维视图先用最粗的金字塔层，加载线程继续读入更细的层
+void MainWindow::onOutOfCoreOpened(std::shared_ptr<ChunkedVolume> chunked, vtkSmartPointer<vtkImageData> resident,
+                                   std::shared_ptr<const VolumeHistogram> histogram) {
+    setCineSeries(nullptr);
+    const int study = loadingStudy;
+    if (study >= 0) {
+        workspace.setImage(study, resident, histogram);
+        workspace.study(study).chunked = chunked;
+    }
+    outOfCoreVolume = chunked;
+    residentLevel = chunked->levels() - 1;
+    setVolumeData(resident, histogram);
+    if (study >= 0 && workspace.study(study).hasViewState) {
+        restoreViewState(workspace.study(study));
+    }
 
-        // 更新切片范围
-        updateSliceLimits();
+    const int *dims = chunked->dimensions();
+    statusBar()->showMessage(QString("核外模式：%1x%2x%3，分块存储 %4 MB，正在读入更细的三维层...")
+        .arg(dims[0]).arg(dims[1]).arg(dims[2]).arg(chunked->fileBytes() / (1024.0 * 1024.0), 0, 'f', 0));
+}
 
-        // 设置窗宽窗位
-        double range[2];
-        loadedImageData->GetScalarRange(range);
-        double window = range[1] - range[0];
-        double level = (range[1] + range[0]) / 2.0;
-
-        wlAxial->SetWindow(window);
-        wlAxial->SetLevel(level);
-        wlSagittal->SetWindow(window);
-        wlSagittal->SetLevel(level);
-        wlCoronal->SetWindow(window);
-        wlCoronal->SetLevel(level);
-
-        // 更新所有视图，感觉有没有都不影响
+void MainWindow::onResidentLevelReady(vtkSmartPointer<vtkImageData> resident, int level) {
+    if (!outOfCoreVolume || loadingStudy < 0) {
+        return;
+    }
+    workspace.setImage(loadingStudy, resident, volumeHistogram);
+    workspace.study(loadingStudy).chunked = outOfCoreVolume;
+    residentLevel = level;
+    setResidentLevel(resident);
+}
+
+void MainWindow::onOutOfCoreFinished() {
+    finishLoading();
+    loadingStudy = -1;
+    applyMemoryBudget();
+    if (outOfCoreVolume) {
+        int dims[3];
+        outOfCoreVolume->levelDimensions(residentLevel, dims);
+        statusBar()->showMessage(QString("核外模式：切片读取全分辨率分块，三维使用第 %1 层 (%2x%3x%4)")
+            .arg(residentLevel).arg(dims[0]).arg(dims[1]).arg(dims[2]), 5000);
+    }
+}
+
+// 多时相序列：显示第一个时相，其余时相留在内存中供电影回放
+void MainWindow::onPhasesLoaded(std::shared_ptr<const CineSeries> series,
+                                std::shared_ptr<const VolumeHistogram> histogram) {
+    finishLoading();
+    outOfCoreVolume.reset();
+
+    const int study = loadingStudy;
+    loadingStudy = -1;
+    vtkImageData *first = series->phases.front();
+    if (study >= 0) {
+        workspace.setImage(study, first, histogram);
+        workspace.study(study).cine = series;
+    }
+    setCineSeries(series);
+    setVolumeData(first, histogram);
+    if (study >= 0 && workspace.study(study).hasViewState) {
+        restoreViewState(workspace.study(study));
+    }
+    applyMemoryBudget();
+
+    const int *dims = first->GetDimensions();
+    QString message = QString("多时相序列：%1 个时相，每个时相 %2x%3x%4")
+        .arg(series->sourcePhases).arg(dims[0]).arg(dims[1]).arg(dims[2]);
+    if (series->phaseStride > 1) {
+        message += QString("；超出预载预算，每 %1 个时相预载一个 (共 %2 个)").arg(series->phaseStride).arg(series->count());
+    }
+    statusBar()->showMessage(message, 5000);
+}
+
+void MainWindow::onLoadFailed(const QString &message) {
+    finishLoading();
+    const bool partial = partialVolumeAttached;
+    partialVolumeAttached = false;
+    setDecodedSlices(nullptr);
+    abandonLoadingStudy();
+    if (partial) {
+        // 渐进加载中途失败：逐层填充的体数据不完整，换回仍在内存中的其他检查，没有时清空视图
+        int fallback = -1;
+        for (int i = 0; i < workspace.count(); ++i) {
+            if (workspace.residency(i) != StudyWorkspace::Evicted
+                && (fallback < 0 || workspace.study(i).lastUsed > workspace.study(fallback).lastUsed)) {
+                fallback = i;
+            }
+        }
+        if (fallback >= 0) {
+            activateStudy(fallback);
+        } else {
+            detachVolume();
+        }
+    }
+    QMessageBox::warning(this, "错误", message);
+}
+
+void MainWindow::onLoadCanceled() {
+    finishLoading();
+    if (partialVolumeAttached) {
+        // 渐进加载中途取消时保留已经解码的切片，未解码部分保持为空；解码线程已经停止写入
+        setDecodedSlices(nullptr);
+        if (loadingStudy >= 0) {
+            workspace.setImage(loadingStudy, loadedImageData);
+            loadingStudy = -1;
+            updateStudyTabs();
+        }
+        loadedImageData->Modified();
         updateAxialSlice(axialSlider->value());
-        updateSliceViewport(rendererAxial, actorAxial);
+        updateSagittalSlice(sagittalSlider->value());
         updateCoronalSlice(coronalSlider->value());
+        statusBar()->showMessage("已取消加载，保留已解码的切片", 3000);
+    } else {
+        abandonLoadingStudy();
+        statusBar()->showMessage("已取消加载", 3000);
+    }
+    partialVolumeAttached = false;
+}
+
+// 卸下当前体数据，三个切片视图和三维视图回到未加载时的空白状态
+void MainWindow::detachVolume() {
+    slicePrefetcher.setVolume(nullptr, nullptr);
+    sliceCache.clear();
+    brickedVolume.reset();
+    decodedSlices.reset();
+    setSliceInputs(nullptr);
+    actorAxial->SetInputData(nullptr);
+    actorSagittal->SetInputData(nullptr);
+    actorCoronal->SetInputData(nullptr);
+    renderer3D->RemoveVolume(volume);
+    volumeLod->setVolume(nullptr);
+    volumeMapper->SetInputData(nullptr);
+    cpuRaycaster.setInput(nullptr);
+    updateIsosurfaces();
+    renderScheduler->requestRender(view3D);
+    renderScheduler->requestRender(viewAxial);
+    renderScheduler->requestRender(viewSagittal);
+    renderScheduler->requestRender(viewCoronal);
+}
+
+void MainWindow::cancelLoading() {
+    if (dicomLoader) {
+        dicomLoader->cancel();
+        cancelLoadButton->setEnabled(false);
+    }
+}
 
-        // 重置并应用相机设置
-        rendererAxial->ResetCamera();
-        rendererSagittal->ResetCamera();
-        rendererCoronal->ResetCamera();
+// 结束加载线程并恢复界面状态
+void MainWindow::finishLoading() {
+    if (loadThread) {
+        loadThread->quit();
+        loadThread->wait();
+        delete dicomLoader;
+        delete loadThread;
+        dicomLoader = nullptr;
+        loadThread = nullptr;
+    }
+
+    loadProgressBar->hide();
+    cancelLoadButton->hide();
+    openDICOMAction->setEnabled(true);
+    benchmarkReaderAction->setEnabled(true);
+    studyTabs->setEnabled(true);
+    statusBar()->clearMessage();
+}
+
+// --- 多检查工作区 ---
+
+void MainWindow::switchStudy(int index) {
+    if (index < 0 || index == activeStudy) {
+        return;
+    }
+    if (loadThread) {
+        QSignalBlocker blocker(studyTabs);
+        studyTabs->setCurrentIndex(activeStudy);
+        return;
+    }
+    activateStudy(index);
+}
+
+// 体数据仍在内存中时直接切换；已降级的先显示低分辨率副本，已释放的保留当前画面，同时在后台重新加载
+void MainWindow::activateStudy(int index) {
+    if (index < 0) {
+        return;
+    }
+    saveViewState();
+    activeStudy = index;
+    workspace.touch(index);
+    {
+        QSignalBlocker blocker(studyTabs);
+        studyTabs->setCurrentIndex(index);
+    }
+
+    StudyWorkspace::Study &study = workspace.study(index);
+    if (study.image || study.lowRes) {
+        outOfCoreVolume = study.image ? study.chunked : nullptr; // 降级后的副本总是按普通体数据显示
+        setCineSeries(study.image ? study.cine : nullptr);
+    }
+    if (study.image) {
+        setVolumeData(study.image, study.histogram);
+        restoreViewState(study);
+        applyMemoryBudget();
+        return;
+    }
+    if (study.lowRes) {
+        setVolumeData(study.lowRes, study.histogram);
+        restoreViewState(study);
+        applyMemoryBudget();
+    }
+    loadingStudy = index;
+    updateStudyTabs();
+    // 已有低分辨率画面时不再换成逐层填充的空体数据
+    startLoaderThread(study.dirPath, &DicomLoader::load, !study.lowRes);
+}
+
+void MainWindow::closeStudy(int index) {
+    if (loadThread) {
+        return;
+    }
+    if (workspace.count() <= 1) {
+        statusBar()->showMessage("至少保留一个检查", 3000);
+        return;
+    }
+    const bool wasActive = (index == activeStudy);
+    const std::string studyKey = workspace.study(index).dirPath.toStdString();
+    isosurfaceCache.removeStudy(studyKey);
+    if (const std::shared_ptr<const CineSeries> &cine = workspace.study(index).cine) {
+        for (int phase = 0; phase < cine->count(); ++phase) {
+            isosurfaceCache.removeStudy(studyKey + "#phase" + std::to_string(phase));
+        }
+    }
+    workspace.remove(index);
+    {
+        QSignalBlocker blocker(studyTabs);
+        studyTabs->removeTab(index);
+    }
+    if (wasActive) {
+        activeStudy = -1;
+        activateStudy(workspace.mostRecent());
+        return;
+    }
+    if (activeStudy > index) {
+        --activeStudy;
+    }
+    updateStudyTabs();
+}
+
+// 只在显示的是该检查的全分辨率体数据 (多时相序列的任一时相) 时记录
+void MainWindow::saveViewState() {
+    if (activeStudy < 0 || partialVolumeAttached) {
+        return;
+    }
+    StudyWorkspace::Study &study = workspace.study(activeStudy);
+    const bool showingCine = cineSeries && study.cine == cineSeries;
+    if (!loadedImageData || (loadedImageData.GetPointer() != study.image.GetPointer() && !showingCine)) {
+        return;
+    }
+    study.hasViewState = true;
+    study.slices[SAGITTAL_ORIENTATION] = sagittalSlider->value();
+    study.slices[CORONAL_ORIENTATION] = coronalSlider->value();
+    study.slices[AXIAL_ORIENTATION] = axialSlider->value();
+    study.window = wlAxial->GetWindow();
+    study.level = wlAxial->GetLevel();
+}
+
+// 显示低分辨率副本时层号按抽取因子换算
+void MainWindow::restoreViewState(const StudyWorkspace::Study &study) {
+    if (!study.hasViewState) {
+        return;
+    }
+    const int factor = (loadedImageData.GetPointer() == study.lowRes.GetPointer()) ? StudyWorkspace::LOW_RES_FACTOR : 1;
+    applyWindowLevel(study.window, study.level);
+    sagittalSlider->setValue(study.slices[SAGITTAL_ORIENTATION] / factor);
+    coronalSlider->setValue(study.slices[CORONAL_ORIENTATION] / factor);
+    axialSlider->setValue(study.slices[AXIAL_ORIENTATION] / factor);
+    refreshSliceViews();
+}
+
+void MainWindow::applyMemoryBudget() {
+    const std::vector<int> changed = workspace.enforceBudget(activeStudy);
+    updateStudyTabs();
+    if (!changed.empty()) {
+        statusBar()->showMessage(QString("超出工作区内存预算，已降级或释放 %1 个检查").arg(changed.size()), 3000);
+    }
+}
+
+void MainWindow::updateStudyTabs() {
+    const double megabyte = 1024.0 * 1024.0;
+    for (int i = 0; i < workspace.count(); ++i) {
+        const StudyWorkspace::Study &study = workspace.study(i);
+        QString text = study.title;
+        if (i == loadingStudy) {
+            text += " (加载中)";
+        } else if (workspace.residency(i) == StudyWorkspace::Downsampled) {
+            text += " (低分辨率)";
+        } else if (workspace.residency(i) == StudyWorkspace::Evicted) {
+            text += " (已释放)";
+        }
+        studyTabs->setTabText(i, text);
+        studyTabs->setTabToolTip(i, QString("%1\n内存: %2 MB").arg(study.dirPath)
+                                 .arg(workspace.studyBytes(i) / megabyte, 0, 'f', 1));
+    }
+    studyTabs->setVisible(workspace.count() > 0);
+}
+
+// 从未加载成功的检查直接关闭；重新加载失败的保留为已释放状态，视图退回仍在显示的检查
+void MainWindow::abandonLoadingStudy() {
+    const int index = loadingStudy;
+    loadingStudy = -1;
+    if (index < 0) {
+        return;
+    }
+    if (!workspace.study(index).hasViewState && workspace.residency(index) == StudyWorkspace::Evicted) {
+        workspace.remove(index);
+        QSignalBlocker blocker(studyTabs);
+        studyTabs->removeTab(index);
+        if (activeStudy > index) {
+            --activeStudy;
+        } else if (activeStudy == index) {
+            activeStudy = -1;
+        }
+    }
+
+    if (activeStudy < 0 || workspace.residency(activeStudy) == StudyWorkspace::Evicted) {
+        int displayed = -1;
+        for (int i = 0; i < workspace.count(); ++i) {
+            const StudyWorkspace::Study &study = workspace.study(i);
+            if (loadedImageData && (loadedImageData.GetPointer() == study.image.GetPointer()
+                                    || loadedImageData.GetPointer() == study.lowRes.GetPointer())) {
+                displayed = i;
+            }
+        }
+        activeStudy = displayed;
+        QSignalBlocker blocker(studyTabs);
+        studyTabs->setCurrentIndex(displayed);
+    }
+    updateStudyTabs();
+}
+
+void MainWindow::setMemoryBudget() {
+    const qint64 gigabyte = 1024LL * 1024 * 1024;
+    bool ok = false;
+    int budget = QInputDialog::getInt(this, "工作区内存预算", "所有检查的体数据上限 (GB):",
+                                      static_cast<int>(workspace.budget() / gigabyte), 1, 1024, 1, &ok);
+    if (!ok) {
+        return;
+    }
+    QSettings().setValue("workspace/memoryBudget", budget * gigabyte);
+    workspace.setBudget(budget * gigabyte);
+    applyMemoryBudget();
+}
+
+void MainWindow::showMemoryUsage() {
+    const double megabyte = 1024.0 * 1024.0;
+    QString report;
+    for (int i = 0; i < workspace.count(); ++i) {
+        const char *state = "全分辨率";
+        if (i == loadingStudy) {
+            state = "加载中";
+        } else if (workspace.residency(i) == StudyWorkspace::Downsampled) {
+            state = "低分辨率";
+        } else if (workspace.residency(i) == StudyWorkspace::Evicted) {
+            state = "已释放";
+        }
+        report += QString("%1%2: %3 MB (%4)\n").arg(i == activeStudy ? "* " : "  ")
+            .arg(workspace.study(i).title).arg(workspace.studyBytes(i) / megabyte, 0, 'f', 1).arg(state);
+    }
+    report += QString("\n体数据合计: %1 MB / 预算 %2 MB\n\n")
+        .arg(workspace.totalBytes() / megabyte, 0, 'f', 1).arg(workspace.budget() / megabyte, 0, 'f', 0);
+
+    MemoryFootprint footprint;
+    collectMemoryFootprint(footprint);
+    report += QString::fromStdString(footprint.report());
+    QMessageBox::information(this, "工作区内存占用", report);
+}
+
+// 当前体数据排在最前，各使用者引用它时报告为共享而不是另一份拷贝
+void MainWindow::collectMemoryFootprint(MemoryFootprint &footprint) {
+    footprint.addImage("当前体数据", loadedImageData);
+    footprint.addImage("三维映射器输入", vtkImageData::SafeDownCast(volumeMapper->GetInput()));
+    footprint.addImage("轴状面 reslice 输入", vtkImageData::SafeDownCast(resliceAxial->GetInput()));
+    footprint.addImage("矢状面 reslice 输入", vtkImageData::SafeDownCast(resliceSagittal->GetInput()));
+    footprint.addImage("冠状面 reslice 输入", vtkImageData::SafeDownCast(resliceCoronal->GetInput()));
+    for (int i = 0; i < workspace.count(); ++i) {
+        const StudyWorkspace::Study &study = workspace.study(i);
+        footprint.addImage(study.title.toStdString() + " 全分辨率", study.image);
+        footprint.addImage(study.title.toStdString() + " 低分辨率副本", study.lowRes);
+        if (study.cine) {
+            for (int phase = 1; phase < study.cine->count(); ++phase) {
+                footprint.addImage(study.title.toStdString() + " 时相 "
+                                   + std::to_string(phase * study.cine->phaseStride + 1), study.cine->phases[phase]);
+            }
+        }
+    }
+    for (const auto &proxy : volumeLod->proxyVolumes()) {
+        footprint.addImage("三维代理 1/" + std::to_string(proxy.first), proxy.second);
+    }
+    if (cinePlayer->proxyBytes() > 0) {
+        footprint.addBuffer("电影回放各时相三维代理", cinePlayer, cinePlayer->proxyBytes());
+    }
+    if (brickedVolume) {
+        footprint.addBuffer("分块副本", brickedVolume->data(), static_cast<int64_t>(brickedVolume->memoryBytes()));
+    }
+    if (outOfCoreVolume) {
+        footprint.addBuffer("核外块缓存", outOfCoreVolume.get(), outOfCoreVolume->cachedBytes());
+    }
+    if (isosurfaceCache.count() > 0) {
+        footprint.addBuffer("等值面网格缓存 (" + std::to_string(isosurfaceCache.count()) + " 个)", &isosurfaceCache,
+                            static_cast<int64_t>(isosurfaceCache.bytes()));
+    }
 
-        // 重置相机视角
+    // 映射器输入超出显存上限而代理预算不够时，映射器会在内部再重采样一份，只能估计大小
+    const qint64 gpuBytes = volumeLod->gpuBudgetBytes();
+    if (gpuBytes > 0
+        && MemoryFootprint::imageBytes(vtkImageData::SafeDownCast(volumeMapper->GetInput())) > gpuBytes) {
+        footprint.addBuffer("三维映射器内部重采样 (估计)", volumeMapper.GetPointer(), gpuBytes);
+    }
+}
+
+// 把加载完成的体数据接入体绘制和三个切片管线
+// 渐进加载时切片管线已在分配阶段接好，这里只切换到完整体数据并刷新
+void MainWindow::setVolumeData(vtkImageData* image, std::shared_ptr<const VolumeHistogram> histogram) {
+    if (!image || image->GetScalarType() == VTK_VOID) {
+        return;
+    }
+    TRACE_SCOPE("setVolumeData");
+    volumeHistogram = std::move(histogram);
+    setDecodedSlices(nullptr); // 体数据已完整
+    const bool alreadyAttached = (image == loadedImageData.GetPointer());
+    if (alreadyAttached) {
+        loadedImageData->Modified(); // 工作线程写入的切片需要重新经过管线
+    } else {
+        attachSliceVolume(image);
+    }
+    partialVolumeAttached = false;
+    cpuRaycaster.setInput(loadedImageData); // 先换输入，分块副本构建后再交给光线投射
+    updateBrickedLayout();
+
+    // 输出数据信息
+    //int* dimensions = loadedImageData->GetDimensions();
+    //qDebug() << "DICOM序列维度:" << dimensions[0] << "x" << dimensions[1] << "x" << dimensions[2];
+
+    // 更新体绘制管线
+    volumeMapper->SetInputData(loadedImageData);
+    volumeLod->setVolume(loadedImageData);
+    volume->SetMapper(volumeMapper);
+    if (renderer3D->GetVolumes()->GetNumberOfItems() == 0) {
+        renderer3D->AddVolume(volume);
+    }
+    updateIsosurfaces();
+
+    // 设置窗宽窗位
+    double window, level;
+    defaultWindowLevel(window, level);
+    applyWindowLevel(window, level);
+    updateHistogramView();
+
+    // 更新所有视图，感觉有没有都不影响
+    updateAxialSlice(axialSlider->value());
+    updateSagittalSlice(sagittalSlider->value());
+    updateCoronalSlice(coronalSlider->value());
+
+    // 重置相机视角 (渐进加载时预览阶段已经重置过，保留用户调整后的视角)
+    if (!alreadyAttached || !previewShown) {
         renderer3D->ResetCamera();
         renderer3D->GetActiveCamera()->Zoom(1.5);
+    }
+    previewShown = false;
 
-        // 刷新所有渲染窗口
-        qvtkWidget3D->renderWindow()->Render();
-        qvtkWidgetAxial->renderWindow()->Render();
-        qvtkWidgetSagittal->renderWindow()->Render();
-        qvtkWidgetCoronal->renderWindow()->Render();
+    // 刷新所有渲染窗口
+    renderScheduler->requestRender(view3D);
+    renderScheduler->requestRender(viewAxial);
+    renderScheduler->requestRender(viewSagittal);
+    renderScheduler->requestRender(viewCoronal);
+}
 
-        QApplication::restoreOverrideCursor();
-        QMessageBox::information(this, "成功", 
-            QString("DICOM序列加载完成!\n图像大小: %1x%2x%3")
-            .arg(dimensions[0])
-            .arg(dimensions[1])
-            .arg(dimensions[2]));
+// 把体数据接入三个切片管线，重置切片范围和切片视图相机
+// 核外模式只支持轴对齐的单层切片：倾斜平面和厚层投影都需要整个体数据在内存中
+void MainWindow::attachSliceVolume(vtkImageData* image) {
+    slicePrefetcher.setVolume(nullptr, nullptr); // 完整体数据就绪后由 updateBrickedLayout 重新设置
+    sliceCache.clear();
+    setSliceInputs(image);
+    if (outOfCoreVolume) {
+        setupReslice(resliceAxial, AXIAL_ORIENTATION);
+        setupReslice(resliceSagittal, SAGITTAL_ORIENTATION);
+        setupReslice(resliceCoronal, CORONAL_ORIENTATION);
+    }
+    axialSlabSpin->setEnabled(!outOfCoreVolume);
+    sagittalSlabSpin->setEnabled(!outOfCoreVolume);
+    coronalSlabSpin->setEnabled(!outOfCoreVolume);
+
+    // 更新切片范围
+    updateSliceLimits();
+
+    updateAxialSlice(axialSlider->value());
+    updateSagittalSlice(sagittalSlider->value());
+    updateCoronalSlice(coronalSlider->value());
+    renderScheduler->flush(); // 重置相机需要切片已经接入
+    updateSliceViewport(rendererAxial, actorAxial);
+
+    // 重置并应用相机设置
+    rendererAxial->ResetCamera();
+    rendererSagittal->ResetCamera();
+    rendererCoronal->ResetCamera();
+}
 
-    } catch (std::exception& e) {
+void MainWindow::setSliceInputs(vtkImageData* image) {
+    loadedImageData = image;
+    resliceAxial->SetInputData(loadedImageData);
+    resliceSagittal->SetInputData(loadedImageData);
+    resliceCoronal->SetInputData(loadedImageData);
+    axialExtractor.setInput(loadedImageData);
+    sagittalExtractor.setInput(loadedImageData);
+    coronalExtractor.setInput(loadedImageData);
+    axialExtractor.setChunkedVolume(outOfCoreVolume);
+    sagittalExtractor.setChunkedVolume(outOfCoreVolume);
+    coronalExtractor.setChunkedVolume(outOfCoreVolume);
+    for (ObliqueSlicer &slicer : obliqueSlicers) {
+        slicer.setInput(loadedImageData);
+    }
+    for (SlabProjector &projector : slabProjectors) {
+        projector.setInput(loadedImageData);
+    }
+    setDecodedSlices(decodedSlices); // setInput 清除了已解码的层
+}
+
+void MainWindow::setDecodedSlices(std::shared_ptr<const DecodedSlices> decoded) {
+    decodedSlices = std::move(decoded);
+    axialExtractor.setDecodedSlices(decodedSlices);
+    sagittalExtractor.setDecodedSlices(decodedSlices);
+    coronalExtractor.setDecodedSlices(decodedSlices);
+    for (ObliqueSlicer &slicer : obliqueSlicers) {
+        slicer.setDecodedSlices(decodedSlices);
+    }
+    for (SlabProjector &projector : slabProjectors) {
+        projector.setDecodedSlices(decodedSlices);
+    }
+}
+
+// 切片仍从分块存储读取，缓存的切片图像继续有效，不重置层号和相机
+void MainWindow::setResidentLevel(vtkImageData* image) {
+    TRACE_SCOPE("setResidentLevel");
+    setSliceInputs(image);
+    slicePrefetcher.setVolume(loadedImageData, nullptr, outOfCoreVolume);
+    volumeMapper->SetInputData(loadedImageData);
+    volumeLod->setVolume(loadedImageData);
+    cpuRaycaster.setInput(loadedImageData);
+    updateIsosurfaces();
+    renderScheduler->requestRender(view3D);
+}
+
+void MainWindow::sliceDimensions(int dims[3]) const {
+    if (outOfCoreVolume) {
+        outOfCoreVolume->levelDimensions(0, dims);
+    } else {
+        loadedImageData->GetDimensions(dims);
+    }
+}
+
+// 设置三维交互时的目标帧时间，超出时自动降低细节层次
+void MainWindow::setLodTargetFrameTime() {
+    bool ok = false;
+    int ms = QInputDialog::getInt(this, "三维交互目标帧时间", "目标帧时间 (ms):",
+                                  static_cast<int>(volumeLod->targetFrameTime()), 5, 1000, 5, &ok);
+    if (!ok) {
+        return;
+    }
+    QSettings().setValue("lod/targetFrameMs", ms);
+    volumeLod->setTargetFrameTime(ms);
+}
+
+void MainWindow::setLodProxyBudget() {
+    const qint64 megabyte = 1024 * 1024;
+    bool ok = false;
+    int budget = QInputDialog::getInt(this, "三维代理体数据预算",
+                                      "交互时使用的降采样副本总大小上限 (MB，0 表示不生成，只调整采样距离):",
+                                      static_cast<int>(volumeLod->proxyBudget() / megabyte), 0, 65536, 64, &ok);
+    if (!ok) {
+        return;
+    }
+    QSettings().setValue("lod/proxyBudget", budget * megabyte);
+    volumeLod->setProxyBudget(budget * megabyte);
+    renderScheduler->requestRender(view3D);
+}
+
+// --- CPU 光线投射 ---
+
+void MainWindow::setCpuRaycastEnabled(bool enabled) {
+    QSettings().setValue("rendering/cpuRaycast", enabled);
+    update3DMode();
+    renderScheduler->requestRender(view3D);
+}
+
+// 等值面模式优先，其次 CPU 光线投射，都没有勾选时为显卡体绘制
+void MainWindow::update3DMode() {
+    const bool surface = isosurfaceAction->isChecked();
+    const bool cpu = cpuRaycastAction->isChecked() && !surface;
+    volume->SetVisibility(!surface && !cpu);
+    cpuRaycastActor->SetVisibility(cpu);
+    for (const vtkSmartPointer<vtkActor> &actor : isosurfaceActors) {
+        actor->SetVisibility(surface);
+    }
+}
+
+void MainWindow::setCpuRaycastThreads() {
+    bool ok = false;
+    int count = QInputDialog::getInt(this, "CPU 渲染线程数", "CPU 光线投射使用的线程数 (0 表示按处理器核数):",
+                                     cpuRaycaster.threadCount(), 0, 256, 1, &ok);
+    if (!ok) {
+        return;
+    }
+    QSettings().setValue("rendering/cpuThreads", count);
+    cpuRaycaster.setThreadCount(count);
+    isosurfaceExtractor.setThreadCount(count);
+    renderScheduler->requestRender(view3D);
+}
+
+// 始终投射原始体数据 (不用 LOD 代理，避免来回切换时重建分块最小/最大值)；
+// 交互降级时沿用映射器当前的采样距离，第 2、3 层再分别隔 2、4 个像素投射
+void MainWindow::renderCpuRaycast(vtkObject*, unsigned long, void*) {
+    if (!cpuRaycastAction->isChecked() || isosurfaceAction->isChecked()) {
+        return;
+    }
+    const int *size = renderer3D->GetSize();
+    const int pixelStep = 1 << std::max(0, volumeLod->level() - 1);
+    cpuRaycaster.setSampleDistance(volumeMapper->GetSampleDistance());
+    vtkImageData *image = cpuRaycaster.render(CpuRaycaster::viewFromCamera(renderer3D->GetActiveCamera()),
+                                              size[0], size[1], pixelStep);
+    cpuRaycastActor->SetVisibility(image != nullptr); // 没有体数据时不显示上一次的结果
+}
+
+// --- 等值面模式 ---
+
+void MainWindow::setIsosurfaceEnabled(bool enabled) {
+    QSettings().setValue("rendering/isosurface", enabled);
+    updateIsosurfaces();
+    update3DMode();
+    renderScheduler->requestRender(view3D);
+}
+
+void MainWindow::setIsosurfaceThresholds() {
+    bool ok = false;
+    const QString text = QInputDialog::getText(this, "等值面阈值",
+        "等值面阈值 (HU，多个用逗号分隔，例如骨骼 300、皮肤 -500):", QLineEdit::Normal,
+        formatThresholds(isosurfaceThresholds), &ok);
+    if (!ok) {
+        return;
+    }
+    const std::vector<double> thresholds = parseThresholds(text);
+    if (thresholds.empty()) {
+        QMessageBox::warning(this, "错误", QString("无效的阈值：%1").arg(text));
+        return;
+    }
+    QSettings().setValue("isosurface/thresholds", formatThresholds(thresholds));
+    isosurfaceThresholds = thresholds;
+    updateIsosurfaces();
+    renderScheduler->requestRender(view3D);
+}
+
+void MainWindow::setIsosurfaceTriangleBudget() {
+    bool ok = false;
+    const int budget = QInputDialog::getInt(this, "等值面三角形预算", "每个等值面抽取后的三角形数上限 (0 表示不抽取):",
+                                            static_cast<int>(isosurfaceExtractor.triangleBudget()),
+                                            0, 50000000, 100000, &ok);
+    if (!ok) {
+        return;
+    }
+    QSettings().setValue("isosurface/triangleBudget", budget);
+    isosurfaceExtractor.setTriangleBudget(budget); // 预算是缓存键的一部分，旧网格留在缓存中等待淘汰
+    updateIsosurfaces();
+    renderScheduler->requestRender(view3D);
+}
+
+// 多时相序列的每个时相分别缓存网格
+std::string MainWindow::isosurfaceStudyKey() const {
+    std::string key = activeStudy >= 0 ? workspace.study(activeStudy).dirPath.toStdString() : std::string();
+    if (cineSeries) {
+        key += "#phase" + std::to_string(cinePlayer->currentPhase());
+    }
+    return key;
+}
+
+// 缓存命中时直接换上网格，否则在界面线程中并行提取 (期间显示等待光标)
+// 等值面模式关闭、没有体数据或体数据仍在解码时只移除旧的网格
+// 网格都在缓存中时直接换上；否则交给后台线程提取，完成后由 onIsosurfacesReady 换上。
+// 提取期间同一体数据上的旧等值面继续显示 (例如只改了阈值)，换了体数据时先移除
+void MainWindow::updateIsosurfaces() {
+    if (!isosurfaceAction->isChecked() || !loadedImageData || partialVolumeAttached) {
+        isosurfaceBuilder.cancel();
+        isosurfaceRequest = 0;
+        removeIsosurfaceActors();
+        return;
+    }
+    TRACE_SCOPE("updateIsosurfaces");
+
+    IsosurfaceKey key;
+    key.study = isosurfaceStudyKey();
+    loadedImageData->GetDimensions(key.dimensions);
+    key.triangleBudget = isosurfaceExtractor.triangleBudget();
+
+    std::vector<IsosurfaceBuilder::Surface> surfaces;
+    for (double threshold : isosurfaceThresholds) {
+        key.threshold = threshold;
+        IsosurfaceBuilder::Surface surface;
+        surface.threshold = threshold;
+        surface.mesh = isosurfaceCache.find(key);
+        surface.cached = true;
+        if (!surface.mesh) {
+            if (isosurfaceSource != loadedImageData.GetPointer()) {
+                removeIsosurfaceActors();
+            }
+            isosurfaceRequest = isosurfaceBuilder.request(loadedImageData, key, isosurfaceThresholds, isosurfaceExtractor);
+            statusBar()->showMessage("正在后台提取等值面...");
+            return;
+        }
+        surfaces.push_back(surface);
+    }
+    isosurfaceBuilder.cancel(); // 之前的请求已经用不上
+    isosurfaceRequest = 0;
+    showIsosurfaces(surfaces);
+}
+
+void MainWindow::onIsosurfacesReady(unsigned int request) {
+    std::vector<IsosurfaceBuilder::Surface> surfaces;
+    if (request != isosurfaceRequest || !isosurfaceBuilder.takeResult(request, surfaces)) {
+        return; // 提取期间体数据或阈值又变了，新的请求已在排队
+    }
+    isosurfaceRequest = 0;
+    showIsosurfaces(surfaces);
+    renderScheduler->requestRender(view3D);
+}
+
+void MainWindow::showIsosurfaces(const std::vector<IsosurfaceBuilder::Surface> &surfaces) {
+    removeIsosurfaceActors();
+    QStringList summary;
+    for (size_t i = 0; i < surfaces.size(); ++i) {
+        const IsosurfaceBuilder::Surface &surface = surfaces[i];
+        if (surface.cached) {
+            summary << QString("%1 HU: %2 个三角形 (缓存)").arg(surface.threshold).arg(surface.mesh->GetNumberOfPolys());
+        } else {
+            summary << QString("%1 HU: 提取 %2 ms，抽取 %3 ms，%4 → %5 个三角形")
+                .arg(surface.threshold)
+                .arg(surface.stats.extractMs, 0, 'f', 0)
+                .arg(surface.stats.decimateMs + surface.stats.mergeMs, 0, 'f', 0)
+                .arg(surface.stats.extractedTriangles)
+                .arg(surface.stats.triangles);
+        }
+
+        vtkSmartPointer<vtkPolyDataMapper> mapper = vtkSmartPointer<vtkPolyDataMapper>::New();
+        mapper->SetInputData(surface.mesh);
+        mapper->ScalarVisibilityOff();
+        vtkSmartPointer<vtkActor> actor = vtkSmartPointer<vtkActor>::New();
+        actor->SetMapper(mapper);
+        double rgb[3];
+        colorTransferFunction->GetColor(surface.threshold, rgb);
+        actor->GetProperty()->SetColor(rgb);
+        if (i + 1 < surfaces.size()) {
+            actor->GetProperty()->SetOpacity(0.3); // 低阈值的外层半透明，露出里面的高阈值等值面
+        }
+        renderer3D->AddActor(actor);
+        isosurfaceActors.push_back(actor);
+    }
+    isosurfaceSource = loadedImageData.GetPointer();
+    update3DMode();
+    statusBar()->showMessage("等值面 " + summary.join("; "), 5000);
+}
+
+void MainWindow::removeIsosurfaceActors() {
+    for (const vtkSmartPointer<vtkActor> &actor : isosurfaceActors) {
+        renderer3D->RemoveActor(actor);
+    }
+    isosurfaceActors.clear();
+    isosurfaceSource = nullptr;
+}
+
+// 不经过缓存重新提取各阈值的等值面，报告提取耗时和三角形数；
+// 再分别以当前体绘制方式和等值面绕焦点旋转一周，同步渲染每一帧，比较静止画质下的帧率
+void MainWindow::benchmarkSurfaceRendering() {
+    if (!loadedImageData || partialVolumeAttached) {
+        QMessageBox::information(this, "提示", "请先加载DICOM序列");
+        return;
+    }
+
+    int* dims = loadedImageData->GetDimensions();
+    QString report = QString("图像大小: %1x%2x%3\n三角形预算: %4\n\n")
+        .arg(dims[0]).arg(dims[1]).arg(dims[2])
+        .arg(isosurfaceExtractor.triangleBudget());
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    IsosurfaceKey key;
+    key.study = isosurfaceStudyKey();
+    loadedImageData->GetDimensions(key.dimensions);
+    key.triangleBudget = isosurfaceExtractor.triangleBudget();
+    int64_t triangles = 0;
+    for (double threshold : isosurfaceThresholds) {
+        key.threshold = threshold;
+        IsosurfaceExtractor::Statistics stats;
+        vtkSmartPointer<vtkPolyData> mesh = isosurfaceExtractor.extract(loadedImageData, threshold, &stats);
+        isosurfaceCache.insert(key, mesh);
+        triangles += stats.triangles;
+        report += QString("等值面 %1 HU (%2 个层块，%3 线程):\n  提取 %4 ms，抽取 %5 ms，合并 %6 ms\n  三角形 %7 → %8\n")
+            .arg(threshold)
+            .arg(stats.slabs).arg(stats.threads)
+            .arg(stats.extractMs, 0, 'f', 1)
+            .arg(stats.decimateMs, 0, 'f', 1)
+            .arg(stats.mergeMs, 0, 'f', 1)
+            .arg(stats.extractedTriangles)
+            .arg(stats.triangles);
+    }
+
+    vtkRenderWindow *window = qvtkWidget3D->renderWindow();
+    vtkCamera *camera = renderer3D->GetActiveCamera();
+    auto measureFps = [&]() {
+        window->Render(); // 预热：上传纹理或网格
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < SURFACE_BENCHMARK_FRAMES; ++i) {
+            camera->Azimuth(360.0 / SURFACE_BENCHMARK_FRAMES);
+            renderer3D->ResetCameraClippingRange();
+            window->Render();
+        }
+        return SURFACE_BENCHMARK_FRAMES * 1.0e9 / std::max<qint64>(1, timer.nsecsElapsed());
+    };
+
+    // 临时切换模式，不触发信号也不改动保存的设置
+    const bool surfaceMode = isosurfaceAction->isChecked();
+    QSignalBlocker blocker(isosurfaceAction);
+    isosurfaceAction->setChecked(false);
+    update3DMode();
+    const double volumeFps = measureFps();
+    isosurfaceAction->setChecked(true);
+    updateIsosurfaces(); // 刚提取的网格都在缓存中
+    const double surfaceFps = measureFps();
+    isosurfaceAction->setChecked(surfaceMode);
+    updateIsosurfaces();
+    update3DMode();
+    QApplication::restoreOverrideCursor();
+
+    report += QString("\n旋转一周 %1 帧 (静止画质):\n  %2: %3 fps (%4 ms/帧)\n  等值面 (%5 个三角形): %6 fps (%7 ms/帧)")
+        .arg(SURFACE_BENCHMARK_FRAMES)
+        .arg(cpuRaycastAction->isChecked() ? "CPU 光线投射" : "体绘制")
+        .arg(volumeFps, 0, 'f', 1).arg(volumeFps > 0.0 ? 1000.0 / volumeFps : 0.0, 0, 'f', 1)
+        .arg(triangles)
+        .arg(surfaceFps, 0, 'f', 1).arg(surfaceFps > 0.0 ? 1000.0 / surfaceFps : 0.0, 0, 'f', 1);
+    report += QString("\n\n网格缓存: %1 个，占用 %2 MB")
+        .arg(isosurfaceCache.count())
+        .arg(isosurfaceCache.bytes() / (1024.0 * 1024.0), 0, 'f', 1);
+    renderScheduler->requestRender(view3D);
+    QMessageBox::information(this, "等值面与体绘制帧率对比", report);
+}
+
+// --- 性能跟踪 ---
+
+void MainWindow::setTracingEnabled(bool enabled) {
+    Tracer::instance().setEnabled(enabled);
+    statusBar()->showMessage(enabled ? "性能跟踪已开启" : "性能跟踪已暂停");
+    updateTraceOverlay();
+}
+
+// 导出为 Chrome trace JSON，可在 chrome://tracing 或 ui.perfetto.dev 中打开
+void MainWindow::exportTrace() {
+    if (Tracer::instance().eventCount() == 0) {
+        QMessageBox::information(this, "提示", "尚未记录任何跟踪事件，请先开启“记录性能跟踪”");
+        return;
+    }
+    QString path = QFileDialog::getSaveFileName(this, "导出性能跟踪",
+        QDir(QDir::homePath()).filePath("dicomviewer_trace.json"), "Trace JSON (*.json)");
+    if (path.isEmpty()) {
+        return;
+    }
+    std::string error;
+    if (!Tracer::instance().writeChromeTrace(path.toStdString(), &error)) {
+        QMessageBox::warning(this, "导出失败", QString::fromStdString(error));
+        return;
+    }
+    QString message = QString("已导出 %1 个事件").arg(Tracer::instance().eventCount());
+    if (Tracer::instance().droppedCount() > 0) {
+        message += QString("，超出上限丢弃 %1 个").arg(Tracer::instance().droppedCount());
+    }
+    statusBar()->showMessage(message);
+}
+
+void MainWindow::setTraceOverlayVisible(bool visible) {
+    traceOverlay->setVisible(visible);
+    updateTraceOverlay();
+}
+
+void MainWindow::updateTraceOverlay() {
+    if (!traceOverlay->isVisible()) {
+        return;
+    }
+    QString text;
+    if (!Tracer::enabled()) {
+        text = "性能跟踪未开启";
+    } else {
+        text = "上一帧 (ms)";
+        for (const auto &stage : Tracer::instance().lastFrame()) {
+            text += QString("\n%1 %2").arg(QString::fromStdString(stage.first), -24).arg(stage.second, 7, 'f', 2);
+        }
+    }
+    traceOverlay->setText(text);
+    traceOverlay->adjustSize();
+}
+
+// 显示自上次查看以来的渲染调度计数，然后清零
+void MainWindow::showRenderStatistics() {
+    const RenderScheduler::Counters &c = renderScheduler->counters();
+    QMessageBox::information(this, "渲染统计", QString(
+        "帧间隔: %1 ms\n"
+        "请求: %2\n"
+        "合并到同一帧: %3\n"
+        "被替换未执行的更新: %4\n"
+        "帧数: %5，渲染次数: %6\n"
+        "最近一帧耗时: %7 ms，最长一帧: %8 ms")
+        .arg(renderScheduler->frameInterval())
+        .arg(c.requests)
+        .arg(c.merged)
+        .arg(c.dropped)
+        .arg(c.frames).arg(c.renders)
+        .arg(c.lastFrameMs, 0, 'f', 2)
+        .arg(c.maxFrameMs, 0, 'f', 2));
+    renderScheduler->resetCounters();
+}
+
+// 按设置为加载完成的体数据构建分块副本，交给矢状面、冠状面的提取器和CPU光线投射
+// 渐进加载过程中体数据仍在写入，等加载完成后再构建
+// 多时相序列每帧换一个时相，既不构建分块副本也不预取 (切片缓存的键不区分时相)
+void MainWindow::updateBrickedLayout() {
+    brickedVolume.reset();
+    if (brickedLayoutAction->isChecked() && loadedImageData && !partialVolumeAttached && !outOfCoreVolume && !cineSeries) {
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        brickedVolume = std::make_shared<BrickedVolume>(loadedImageData);
         QApplication::restoreOverrideCursor();
-        QMessageBox::critical(this, "错误", 
-            QString("加载DICOM序列时发生错误：%1").arg(e.what()));
     }
+    sagittalExtractor.setBrickedVolume(brickedVolume);
+    coronalExtractor.setBrickedVolume(brickedVolume);
+    cpuRaycaster.setBrickedVolume(brickedVolume);
+    slicePrefetcher.setVolume(partialVolumeAttached || cineSeries ? nullptr : loadedImageData.GetPointer(), brickedVolume,
+                              outOfCoreVolume);
+}
+
+void MainWindow::setBrickedLayoutEnabled(bool enabled) {
+    QSettings().setValue("slices/brickedLayout", enabled);
+    if (loadThread) {
+        return; // 加载完成时会按新设置构建
+    }
+    updateBrickedLayout();
+    if (loadedImageData) {
+        updateSagittalSlice(sagittalSlider->value());
+        updateCoronalSlice(coronalSlider->value());
+    }
+}
+
+// 当前窗宽窗位保存在三个 vtkImageMapToWindowLevelColors 中 (倾斜平面时也由它们映射)
+// 纹理映射模式下切片演员直接显示原始灰度，由图像属性完成映射；否则输入已是RGBA，属性保持恒等映射
+void MainWindow::applyWindowLevel(double window, double level) {
+    wlAxial->SetWindow(window);
+    wlAxial->SetLevel(level);
+    wlSagittal->SetWindow(window);
+    wlSagittal->SetLevel(level);
+    wlCoronal->SetWindow(window);
+    wlCoronal->SetLevel(level);
+
+    const bool lookup = windowLevelLookupAction->isChecked();
+    for (vtkImageActor *actor : {actorAxial.GetPointer(), actorSagittal.GetPointer(), actorCoronal.GetPointer()}) {
+        actor->GetProperty()->SetColorWindow(lookup ? window : 255.0);
+        actor->GetProperty()->SetColorLevel(lookup ? level : 127.5);
+    }
+    updateCineView();
+}
+
+// 纹理映射模式只需重新渲染；否则切片图像要按新的窗宽窗位重新生成
+void MainWindow::setWindowLevel(double window, double level) {
+    if (window < 1.0) {
+        window = 1.0;
+    }
+    applyWindowLevel(window, level);
+    statusBar()->showMessage(QString("窗宽 %1 / 窗位 %2").arg(window, 0, 'f', 0).arg(level, 0, 'f', 0));
+    if (!loadedImageData) return;
+
+    if (windowLevelLookupAction->isChecked()) {
+        renderScheduler->requestRender(viewAxial);
+        renderScheduler->requestRender(viewSagittal);
+        renderScheduler->requestRender(viewCoronal);
+    } else {
+        refreshSliceViews();
+    }
+}
+
+// 恢复实际出现的最小到最大值，百分位数窗口裁掉的离群灰度也能重新看到
+void MainWindow::resetWindowLevel() {
+    if (!loadedImageData) return;
+    double range[2];
+    scalarRange(range);
+    setWindowLevel(range[1] - range[0], (range[1] + range[0]) / 2.0);
+}
+
+void MainWindow::autoWindowLevel() {
+    if (!loadedImageData) return;
+    double window, level;
+    defaultWindowLevel(window, level);
+    setWindowLevel(window, level);
+}
+
+// 默认窗口覆盖 0.5% 到 99.5% 分位数，金属伪影、FOV 外的填充值不会把窗宽撑大
+void MainWindow::defaultWindowLevel(double &window, double &level) const {
+    if (volumeHistogram) {
+        volumeHistogram->windowLevel(0.005, 0.995, window, level);
+        return;
+    }
+    double range[2];
+    scalarRange(range);
+    window = range[1] - range[0];
+    level = (range[1] + range[0]) / 2.0;
+}
+
+// 直方图记录了实际出现的最小/最大值；没有直方图时才让VTK扫描整个体数据
+void MainWindow::scalarRange(double range[2]) const {
+    if (volumeHistogram) {
+        range[0] = volumeHistogram->minimum();
+        range[1] = volumeHistogram->maximum();
+        return;
+    }
+    loadedImageData->GetScalarRange(range);
+}
+
+// 直方图按对数刻度画成灰色柱，叠加当前的不透明度传输函数 (纵轴为 0 到 1)
+void MainWindow::updateHistogramView() {
+    const int width = 512, height = 48;
+    QPixmap pixmap(width, height);
+    pixmap.fill(QColor(32, 32, 32));
+    if (volumeHistogram && volumeHistogram->maximum() > volumeHistogram->minimum()) {
+        const double lo = volumeHistogram->minimum(), hi = volumeHistogram->maximum();
+        const std::vector<int64_t> bins = volumeHistogram->resample(width, lo, hi);
+        double peak = 0.0;
+        for (int64_t count : bins) {
+            peak = std::max(peak, std::log1p(static_cast<double>(count)));
+        }
+        QPainter painter(&pixmap);
+        painter.setPen(QColor(150, 150, 150));
+        for (int x = 0; x < width && peak > 0.0; ++x) {
+            const int h = static_cast<int>(std::log1p(static_cast<double>(bins[x])) / peak * (height - 1));
+            if (h > 0) {
+                painter.drawLine(x, height - 1, x, height - 1 - h);
+            }
+        }
+        QPolygonF curve;
+        for (int x = 0; x < width; ++x) {
+            const double opacity = opacityTransferFunction->GetValue(lo + (hi - lo) * (x + 0.5) / width);
+            curve << QPointF(x, (height - 1) * (1.0 - std::min(std::max(opacity, 0.0), 1.0)));
+        }
+        painter.setRenderHint(QPainter::Antialiasing);
+        painter.setPen(QPen(QColor(255, 200, 0), 1.5));
+        painter.drawPolyline(curve);
+    }
+    histogramLabel->setPixmap(pixmap);
+}
+
+void MainWindow::refreshSliceViews() {
+    updateAxialSlice(axialSlider->value());
+    updateSagittalSlice(sagittalSlider->value());
+    updateCoronalSlice(coronalSlider->value());
+}
+
+void MainWindow::setWindowLevelLookupMode(bool enabled) {
+    QSettings().setValue("windowLevel/lookupMode", enabled);
+    applyWindowLevel(wlAxial->GetWindow(), wlAxial->GetLevel());
+    if (loadedImageData) {
+        refreshSliceViews();
+    }
+}
+
+void MainWindow::onWindowLevelStart(vtkObject*, unsigned long, void*) {
+    windowLevelDragging = true;
+    dragStartWindow = wlAxial->GetWindow();
+    dragStartLevel = wlAxial->GetLevel();
+}
+
+// 水平拖动改变窗宽，垂直拖动改变窗位；拖过整个视图对应体数据灰度范围的两倍
+void MainWindow::onWindowLevelDrag(vtkObject* caller, unsigned long, void*) {
+    if (!loadedImageData) return;
+    vtkInteractorStyleImage *style = static_cast<vtkInteractorStyleImage *>(caller);
+    const int *start = style->GetWindowLevelStartPosition();
+    const int *current = style->GetWindowLevelCurrentPosition();
+    const int *size = style->GetInteractor()->GetRenderWindow()->GetSize();
+    if (size[0] <= 0 || size[1] <= 0) return;
+
+    double range[2];
+    scalarRange(range);
+    const double span = std::max(1.0, range[1] - range[0]);
+    const double dx = 2.0 * span * (current[0] - start[0]) / size[0];
+    const double dy = 2.0 * span * (current[1] - start[1]) / size[1];
+    setWindowLevel(dragStartWindow + dx, dragStartLevel - dy);
+}
+
+// 松开后以最终的窗宽窗位重新生成一次，结果进入缓存并恢复预取
+void MainWindow::onWindowLevelEnd(vtkObject*, unsigned long, void*) {
+    windowLevelDragging = false;
+    if (loadedImageData && !windowLevelLookupAction->isChecked()) {
+        refreshSliceViews();
+    }
+}
+
+void MainWindow::onWindowLevelReset(vtkObject*, unsigned long, void*) {
+    resetWindowLevel();
+}
+
+// --- 倾斜切片平面 ---
+
+void MainWindow::obliquePlaneCenter(int orientation, double center[2]) const {
+    double origin[3], spacing[3];
+    int dims[3];
+    loadedImageData->GetOrigin(origin);
+    loadedImageData->GetSpacing(spacing);
+    loadedImageData->GetDimensions(dims);
+    for (int i = 0; i < 2; ++i) {
+        const int axis = PLANE_AXES[orientation][i];
+        center[i] = origin[axis] + spacing[axis] * (dims[axis] - 1) / 2.0;
+    }
+}
+
+int MainWindow::slabThickness(int orientation) const {
+    if (outOfCoreVolume) {
+        return 1;
+    }
+    switch (orientation) {
+        case AXIAL_ORIENTATION: return axialSlabSpin->value();
+        case SAGITTAL_ORIENTATION: return sagittalSlabSpin->value();
+        case CORONAL_ORIENTATION: return coronalSlabSpin->value();
+    }
+    return 1;
+}
+
+SlabProjector::Mode MainWindow::slabMode() const {
+    QAction *checked = slabModeGroup->checkedAction();
+    return checked ? static_cast<SlabProjector::Mode>(checked->data().toInt()) : SlabProjector::Maximum;
+}
+
+void MainWindow::updateSliceView(int orientation) {
+    switch (orientation) {
+        case AXIAL_ORIENTATION: updateAxialSlice(axialSlider->value()); break;
+        case SAGITTAL_ORIENTATION: updateSagittalSlice(sagittalSlider->value()); break;
+        case CORONAL_ORIENTATION: updateCoronalSlice(coronalSlider->value()); break;
+    }
+}
+
+bool MainWindow::onPlaneRotateStart(vtkObject* caller, unsigned long, void*) {
+    if (!rotatePlaneAction->isChecked() || !loadedImageData) {
+        return false;
+    }
+    if (outOfCoreVolume) {
+        statusBar()->showMessage("核外模式下不支持旋转切片平面", 3000);
+        return false;
+    }
+    vtkRenderWindowInteractor *interactor = static_cast<vtkRenderWindowInteractor *>(caller);
+    vtkImageReslice *reslice = nullptr;
+    if (interactor == qvtkWidgetAxial->renderWindow()->GetInteractor()) {
+        rotatingOrientation = AXIAL_ORIENTATION;
+        reslice = resliceAxial;
+    } else if (interactor == qvtkWidgetSagittal->renderWindow()->GetInteractor()) {
+        rotatingOrientation = SAGITTAL_ORIENTATION;
+        reslice = resliceSagittal;
+    } else {
+        rotatingOrientation = CORONAL_ORIENTATION;
+        reslice = resliceCoronal;
+    }
+    interactor->GetEventPosition(rotateStartPosition);
+    vtkMatrix4x4 *axes = reslice->GetResliceAxes();
+    for (int i = 0; i < 16; ++i) {
+        rotateStartAxes[i] = axes->GetElement(i / 4, i % 4);
+    }
+    return true;
+}
+
+// 水平拖动绕平面的 v 轴旋转，垂直拖动绕 u 轴旋转，两者叠加得到双斜平面；角度按起点计算，不累积误差
+bool MainWindow::onPlaneRotateMove(vtkObject* caller, unsigned long, void*) {
+    if (rotatingOrientation < 0) {
+        return false;
+    }
+    vtkRenderWindowInteractor *interactor = static_cast<vtkRenderWindowInteractor *>(caller);
+    const int *position = interactor->GetEventPosition();
+    const int *size = interactor->GetRenderWindow()->GetSize();
+    if (size[0] <= 0 || size[1] <= 0) {
+        return true;
+    }
+    const double yaw = ROTATE_DEGREES_PER_VIEW * (position[0] - rotateStartPosition[0]) / size[0];
+    const double pitch = -ROTATE_DEGREES_PER_VIEW * (position[1] - rotateStartPosition[1]) / size[1];
+
+    vtkSmartPointer<vtkTransform> rotation = vtkSmartPointer<vtkTransform>::New();
+    rotation->RotateWXYZ(yaw, rotateStartAxes[1], rotateStartAxes[5], rotateStartAxes[9]);
+    rotation->RotateWXYZ(pitch, rotateStartAxes[0], rotateStartAxes[4], rotateStartAxes[8]);
+    vtkMatrix4x4 *r = rotation->GetMatrix();
+
+    vtkImageReslice *reslice = rotatingOrientation == AXIAL_ORIENTATION ? resliceAxial.GetPointer()
+        : rotatingOrientation == SAGITTAL_ORIENTATION ? resliceSagittal.GetPointer() : resliceCoronal.GetPointer();
+    vtkMatrix4x4 *axes = reslice->GetResliceAxes();
+    for (int row = 0; row < 3; ++row) {
+        for (int col = 0; col < 3; ++col) {
+            double value = 0.0;
+            for (int k = 0; k < 3; ++k) {
+                value += r->GetElement(row, k) * rotateStartAxes[k * 4 + col];
+            }
+            axes->SetElement(row, col, value);
+        }
+    }
+    axes->Modified();
+    updateSliceView(rotatingOrientation); // 平移部分在更新时按当前层号重新计算
+    return true;
+}
+
+bool MainWindow::onPlaneRotateEnd(vtkObject*, unsigned long, void*) {
+    if (rotatingOrientation < 0) {
+        return false;
+    }
+    const int orientation = rotatingOrientation;
+    rotatingOrientation = -1;
+    updateSliceView(orientation); // 全分辨率
+    return true;
+}
+
+void MainWindow::resetSlicePlanes() {
+    setupReslice(resliceAxial, AXIAL_ORIENTATION);
+    setupReslice(resliceSagittal, SAGITTAL_ORIENTATION);
+    setupReslice(resliceCoronal, CORONAL_ORIENTATION);
+    if (loadedImageData) {
+        refreshSliceViews();
+    }
+}
+
+// --- 多时相电影回放 ---
+
+void MainWindow::setCineSeries(std::shared_ptr<const CineSeries> series) {
+    if (series && series->count() < 2) {
+        series = nullptr; // 只预载到一个时相时按普通序列显示
+    }
+    cineSeries = series;
+    cinePlayer->setSeries(series);
+    cinePlayButton->setText("播放");
+    cineBar->setVisible(series != nullptr);
+    if (series) {
+        QSignalBlocker blocker(cinePhaseSlider);
+        cinePhaseSlider->setRange(0, series->count() - 1);
+        cinePhaseSlider->setValue(0);
+        updateCineControls();
+        updateCineStatistics();
+    }
+}
+
+// 只有轴对齐的单层切片在后台准备；倾斜平面、厚层投影和纹理映射模式在换帧时按原路径生成
+void MainWindow::updateCineView() {
+    if (!cineSeries) {
+        return;
+    }
+    const bool lookup = windowLevelLookupAction->isChecked();
+    vtkImageReslice *reslices[3] = {resliceSagittal, resliceCoronal, resliceAxial};
+    const int values[3] = {sagittalSlider->value(), coronalSlider->value(), axialSlider->value()};
+    int slices[3];
+    for (int orientation = 0; orientation < 3; ++orientation) {
+        const bool prepared = !lookup && slabThickness(orientation) == 1
+            && isAxisAlignedAxes(reslices[orientation]->GetResliceAxes());
+        slices[orientation] = prepared ? values[orientation] : -1;
+    }
+    cinePlayer->setView(slices, wlAxial->GetWindow(), wlAxial->GetLevel(), volumeLod->decimationFactor());
+}
+
+void MainWindow::updateCineControls() {
+    if (!cineSeries) {
+        return;
+    }
+    const int phase = std::max(0, cinePlayer->currentPhase());
+    {
+        QSignalBlocker blocker(cinePhaseSlider);
+        cinePhaseSlider->setValue(phase);
+    }
+    QString text = QString("时相 %1/%2").arg(phase * cineSeries->phaseStride + 1).arg(cineSeries->sourcePhases);
+    if (cineSeries->triggerTimes[phase] >= 0.0) {
+        text += QString(" · %1 ms").arg(cineSeries->triggerTimes[phase], 0, 'f', 0);
+    }
+    cinePhaseLabel->setText(text);
+}
+
+// 换上后台准备好的切片和该时相的体数据，帧内不再提取轴对齐切片
+void MainWindow::onCinePhaseChanged(int phase) {
+    if (!cineSeries || phase < 0 || phase >= cineSeries->count()) {
+        return;
+    }
+    TRACE_SCOPE("onCinePhaseChanged");
+    setSliceInputs(cineSeries->phases[phase]);
+    const CinePlayer::Frame &frame = cinePlayer->currentFrame();
+    if (cinePlayer->isPlaying() && frame.phase == phase && frame.volume) {
+        // 播放中直接换上后台准备的三维输入，不在帧内重建LOD代理；暂停后再按当前时相重建
+        volumeLod->setExternalInput(frame.volume);
+    } else {
+        volumeMapper->SetInputData(loadedImageData);
+        volumeLod->setVolume(loadedImageData);
+    }
+    cpuRaycaster.setInput(loadedImageData);
+    if (isosurfaceAction->isChecked()) {
+        updateIsosurfaces();
+    }
+
+    vtkImageActor *actors[3] = {actorSagittal, actorCoronal, actorAxial};
+    const int views[3] = {viewSagittal, viewCoronal, viewAxial};
+    for (int orientation = 0; orientation < 3; ++orientation) {
+        if (frame.phase == phase && frame.slices[orientation]) {
+            actors[orientation]->SetInputData(frame.slices[orientation]);
+            renderScheduler->requestRender(views[orientation]);
+        } else {
+            updateSliceView(orientation);
+        }
+    }
+    renderScheduler->requestRender(view3D);
+    updateCineControls();
+}
+
+void MainWindow::toggleCinePlayback() {
+    if (cinePlayer->isPlaying()) {
+        cinePlayer->pause();
+        // 播放期间映射器用的是后台准备的输入，恢复按当前时相切换LOD代理
+        volumeMapper->SetInputData(loadedImageData);
+        volumeLod->setVolume(loadedImageData);
+        renderScheduler->requestRender(view3D);
+    } else {
+        updateCineView();
+        cinePlayer->play();
+    }
+    cinePlayButton->setText(cinePlayer->isPlaying() ? "暂停" : "播放");
+    updateCineStatistics();
+}
+
+// 丢帧包括后台尚未准备好下一帧和界面线程错过帧时刻两种情况
+void MainWindow::updateCineStatistics() {
+    const CinePlayer::Statistics stats = cinePlayer->statistics();
+    const quint64 ticks = stats.presented + stats.dropped;
+    cineStatsLabel->setText(QString("实际 %1 fps，丢帧 %2 (%3%)，准备 %4 ms (最长 %5 ms)")
+        .arg(stats.elapsedSeconds > 0.0 ? stats.presented / stats.elapsedSeconds : 0.0, 0, 'f', 1)
+        .arg(stats.dropped)
+        .arg(ticks > 0 ? 100.0 * stats.dropped / ticks : 0.0, 0, 'f', 1)
+        .arg(stats.prepareMs, 0, 'f', 1)
+        .arg(stats.maxPrepareMs, 0, 'f', 1));
+}
+
+// --- 渐进加载 ---
+
+// 体数据已分配 (已清零)：立即接入切片管线，切片在解码过程中陆续填充
+void MainWindow::onVolumeAllocated(vtkSmartPointer<vtkImageData> image, std::shared_ptr<const DecodedSlices> decoded) {
+    outOfCoreVolume.reset();
+    setCineSeries(nullptr);
+    renderer3D->RemoveVolume(volume); // 预览就绪前不显示旧的体绘制
+    volumeLod->setVolume(nullptr);
+    cpuRaycaster.setInput(nullptr);
+    volumeHistogram.reset(); // 直方图随 loaded 一起到达
+    updateHistogramView();
+    previewShown = false;
+    windowLevelPending = true;
+    partialVolumeAttached = true;
+    decodedSlices = std::move(decoded); // 接入切片管线时一并交给提取器，之后只读取已发布的层
+    attachSliceVolume(image);
+    updateIsosurfaces(); // 解码完成前不提取等值面
+}
+
+// 工作线程已解码更多切片 (节流后通知)，刷新三个切片视图
+void MainWindow::onSlicesDecoded(int decoded, int total) {
+    if (!loadedImageData) return;
+
+    loadedImageData->Modified();
+    if (windowLevelPending && (!decodedSlices || decodedSlices->contains(axialSlider->value()))) {
+        // 第一张切片 (中间层) 到达后按它的灰度范围设置窗宽窗位
+        double range[2];
+        axialExtractor.extract(AXIAL_ORIENTATION, axialSlider->value())->GetScalarRange(range);
+        applyWindowLevel(range[1] - range[0], (range[1] + range[0]) / 2.0);
+        windowLevelPending = false;
+    }
+
+    updateAxialSlice(axialSlider->value());
+    updateSagittalSlice(sagittalSlider->value());
+    updateCoronalSlice(coronalSlider->value());
+    statusBar()->showMessage(QString("已解码 %1/%2 层").arg(decoded).arg(total));
+}
+
+// 抽取层组成的低分辨率体数据先用于三维预览，加载完成后替换为完整体数据
+void MainWindow::onPreviewReady(vtkSmartPointer<vtkImageData> preview) {
+    volumeMapper->SetInputData(preview);
+    cpuRaycaster.setInput(preview);
+    volume->SetMapper(volumeMapper);
+    if (renderer3D->GetVolumes()->GetNumberOfItems() == 0) {
+        renderer3D->AddVolume(volume);
+    }
+    renderer3D->ResetCamera();
+    renderer3D->GetActiveCamera()->Zoom(1.5);
+    previewShown = true;
+    renderScheduler->requestRender(view3D);
+}
+
+// 体数据大小按裁剪后的体素数减少，三维渲染和切片管线的工作量也随之减少
+void MainWindow::onBodyCropped(qint64 originalBytes, qint64 croppedBytes, double milliseconds) {
+    const double megabyte = 1024.0 * 1024.0;
+    bodyCropSummary = QString("已裁剪体外区域：%1 MB → %2 MB (节省 %3%，耗时 %4 ms)")
+        .arg(originalBytes / megabyte, 0, 'f', 1).arg(croppedBytes / megabyte, 0, 'f', 1)
+        .arg(originalBytes > 0 ? 100.0 * (originalBytes - croppedBytes) / originalBytes : 0.0, 0, 'f', 0)
+        .arg(milliseconds, 0, 'f', 0);
 }
 
 // 更新切片的最小最大值
 void MainWindow::updateSliceLimits() {
     if (!loadedImageData) return;
 
-    int* dims = loadedImageData->GetDimensions(); // (nx, ny, nz)
+    int dims[3]; // (nx, ny, nz)
+    sliceDimensions(dims);
 
     axialSliceMin = 0;
     axialSliceMax = dims[2] - 1;
@@ -453,10 +2364,92 @@ void MainWindow::updateSliceLimits() {
     coronalSlider->setValue((coronalSliceMin + coronalSliceMax) / 2);
 }
 
-// 更新切片Actor的原点和方向
-void MainWindow::updateSliceActor(vtkImageActor* actor, vtkImageReslice* reslice, int slice, int orientation) {
+// 更新切片的输入：轴对齐平面直接按整数层号提取，只有倾斜平面才经过 vtkImageReslice
+// 轴对齐平面的显示图像来自切片缓存，未命中时提取并映射窗宽窗位后放入缓存，然后预取滚动方向上的后续切片
+void MainWindow::updateSliceActor(vtkImageActor* actor, vtkImageMapToWindowLevelColors* wl, vtkImageReslice* reslice,
+                                  SliceExtractor& extractor, int slice, int orientation) {
     if (!loadedImageData) return;
+    TRACE_SCOPE("updateSliceActor");
+
+    const bool lookup = windowLevelLookupAction->isChecked();
+    if (isAxisAlignedAxes(reslice->GetResliceAxes())) {
+        // 厚层投影：投影器按层范围的变化增量更新，结果不进切片缓存 (缓存键不含层数和投影方式)
+        const int thickness = slabThickness(orientation);
+        vtkImageData *slab = nullptr;
+        if (thickness > 1) {
+            // 渐进加载中平板用到未解码的层时为空，先显示单层切片
+            slab = slabProjectors[orientation].project(orientation, slice, thickness, slabMode());
+        }
+        if (slab) {
+            vtkSmartPointer<vtkImageData> image = slab;
+            if (!lookup) {
+                image = mapWindowLevelToRGBA(slab, wl->GetWindow(), wl->GetLevel());
+            }
+            if (actor->GetInput() != image.GetPointer()) {
+                actor->SetInputData(image);
+            }
+            lastSliceIndex[orientation] = slice;
+            return;
+        }
+
+        if (lookup) {
+            // 原始灰度直接交给演员，窗宽窗位由图像属性在生成纹理时应用
+            vtkImageData *raw = extractor.extract(orientation, slice);
+            if (extractor.failed()) {
+                reportSliceReadError(extractor);
+            }
+            if (actor->GetInput() != raw) {
+                actor->SetInputData(raw);
+            }
+            lastSliceIndex[orientation] = slice;
+            return;
+        }
+
+        // 渐进加载期间体数据仍在变化，拖动窗宽窗位时的中间结果也用不上，都不缓存也不预取；多时相序列的缓存键区分不了时相
+        const bool cacheable = !partialVolumeAttached && !windowLevelDragging && !cineSeries;
+        SliceKey key{orientation, slice, wl->GetWindow(), wl->GetLevel()};
+        vtkSmartPointer<vtkImageData> image = cacheable ? sliceCache.find(key) : nullptr;
+        if (!image) {
+            image = mapWindowLevelToRGBA(extractor.extract(orientation, slice), key.window, key.level);
+            if (extractor.failed()) {
+                reportSliceReadError(extractor); // 空白切片不进缓存
+            } else if (cacheable) {
+                sliceCache.insert(key, image);
+            }
+        }
+        if (actor->GetInput() != image.GetPointer()) {
+            actor->SetInputData(image);
+        }
+
+        if (cacheable) {
+            const int direction = (slice > lastSliceIndex[orientation]) - (slice < lastSliceIndex[orientation]);
+            slicePrefetcher.request(orientation, slice, direction, key.window, key.level);
+        }
+        lastSliceIndex[orientation] = slice;
+        return;
+    }
+
+    // 倾斜平面：多线程重采样只重新计算当前平面，拖动旋转期间降低分辨率，松开后再算一次全分辨率
+    setReslicePosition(reslice, slice, orientation);
+    double center[2];
+    obliquePlaneCenter(orientation, center);
+    const int step = (rotatingOrientation == orientation) ? OBLIQUE_PREVIEW_STEP : 1;
+    vtkSmartPointer<vtkImageData> image = obliqueSlicers[orientation].reslice(reslice->GetResliceAxes(), center, step);
+    if (image && !lookup) {
+        image = mapWindowLevelToRGBA(image, wl->GetWindow(), wl->GetLevel());
+    }
+    if (image && actor->GetInput() != image.GetPointer()) {
+        actor->SetInputData(image);
+    }
+    lastSliceIndex[orientation] = slice;
+}
+
+// 核外存储被删除或截断时切片读取失败，视图中显示为空白，在状态栏中给出原因
+void MainWindow::reportSliceReadError(const SliceExtractor& extractor) {
+    statusBar()->showMessage(QString("切片读取失败：%1").arg(QString::fromStdString(extractor.errorMessage())), 5000);
+}
 
+void MainWindow::setReslicePosition(vtkImageReslice* reslice, int slice, int orientation) {
     double spacing[3];
     loadedImageData->GetSpacing(spacing);
     double origin[3];
@@ -475,6 +2468,24 @@ void MainWindow::updateSliceActor(vtkImageActor* actor, vtkImageReslice* reslice
         reslice->SetResliceAxes(currentAxes);
     }
 
+    if (!isAxisAlignedAxes(currentAxes)) {
+        // 倾斜平面经过体数据中心沿法线偏移 (slice - 中间层) 个层距的点；
+        // 平移部分让该点在平面坐标系中的位置与轴对齐时相同，旋转时画面中心不跳动
+        double center[2];
+        obliquePlaneCenter(orientation, center);
+        int dims[3];
+        loadedImageData->GetDimensions(dims);
+        const double offset = (slice - (dims[orientation] - 1) / 2.0) * spacing[orientation];
+        for (int k = 0; k < 3; ++k) {
+            const double volumeCenter = origin[k] + spacing[k] * (dims[k] - 1) / 2.0;
+            const double pivot = volumeCenter + currentAxes->GetElement(k, 2) * offset;
+            currentAxes->SetElement(k, 3, pivot - currentAxes->GetElement(k, 0) * center[0]
+                                                - currentAxes->GetElement(k, 1) * center[1]);
+        }
+        reslice->SetResliceAxes(currentAxes);
+        return;
+    }
+
     double slicePosition = 0.0;
     switch (orientation) {
         case AXIAL_ORIENTATION:    // Z
@@ -491,38 +2502,135 @@ void MainWindow::updateSliceActor(vtkImageActor* actor, vtkImageReslice* reslice
             break;
     }
     reslice->SetResliceAxes(currentAxes); // 应用更新后的矩阵
-    reslice->Update(); // 非常重要：确保reslice更新
+}
 
-    // actor->GetMapper()->Update(); // actor的mapper会自动更新，但有时显式调用有帮助
+// 在三个方向上分别用 vtkImageReslice 和快速路径切换切片，统计单次切换的平均耗时
+// 分别给出只提取切片和提取后再映射窗宽窗位 (即显示前的完整处理) 两项
+void MainWindow::benchmarkSliceExtraction() {
+    if (!loadedImageData) {
+        QMessageBox::information(this, "提示", "请先加载DICOM序列");
+        return;
+    }
+
+    const int SAMPLES = 32;
+    const int orientations[3] = {AXIAL_ORIENTATION, SAGITTAL_ORIENTATION, CORONAL_ORIENTATION};
+    const char* names[3] = {"轴状面", "矢状面", "冠状面"};
+    int* dims = loadedImageData->GetDimensions();
+    double range[2];
+    scalarRange(range);
+
+    QString report = QString("图像大小: %1x%2x%3\n每个方向切换 %4 次，单次平均耗时 (提取 / 提取+窗宽窗位):\n\n")
+        .arg(dims[0]).arg(dims[1]).arg(dims[2]).arg(SAMPLES);
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    QElapsedTimer buildTimer;
+    buildTimer.start();
+    BrickedVolume bricked(loadedImageData);
+    double buildMs = buildTimer.nsecsElapsed() / 1.0e6;
+    std::vector<unsigned char> brickedSlice;
+
+    for (int i = 0; i < 3; ++i) {
+        const int orientation = orientations[i];
+        const int sliceCount = dims[orientation];
+
+        vtkSmartPointer<vtkImageReslice> reslice = vtkSmartPointer<vtkImageReslice>::New();
+        setupReslice(reslice, orientation);
+        reslice->SetInputData(loadedImageData);
+        SliceExtractor extractor;
+        extractor.setInput(loadedImageData);
+        vtkSmartPointer<vtkImageMapToWindowLevelColors> wl = vtkSmartPointer<vtkImageMapToWindowLevelColors>::New();
+        wl->SetWindow(range[1] - range[0]);
+        wl->SetLevel((range[1] + range[0]) / 2.0);
+
+        // 测量 SAMPLES 次均匀分布的切片切换，第0次用于预热不计时
+        auto measure = [&](auto&& changeSlice) {
+            changeSlice(0);
+            QElapsedTimer timer;
+            timer.start();
+            for (int k = 0; k < SAMPLES; ++k) {
+                changeSlice(SAMPLES > 1 ? k * (sliceCount - 1) / (SAMPLES - 1) : 0);
+            }
+            return timer.nsecsElapsed() / 1.0e6 / SAMPLES;
+        };
+
+        double resliceMs = measure([&](int slice) {
+            setReslicePosition(reslice, slice, orientation);
+            reslice->Update();
+        });
+        wl->SetInputConnection(reslice->GetOutputPort());
+        double resliceTotalMs = measure([&](int slice) {
+            setReslicePosition(reslice, slice, orientation);
+            wl->Update();
+        });
+
+        double fastMs = measure([&](int slice) {
+            extractor.extract(orientation, slice);
+        });
+        wl->SetInputData(extractor.output());
+        double fastTotalMs = measure([&](int slice) {
+            extractor.extract(orientation, slice);
+            wl->Update();
+        });
+        // 快速路径 + 本地窗宽窗位内核 (即切片视图实际使用的路径)
+        double mappedMs = measure([&](int slice) {
+            mapWindowLevelToRGBA(extractor.extract(orientation, slice), wl->GetWindow(), wl->GetLevel());
+        });
+
+        // 同一方向从分块副本提取 (不含窗宽窗位)
+        const size_t slicePoints = static_cast<size_t>(dims[0]) * dims[1] * dims[2] / sliceCount;
+        brickedSlice.resize(slicePoints * bricked.elementBytes());
+        double brickedMs = measure([&](int slice) {
+            bricked.extractSlice(orientation, slice, brickedSlice.data());
+        });
+
+        report += QString("%1:\n  vtkImageReslice: %2 / %3 ms\n  快速路径: %4 / %5 ms (%6x)\n  快速路径+SIMD窗宽窗位: %8 ms\n  分块布局: %7 ms\n")
+            .arg(names[i])
+            .arg(resliceMs, 0, 'f', 3).arg(resliceTotalMs, 0, 'f', 3)
+            .arg(fastMs, 0, 'f', 3).arg(fastTotalMs, 0, 'f', 3)
+            .arg(fastTotalMs > 0.0 ? resliceTotalMs / fastTotalMs : 0.0, 0, 'f', 1)
+            .arg(brickedMs, 0, 'f', 3)
+            .arg(mappedMs, 0, 'f', 3);
+    }
+    QApplication::restoreOverrideCursor();
+    report += QString("\n分块副本 (%1³): 构建 %2 ms，占用 %3 MB")
+        .arg(BrickedVolume::BRICK_SIZE)
+        .arg(buildMs, 0, 'f', 1)
+        .arg(bricked.memoryBytes() / (1024.0 * 1024.0), 0, 'f', 1);
+    report += QString("\n切片缓存: 命中 %1 次，未命中 %2 次，占用 %3 MB")
+        .arg(sliceCache.hits())
+        .arg(sliceCache.misses())
+        .arg(sliceCache.bytes() / (1024.0 * 1024.0), 0, 'f', 1);
+
+    QMessageBox::information(this, "切片提取性能对比", report);
 }
 
 // 更新3D视图的不透明度
 void MainWindow::update3DOpacity(int value) {
     if (!loadedImageData) return;
+    TRACE_SCOPE("update3DOpacity");
     
     // 将滑块值(0-100)转换为不透明度因子(0.0-1.0)
     double newOpacityFactor = value / 100.0;
     
     // 重新设置不透明度传输函数
-    opacityTransferFunction->RemoveAllPoints();
-    opacityTransferFunction->AddPoint(0,    0.0);
-    opacityTransferFunction->AddPoint(500,  0.15 * newOpacityFactor);
-    opacityTransferFunction->AddPoint(1000, 0.3 * newOpacityFactor);
-    opacityTransferFunction->AddPoint(1150, 0.5 * newOpacityFactor);
-    opacityTransferFunction->AddPoint(2000, 0.8 * newOpacityFactor);
+    setDefaultOpacityPoints(opacityTransferFunction, newOpacityFactor);
 
     volumeProperty->SetScalarOpacity(opacityTransferFunction);
-    qvtkWidget3D->renderWindow()->Render();
+    updateHistogramView();
+    renderScheduler->requestRender(view3D);
 }
 
 // 更新轴状位、矢状位和冠状位的切片
+// 切片提取推迟到下一帧渲染前执行，快速滚动时每帧只处理最后到达的层号
 void MainWindow::updateAxialSlice(int slice) {
     currentAxialSlice = slice;
     axialLabel->setText(QString("轴状位 (Axial): %1/%2").arg(slice).arg(axialSliceMax));
     if (loadedImageData) {
-        updateSliceActor(actorAxial, resliceAxial, slice, AXIAL_ORIENTATION);
+        renderScheduler->requestUpdate(viewAxial, [this, slice]() {
+            updateSliceActor(actorAxial, wlAxial, resliceAxial, axialExtractor, slice, AXIAL_ORIENTATION);
+        });
+        updateCineView();
         //updateSliceViewport(rendererAxial, actorAxial);
-        qvtkWidgetAxial->renderWindow()->Render();
     }
 }
 
@@ -530,9 +2638,11 @@ void MainWindow::updateSagittalSlice(int slice) {
     currentSagittalSlice = slice; 
     sagittalLabel->setText(QString("矢状位 (Sagittal): %1/%2").arg(slice).arg(sagittalSliceMax));
     if (loadedImageData) {
-        updateSliceActor(actorSagittal, resliceSagittal, slice, SAGITTAL_ORIENTATION);
+        renderScheduler->requestUpdate(viewSagittal, [this, slice]() {
+            updateSliceActor(actorSagittal, wlSagittal, resliceSagittal, sagittalExtractor, slice, SAGITTAL_ORIENTATION);
+        });
+        updateCineView();
         //updateSliceViewport(rendererSagittal, actorSagittal);
-        qvtkWidgetSagittal->renderWindow()->Render();
     }
 }
 
@@ -540,9 +2650,11 @@ void MainWindow::updateCoronalSlice(int slice) {
     currentCoronalSlice = slice;
     coronalLabel->setText(QString("冠状位 (Coronal): %1/%2").arg(slice).arg(coronalSliceMax));
     if (loadedImageData) {
-        updateSliceActor(actorCoronal, resliceCoronal, slice, CORONAL_ORIENTATION);
+        renderScheduler->requestUpdate(viewCoronal, [this, slice]() {
+            updateSliceActor(actorCoronal, wlCoronal, resliceCoronal, coronalExtractor, slice, CORONAL_ORIENTATION);
+        });
+        updateCineView();
         //updateSliceViewport(rendererCoronal, actorCoronal);
-        qvtkWidgetCoronal->renderWindow()->Render();
     }
 }
 
@@ -589,10 +2701,10 @@ void MainWindow::resizeEvent(QResizeEvent* event) {
         updateSliceViewport(rendererSagittal, actorSagittal);
         updateSliceViewport(rendererCoronal, actorCoronal);
         
-        // 刷新渲染
-        qvtkWidgetAxial->renderWindow()->Render();
-        qvtkWidgetSagittal->renderWindow()->Render();
-        qvtkWidgetCoronal->renderWindow()->Render();
+        // 刷新渲染，连续缩放时每帧只渲染一次
+        renderScheduler->requestRender(viewAxial);
+        renderScheduler->requestRender(viewSagittal);
+        renderScheduler->requestRender(viewCoronal);
     }
 }
 
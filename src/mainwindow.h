@@ -12,6 +12,11 @@
 #include <QApplication>
 #include <QMenuBar>
 #include <QMenu>
+#include <QThread>
+#include <QProgressBar>
+#include <QStatusBar>
+#include <QTabBar>
+#include <QActionGroup>
 
 // 前向声明 Qt UI 类 (如果使用 Qt Designer 生成 .ui 文件)
 QT_BEGIN_NAMESPACE
@@ -20,7 +25,7 @@ QT_END_NAMESPACE
 
 // VTK Headers
 #include <vtkSmartPointer.h>
-#include <vtkDICOMImageReader.h>
+#include <vtkImageData.h>
 #include <vtkRenderer.h>
 #include <vtkRenderWindow.h>
 #include <vtkRenderWindowInteractor.h>
@@ -37,9 +42,30 @@ QT_END_NAMESPACE
 #include <vtkAxesActor.h> // 用于显示坐标轴
 #include <vtkOrientationMarkerWidget.h> // 用于显示坐标轴
 #include <vtkRayCastImageDisplayHelper.h>
+#include <vtkActor2D.h>
+#include <vtkImageMapper.h>
+#include <vtkActor.h>
 
 #include <QVTKOpenGLNativeWidget.h>
 
+#include "dicomloader.h"
+#include "volumecache.h"
+#include "sliceextractor.h"
+#include "slicecache.h"
+#include "renderscheduler.h"
+#include "volumelod.h"
+#include "studyworkspace.h"
+#include "obliqueslicer.h"
+#include "slabprojector.h"
+#include "memoryfootprint.h"
+#include "cpuraycaster.h"
+#include "isosurfaceextractor.h"
+#include "isosurfacebuilder.h"
+#include "cineplayer.h"
+
+#include <memory>
+#include <vector>
+
 class MainWindow : public QMainWindow {
     Q_OBJECT
 
@@ -54,6 +80,56 @@ private slots:
     void updateCoronalSlice(int slice);
     void update3DOpacity(int value); // 示例：调整3D体渲染不透明度
 
+    // 异步加载回调
+    void onLoadProgress(int current, int total, const QString &stage);
+    void onVolumeLoaded(vtkSmartPointer<vtkImageData> image, std::shared_ptr<const VolumeHistogram> histogram);
+    void onLoadFailed(const QString &message);
+    void onLoadCanceled();
+    void cancelLoading();
+    void benchmarkReaders(); // 对比 vtkDICOMImageReader 与并行读取器
+    void onBenchmarkFinished(const QString &report);
+    void benchmarkSliceExtraction(); // 对比 vtkImageReslice 与正交切片快速路径
+    void setBrickedLayoutEnabled(bool enabled);
+    void showRenderStatistics();
+    void setLodTargetFrameTime();
+    void setLodProxyBudget();    // 三维代理体数据预算
+    void setCpuRaycastEnabled(bool enabled); // 三维视图改用 CPU 光线投射
+    void setCpuRaycastThreads();
+    void setIsosurfaceEnabled(bool enabled);  // 三维视图改为显示等值面网格
+    void setIsosurfaceThresholds();
+    void setIsosurfaceTriangleBudget();
+    void benchmarkSurfaceRendering();         // 等值面与体绘制的旋转帧率对比
+    void onVolumeAllocated(vtkSmartPointer<vtkImageData> image, std::shared_ptr<const DecodedSlices> decoded); // 渐进加载
+    void onSlicesDecoded(int decoded, int total);
+    void onPreviewReady(vtkSmartPointer<vtkImageData> preview);
+    void onBodyCropped(qint64 originalBytes, qint64 croppedBytes, double milliseconds);
+    void onOutOfCoreOpened(std::shared_ptr<ChunkedVolume> chunked, vtkSmartPointer<vtkImageData> resident,
+                           std::shared_ptr<const VolumeHistogram> histogram); // 核外加载
+    void onResidentLevelReady(vtkSmartPointer<vtkImageData> resident, int level);
+    void onOutOfCoreFinished();
+    void onPhasesLoaded(std::shared_ptr<const CineSeries> series,
+                        std::shared_ptr<const VolumeHistogram> histogram); // 多时相序列
+    void onCinePhaseChanged(int phase);        // 回放器换上了新的时相
+    void onIsosurfacesReady(unsigned int request); // 后台提取完成，换上等值面
+    void toggleCinePlayback();
+    void updateCineStatistics();
+    void setCineBudget();                      // 多时相预载的内存预算
+    void setOutOfCoreBudget();                 // 核外模式的内存预算
+    void clearOutOfCoreStore();
+    void setVolumeCacheEnabled(bool enabled); // 体数据缓存开关
+    void setVolumeCacheLimit();                // 设置体数据缓存上限
+    void clearVolumeCache();
+    void setWindowLevelLookupMode(bool enabled); // 窗宽窗位在纹理映射阶段应用
+    void resetSlicePlanes();                     // 恢复三个正交切片方向
+    void setTracingEnabled(bool enabled);        // 性能跟踪
+    void exportTrace();
+    void setTraceOverlayVisible(bool visible);
+    void updateTraceOverlay();                   // 每帧结束后刷新叠加层
+    void switchStudy(int index);                 // 切换检查标签页
+    void closeStudy(int index);
+    void setMemoryBudget();                      // 设置工作区内存预算
+    void showMemoryUsage();                      // 各检查的内存占用和体数据大小的分配清单
+
 private:
 
     // --- Qt UI 元素
@@ -67,20 +143,112 @@ private:
     QSlider *axialSlider;
     QSlider *sagittalSlider;
     QSlider *coronalSlider;
+    QSpinBox *axialSlabSpin;    // 厚层投影的层数，1 为单层
+    QSpinBox *sagittalSlabSpin;
+    QSpinBox *coronalSlabSpin;
     QLabel *axialLabel;
     QLabel *sagittalLabel;
     QLabel *coronalLabel;
     QLabel *opacityLabel; // 用于显示3D不透明度标签
+    QLabel *histogramLabel; // 灰度直方图 (对数刻度) 与不透明度传输函数曲线
 
     QMenuBar *menuBar;
     QMenu *fileMenu;
     QAction *openDICOMAction;
+    QAction *volumeCacheAction;      // 缓存解码后的体数据 (可勾选)
+    QAction *volumeCacheLimitAction;
+    QAction *clearVolumeCacheAction;
+    QAction *progressiveLoadAction;  // 渐进式加载 (可勾选)
+    QAction *bodyCropAction;         // 加载后裁掉体外空气和检查床 (可勾选)
+    QAction *outOfCoreAction;        // 超出预算的序列分块存放在磁盘上 (可勾选)
+    QAction *outOfCoreBudgetAction;
+    QAction *clearOutOfCoreAction;
+    QAction *cineAction;             // 多时相序列预载全部时相 (可勾选)
+    QAction *cineBudgetAction;
+    QAction *memoryBudgetAction;
+    QAction *memoryUsageAction;
+    QMenu *toolsMenu;
+    QAction *benchmarkReaderAction;
+    QAction *benchmarkSliceAction;
+    QAction *brickedLayoutAction;    // 矢状/冠状面从分块副本提取 (可勾选)
+    QAction *renderStatsAction;
+    QAction *lodTargetAction;
+    QAction *lodProxyBudgetAction;
+    QAction *cpuRaycastAction;       // CPU 光线投射体绘制 (可勾选)
+    QAction *cpuThreadsAction;
+    QAction *isosurfaceAction;       // 等值面模式 (可勾选)
+    QAction *isosurfaceThresholdsAction;
+    QAction *isosurfaceBudgetAction;
+    QAction *benchmarkSurfaceAction;
+    QMenu *windowLevelMenu;          // 窗宽窗位预设
+    QAction *windowLevelLookupAction; // 在图像属性中应用窗宽窗位 (可勾选)
+    QMenu *slabMenu;                 // 厚层投影方式
+    QActionGroup *slabModeGroup;     // 数据为 SlabProjector::Mode
+    QAction *traceAction;            // 记录性能跟踪 (可勾选)
+    QAction *exportTraceAction;
+    QAction *traceOverlayAction;     // 显示上一帧各阶段耗时 (可勾选)
+    QAction *rotatePlaneAction;      // 左键拖动旋转切片平面 (可勾选)
+    QAction *resetPlanesAction;
 
     QSlider *opacitySlider3D; // 示例
+    QTabBar *studyTabs;       // 每个打开的检查一个标签页
+    QWidget *cineBar;         // 电影回放控制，只在显示多时相序列时可见
+    QPushButton *cinePlayButton;
+    QSlider *cinePhaseSlider;
+    QSpinBox *cineFrameRateSpin;
+    QLabel *cinePhaseLabel;
+    QLabel *cineStatsLabel;   // 实际帧率、丢帧和每帧准备耗时
+
+    QLabel *lodLabel;              // 状态栏中的三维细节层次指示
+    QLabel *traceOverlay;          // 三维视图左上角的帧耗时叠加层
+    QString traceOutputPath;       // DICOMVIEWER_TRACE 指定的文件，退出时写入
+    QProgressBar *loadProgressBar; // 状态栏中的加载进度
+    QPushButton *cancelLoadButton; // 取消加载按钮
+
+    // --- 异步加载 ---
+    QThread *loadThread;        // 加载工作线程，空闲时为 nullptr
+    DicomLoader *dicomLoader;   // 运行在 loadThread 中的读取器
+    bool previewShown;          // 渐进加载：三维视图正在显示低分辨率预览
+    bool windowLevelPending;    // 渐进加载：等待第一张切片来确定窗宽窗位
+    bool partialVolumeAttached; // 渐进加载：切片视图显示的是尚未解码完的体数据
+    std::shared_ptr<const DecodedSlices> decodedSlices; // 渐进加载：已解码的层，其余层不能读取；体数据完整时为空
+    QString bodyCropSummary;    // 本次加载的自动裁剪结果，附在加载完成的提示后
+
+    // --- 多检查工作区 ---
+    StudyWorkspace workspace;
+    int activeStudy;  // 当前显示的检查，没有时为 -1
+    int loadingStudy; // 正在加载的检查，没有时为 -1
+
+    // --- 多时相电影回放 ---
+    CinePlayer *cinePlayer;
+    std::shared_ptr<const CineSeries> cineSeries; // 当前显示的多时相序列，此时 loadedImageData 是其中一个时相
+
+    // --- 鼠标拖动调节窗宽窗位 ---
+    bool windowLevelDragging;     // 拖动期间的中间结果不进缓存也不预取
+    double dragStartWindow, dragStartLevel;
+
+    // --- 拖动旋转切片平面 (倾斜MPR) ---
+    ObliqueSlicer obliqueSlicers[3]; // 按方向编号，倾斜平面的重采样
+    int rotatingOrientation;         // 正在旋转的视图方向，没有时为 -1
+    int rotateStartPosition[2];
+    double rotateStartAxes[16];
+
+    // --- 厚层投影 (MIP / MinIP / 平均) ---
+    SlabProjector slabProjectors[3]; // 按方向编号，轴对齐时层数大于 1 才使用
 
     // --- VTK 组件 ---
-    vtkSmartPointer<vtkDICOMImageReader> dicomReader;
-    vtkImageData* loadedImageData; // 保存读取的图像数据指针
+    vtkSmartPointer<vtkImageData> loadedImageData; // 读取完成的体数据
+    std::shared_ptr<const VolumeHistogram> volumeHistogram; // loadedImageData 的灰度直方图，可能为空
+    std::shared_ptr<const BrickedVolume> brickedVolume; // 可选的分块副本
+    std::shared_ptr<ChunkedVolume> outOfCoreVolume; // 核外模式的分块存储，此时 loadedImageData 是驻留的金字塔层
+    int residentLevel;                              // 核外模式下 loadedImageData 对应的金字塔层
+    SliceImageCache sliceCache;       // 映射好窗宽窗位的切片，三个视图共用
+    SlicePrefetcher slicePrefetcher;  // 沿滚动方向预取切片到 sliceCache
+    int lastSliceIndex[3];            // 各方向上一次显示的层号，用于判断滚动方向
+
+    // --- 渲染调度 ---
+    RenderScheduler *renderScheduler;
+    int view3D, viewAxial, viewSagittal, viewCoronal; // 调度器中的视图编号
 
     // 3D 视图
     vtkSmartPointer<vtkRenderer> renderer3D;
@@ -92,10 +260,22 @@ private:
     vtkSmartPointer<vtkInteractorStyleTrackballCamera> style3D;
     vtkSmartPointer<vtkAxesActor> axes3D; // 可选的坐标轴
     vtkSmartPointer<vtkOrientationMarkerWidget> orientationMarkerWidget3D; // 可选的坐标轴指示器
+    std::unique_ptr<VolumeLodController> volumeLod; // 交互时的细节层次
+    CpuRaycaster cpuRaycaster;                      // 没有可用显卡时代替 volumeMapper
+    vtkSmartPointer<vtkImageMapper> cpuRaycastMapper;
+    vtkSmartPointer<vtkActor2D> cpuRaycastActor;    // 铺满三维视图显示 CPU 渲染结果
+    IsosurfaceExtractor isosurfaceExtractor;
+    IsosurfaceCache isosurfaceCache;                // 按 (检查, 阈值) 缓存抽取后的网格
+    std::vector<double> isosurfaceThresholds;       // 从低到高
+    std::vector<vtkSmartPointer<vtkActor>> isosurfaceActors; // 每个阈值一个
+    IsosurfaceBuilder isosurfaceBuilder;            // 在后台提取缓存中没有的网格；声明在缓存之后，先于缓存析构
+    unsigned int isosurfaceRequest;                 // 等待中的后台提取请求，0 表示没有
+    const vtkImageData *isosurfaceSource;           // 当前等值面演员所属的体数据，只用于比较
 
     // Axial (轴状) 切片视图
     vtkSmartPointer<vtkRenderer> rendererAxial;
-    vtkSmartPointer<vtkImageReslice> resliceAxial;
+    vtkSmartPointer<vtkImageReslice> resliceAxial; // 保存切片平面的 ResliceAxes，性能对比时也用它重采样
+    SliceExtractor axialExtractor;                 // 轴对齐时的快速路径
     vtkSmartPointer<vtkImageMapToWindowLevelColors> wlAxial;
     vtkSmartPointer<vtkImageActor> actorAxial;
     vtkSmartPointer<vtkInteractorStyleImage> styleAxial;
@@ -105,6 +285,7 @@ private:
     // Sagittal (矢状) 切片视图
     vtkSmartPointer<vtkRenderer> rendererSagittal;
     vtkSmartPointer<vtkImageReslice> resliceSagittal;
+    SliceExtractor sagittalExtractor;
     vtkSmartPointer<vtkImageMapToWindowLevelColors> wlSagittal;
     vtkSmartPointer<vtkImageActor> actorSagittal;
     vtkSmartPointer<vtkInteractorStyleImage> styleSagittal;
@@ -114,6 +295,7 @@ private:
     // Coronal (冠状) 切片视图
     vtkSmartPointer<vtkRenderer> rendererCoronal;
     vtkSmartPointer<vtkImageReslice> resliceCoronal;
+    SliceExtractor coronalExtractor;
     vtkSmartPointer<vtkImageMapToWindowLevelColors> wlCoronal;
     vtkSmartPointer<vtkImageActor> actorCoronal;
     vtkSmartPointer<vtkInteractorStyleImage> styleCoronal;
@@ -126,10 +308,62 @@ private:
     void setupVTKColorAndOpacity(); // 设置颜色和不透明度函数
     void setup3DView();
     void setupSliceViews(); // 一个统一的函数来设置所有切片视图
+    void setupRenderScheduler(); // 把四个渲染窗口登记到渲染调度器
     void connectSignalsSlots(); // 连接信号和槽
 
+    // 连接体绘制和切片管线；histogram 为空时窗宽窗位和灰度范围退回到扫描体数据
+    void setVolumeData(vtkImageData* image, std::shared_ptr<const VolumeHistogram> histogram = nullptr);
+    void attachSliceVolume(vtkImageData* image); // 只连接切片管线
+    void setSliceInputs(vtkImageData* image);    // 切换切片管线的输入，不重置层号和相机
+    void setDecodedSlices(std::shared_ptr<const DecodedSlices> decoded); // 交给切片提取、厚层投影和倾斜切片
+    void setResidentLevel(vtkImageData* image);  // 核外模式：换成更细的驻留层，只影响三维视图
+    void sliceDimensions(int dims[3]) const;     // 各方向的层数，核外模式下为全分辨率尺寸
+    void applyWindowLevel(double window, double level);
+    void setWindowLevel(double window, double level); // 应用并刷新三个切片视图
+    void resetWindowLevel();                          // 全灰度范围
+    void autoWindowLevel();                           // 按灰度百分位数，与加载后的默认值相同
+    void defaultWindowLevel(double &window, double &level) const;
+    void scalarRange(double range[2]) const;          // 有直方图时不扫描体数据
+    void updateHistogramView();
+    void refreshSliceViews();
+    void renderCpuRaycast(vtkObject* caller, unsigned long event, void* data); // 三维渲染器开始渲染前调用
+    void update3DMode();        // 按体绘制 / CPU 光线投射 / 等值面模式切换三维视图中显示的对象
+    void updateIsosurfaces();   // 按当前体数据和阈值重建等值面演员，网格优先取自缓存，缺少的在后台提取
+    void showIsosurfaces(const std::vector<IsosurfaceBuilder::Surface> &surfaces); // 换上各阈值的演员
+    void removeIsosurfaceActors();
+    std::string isosurfaceStudyKey() const;
+    void onWindowLevelStart(vtkObject* caller, unsigned long event, void* data);
+    void onWindowLevelDrag(vtkObject* caller, unsigned long event, void* data);
+    void onWindowLevelEnd(vtkObject* caller, unsigned long event, void* data);
+    void onWindowLevelReset(vtkObject* caller, unsigned long event, void* data);
+    bool onPlaneRotateStart(vtkObject* caller, unsigned long event, void* data); // 返回 true 时不再交给交互样式
+    bool onPlaneRotateMove(vtkObject* caller, unsigned long event, void* data);
+    bool onPlaneRotateEnd(vtkObject* caller, unsigned long event, void* data);
+    void updateSliceView(int orientation); // 按滑块当前层号刷新该方向的视图
+    void obliquePlaneCenter(int orientation, double center[2]) const; // 体数据中心在平面坐标系中的位置
+    int slabThickness(int orientation) const;
+    SlabProjector::Mode slabMode() const;
+    void updateBrickedLayout(); // 按设置构建或释放分块副本
+    void setCineSeries(std::shared_ptr<const CineSeries> series); // 停止播放并切换回放的序列，传入空指针时隐藏回放控制
+    void updateCineView();      // 把当前层号和窗宽窗位交给回放器，后台据此准备下一帧
+    void updateCineControls();  // 时相滑块和时相标签
+    void activateStudy(int index);  // 显示检查，体数据已被释放时在后台重新加载
+    void saveViewState();           // 记录当前检查的层号和窗宽窗位
+    void restoreViewState(const StudyWorkspace::Study &study);
+    void applyMemoryBudget();       // 按预算降级或释放其他检查
+    void collectMemoryFootprint(MemoryFootprint &footprint); // 所有体数据大小的分配，共享的缓冲区只计一次
+    void updateStudyTabs();
+    void abandonLoadingStudy();     // 加载失败或取消后处理没有体数据的检查
+    QString chooseDICOMFolder(); // 弹出目录选择对话框
+    void startLoaderThread(const QString &dirPath, void (DicomLoader::*job)(const QString &),
+                           bool allowProgressive = true); // 在工作线程中运行读取任务
+    void finishLoading(); // 结束加载线程并恢复界面
+    void detachVolume(); // 卸下当前体数据，清空所有视图
     void updateSliceLimits(); // 读取DICOM后更新切片范围
-    void updateSliceActor(vtkImageActor* actor, vtkImageReslice* reslice, int slice, int orientation);
+    void updateSliceActor(vtkImageActor* actor, vtkImageMapToWindowLevelColors* wl, vtkImageReslice* reslice,
+                          SliceExtractor& extractor, int slice, int orientation);
+    void reportSliceReadError(const SliceExtractor& extractor); // 在状态栏中提示切片读取失败
+    void setReslicePosition(vtkImageReslice* reslice, int slice, int orientation); // 设置 ResliceAxes 的平移
     void setupReslice(vtkSmartPointer<vtkImageReslice> reslice, int orientation);
     void updateSliceViewport(vtkRenderer* renderer, vtkImageActor* actor);// 更新切片视图的显示范围
 
@@ -0,0 +1,131 @@
+#include "memoryfootprint.h"
+
+#include <vtkImageData.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__APPLE__)
+#include <mach/mach.h>
+#endif
+
+namespace {
+
+#if defined(__linux__)
+// /proc/self/status 中以 kB 为单位的字段，如 VmRSS、VmHWM
+int64_t procStatusBytes(const char *field) {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    const size_t length = std::strlen(field);
+    while (std::getline(status, line)) {
+        if (line.compare(0, length, field) == 0 && line.size() > length && line[length] == ':') {
+            return std::stoll(line.substr(length + 1)) * 1024;
+        }
+    }
+    return -1;
+}
+#endif
+
+std::string megabytes(int64_t bytes) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.1f MB", bytes / (1024.0 * 1024.0));
+    return text;
+}
+
+} // namespace
+
+void MemoryFootprint::addImage(const std::string &name, vtkImageData *image) {
+    const int64_t bytes = imageBytes(image);
+    if (bytes > 0) {
+        addBuffer(name, image->GetScalarPointer(), bytes);
+    }
+}
+
+void MemoryFootprint::addBuffer(const std::string &name, const void *buffer, int64_t bytes) {
+    int sharedWith = -1;
+    for (size_t i = 0; i < items.size(); ++i) {
+        if (items[i].buffer == buffer && items[i].sharedWith < 0) {
+            sharedWith = static_cast<int>(i);
+            break;
+        }
+    }
+    items.push_back({name, buffer, bytes, sharedWith});
+}
+
+int64_t MemoryFootprint::uniqueBytes() const {
+    int64_t total = 0;
+    for (const Entry &entry : items) {
+        if (entry.sharedWith < 0) {
+            total += entry.bytes;
+        }
+    }
+    return total;
+}
+
+std::string MemoryFootprint::report() const {
+    std::ostringstream out;
+    for (const Entry &entry : items) {
+        out << entry.name << ": " << megabytes(entry.bytes);
+        if (entry.sharedWith >= 0) {
+            out << " (与 " << items[entry.sharedWith].name << " 共享)";
+        }
+        out << "\n";
+    }
+    out << "\n去重后合计: " << megabytes(uniqueBytes()) << "\n";
+    const int64_t resident = residentBytes(), peak = peakResidentBytes();
+    if (resident >= 0) {
+        out << "进程常驻内存: " << megabytes(resident);
+        if (peak >= 0) {
+            out << " (峰值 " << megabytes(peak) << ")";
+        }
+        out << "\n";
+    }
+    return out.str();
+}
+
+int64_t MemoryFootprint::residentBytes() {
+#if defined(__linux__)
+    return procStatusBytes("VmRSS");
+#elif defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    return GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))
+        ? static_cast<int64_t>(counters.WorkingSetSize) : -1;
+#elif defined(__APPLE__)
+    mach_task_basic_info info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    return task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count)
+        == KERN_SUCCESS ? static_cast<int64_t>(info.resident_size) : -1;
+#else
+    return -1;
+#endif
+}
+
+int64_t MemoryFootprint::peakResidentBytes() {
+#if defined(__linux__)
+    return procStatusBytes("VmHWM");
+#elif defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    return GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))
+        ? static_cast<int64_t>(counters.PeakWorkingSetSize) : -1;
+#elif defined(__APPLE__)
+    mach_task_basic_info info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    return task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count)
+        == KERN_SUCCESS ? static_cast<int64_t>(info.resident_size_max) : -1;
+#else
+    return -1;
+#endif
+}
+
+int64_t MemoryFootprint::imageBytes(vtkImageData *image) {
+    if (!image || image->GetScalarType() == VTK_VOID) {
+        return 0;
+    }
+    return static_cast<int64_t>(image->GetNumberOfPoints()) * image->GetNumberOfScalarComponents()
+        * image->GetScalarSize();
+}
@@ -0,0 +1,38 @@
+#ifndef MEMORYFOOTPRINT_H
+#define MEMORYFOOTPRINT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class vtkImageData;
+
+// 体数据大小的内存分配清单
+// 按数据起始地址去重：多个使用者引用同一块缓冲区时只计一次，报告中标出它与谁共享。
+class MemoryFootprint {
+public:
+    struct Entry {
+        std::string name;
+        const void *buffer; // 数据起始地址
+        int64_t bytes;
+        int sharedWith;     // 与之共享的第一个条目编号，独立分配时为 -1
+    };
+
+    void addImage(const std::string &name, vtkImageData *image); // 空图像忽略
+    void addBuffer(const std::string &name, const void *buffer, int64_t bytes);
+
+    const std::vector<Entry> &entries() const { return items; }
+    int64_t uniqueBytes() const; // 去重后的合计
+    std::string report() const;  // 每个条目一行，最后是合计与进程常驻内存
+
+    // 进程当前/峰值常驻内存，平台不支持时返回 -1
+    static int64_t residentBytes();
+    static int64_t peakResidentBytes();
+
+    static int64_t imageBytes(vtkImageData *image);
+
+private:
+    std::vector<Entry> items;
+};
+
+#endif // MEMORYFOOTPRINT_H
@@ -0,0 +1,218 @@
+#include "obliqueslicer.h"
+#include "parallelfor.h"
+#include "tracer.h"
+
+#include <vtkMatrix4x4.h>
+#include <vtkSetGet.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+
+namespace {
+
+const int ROWS_PER_TASK = 8;
+
+// 体素索引空间中的输出平面：第 (i, j) 个像素位于 base + i * du + j * dv
+struct PlaneSampling {
+    double base[3];
+    double du[3];
+    double dv[3];
+    int width;
+    int height;
+};
+
+// 求一行中落在体数据内部的像素区间 [first, last]，没有交集时返回 false
+bool clipRow(const double start[3], const double du[3], const int dims[3], int width, int &first, int &last) {
+    double lo = 0.0;
+    double hi = width - 1.0;
+    for (int k = 0; k < 3; ++k) {
+        const double maxIndex = dims[k] - 1.0;
+        if (std::abs(du[k]) < 1e-12) {
+            if (start[k] < -1e-6 || start[k] > maxIndex + 1e-6) {
+                return false;
+            }
+            continue;
+        }
+        double a = (0.0 - start[k]) / du[k];
+        double b = (maxIndex - start[k]) / du[k];
+        if (a > b) {
+            std::swap(a, b);
+        }
+        lo = std::max(lo, a);
+        hi = std::min(hi, b);
+    }
+    first = static_cast<int>(std::ceil(lo - 1e-6));
+    last = static_cast<int>(std::floor(hi + 1e-6));
+    first = std::max(first, 0);
+    last = std::min(last, width - 1);
+    return first <= last;
+}
+
+// 整数类型四舍五入，与 vtkImageReslice 一致
+template <typename T>
+T roundSample(double value) {
+    if (std::is_integral<T>::value) {
+        return static_cast<T>(std::floor(value + 0.5));
+    }
+    return static_cast<T>(value);
+}
+
+template <typename T>
+void resliceKernel(const T *in, T *out, const int dims[3], int components, const PlaneSampling &plane) {
+    const size_t strideY = static_cast<size_t>(dims[0]) * components;
+    const size_t strideZ = strideY * dims[1];
+    const size_t rowElements = static_cast<size_t>(plane.width) * components;
+    const int tasks = (plane.height + ROWS_PER_TASK - 1) / ROWS_PER_TASK;
+
+    parallelFor(0, tasks, [&](int task, int) {
+        const int j0 = task * ROWS_PER_TASK;
+        const int j1 = std::min(plane.height, j0 + ROWS_PER_TASK);
+        for (int j = j0; j < j1; ++j) {
+            T *row = out + rowElements * j;
+            const double start[3] = {
+                plane.base[0] + j * plane.dv[0],
+                plane.base[1] + j * plane.dv[1],
+                plane.base[2] + j * plane.dv[2],
+            };
+            int first = 0, last = -1;
+            if (!clipRow(start, plane.du, dims, plane.width, first, last)) {
+                std::memset(row, 0, rowElements * sizeof(T));
+                continue;
+            }
+            std::memset(row, 0, static_cast<size_t>(first) * components * sizeof(T));
+            std::memset(row + static_cast<size_t>(last + 1) * components, 0,
+                        static_cast<size_t>(plane.width - 1 - last) * components * sizeof(T));
+
+            for (int i = first; i <= last; ++i) {
+                double p[3];
+                int i0[3];
+                size_t step[3];
+                double f[3];
+                for (int k = 0; k < 3; ++k) {
+                    p[k] = std::min(std::max(start[k] + i * plane.du[k], 0.0), dims[k] - 1.0);
+                    i0[k] = std::min(static_cast<int>(p[k]), dims[k] - 1);
+                    f[k] = p[k] - i0[k];
+                }
+                // 位于最后一层时没有下一个体素，权重为 0 的那一侧指回自身
+                step[0] = i0[0] + 1 < dims[0] ? components : 0;
+                step[1] = i0[1] + 1 < dims[1] ? strideY : 0;
+                step[2] = i0[2] + 1 < dims[2] ? strideZ : 0;
+
+                const T *v = in + i0[2] * strideZ + i0[1] * strideY + static_cast<size_t>(i0[0]) * components;
+                for (int c = 0; c < components; ++c) {
+                    const T *q = v + c;
+                    const double c00 = q[0] + f[0] * (static_cast<double>(q[step[0]]) - q[0]);
+                    const double c10 = q[step[1]] + f[0] * (static_cast<double>(q[step[1] + step[0]]) - q[step[1]]);
+                    const double c01 = q[step[2]] + f[0] * (static_cast<double>(q[step[2] + step[0]]) - q[step[2]]);
+                    const double c11 = q[step[2] + step[1]]
+                        + f[0] * (static_cast<double>(q[step[2] + step[1] + step[0]]) - q[step[2] + step[1]]);
+                    const double c0 = c00 + f[1] * (c10 - c00);
+                    const double c1 = c01 + f[1] * (c11 - c01);
+                    row[static_cast<size_t>(i) * components + c] = roundSample<T>(c0 + f[2] * (c1 - c0));
+                }
+            }
+        }
+    });
+}
+
+} // namespace
+
+ObliqueSlicer::ObliqueSlicer()
+    : slice(vtkSmartPointer<vtkImageData>::New()), valid(false), lastStep(0), lastVolumeTime(0)
+{
+    std::fill(lastAxes, lastAxes + 16, 0.0);
+    lastCenter[0] = lastCenter[1] = 0.0;
+}
+
+void ObliqueSlicer::setInput(vtkImageData *input) {
+    volume = input;
+    decoded.reset();
+    valid = false;
+}
+
+void ObliqueSlicer::setDecodedSlices(std::shared_ptr<const DecodedSlices> decodedSlices) {
+    decoded = std::move(decodedSlices);
+    valid = false;
+}
+
+vtkImageData *ObliqueSlicer::reslice(vtkMatrix4x4 *axes, const double center[2], int step) {
+    if (!volume || !axes || volume->GetScalarType() == VTK_VOID) {
+        return nullptr;
+    }
+    step = std::max(1, step);
+
+    double elements[16];
+    for (int i = 0; i < 16; ++i) {
+        elements[i] = axes->GetElement(i / 4, i % 4);
+    }
+    if (valid && step == lastStep && volume->GetMTime() == lastVolumeTime
+        && center[0] == lastCenter[0] && center[1] == lastCenter[1]
+        && std::equal(elements, elements + 16, lastAxes)) {
+        return slice;
+    }
+    TRACE_SCOPE("ObliqueSlicer::reslice");
+
+    int dims[3];
+    double spacing[3], origin[3];
+    volume->GetDimensions(dims);
+    volume->GetSpacing(spacing);
+    volume->GetOrigin(origin);
+
+    // 输出为覆盖整个体数据的正方形，像素间距取最小体素间距
+    double diagonal = 0.0;
+    for (int k = 0; k < 3; ++k) {
+        const double extent = (dims[k] - 1) * spacing[k];
+        diagonal += extent * extent;
+    }
+    diagonal = std::sqrt(diagonal);
+    const double pixel = std::min(spacing[0], std::min(spacing[1], spacing[2])) * step;
+    const int size = static_cast<int>(std::ceil(diagonal / pixel)) + 1;
+    const double outOrigin[2] = {center[0] - 0.5 * (size - 1) * pixel, center[1] - 0.5 * (size - 1) * pixel};
+
+    const int components = volume->GetNumberOfScalarComponents();
+    int *outDims = slice->GetDimensions();
+    if (outDims[0] != size || outDims[1] != size || slice->GetScalarType() != volume->GetScalarType()
+        || slice->GetNumberOfScalarComponents() != components) {
+        slice->SetDimensions(size, size, 1);
+        slice->AllocateScalars(volume->GetScalarType(), components);
+    }
+    slice->SetSpacing(pixel, pixel, 1.0);
+    slice->SetOrigin(outOrigin[0], outOrigin[1], 0.0);
+
+    // 世界坐标 = R * (x, y, 0) + t，再换算为体素索引
+    PlaneSampling plane;
+    plane.width = size;
+    plane.height = size;
+    for (int k = 0; k < 3; ++k) {
+        const double world = elements[k * 4] * outOrigin[0] + elements[k * 4 + 1] * outOrigin[1] + elements[k * 4 + 3];
+        plane.base[k] = (world - origin[k]) / spacing[k];
+        plane.du[k] = elements[k * 4] * pixel / spacing[k];
+        plane.dv[k] = elements[k * 4 + 1] * pixel / spacing[k];
+    }
+
+    void *out = slice->GetScalarPointer();
+    if (decoded && !decoded->complete()) {
+        std::memset(out, 0, static_cast<size_t>(size) * size * components * volume->GetScalarSize());
+        valid = false; // 解码完成后重新采样
+        slice->Modified();
+        return slice;
+    }
+    const void *in = volume->GetScalarPointer();
+    switch (volume->GetScalarType()) {
+        vtkTemplateMacro(resliceKernel(static_cast<const VTK_TT *>(in), static_cast<VTK_TT *>(out),
+                                       dims, components, plane));
+        default:
+            return nullptr;
+    }
+
+    valid = true;
+    lastStep = step;
+    lastVolumeTime = volume->GetMTime();
+    lastCenter[0] = center[0];
+    lastCenter[1] = center[1];
+    std::copy(elements, elements + 16, lastAxes);
+    slice->Modified();
+    return slice;
+}
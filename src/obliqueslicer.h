@@ -0,0 +1,42 @@
+#ifndef OBLIQUESLICER_H
+#define OBLIQUESLICER_H
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+
+#include <memory>
+
+#include "decodedslices.h"
+
+class vtkMatrix4x4;
+
+// 任意方向切片的多线程三线性重采样，替代倾斜平面上的 vtkImageReslice
+// 输出坐标与 vtkImageReslice 相同，位于 ResliceAxes 定义的平面坐标系中；输出范围固定为以 center 为中心、
+// 边长等于体数据包围盒对角线的正方形，平面怎么旋转输出大小都不变，视图相机不需要调整。
+// 平面的两个方向事先换算到体素索引空间，每行先与体数据求交，只对交集内的像素插值，其余填 0 (与 reslice 的默认背景相同)。
+// ResliceAxes、中心、步长和体数据都没有变化时直接返回上一次的结果。
+// 倾斜平面会穿过任意层：渐进加载时在所有层解码完成之前输出全零的占位图像，不读取体数据。
+class ObliqueSlicer {
+public:
+    ObliqueSlicer();
+
+    void setInput(vtkImageData *volume); // 同时清除已解码的层
+    void setDecodedSlices(std::shared_ptr<const DecodedSlices> decoded); // 为空表示体数据已完整
+    // center 为输出正方形中心在平面坐标系中的位置；step > 1 时按该倍数降低输出分辨率，用于拖动时的预览
+    vtkImageData *reslice(vtkMatrix4x4 *axes, const double center[2], int step = 1);
+    vtkImageData *output() const { return slice; }
+
+private:
+    vtkSmartPointer<vtkImageData> volume;
+    vtkSmartPointer<vtkImageData> slice;
+    std::shared_ptr<const DecodedSlices> decoded;
+
+    // 上一次重采样的参数
+    bool valid;
+    double lastAxes[16];
+    double lastCenter[2];
+    int lastStep;
+    vtkMTimeType lastVolumeTime;
+};
+
+#endif // OBLIQUESLICER_H
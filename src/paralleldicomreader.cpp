@@ -0,0 +1,627 @@
+#include "paralleldicomreader.h"
+#include "dicomcodec.h"
+#include "parallelfor.h"
+#include "tracer.h"
+
+#include <vtkType.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+
+namespace {
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool isIntegral(double value) {
+    return value == std::floor(value);
+}
+
+// 把一个切片的行顺序上下翻转 (DICOM 首行在上，VTK 首行在下)
+void flipRows(char *data, size_t rowBytes, int rows) {
+    for (int top = 0, bottom = rows - 1; top < bottom; ++top, --bottom) {
+        std::swap_ranges(data + rowBytes * top, data + rowBytes * (top + 1), data + rowBytes * bottom);
+    }
+}
+
+// 应用 Rescale 并转换为输出类型，in 与 out 可以是同一块内存 (类型大小相同时)
+template <typename InT, typename OutT>
+void rescale(const InT *in, OutT *out, size_t count, double slope, double intercept) {
+    if (slope == 1.0 && intercept == 0.0) {
+        if (std::is_same<InT, OutT>::value && static_cast<const void *>(in) == static_cast<const void *>(out)) {
+            return; // 原地且无需转换
+        }
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = static_cast<OutT>(in[i]);
+        }
+    } else {
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = static_cast<OutT>(in[i] * slope + intercept);
+        }
+    }
+}
+
+template <typename InT>
+void rescaleTo(int outType, const InT *in, void *out, size_t count, double slope, double intercept) {
+    switch (outType) {
+        case VTK_UNSIGNED_CHAR: rescale(in, static_cast<unsigned char *>(out), count, slope, intercept); break;
+        case VTK_SIGNED_CHAR: rescale(in, static_cast<signed char *>(out), count, slope, intercept); break;
+        case VTK_SHORT: rescale(in, static_cast<short *>(out), count, slope, intercept); break;
+        case VTK_UNSIGNED_SHORT: rescale(in, static_cast<unsigned short *>(out), count, slope, intercept); break;
+        case VTK_INT: rescale(in, static_cast<int *>(out), count, slope, intercept); break;
+        case VTK_UNSIGNED_INT: rescale(in, static_cast<unsigned int *>(out), count, slope, intercept); break;
+        case VTK_FLOAT: rescale(in, static_cast<float *>(out), count, slope, intercept); break;
+        default: throw std::runtime_error("不支持的输出数据类型");
+    }
+}
+
+// 按存储位数和像素表示分派原始像素类型
+void rescaleRaw(int bitsAllocated, int pixelRepresentation, int outType,
+                const void *in, void *out, size_t count, double slope, double intercept) {
+    const bool isSigned = pixelRepresentation == 1;
+    switch (bitsAllocated) {
+        case 8:
+            if (isSigned) rescaleTo(outType, static_cast<const signed char *>(in), out, count, slope, intercept);
+            else rescaleTo(outType, static_cast<const unsigned char *>(in), out, count, slope, intercept);
+            break;
+        case 16:
+            if (isSigned) rescaleTo(outType, static_cast<const short *>(in), out, count, slope, intercept);
+            else rescaleTo(outType, static_cast<const unsigned short *>(in), out, count, slope, intercept);
+            break;
+        case 32:
+            if (isSigned) rescaleTo(outType, static_cast<const int *>(in), out, count, slope, intercept);
+            else rescaleTo(outType, static_cast<const unsigned int *>(in), out, count, slope, intercept);
+            break;
+        default:
+            throw std::runtime_error("不支持的BitsAllocated");
+    }
+}
+
+// 输出类型能表示的范围，Rescale 后超出的值会回绕，直方图范围不必超过它
+void scalarTypeRange(int scalarType, double &lo, double &hi) {
+    switch (scalarType) {
+        case VTK_UNSIGNED_CHAR: lo = 0.0; hi = 255.0; break;
+        case VTK_SIGNED_CHAR: lo = -128.0; hi = 127.0; break;
+        case VTK_SHORT: lo = -32768.0; hi = 32767.0; break;
+        case VTK_UNSIGNED_SHORT: lo = 0.0; hi = 65535.0; break;
+        case VTK_INT: lo = -2147483648.0; hi = 2147483647.0; break;
+        case VTK_UNSIGNED_INT: lo = 0.0; hi = 4294967295.0; break;
+        default: lo = -3.4e38; hi = 3.4e38; break;
+    }
+}
+
+// 切片法向：ImageOrientation 两个方向的叉积，退化时取z轴
+void sliceNormal(const DicomSliceInfo &slice, double normal[3]) {
+    const double *o = slice.imageOrientation;
+    normal[0] = o[1] * o[5] - o[2] * o[4];
+    normal[1] = o[2] * o[3] - o[0] * o[5];
+    normal[2] = o[0] * o[4] - o[1] * o[3];
+    double len = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+    if (len > 0.0) {
+        for (int i = 0; i < 3; ++i) normal[i] /= len;
+    } else {
+        normal[0] = 0.0; normal[1] = 0.0; normal[2] = 1.0;
+    }
+}
+
+double slicePosition(const DicomSliceInfo &s, const double normal[3]) {
+    return s.imagePosition[0] * normal[0] + s.imagePosition[1] * normal[1] + s.imagePosition[2] * normal[2];
+}
+
+// 同一位置上有多张切片、每个位置的张数相同，且同一位置上各切片的 TemporalPositionIdentifier/TriggerTime 互不相同时
+// 视为多时相序列：每个位置上的切片按这两个字段排序，第 k 张归入第 k 个时相。
+// 位置按 1 微米取整比较；只有一个位置 (例如缺少 ImagePositionPatient) 或时间字段不能区分同位置的切片时，
+// 无法可靠分组，仍作为一个时相，按原来的方式以位置和 InstanceNumber 排序
+std::vector<std::vector<DicomSliceInfo>> splitPhases(std::vector<DicomSliceInfo> slices) {
+    double normal[3];
+    sliceNormal(slices.front(), normal);
+    std::map<long long, std::vector<size_t>> positions;
+    for (size_t i = 0; i < slices.size(); ++i) {
+        positions[std::llround(slicePosition(slices[i], normal) * 1000.0)].push_back(i);
+    }
+    const auto temporalLess = [&slices](size_t a, size_t b) {
+        const DicomSliceInfo &sa = slices[a], &sb = slices[b];
+        if (sa.temporalPositionIdentifier != sb.temporalPositionIdentifier) {
+            return sa.temporalPositionIdentifier < sb.temporalPositionIdentifier;
+        }
+        return sa.triggerTime < sb.triggerTime;
+    };
+    const size_t phases = positions.begin()->second.size();
+    bool split = phases > 1 && positions.size() > 1;
+    for (auto it = positions.begin(); split && it != positions.end(); ++it) {
+        std::vector<size_t> &group = it->second;
+        std::sort(group.begin(), group.end(), temporalLess);
+        split = group.size() == phases
+            && std::adjacent_find(group.begin(), group.end(), [&temporalLess](size_t a, size_t b) {
+                   return !temporalLess(a, b);
+               }) == group.end();
+    }
+    std::vector<std::vector<DicomSliceInfo>> result;
+    if (!split) {
+        result.push_back(std::move(slices));
+        return result;
+    }
+
+    result.resize(phases);
+    for (auto &entry : positions) {
+        for (size_t k = 0; k < phases; ++k) {
+            result[k].push_back(std::move(slices[entry.second[k]]));
+        }
+    }
+    return result;
+}
+
+int scalarSize(int scalarType) {
+    switch (scalarType) {
+        case VTK_UNSIGNED_CHAR:
+        case VTK_SIGNED_CHAR: return 1;
+        case VTK_SHORT:
+        case VTK_UNSIGNED_SHORT: return 2;
+        default: return 4;
+    }
+}
+
+} // namespace
+
+ParallelDICOMReader::ParallelDICOMReader()
+    : threads(0), cancelFlag(nullptr), indexCache(nullptr), activePhase(0), outputScalarType(VTK_VOID), components(1),
+      reusedHeaders(0), parsedHeaders(0), decodedSlices(0), headerTime(0.0), decodeTime(0.0)
+{
+    dims[0] = dims[1] = dims[2] = 0;
+    std::fill(volumeSpacing, volumeSpacing + 3, 1.0);
+    std::fill(volumeOrigin, volumeOrigin + 3, 0.0);
+}
+
+void ParallelDICOMReader::setThreadCount(int count) {
+    threads = count;
+}
+
+int ParallelDICOMReader::threadCount() const {
+    return threads > 0 ? threads : defaultThreadCount();
+}
+
+void ParallelDICOMReader::setProgressCallback(ProgressCallback callback) {
+    progressCallback = std::move(callback);
+}
+
+void ParallelDICOMReader::setCancelFlag(const std::atomic<bool> *flag) {
+    cancelFlag = flag;
+}
+
+void ParallelDICOMReader::setIndexCache(const SeriesIndexCache *cache) {
+    indexCache = cache;
+}
+
+void ParallelDICOMReader::setSliceCallback(SliceCallback callback) {
+    sliceCallback = std::move(callback);
+}
+
+bool ParallelDICOMReader::wasCanceled() const {
+    return cancelFlag && *cancelFlag;
+}
+
+void ParallelDICOMReader::reportProgress(int current, int total, const char *stage) const {
+    if (progressCallback) {
+        progressCallback(current, total, stage);
+    }
+}
+
+bool ParallelDICOMReader::scanDirectory(const std::string &dirPath) {
+    TRACE_SCOPE("ParallelDICOMReader::scanDirectory");
+    auto start = std::chrono::steady_clock::now();
+    phaseSlices.clear();
+    sortedSlices.clear();
+    activePhase = 0;
+    error.clear();
+    reusedHeaders = 0;
+    parsedHeaders = 0;
+
+    // 列出目录文件及其大小、修改时间，作为索引是否失效的依据
+    SeriesIndex index;
+    index.dirPath = dirPath;
+    std::error_code ec;
+    for (const auto &entry : std::filesystem::directory_iterator(std::filesystem::u8path(dirPath), ec)) {
+        if (entry.is_regular_file(ec)) {
+            SeriesIndexEntry file;
+            file.fileName = entry.path().u8string();
+            file.size = entry.file_size(ec);
+            file.modifiedTime = static_cast<int64_t>(entry.last_write_time(ec).time_since_epoch().count());
+            index.files.push_back(std::move(file));
+        }
+    }
+    if (ec) {
+        error = "无法读取目录: " + dirPath;
+        return false;
+    }
+    std::sort(index.files.begin(), index.files.end(),
+        [](const SeriesIndexEntry &a, const SeriesIndexEntry &b) { return a.fileName < b.fileName; });
+
+    // 未变化的文件直接复用索引中的头信息，只重新解析新增或修改过的文件
+    SeriesIndex previous;
+    const bool haveIndex = indexCache && indexCache->load(dirPath, previous);
+    std::unordered_map<std::string, const SeriesIndexEntry *> previousFiles;
+    if (haveIndex) {
+        for (const SeriesIndexEntry &file : previous.files) {
+            previousFiles[file.fileName] = &file;
+        }
+    }
+    std::vector<int> toParse;
+    for (int i = 0; i < static_cast<int>(index.files.size()); ++i) {
+        SeriesIndexEntry &file = index.files[i];
+        auto it = previousFiles.find(file.fileName);
+        if (it != previousFiles.end() && it->second->size == file.size && it->second->modifiedTime == file.modifiedTime) {
+            file.isDicom = it->second->isDicom;
+            file.info = it->second->info;
+        } else {
+            toParse.push_back(i);
+        }
+    }
+    reusedHeaders = static_cast<int>(index.files.size() - toParse.size());
+    parsedHeaders = static_cast<int>(toParse.size());
+
+    // 并行解析文件头，非DICOM文件直接跳过
+    const int total = static_cast<int>(toParse.size());
+    std::atomic<int> done(0);
+    parallelFor(0, total, [&](int i, int) {
+        if (wasCanceled()) {
+            return;
+        }
+        SeriesIndexEntry &file = index.files[toParse[i]];
+        file.isDicom = parseDicomHeader(file.fileName, file.info);
+        reportProgress(++done, total, "读取文件头");
+    }, threadCount());
+
+    if (wasCanceled()) {
+        return false;
+    }
+
+    // 目录完全未变化：直接恢复上次的切片顺序和几何信息，跳过分组和排序
+    if (haveIndex && toParse.empty() && previous.files.size() == index.files.size()
+        && !previous.sortedSlices.empty() && restoreFromIndex(previous)) {
+        headerTime = secondsSince(start);
+        return true;
+    }
+
+    // 一个目录中可能混有多个序列，取切片最多的一组
+    std::map<std::tuple<std::string, int, int>, int> groupSizes;
+    for (const SeriesIndexEntry &file : index.files) {
+        if (file.isDicom) {
+            ++groupSizes[std::make_tuple(file.info.seriesInstanceUID, file.info.rows, file.info.columns)];
+        }
+    }
+    if (groupSizes.empty()) {
+        error = "无法读取DICOM数据或数据为空!";
+        return false;
+    }
+    auto largest = std::max_element(groupSizes.begin(), groupSizes.end(),
+        [](const auto &a, const auto &b) { return a.second < b.second; });
+    std::vector<DicomSliceInfo> series;
+    for (const SeriesIndexEntry &file : index.files) {
+        if (file.isDicom && std::make_tuple(file.info.seriesInstanceUID, file.info.rows, file.info.columns) == largest->first) {
+            series.push_back(file.info);
+        }
+    }
+    phaseSlices = splitPhases(std::move(series));
+
+    bool ok = computeGeometry();
+    if (ok && indexCache) {
+        for (const std::vector<DicomSliceInfo> &phase : phaseSlices) {
+            for (const DicomSliceInfo &slice : phase) {
+                index.sortedSlices.push_back(slice.fileName);
+            }
+        }
+        std::copy(dims, dims + 3, index.dimensions);
+        std::copy(volumeSpacing, volumeSpacing + 3, index.spacing);
+        std::copy(volumeOrigin, volumeOrigin + 3, index.origin);
+        index.scalarType = outputScalarType;
+        index.components = components;
+        index.phases = phaseCount();
+        indexCache->save(index);
+    }
+    headerTime = secondsSince(start);
+    return ok;
+}
+
+// 按索引中保存的顺序重建各时相的切片列表，并恢复几何信息
+bool ParallelDICOMReader::restoreFromIndex(const SeriesIndex &index) {
+    const size_t perPhase = static_cast<size_t>(std::max(0, index.dimensions[2]));
+    if (index.phases < 1 || perPhase == 0 || perPhase * index.phases != index.sortedSlices.size()) {
+        return false;
+    }
+    std::unordered_map<std::string, const DicomSliceInfo *> infos;
+    for (const SeriesIndexEntry &file : index.files) {
+        if (file.isDicom) {
+            infos[file.fileName] = &file.info;
+        }
+    }
+    phaseSlices.assign(index.phases, std::vector<DicomSliceInfo>());
+    for (size_t i = 0; i < index.sortedSlices.size(); ++i) {
+        auto it = infos.find(index.sortedSlices[i]);
+        if (it == infos.end()) {
+            phaseSlices.clear();
+            return false;
+        }
+        phaseSlices[i / perPhase].push_back(*it->second);
+    }
+    sortedSlices = phaseSlices.front();
+
+    std::copy(index.dimensions, index.dimensions + 3, dims);
+    std::copy(index.spacing, index.spacing + 3, volumeSpacing);
+    std::copy(index.origin, index.origin + 3, volumeOrigin);
+    outputScalarType = index.scalarType;
+    components = index.components;
+    return true;
+}
+
+bool ParallelDICOMReader::selectPhase(int phase) {
+    if (phase < 0 || phase >= phaseCount()) {
+        error = "时相编号无效";
+        return false;
+    }
+    activePhase = phase;
+    sortedSlices = phaseSlices[phase];
+    return true;
+}
+
+double ParallelDICOMReader::phaseTriggerTime(int phase) const {
+    if (phase < 0 || phase >= phaseCount()) {
+        return -1.0;
+    }
+    double sum = 0.0;
+    for (const DicomSliceInfo &slice : phaseSlices[phase]) {
+        if (slice.triggerTime < 0.0) {
+            return -1.0;
+        }
+        sum += slice.triggerTime;
+    }
+    return sum / phaseSlices[phase].size();
+}
+
+// 各时相沿切片法向排序，并按第一个时相确定尺寸、间距和原点；输出类型取决于所有时相的 Rescale
+bool ParallelDICOMReader::computeGeometry() {
+    double normal[3];
+    sliceNormal(phaseSlices.front().front(), normal);
+    auto position = [&normal](const DicomSliceInfo &s) {
+        return slicePosition(s, normal);
+    };
+    for (std::vector<DicomSliceInfo> &phase : phaseSlices) {
+        std::stable_sort(phase.begin(), phase.end(),
+            [&position](const DicomSliceInfo &a, const DicomSliceInfo &b) {
+                double pa = position(a), pb = position(b);
+                return pa != pb ? pa < pb : a.instanceNumber < b.instanceNumber;
+            });
+    }
+    sortedSlices = phaseSlices.front();
+
+    const DicomSliceInfo &front = sortedSlices.front();
+    const int n = static_cast<int>(sortedSlices.size());
+    dims[0] = front.columns;
+    dims[1] = front.rows;
+    dims[2] = n;
+    components = front.samplesPerPixel;
+
+    // PixelSpacing 依次为行间距(y)和列间距(x)
+    volumeSpacing[0] = front.pixelSpacing[1];
+    volumeSpacing[1] = front.pixelSpacing[0];
+    volumeSpacing[2] = front.sliceThickness;
+    if (n > 1) {
+        double zSpacing = (position(sortedSlices.back()) - position(front)) / (n - 1);
+        if (zSpacing > 0.0) {
+            volumeSpacing[2] = zSpacing;
+        }
+    }
+    std::copy(front.imagePosition, front.imagePosition + 3, volumeOrigin);
+
+    // 与 vtkDICOMImageReader 相同的类型规则：非整数Rescale输出float，带符号或负截距输出short
+    bool needFloat = false, needSigned = false;
+    for (const std::vector<DicomSliceInfo> &phase : phaseSlices) {
+        for (const DicomSliceInfo &s : phase) {
+            needFloat = needFloat || !isIntegral(s.rescaleSlope) || !isIntegral(s.rescaleIntercept);
+            needSigned = needSigned || s.pixelRepresentation == 1 || s.rescaleIntercept < 0.0;
+        }
+    }
+    if (needFloat) {
+        outputScalarType = VTK_FLOAT;
+    } else {
+        switch (front.bitsAllocated) {
+            case 8: outputScalarType = needSigned ? VTK_SHORT : VTK_UNSIGNED_CHAR; break;
+            case 16: outputScalarType = needSigned ? VTK_SHORT : VTK_UNSIGNED_SHORT; break;
+            case 32: outputScalarType = needSigned ? VTK_INT : VTK_UNSIGNED_INT; break;
+            default:
+                error = "不支持的BitsAllocated: " + std::to_string(front.bitsAllocated);
+                return false;
+        }
+    }
+    return true;
+}
+
+vtkSmartPointer<vtkImageData> ParallelDICOMReader::readVolume() {
+    vtkSmartPointer<vtkImageData> image = allocateVolume(false);
+    if (!image) {
+        return nullptr;
+    }
+    std::vector<int> slices(dims[2]);
+    for (int z = 0; z < dims[2]; ++z) {
+        slices[z] = z;
+    }
+    return decodeSlices(image, slices) ? image : nullptr;
+}
+
+// 按 scanDirectory 得到的几何信息预分配体数据；渐进加载时先清零，未解码的切片显示为空
+vtkSmartPointer<vtkImageData> ParallelDICOMReader::allocateVolume(bool zeroFill) {
+    if (sortedSlices.empty() || outputScalarType == VTK_VOID) {
+        error = "没有可读取的切片";
+        return nullptr;
+    }
+    decodedSlices = 0;
+    decodeTime = 0.0;
+    resetHistogram();
+
+    vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+    image->SetDimensions(dims);
+    image->SetSpacing(volumeSpacing);
+    image->SetOrigin(volumeOrigin);
+    image->AllocateScalars(outputScalarType, components);
+
+    if (zeroFill) {
+        const size_t sliceBytes = static_cast<size_t>(dims[0]) * dims[1] * components * scalarSize(outputScalarType);
+        char *base = static_cast<char *>(image->GetScalarPointer());
+        parallelFor(0, dims[2], [&](int z, int) {
+            std::memset(base + sliceBytes * z, 0, sliceBytes);
+        }, threadCount());
+    }
+    return image;
+}
+
+// 分块存储按层块流式解码时不分配整个体数据，只清空计数和直方图
+bool ParallelDICOMReader::beginStreaming() {
+    if (sortedSlices.empty() || outputScalarType == VTK_VOID) {
+        error = "没有可读取的切片";
+        return false;
+    }
+    decodedSlices = 0;
+    decodeTime = 0.0;
+    resetHistogram();
+    return true;
+}
+
+bool ParallelDICOMReader::decodeRange(char *dest, int z0, int z1) {
+    std::vector<int> slices;
+    for (int z = std::max(0, z0); z < std::min(z1, dims[2]); ++z) {
+        slices.push_back(z);
+    }
+    return decodeInto(dest, z0, slices);
+}
+
+// 并行解码指定切片到预分配体数据中各自的z偏移处；任务按列表顺序领取，靠前的切片先完成
+bool ParallelDICOMReader::decodeSlices(vtkImageData *image, const std::vector<int> &slices) {
+    return decodeInto(static_cast<char *>(image->GetScalarPointer()), 0, slices);
+}
+
+// base 处存放第 baseZ 层，切片 z 解码到 base + (z - baseZ) 层的位置
+bool ParallelDICOMReader::decodeInto(char *base, int baseZ, const std::vector<int> &slices) {
+    TRACE_SCOPE("ParallelDICOMReader::decodeSlices");
+    auto start = std::chrono::steady_clock::now();
+    const size_t sliceBytes = static_cast<size_t>(dims[0]) * dims[1] * components * scalarSize(outputScalarType);
+
+    const int total = dims[2];
+    const int workers = threadCount();
+    const size_t sliceValues = static_cast<size_t>(dims[0]) * dims[1] * components;
+    std::vector<DecodeBuffers> buffers(workers);
+    try {
+        parallelFor(0, static_cast<int>(slices.size()), [&](int i, int threadIndex) {
+            if (wasCanceled()) {
+                return;
+            }
+            const int z = slices[i];
+            char *dest = base + sliceBytes * (z - baseZ);
+            decodeSlice(z, dest, buffers[threadIndex]);
+            valueHistogram.add(buffers[threadIndex].histogram, dest, outputScalarType, sliceValues);
+            reportProgress(++decodedSlices, total, "解码像素数据");
+            if (sliceCallback) {
+                sliceCallback(z);
+            }
+        }, workers);
+    } catch (std::exception &e) {
+        error = e.what();
+        return false;
+    }
+
+    for (const DecodeBuffers &buffer : buffers) {
+        valueHistogram.merge(buffer.histogram);
+    }
+    decodeTime += secondsSince(start);
+    return !wasCanceled();
+}
+
+// 各切片存储值的范围经 Rescale 后取并集，整数输出时每个灰度一个区间
+// 范围覆盖所有时相，各时相的直方图区间一致，可以直接合并
+void ParallelDICOMReader::resetHistogram() {
+    double typeLo, typeHi;
+    scalarTypeRange(outputScalarType, typeLo, typeHi);
+    double lo = typeHi, hi = typeLo;
+    for (const std::vector<DicomSliceInfo> &phase : phaseSlices) {
+        for (const DicomSliceInfo &s : phase) {
+            const double bits = s.bitsAllocated;
+            const double storedLo = s.pixelRepresentation == 1 ? -std::pow(2.0, bits - 1) : 0.0;
+            const double storedHi = s.pixelRepresentation == 1 ? std::pow(2.0, bits - 1) - 1.0 : std::pow(2.0, bits) - 1.0;
+            const double a = storedLo * s.rescaleSlope + s.rescaleIntercept;
+            const double b = storedHi * s.rescaleSlope + s.rescaleIntercept;
+            lo = std::min(lo, std::min(a, b));
+            hi = std::max(hi, std::max(a, b));
+        }
+    }
+    valueHistogram.setRange(std::max(lo, typeLo), std::min(hi, typeHi), outputScalarType != VTK_FLOAT);
+}
+
+// 解码单个切片到目标位置；原始类型与输出类型宽度相同时直接读入目标内存并原地转换
+// 压缩切片 (RLE / JPEG Lossless) 在当前工作线程内解码，之后与未压缩数据走相同的翻转和重标定
+void ParallelDICOMReader::decodeSlice(int z, char *dest, DecodeBuffers &buffers) const {
+    TRACE_SCOPE("decodeSlice");
+    const DicomSliceInfo &s = sortedSlices[z];
+    const bool native = isNativeTransferSyntax(s.transferSyntaxUID);
+    if (!native && !isEncapsulatedTransferSyntax(s.transferSyntaxUID)) {
+        throw std::runtime_error("不支持的压缩传输语法: " + s.transferSyntaxUID + " (" + s.fileName + ")");
+    }
+
+    const int bytesPerSample = s.bitsAllocated / 8;
+    const size_t count = static_cast<size_t>(s.rows) * s.columns * s.samplesPerPixel;
+    const size_t rawBytes = count * bytesPerSample;
+    if (native && s.pixelDataLength < rawBytes) {
+        throw std::runtime_error("像素数据长度不足: " + s.fileName);
+    }
+
+    const bool inPlace = bytesPerSample == scalarSize(outputScalarType) && outputScalarType != VTK_FLOAT;
+    char *raw = dest;
+    if (!inPlace) {
+        buffers.raw.resize(rawBytes);
+        raw = buffers.raw.data();
+    }
+
+    std::ifstream in(std::filesystem::u8path(s.fileName), std::ios::binary);
+    if (native) {
+        in.seekg(static_cast<std::streamoff>(s.pixelDataOffset));
+        if (!in.read(raw, static_cast<std::streamsize>(rawBytes))) {
+            throw std::runtime_error("读取像素数据失败: " + s.fileName);
+        }
+    } else {
+        // 封装数据长度未定义，读到文件末尾，由序列结束标记确定实际范围
+        in.seekg(0, std::ios::end);
+        const std::streamoff fileSize = in.tellg();
+        const std::streamoff offset = static_cast<std::streamoff>(s.pixelDataOffset);
+        if (!in || fileSize < offset) {
+            throw std::runtime_error("读取像素数据失败: " + s.fileName);
+        }
+        buffers.encoded.resize(static_cast<size_t>(fileSize - offset));
+        in.seekg(offset);
+        if (!in.read(buffers.encoded.data(), static_cast<std::streamsize>(buffers.encoded.size()))) {
+            throw std::runtime_error("读取像素数据失败: " + s.fileName);
+        }
+
+        PixelLayout layout;
+        layout.rows = s.rows;
+        layout.columns = s.columns;
+        layout.samplesPerPixel = s.samplesPerPixel;
+        layout.bitsAllocated = s.bitsAllocated;
+        try {
+            readEncapsulatedFrame(buffers.encoded.data(), buffers.encoded.size(), buffers.frame);
+            decodeEncapsulatedFrame(s.transferSyntaxUID, buffers.frame.data(), buffers.frame.size(), layout, raw);
+        } catch (std::exception &e) {
+            throw std::runtime_error(std::string(e.what()) + " (" + s.fileName + ")");
+        }
+    }
+
+    flipRows(raw, static_cast<size_t>(s.columns) * s.samplesPerPixel * bytesPerSample, s.rows);
+    rescaleRaw(s.bitsAllocated, s.pixelRepresentation, outputScalarType,
+               raw, dest, count, s.rescaleSlope, s.rescaleIntercept);
+}
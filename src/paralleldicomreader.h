@@ -0,0 +1,111 @@
+#ifndef PARALLELDICOMREADER_H
+#define PARALLELDICOMREADER_H
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+
+#include "dicomparser.h"
+#include "seriesindexcache.h"
+#include "volumehistogram.h"
+
+// 多线程DICOM序列读取器
+// 先并行只读文件头确定切片顺序和体数据几何，再预分配一个vtkImageData，
+// 由线程池把每个切片直接解码到各自的z偏移处，不经过中间整体拷贝。
+// 设置索引缓存后，目录未变化时直接使用缓存的切片顺序和几何信息。
+// 输出与vtkDICOMImageReader一致：应用Rescale，行序自下而上。
+// 每个切片解码后趁数据还在缓存中统计灰度直方图，读取完成时直方图也已就绪。
+// 多时相序列 (心脏、灌注) 按时相拆成几何相同的若干组切片，每次读取其中选中的一个时相。
+class ParallelDICOMReader {
+public:
+    using ProgressCallback = std::function<void(int current, int total, const char *stage)>;
+    using SliceCallback = std::function<void(int z)>;
+
+    ParallelDICOMReader();
+
+    void setThreadCount(int count);   // <=0 表示使用全部硬件线程
+    int threadCount() const;
+    void setProgressCallback(ProgressCallback callback); // 可能在工作线程中被调用
+    void setCancelFlag(const std::atomic<bool> *flag);
+    void setIndexCache(const SeriesIndexCache *cache); // 可选：复用未变化文件的头信息
+    void setSliceCallback(SliceCallback callback); // 每解码完一个切片调用一次，可能在工作线程中
+
+    // 第一遍：并行解析目录中所有文件头，选出切片最多的序列，按时相分组并排序
+    bool scanDirectory(const std::string &dirPath);
+
+    // 多时相序列的时相数，各时相的尺寸、间距和输出类型相同；scanDirectory 后默认选中第一个时相
+    int phaseCount() const { return static_cast<int>(phaseSlices.size()); }
+    int currentPhase() const { return activePhase; }
+    bool selectPhase(int phase); // 之后的读取和解码都针对该时相
+    double phaseTriggerTime(int phase) const; // 时相内切片 TriggerTime 的平均值 (ms)，文件中没有时返回 -1
+    // 第二遍：预分配体数据并并行解码像素，失败或取消时返回nullptr
+    vtkSmartPointer<vtkImageData> readVolume();
+
+    // 分步读取，供渐进加载按自定义顺序分批解码
+    vtkSmartPointer<vtkImageData> allocateVolume(bool zeroFill);
+    bool decodeSlices(vtkImageData *image, const std::vector<int> &slices);
+    // 按层块流式解码，供核外分块存储使用：beginStreaming 代替 allocateVolume，
+    // decodeRange 把 [z0, z1) 层解码到 dest (第 z0 层在开头)，直方图照常累计
+    bool beginStreaming();
+    bool decodeRange(char *dest, int z0, int z1);
+
+    const std::vector<DicomSliceInfo> &slices() const { return sortedSlices; }
+    const int *dimensions() const { return dims; }
+    const double *spacing() const { return volumeSpacing; }
+    const double *origin() const { return volumeOrigin; }
+    int scalarType() const { return outputScalarType; }
+    int numberOfComponents() const { return components; }
+
+    const std::string &errorMessage() const { return error; }
+    bool wasCanceled() const;
+    int reusedHeaderCount() const { return reusedHeaders; } // 从索引复用的文件数
+    int parsedHeaderCount() const { return parsedHeaders; } // 本次重新解析的文件数
+    double headerSeconds() const { return headerTime; }
+    double decodeSeconds() const { return decodeTime; }
+    // 已解码切片的灰度直方图，范围由文件头的位数和 Rescale 推出，allocateVolume 时清空
+    const VolumeHistogram &histogram() const { return valueHistogram; }
+
+private:
+    void reportProgress(int current, int total, const char *stage) const;
+    bool computeGeometry();
+    bool restoreFromIndex(const SeriesIndex &index);
+    // 每个工作线程复用的临时缓冲区
+    struct DecodeBuffers {
+        std::vector<char> raw;     // 需要类型转换时的原始像素
+        std::vector<char> encoded; // 封装格式：像素数据元素的值
+        std::vector<char> frame;   // 封装格式：拼接后的第一帧码流
+        VolumeHistogram::Partial histogram;
+    };
+    void decodeSlice(int z, char *dest, DecodeBuffers &buffers) const;
+    bool decodeInto(char *base, int baseZ, const std::vector<int> &slices);
+    void resetHistogram();
+
+    int threads;
+    ProgressCallback progressCallback;
+    SliceCallback sliceCallback;
+    const std::atomic<bool> *cancelFlag;
+    const SeriesIndexCache *indexCache;
+
+    std::vector<std::vector<DicomSliceInfo>> phaseSlices; // 各时相按切片位置排序
+    std::vector<DicomSliceInfo> sortedSlices;             // 当前时相
+    int activePhase;
+    int dims[3];
+    double volumeSpacing[3];
+    double volumeOrigin[3];
+    int outputScalarType;
+    int components;
+
+    std::string error;
+    int reusedHeaders;
+    int parsedHeaders;
+    std::atomic<int> decodedSlices;
+    double headerTime;
+    double decodeTime;
+    VolumeHistogram valueHistogram;
+};
+
+#endif // PARALLELDICOMREADER_H
@@ -0,0 +1,140 @@
+#ifndef PARALLELFOR_H
+#define PARALLELFOR_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 默认线程数：硬件并发数，至少为1
+inline int defaultThreadCount() {
+    unsigned int n = std::thread::hardware_concurrency();
+    return n > 0 ? static_cast<int>(n) : 1;
+}
+
+// 进程内共享的常驻工作线程，第一次 parallelFor 时创建 (硬件并发数减一个，调用线程自己也参与计算)
+// 切片切换、旋转、光线投射等每帧都会调用 parallelFor，不能每次都创建和回收线程
+class ThreadPool {
+public:
+    static ThreadPool &instance() {
+        // 故意不释放：退出时工作线程阻塞在条件变量上，随进程结束，避免静态析构时等待线程
+        static ThreadPool *pool = new ThreadPool(std::max(1, defaultThreadCount() - 1));
+        return *pool;
+    }
+
+    void submit(std::function<void()> job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(std::move(job));
+        }
+        wake.notify_one();
+    }
+
+    int size() const { return static_cast<int>(workers.size()); }
+
+private:
+    explicit ThreadPool(int count) {
+        workers.reserve(count);
+        for (int i = 0; i < count; ++i) {
+            workers.emplace_back([this] { run(); });
+            workers.back().detach();
+        }
+    }
+
+    void run() {
+        for (;;) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this] { return !jobs.empty(); });
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            job();
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<std::function<void()>> jobs;
+    std::vector<std::thread> workers;
+};
+
+// 在多个线程上对 [begin, end) 中的每个下标调用 fn(index, threadIndex)，threadIndex 在 [0, threadCount) 内且各线程不同
+// 任务按下标动态领取，切片大小不均时也能保持负载均衡；工作线程抛出的第一个异常在返回前重新抛出
+// 调用线程领取下标，同时向线程池提交最多 threadCount - 1 个协助任务；调用线程做完后关闭这次循环，
+// 只等待已经开始的协助任务，尚未轮到的任务出队后直接返回。因此在线程池的任务中嵌套调用 parallelFor 也不会死锁
+template <typename Fn>
+void parallelFor(int begin, int end, Fn &&fn, int threadCount = 0) {
+    if (end <= begin) {
+        return;
+    }
+    if (threadCount <= 0) {
+        threadCount = defaultThreadCount();
+    }
+    threadCount = std::min(threadCount, end - begin);
+
+    // 协助任务可能在本次调用返回后才出队，共享状态由任务持有
+    struct Loop {
+        std::atomic<int> next{0};
+        int end = 0;
+        std::mutex mutex;
+        std::condition_variable done;
+        int active = 0;   // 正在运行的协助任务
+        bool closed = false;
+        std::exception_ptr firstError;
+    };
+    auto loop = std::make_shared<Loop>();
+    loop->next = begin;
+    loop->end = end;
+
+    auto work = [&fn](Loop &state, int threadIndex) {
+        try {
+            for (int i = state.next++; i < state.end; i = state.next++) {
+                fn(i, threadIndex);
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            if (!state.firstError) {
+                state.firstError = std::current_exception();
+            }
+            state.next = state.end; // 让其他线程尽快停止
+        }
+    };
+
+    if (threadCount > 1) {
+        ThreadPool &pool = ThreadPool::instance();
+        for (int t = 1; t < threadCount; ++t) {
+            pool.submit([loop, &work, t]() {
+                {
+                    std::lock_guard<std::mutex> lock(loop->mutex);
+                    if (loop->closed) {
+                        return; // 调用线程已经做完，fn 和 work 可能已不存在
+                    }
+                    ++loop->active;
+                }
+                work(*loop, t);
+                std::lock_guard<std::mutex> lock(loop->mutex);
+                if (--loop->active == 0) {
+                    loop->done.notify_all();
+                }
+            });
+        }
+    }
+    work(*loop, 0); // 调用线程也参与计算
+
+    std::unique_lock<std::mutex> lock(loop->mutex);
+    loop->closed = true;
+    loop->done.wait(lock, [&loop] { return loop->active == 0; });
+    if (loop->firstError) {
+        std::rethrow_exception(loop->firstError);
+    }
+}
+
+#endif // PARALLELFOR_H
@@ -0,0 +1,117 @@
+#include "renderscheduler.h"
+#include "tracer.h"
+
+#include <QGuiApplication>
+#include <QScreen>
+
+#include <vtkRenderWindow.h>
+
+#include <algorithm>
+#include <cmath>
+
+RenderScheduler::RenderScheduler(QObject *parent)
+    : QObject(parent), intervalMs(16)
+{
+    // 帧间隔跟随主屏幕刷新率
+    if (QScreen *screen = QGuiApplication::primaryScreen()) {
+        if (screen->refreshRate() > 1.0) {
+            intervalMs = std::max(1, static_cast<int>(std::floor(1000.0 / screen->refreshRate())));
+        }
+    }
+    frameTimer.setSingleShot(true);
+    frameTimer.setTimerType(Qt::PreciseTimer);
+    connect(&frameTimer, &QTimer::timeout, this, &RenderScheduler::renderFrame);
+}
+
+int RenderScheduler::addView(vtkRenderWindow *window) {
+    views.push_back(View{window, false, nullptr});
+    return static_cast<int>(views.size()) - 1;
+}
+
+void RenderScheduler::requestRender(int view) {
+    ++stats.requests;
+    if (views[view].dirty) {
+        ++stats.merged;
+        return;
+    }
+    views[view].dirty = true;
+    schedule();
+}
+
+void RenderScheduler::requestUpdate(int view, std::function<void()> update) {
+    ++stats.requests;
+    View &v = views[view];
+    if (v.update) {
+        ++stats.dropped;
+    }
+    v.update = std::move(update);
+    if (v.dirty) {
+        ++stats.merged;
+        return;
+    }
+    v.dirty = true;
+    schedule();
+}
+
+// 距上一帧不足一个帧间隔时等到下一帧，否则立即渲染
+void RenderScheduler::schedule() {
+    if (frameTimer.isActive()) {
+        return;
+    }
+    int wait = 0;
+    if (sinceLastFrame.isValid()) {
+        wait = std::max<qint64>(0, intervalMs - sinceLastFrame.elapsed());
+    }
+    frameTimer.start(wait);
+}
+
+void RenderScheduler::renderFrame() {
+    QElapsedTimer frame;
+    frame.start();
+    sinceLastFrame.start();
+    const bool tracing = Tracer::enabled();
+    if (tracing) {
+        Tracer::instance().beginFrame();
+    }
+
+    {
+        TRACE_SCOPE("frame");
+        for (View &view : views) {
+            if (!view.dirty) {
+                continue;
+            }
+            // 先取出状态再执行，更新或渲染过程中到达的新请求留给下一帧
+            view.dirty = false;
+            std::function<void()> update = std::move(view.update);
+            view.update = nullptr;
+            if (update) {
+                TRACE_SCOPE("view update");
+                update();
+            }
+            TRACE_SCOPE("Render");
+            view.window->Render();
+            ++stats.renders;
+        }
+    }
+
+    ++stats.frames;
+    stats.lastFrameMs = frame.nsecsElapsed() / 1.0e6;
+    stats.maxFrameMs = std::max(stats.maxFrameMs, stats.lastFrameMs);
+    if (tracing) {
+        Tracer::instance().endFrame();
+    }
+    emit frameFinished();
+}
+
+void RenderScheduler::flush() {
+    frameTimer.stop();
+    renderFrame();
+}
+
+void RenderScheduler::setFrameInterval(int ms) {
+    intervalMs = std::max(1, ms);
+}
+
+void RenderScheduler::resetCounters() {
+    stats = Counters();
+}
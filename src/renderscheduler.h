@@ -0,0 +1,65 @@
+#ifndef RENDERSCHEDULER_H
+#define RENDERSCHEDULER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+
+#include <functional>
+#include <vector>
+
+class vtkRenderWindow;
+
+// 按显示帧节奏合并渲染请求
+// 滑块、不透明度和窗口缩放等事件只把视图标记为待渲染，并登记渲染前要执行的更新；
+// 每个显示帧最多执行一次各视图最新的更新并渲染一次，中间被覆盖的更新不再执行。
+class RenderScheduler : public QObject {
+    Q_OBJECT
+
+public:
+    struct Counters {
+        quint64 requests = 0;  // 收到的渲染和更新请求
+        quint64 merged = 0;    // 视图已待渲染时到达、并入同一帧的请求
+        quint64 dropped = 0;   // 执行前就被更新的请求替换掉的更新
+        quint64 frames = 0;    // 执行过的帧
+        quint64 renders = 0;   // 实际的 Render() 次数
+        double lastFrameMs = 0.0;
+        double maxFrameMs = 0.0;
+    };
+
+    explicit RenderScheduler(QObject *parent = nullptr);
+
+    int addView(vtkRenderWindow *window); // 返回视图编号
+    void requestRender(int view);
+    // 登记下一帧渲染该视图前执行的更新，替换尚未执行的旧更新
+    void requestUpdate(int view, std::function<void()> update);
+    void flush(); // 立即执行所有待处理的更新并渲染，用于需要同步结果的场合
+
+    void setFrameInterval(int ms);
+    int frameInterval() const { return intervalMs; }
+    const Counters &counters() const { return stats; }
+    void resetCounters();
+
+signals:
+    void frameFinished(); // 每帧的更新和渲染全部完成后发出
+
+private slots:
+    void renderFrame();
+
+private:
+    struct View {
+        vtkRenderWindow *window;
+        bool dirty;
+        std::function<void()> update;
+    };
+
+    void schedule();
+
+    std::vector<View> views;
+    QTimer frameTimer;
+    QElapsedTimer sinceLastFrame;
+    int intervalMs;
+    Counters stats;
+};
+
+#endif // RENDERSCHEDULER_H
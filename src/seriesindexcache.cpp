@@ -0,0 +1,233 @@
+#include "seriesindexcache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <type_traits>
+
+namespace {
+
+const char INDEX_MAGIC[8] = {'D', 'V', 'I', 'D', 'X', 0, 0, 2};
+
+// 64位 FNV-1a，用于把目录路径映射为索引文件名
+uint64_t hashBytes(const void *data, size_t size, uint64_t hash = 1469598103934665603ull) {
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+uint64_t hashPath(const std::string &path) {
+    return hashBytes(path.data(), path.size());
+}
+
+class BinaryWriter {
+public:
+    explicit BinaryWriter(std::ofstream &out) : out(out) {}
+
+    template <typename T>
+    void pod(const T &value) {
+        static_assert(std::is_trivially_copyable<T>::value, "POD only");
+        out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+    void string(const std::string &value) {
+        pod(static_cast<uint32_t>(value.size()));
+        out.write(value.data(), static_cast<std::streamsize>(value.size()));
+    }
+
+    std::ofstream &out;
+};
+
+class BinaryReader {
+public:
+    explicit BinaryReader(std::ifstream &in) : in(in) {}
+
+    template <typename T>
+    bool pod(T &value) {
+        static_assert(std::is_trivially_copyable<T>::value, "POD only");
+        return static_cast<bool>(in.read(reinterpret_cast<char *>(&value), sizeof(T)));
+    }
+    bool string(std::string &value) {
+        uint32_t size = 0;
+        if (!pod(size) || size > (1u << 16)) {
+            return false;
+        }
+        value.resize(size);
+        return size == 0 || static_cast<bool>(in.read(&value[0], size));
+    }
+
+    std::ifstream &in;
+};
+
+void writeSliceInfo(BinaryWriter &w, const DicomSliceInfo &s) {
+    w.string(s.transferSyntaxUID);
+    w.string(s.seriesInstanceUID);
+    w.pod(s.rows);
+    w.pod(s.columns);
+    w.pod(s.samplesPerPixel);
+    w.pod(s.bitsAllocated);
+    w.pod(s.pixelRepresentation);
+    w.pod(s.instanceNumber);
+    w.pod(s.temporalPositionIdentifier);
+    w.pod(s.triggerTime);
+    w.pod(s.pixelSpacing);
+    w.pod(s.sliceThickness);
+    w.pod(s.imagePosition);
+    w.pod(s.imageOrientation);
+    w.pod(s.rescaleSlope);
+    w.pod(s.rescaleIntercept);
+    w.pod(s.pixelDataOffset);
+    w.pod(s.pixelDataLength);
+}
+
+bool readSliceInfo(BinaryReader &r, DicomSliceInfo &s) {
+    return r.string(s.transferSyntaxUID)
+        && r.string(s.seriesInstanceUID)
+        && r.pod(s.rows)
+        && r.pod(s.columns)
+        && r.pod(s.samplesPerPixel)
+        && r.pod(s.bitsAllocated)
+        && r.pod(s.pixelRepresentation)
+        && r.pod(s.instanceNumber)
+        && r.pod(s.temporalPositionIdentifier)
+        && r.pod(s.triggerTime)
+        && r.pod(s.pixelSpacing)
+        && r.pod(s.sliceThickness)
+        && r.pod(s.imagePosition)
+        && r.pod(s.imageOrientation)
+        && r.pod(s.rescaleSlope)
+        && r.pod(s.rescaleIntercept)
+        && r.pod(s.pixelDataOffset)
+        && r.pod(s.pixelDataLength);
+}
+
+} // namespace
+
+SeriesIndexCache::SeriesIndexCache(const std::string &cacheDir)
+    : cacheDir(cacheDir)
+{
+}
+
+std::string SeriesIndexCache::indexPath(const std::string &dirPath) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.idx", static_cast<unsigned long long>(hashPath(dirPath)));
+    return (std::filesystem::u8path(cacheDir) / name).u8string();
+}
+
+bool SeriesIndexCache::load(const std::string &dirPath, SeriesIndex &index) const {
+    std::ifstream in(std::filesystem::u8path(indexPath(dirPath)), std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    BinaryReader r(in);
+
+    char magic[8];
+    if (!in.read(magic, 8) || !std::equal(magic, magic + 8, INDEX_MAGIC)) {
+        return false; // 旧版本或损坏的索引
+    }
+
+    index = SeriesIndex();
+    uint32_t fileCount = 0, sliceCount = 0;
+    if (!r.string(index.dirPath) || index.dirPath != dirPath
+        || !r.pod(index.dimensions) || !r.pod(index.spacing) || !r.pod(index.origin)
+        || !r.pod(index.scalarType) || !r.pod(index.components) || !r.pod(index.phases)
+        || !r.pod(fileCount) || !r.pod(sliceCount)) {
+        return false;
+    }
+
+    index.files.resize(fileCount);
+    for (SeriesIndexEntry &entry : index.files) {
+        uint8_t isDicom = 0;
+        if (!r.string(entry.fileName) || !r.pod(entry.size) || !r.pod(entry.modifiedTime) || !r.pod(isDicom)) {
+            return false;
+        }
+        entry.isDicom = isDicom != 0;
+        entry.info.fileName = entry.fileName;
+        if (entry.isDicom && !readSliceInfo(r, entry.info)) {
+            return false;
+        }
+    }
+
+    index.sortedSlices.resize(sliceCount);
+    for (std::string &fileName : index.sortedSlices) {
+        if (!r.string(fileName)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SeriesIndexCache::save(const SeriesIndex &index) const {
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::u8path(cacheDir), ec);
+
+    // 先写临时文件再替换，避免中途退出留下半个索引
+    const std::string path = indexPath(index.dirPath);
+    const std::string tempPath = path + ".tmp";
+    {
+        std::ofstream out(std::filesystem::u8path(tempPath), std::ios::binary | std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+        BinaryWriter w(out);
+        out.write(INDEX_MAGIC, 8);
+        w.string(index.dirPath);
+        w.pod(index.dimensions);
+        w.pod(index.spacing);
+        w.pod(index.origin);
+        w.pod(index.scalarType);
+        w.pod(index.components);
+        w.pod(index.phases);
+        w.pod(static_cast<uint32_t>(index.files.size()));
+        w.pod(static_cast<uint32_t>(index.sortedSlices.size()));
+        for (const SeriesIndexEntry &entry : index.files) {
+            w.string(entry.fileName);
+            w.pod(entry.size);
+            w.pod(entry.modifiedTime);
+            w.pod(static_cast<uint8_t>(entry.isDicom ? 1 : 0));
+            if (entry.isDicom) {
+                writeSliceInfo(w, entry.info);
+            }
+        }
+        for (const std::string &fileName : index.sortedSlices) {
+            w.string(fileName);
+        }
+        if (!out) {
+            return false;
+        }
+    }
+    std::filesystem::rename(std::filesystem::u8path(tempPath), std::filesystem::u8path(path), ec);
+    return !ec;
+}
+
+void SeriesIndexCache::remove(const std::string &dirPath) const {
+    std::error_code ec;
+    std::filesystem::remove(std::filesystem::u8path(indexPath(dirPath)), ec);
+}
+
+uint64_t directoryFingerprint(const std::string &dirPath) {
+    std::vector<SeriesIndexEntry> files;
+    std::error_code ec;
+    for (const auto &entry : std::filesystem::directory_iterator(std::filesystem::u8path(dirPath), ec)) {
+        if (entry.is_regular_file(ec)) {
+            SeriesIndexEntry file;
+            file.fileName = entry.path().u8string();
+            file.size = entry.file_size(ec);
+            file.modifiedTime = static_cast<int64_t>(entry.last_write_time(ec).time_since_epoch().count());
+            files.push_back(std::move(file));
+        }
+    }
+    std::sort(files.begin(), files.end(),
+        [](const SeriesIndexEntry &a, const SeriesIndexEntry &b) { return a.fileName < b.fileName; });
+
+    uint64_t hash = hashPath(dirPath);
+    for (const SeriesIndexEntry &file : files) {
+        hash = hashBytes(file.fileName.data(), file.fileName.size(), hash);
+        hash = hashBytes(&file.size, sizeof(file.size), hash);
+        hash = hashBytes(&file.modifiedTime, sizeof(file.modifiedTime), hash);
+    }
+    return hash;
+}
@@ -0,0 +1,51 @@
+#ifndef SERIESINDEXCACHE_H
+#define SERIESINDEXCACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "dicomparser.h"
+
+// 目录中单个文件的索引条目，以路径、大小和修改时间判断文件是否变化
+struct SeriesIndexEntry {
+    std::string fileName;
+    uint64_t size = 0;
+    int64_t modifiedTime = 0;
+    bool isDicom = false;      // 非DICOM文件也记录下来，避免每次重新探测
+    DicomSliceInfo info;
+};
+
+// 一个目录的完整索引：全部文件条目 + 上次排序后的序列几何信息
+struct SeriesIndex {
+    std::string dirPath;
+    std::vector<SeriesIndexEntry> files;   // 按文件名排序
+    // 选中序列按切片位置排序后的文件名；多时相序列依次存放各时相，每个时相 dimensions[2] 个
+    std::vector<std::string> sortedSlices;
+    int dimensions[3] = {0, 0, 0};
+    double spacing[3] = {1.0, 1.0, 1.0};
+    double origin[3] = {0.0, 0.0, 0.0};
+    int scalarType = 0;
+    int components = 1;
+    int phases = 1;
+};
+
+// 持久化的序列索引缓存，每个目录对应缓存目录中的一个索引文件
+class SeriesIndexCache {
+public:
+    explicit SeriesIndexCache(const std::string &cacheDir);
+
+    bool load(const std::string &dirPath, SeriesIndex &index) const;
+    bool save(const SeriesIndex &index) const;
+    void remove(const std::string &dirPath) const;
+
+    std::string indexPath(const std::string &dirPath) const;
+
+private:
+    std::string cacheDir;
+};
+
+// 由目录中所有文件的路径、大小和修改时间计算出的指纹，任一文件变化都会改变指纹
+uint64_t directoryFingerprint(const std::string &dirPath);
+
+#endif // SERIESINDEXCACHE_H
@@ -0,0 +1,314 @@
+#include "slabprojector.h"
+#include "parallelfor.h"
+#include "tracer.h"
+
+#include <vtkSetGet.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+
+namespace {
+
+// 输出像素数乘以层数小于这个值时单线程完成
+const size_t PARALLEL_THRESHOLD = 1 << 20;
+const int ROWS_PER_TASK = 8;
+
+// 平板在体数据中的布局：输出第 (i, j) 个像素在第 k 层的体素位于 i * uStride + j * vStride + k * kStride
+struct SlabGeometry {
+    size_t uStride;
+    size_t vStride;
+    size_t kStride;
+    int width;
+    int height;
+};
+
+SlabGeometry slabGeometry(vtkImageData *volume, int axis) {
+    int dims[3];
+    volume->GetDimensions(dims);
+    const size_t nx = dims[0], nxy = static_cast<size_t>(dims[0]) * dims[1];
+    SlabGeometry g;
+    switch (axis) {
+        case 0: g = {nx, nxy, 1, dims[1], dims[2]}; break;   // 矢状面：Y, Z，层内连续
+        case 1: g = {1, nxy, nx, dims[0], dims[2]}; break;   // 冠状面：X, Z
+        default: g = {1, nx, nxy, dims[0], dims[1]}; break;  // 轴状面：X, Y
+    }
+    return g;
+}
+
+// 平均模式的累加类型：16 位以内的整数用 int32，三万层以内不会溢出
+template <typename T>
+using MeanSum = typename std::conditional<std::is_integral<T>::value,
+    typename std::conditional<sizeof(T) <= 2, std::int32_t, std::int64_t>::type, double>::type;
+
+template <typename T>
+struct MaxReduce {
+    using Acc = T;
+    static Acc merge(Acc a, T x) { return a < x ? x : a; }
+};
+
+template <typename T>
+struct MinReduce {
+    using Acc = T;
+    static Acc merge(Acc a, T x) { return x < a ? x : a; }
+};
+
+template <typename T>
+struct SumReduce {
+    using Acc = MeanSum<T>;
+    static Acc merge(Acc a, T x) { return a + x; }
+};
+
+template <typename Fn>
+void forEachRowBlock(const SlabGeometry &g, size_t layers, Fn &&fn) {
+    const int tasks = (g.height + ROWS_PER_TASK - 1) / ROWS_PER_TASK;
+    const size_t work = static_cast<size_t>(g.width) * g.height * layers;
+    parallelFor(0, tasks, [&](int task, int) {
+        const int j0 = task * ROWS_PER_TASK;
+        fn(j0, std::min(g.height, j0 + ROWS_PER_TASK));
+    }, work < PARALLEL_THRESHOLD ? 1 : 0);
+}
+
+// 完整归约 [first, last] 层。u 方向连续时逐层合并整行 (可向量化)；
+// 矢状面 u 方向跨步而层方向连续，改为每个像素沿层方向归约一段连续内存
+template <typename T, typename Reduce>
+void reduceRange(const T *in, typename Reduce::Acc *acc, const SlabGeometry &g, int first, int last) {
+    const size_t layers = static_cast<size_t>(last - first + 1);
+    forEachRowBlock(g, layers, [&](int j0, int j1) {
+        for (int j = j0; j < j1; ++j) {
+            const T *base = in + j * g.vStride + first * g.kStride;
+            typename Reduce::Acc *dst = acc + static_cast<size_t>(j) * g.width;
+            if (g.uStride == 1) {
+                for (int i = 0; i < g.width; ++i) {
+                    dst[i] = base[i];
+                }
+                for (size_t k = 1; k < layers; ++k) {
+                    const T *src = base + k * g.kStride;
+                    for (int i = 0; i < g.width; ++i) {
+                        dst[i] = Reduce::merge(dst[i], src[i]);
+                    }
+                }
+            } else {
+                for (int i = 0; i < g.width; ++i) {
+                    const T *src = base + i * g.uStride;
+                    typename Reduce::Acc value = src[0];
+                    for (size_t k = 1; k < layers; ++k) {
+                        value = Reduce::merge(value, src[k]);
+                    }
+                    dst[i] = value;
+                }
+            }
+        }
+    });
+}
+
+// 把第 slice 层合并进已有结果；平均模式 sign < 0 时从累加和中减去
+template <typename T, typename Reduce>
+void foldLayer(const T *in, typename Reduce::Acc *acc, const SlabGeometry &g, int slice, int sign) {
+    forEachRowBlock(g, 1, [&](int j0, int j1) {
+        for (int j = j0; j < j1; ++j) {
+            const T *src = in + j * g.vStride + slice * g.kStride;
+            typename Reduce::Acc *dst = acc + static_cast<size_t>(j) * g.width;
+            if (sign < 0) {
+                for (int i = 0; i < g.width; ++i) {
+                    dst[i] -= src[i * g.uStride];
+                }
+            } else {
+                for (int i = 0; i < g.width; ++i) {
+                    dst[i] = Reduce::merge(dst[i], src[i * g.uStride]);
+                }
+            }
+        }
+    });
+}
+
+template <typename T>
+void reduceSlab(const T *in, T *out, void *sums, const SlabGeometry &g, SlabProjector::Mode mode,
+                int first, int last) {
+    switch (mode) {
+        case SlabProjector::Maximum: reduceRange<T, MaxReduce<T>>(in, out, g, first, last); break;
+        case SlabProjector::Minimum: reduceRange<T, MinReduce<T>>(in, out, g, first, last); break;
+        case SlabProjector::Mean:
+            reduceRange<T, SumReduce<T>>(in, static_cast<MeanSum<T> *>(sums), g, first, last);
+            break;
+    }
+}
+
+template <typename T>
+void foldSlab(const T *in, T *out, void *sums, const SlabGeometry &g, SlabProjector::Mode mode,
+              int slice, int sign) {
+    switch (mode) {
+        case SlabProjector::Maximum: foldLayer<T, MaxReduce<T>>(in, out, g, slice, sign); break;
+        case SlabProjector::Minimum: foldLayer<T, MinReduce<T>>(in, out, g, slice, sign); break;
+        case SlabProjector::Mean:
+            foldLayer<T, SumReduce<T>>(in, static_cast<MeanSum<T> *>(sums), g, slice, sign);
+            break;
+    }
+}
+
+// 整数类型四舍五入
+template <typename T>
+void divideSums(const void *sums, T *out, const SlabGeometry &g, int layers) {
+    const MeanSum<T> *src = static_cast<const MeanSum<T> *>(sums);
+    const double scale = 1.0 / layers;
+    forEachRowBlock(g, 1, [&](int j0, int j1) {
+        const size_t begin = static_cast<size_t>(j0) * g.width, end = static_cast<size_t>(j1) * g.width;
+        for (size_t i = begin; i < end; ++i) {
+            const double mean = src[i] * scale;
+            out[i] = static_cast<T>(std::is_integral<T>::value ? std::floor(mean + 0.5) : mean);
+        }
+    });
+}
+
+} // namespace
+
+SlabProjector::SlabProjector()
+    : slab(vtkSmartPointer<vtkImageData>::New()), valid(false), axis(-1), mode(Maximum),
+      first(0), last(-1), volumeTime(0)
+{
+}
+
+void SlabProjector::setInput(vtkImageData *input) {
+    volume = input;
+    decoded.reset();
+    valid = false;
+}
+
+void SlabProjector::setDecodedSlices(std::shared_ptr<const DecodedSlices> decodedSlices) {
+    decoded = std::move(decodedSlices);
+    valid = false;
+}
+
+void SlabProjector::prepareOutput(int newAxis) {
+    int dims[3];
+    double spacing[3], origin[3];
+    volume->GetDimensions(dims);
+    volume->GetSpacing(spacing);
+    volume->GetOrigin(origin);
+
+    // 与 SliceExtractor 的输出几何一致
+    int u = 0, v = 1;
+    switch (newAxis) {
+        case 0: u = 1; v = 2; break;
+        case 1: u = 0; v = 2; break;
+        default: u = 0; v = 1; break;
+    }
+    int *outDims = slab->GetDimensions();
+    if (outDims[0] != dims[u] || outDims[1] != dims[v] || slab->GetScalarType() != volume->GetScalarType()) {
+        slab->SetDimensions(dims[u], dims[v], 1);
+        slab->AllocateScalars(volume->GetScalarType(), 1);
+    }
+    slab->SetSpacing(spacing[u], spacing[v], spacing[newAxis]);
+    slab->SetOrigin(origin[u], origin[v], 0.0);
+}
+
+void SlabProjector::recompute(int newFirst, int newLast) {
+    const SlabGeometry g = slabGeometry(volume, axis);
+    const void *in = volume->GetScalarPointer();
+    void *out = slab->GetScalarPointer();
+    if (mode == Mean) {
+        size_t sumBytes = 0;
+        switch (volume->GetScalarType()) {
+            vtkTemplateMacro(sumBytes = sizeof(MeanSum<VTK_TT>));
+        }
+        sums.resize(static_cast<size_t>(g.width) * g.height * sumBytes);
+    }
+    switch (volume->GetScalarType()) {
+        vtkTemplateMacro(reduceSlab(static_cast<const VTK_TT *>(in), static_cast<VTK_TT *>(out), sums.data(), g,
+                                    mode, newFirst, newLast));
+    }
+    first = newFirst;
+    last = newLast;
+}
+
+void SlabProjector::fold(int slice, int sign) {
+    const SlabGeometry g = slabGeometry(volume, axis);
+    const void *in = volume->GetScalarPointer();
+    void *out = slab->GetScalarPointer();
+    switch (volume->GetScalarType()) {
+        vtkTemplateMacro(foldSlab(static_cast<const VTK_TT *>(in), static_cast<VTK_TT *>(out), sums.data(), g,
+                                  mode, slice, sign));
+    }
+}
+
+void SlabProjector::finishMean() {
+    const SlabGeometry g = slabGeometry(volume, axis);
+    void *out = slab->GetScalarPointer();
+    switch (volume->GetScalarType()) {
+        vtkTemplateMacro(divideSums(sums.data(), static_cast<VTK_TT *>(out), g, last - first + 1));
+    }
+}
+
+vtkImageData *SlabProjector::project(int newAxis, int index, int thickness, Mode newMode) {
+    if (!volume || volume->GetScalarType() == VTK_VOID || volume->GetNumberOfScalarComponents() != 1
+        || newAxis < 0 || newAxis > 2) {
+        return nullptr;
+    }
+    TRACE_SCOPE("SlabProjector::project");
+
+    int dims[3];
+    volume->GetDimensions(dims);
+    thickness = std::max(1, thickness);
+    index = std::max(0, std::min(index, dims[newAxis] - 1));
+    const int newFirst = std::max(0, index - (thickness - 1) / 2);
+    const int newLast = std::min(dims[newAxis] - 1, index - (thickness - 1) / 2 + thickness - 1);
+
+    if (decoded && !decoded->complete()) {
+        // 轴状面平板只跨 [newFirst, newLast] 层，矢状面和冠状面的平板跨所有层
+        if (newAxis != 2 || !decoded->containsRange(newFirst, newLast)) {
+            return nullptr;
+        }
+        valid = false; // 体数据仍在原地写入，上一次的结果可能含有当时未解码的层
+    }
+
+    const bool reusable = valid && newAxis == axis && newMode == mode && volume->GetMTime() == volumeTime;
+    if (reusable && newFirst == first && newLast == last) {
+        return slab;
+    }
+    if (!reusable || newAxis != axis) {
+        axis = newAxis;
+        prepareOutput(axis);
+    }
+    mode = newMode;
+
+    // 与旧范围相比需要移入和移出的层数
+    const int overlapFirst = std::max(first, newFirst), overlapLast = std::min(last, newLast);
+    const int overlap = reusable ? std::max(0, overlapLast - overlapFirst + 1) : 0;
+    const int added = (newLast - newFirst + 1) - overlap;
+    const int removed = (last - first + 1) - overlap;
+    const int layers = newLast - newFirst + 1;
+
+    if (overlap > 0 && mode == Mean && added + removed < layers) {
+        for (int k = first; k <= last; ++k) {
+            if (k < newFirst || k > newLast) {
+                fold(k, -1);
+            }
+        }
+        for (int k = newFirst; k <= newLast; ++k) {
+            if (k < first || k > last) {
+                fold(k, 1);
+            }
+        }
+        first = newFirst;
+        last = newLast;
+    } else if (overlap > 0 && mode != Mean && removed == 0 && added < layers) {
+        for (int k = newFirst; k <= newLast; ++k) {
+            if (k < first || k > last) {
+                fold(k, 1);
+            }
+        }
+        first = newFirst;
+        last = newLast;
+    } else {
+        recompute(newFirst, newLast);
+    }
+    if (mode == Mean) {
+        finishMean();
+    }
+
+    valid = true;
+    volumeTime = volume->GetMTime();
+    slab->Modified();
+    return slab;
+}
@@ -0,0 +1,49 @@
+#ifndef SLABPROJECTOR_H
+#define SLABPROJECTOR_H
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+
+#include <memory>
+#include <vector>
+
+#include "decodedslices.h"
+
+// 轴对齐平板的厚层投影：最大密度 (MIP)、最小密度 (MinIP) 和平均密度
+// 输出几何与 SliceExtractor 相同，可直接替换单层切片。按输出行分给多个线程，
+// 沿平板方向的归约在内层按连续内存展开，编译器可以向量化。
+// 与上一次投影方向和模式相同时尽量增量更新：平均模式只加上移入、减去移出的层；
+// 最大/最小模式在新范围包含旧范围 (加厚) 时只合并新增的层。
+// 渐进加载时只投影已解码的层：平板用到尚未发布的层时返回 nullptr，调用方改为显示单层切片。
+class SlabProjector {
+public:
+    enum Mode { Maximum, Minimum, Mean };
+
+    SlabProjector();
+
+    void setInput(vtkImageData *volume); // 同时清除已解码的层
+    void setDecodedSlices(std::shared_ptr<const DecodedSlices> decoded); // 为空表示体数据已完整
+    // axis 为平板法线方向 (0=X, 1=Y, 2=Z)，以 index 为中心共 thickness 层，超出体数据的部分被截掉；
+    // 只支持单分量体数据，否则返回 nullptr；体数据还在渐进加载、平板用到未解码的层时也返回 nullptr
+    vtkImageData *project(int axis, int index, int thickness, Mode mode);
+    vtkImageData *output() const { return slab; }
+
+private:
+    void prepareOutput(int axis);
+    void recompute(int first, int last);
+    void fold(int slice, int sign); // 平均模式 sign=±1 表示加上/减去该层；最大/最小模式合并该层
+    void finishMean();              // 累加和除以层数写入输出
+
+    vtkSmartPointer<vtkImageData> volume;
+    vtkSmartPointer<vtkImageData> slab;
+    std::shared_ptr<const DecodedSlices> decoded;
+    std::vector<unsigned char> sums; // 平均模式的逐像素累加和，类型见 slabprojector.cpp
+
+    bool valid;
+    int axis;
+    Mode mode;
+    int first, last; // 当前结果覆盖的层范围
+    vtkMTimeType volumeTime;
+};
+
+#endif // SLABPROJECTOR_H
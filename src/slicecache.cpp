@@ -0,0 +1,192 @@
+#include "slicecache.h"
+#include "windowlevel.h"
+#include "tracer.h"
+
+#include <algorithm>
+#include <functional>
+
+const size_t SliceImageCache::DEFAULT_MAX_BYTES = 256 * 1024 * 1024;
+
+size_t SliceKeyHash::operator()(const SliceKey &key) const {
+    size_t hash = std::hash<int>()(key.orientation);
+    hash = hash * 31 + std::hash<int>()(key.index);
+    hash = hash * 31 + std::hash<double>()(key.window);
+    hash = hash * 31 + std::hash<double>()(key.level);
+    return hash;
+}
+
+SliceImageCache::SliceImageCache(size_t maxBytes)
+    : maxBytes(maxBytes), totalBytes(0), hitCount(0), missCount(0)
+{
+}
+
+vtkSmartPointer<vtkImageData> SliceImageCache::find(const SliceKey &key) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = lookup.find(key);
+    if (it == lookup.end()) {
+        ++missCount;
+        return nullptr;
+    }
+    ++hitCount;
+    entries.splice(entries.begin(), entries, it->second);
+    return it->second->image;
+}
+
+bool SliceImageCache::contains(const SliceKey &key) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return lookup.count(key) > 0;
+}
+
+void SliceImageCache::insert(const SliceKey &key, vtkSmartPointer<vtkImageData> image) {
+    if (!image) {
+        return;
+    }
+    const size_t size = static_cast<size_t>(image->GetNumberOfPoints()) * image->GetNumberOfScalarComponents()
+        * image->GetScalarSize();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = lookup.find(key);
+    if (it != lookup.end()) {
+        totalBytes -= it->second->bytes;
+        entries.erase(it->second);
+        lookup.erase(it);
+    }
+    entries.push_front(Entry{key, image, size});
+    lookup[key] = entries.begin();
+    totalBytes += size;
+    evictLocked();
+}
+
+void SliceImageCache::evictLocked() {
+    // 至少保留刚插入的一张
+    while (totalBytes > maxBytes && entries.size() > 1) {
+        const Entry &last = entries.back();
+        totalBytes -= last.bytes;
+        lookup.erase(last.key);
+        entries.pop_back();
+    }
+}
+
+void SliceImageCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    lookup.clear();
+    totalBytes = 0;
+}
+
+void SliceImageCache::setMaxBytes(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    maxBytes = bytes;
+    evictLocked();
+}
+
+size_t SliceImageCache::bytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return totalBytes;
+}
+
+size_t SliceImageCache::hits() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return hitCount;
+}
+
+size_t SliceImageCache::misses() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return missCount;
+}
+
+SlicePrefetcher::SlicePrefetcher(SliceImageCache &cache)
+    : cache(cache), stopping(false), generation(0)
+{
+    worker = std::thread(&SlicePrefetcher::run, this);
+}
+
+SlicePrefetcher::~SlicePrefetcher() {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueChanged.notify_all();
+    worker.join();
+}
+
+void SlicePrefetcher::setVolume(vtkImageData *newVolume, std::shared_ptr<const BrickedVolume> bricked,
+                                std::shared_ptr<const ChunkedVolume> newChunked) {
+    std::lock_guard<std::mutex> work(workMutex);
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        pending.clear();
+        ++generation;
+        volume = newVolume;
+        chunked = newVolume ? newChunked : nullptr;
+    }
+    for (SliceExtractor &extractor : extractors) {
+        extractor.setInput(newVolume);
+        extractor.setBrickedVolume(bricked);
+        extractor.setChunkedVolume(newVolume ? newChunked : nullptr);
+    }
+}
+
+void SlicePrefetcher::request(int orientation, int index, int direction, double window, double level) {
+    if (orientation < 0 || orientation > 2) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (!volume) {
+            return;
+        }
+        const int count = chunked ? chunked->dimensions()[orientation] : volume->GetDimensions()[orientation];
+
+        pending.erase(std::remove_if(pending.begin(), pending.end(),
+            [orientation](const SliceKey &key) { return key.orientation == orientation; }), pending.end());
+        for (int k = 1; k <= PREFETCH_DEPTH; ++k) {
+            int next;
+            if (direction != 0) {
+                next = index + (direction > 0 ? k : -k);
+            } else {
+                next = index + ((k & 1) ? (k + 1) / 2 : -(k / 2)); // +1, -1, +2, -2 ...
+            }
+            if (next >= 0 && next < count) {
+                pending.push_back(SliceKey{orientation, next, window, level});
+            }
+        }
+    }
+    queueChanged.notify_one();
+}
+
+void SlicePrefetcher::run() {
+    Tracer::instance().setThreadName("prefetch");
+    for (;;) {
+        SliceKey key;
+        unsigned int keyGeneration;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueChanged.wait(lock, [this] { return stopping || !pending.empty(); });
+            if (stopping) {
+                return;
+            }
+            key = pending.front();
+            pending.pop_front();
+            keyGeneration = generation;
+        }
+
+        std::lock_guard<std::mutex> work(workMutex);
+        {
+            // 等待 workMutex 期间体数据可能已被替换，旧请求作废
+            std::lock_guard<std::mutex> lock(queueMutex);
+            if (!volume || keyGeneration != generation) {
+                continue;
+            }
+        }
+        if (cache.contains(key)) {
+            continue;
+        }
+        TRACE_SCOPE("SlicePrefetcher::prefetch");
+        vtkImageData *slice = extractors[key.orientation].extract(key.orientation, key.index);
+        if (extractors[key.orientation].failed()) {
+            continue; // 读取失败的空白切片不进缓存，显示时再读一次
+        }
+        cache.insert(key, mapWindowLevelToRGBA(slice, key.window, key.level));
+    }
+}
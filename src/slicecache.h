@@ -0,0 +1,106 @@
+#ifndef SLICECACHE_H
+#define SLICECACHE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+
+#include "sliceextractor.h"
+
+// 切片图像缓存的键：方向、层号和映射时的窗宽窗位
+struct SliceKey {
+    int orientation;
+    int index;
+    double window;
+    double level;
+
+    bool operator==(const SliceKey &other) const {
+        return orientation == other.orientation && index == other.index
+            && window == other.window && level == other.level;
+    }
+};
+
+struct SliceKeyHash {
+    size_t operator()(const SliceKey &key) const;
+};
+
+// 已按窗宽窗位映射好的RGBA切片的LRU缓存，总大小超过上限时淘汰最久未用的切片
+// 命中时切片视图只需把图像交给 vtkImageActor 上传纹理。线程安全，预取线程和GUI线程共用。
+class SliceImageCache {
+public:
+    static const size_t DEFAULT_MAX_BYTES;
+
+    explicit SliceImageCache(size_t maxBytes = DEFAULT_MAX_BYTES);
+
+    vtkSmartPointer<vtkImageData> find(const SliceKey &key); // 命中时移到最近使用
+    bool contains(const SliceKey &key) const;
+    void insert(const SliceKey &key, vtkSmartPointer<vtkImageData> image);
+    void clear();
+
+    void setMaxBytes(size_t bytes);
+    size_t bytes() const;
+    size_t hits() const;
+    size_t misses() const;
+
+private:
+    struct Entry {
+        SliceKey key;
+        vtkSmartPointer<vtkImageData> image;
+        size_t bytes;
+    };
+
+    void evictLocked();
+
+    mutable std::mutex mutex;
+    std::list<Entry> entries; // 表头为最近使用
+    std::unordered_map<SliceKey, std::list<Entry>::iterator, SliceKeyHash> lookup;
+    size_t maxBytes;
+    size_t totalBytes;
+    size_t hitCount;
+    size_t missCount;
+};
+
+// 后台切片预取
+// 每次切片变化后，沿滚动方向预先提取并映射接下来的若干层放入缓存；方向未知时向两侧交替预取。
+// 同一方向的新请求会替换尚未执行的旧请求，始终只追随最新的滚动位置。
+class SlicePrefetcher {
+public:
+    static const int PREFETCH_DEPTH = 8;
+
+    explicit SlicePrefetcher(SliceImageCache &cache);
+    ~SlicePrefetcher();
+
+    // 切换体数据：等待正在执行的预取结束并丢弃排队的请求；传入 nullptr 暂停预取
+    // 核外模式下 volume 为驻留层，切片从 chunked 提取，预先读入的块同时留在存储的块缓存中
+    void setVolume(vtkImageData *volume, std::shared_ptr<const BrickedVolume> bricked,
+                   std::shared_ptr<const ChunkedVolume> chunked = nullptr);
+    // direction: >0 向层号增大方向滚动，<0 反向，0 未知
+    void request(int orientation, int index, int direction, double window, double level);
+
+private:
+    void run();
+
+    SliceImageCache &cache;
+    SliceExtractor extractors[3];
+    vtkSmartPointer<vtkImageData> volume;
+    std::shared_ptr<const ChunkedVolume> chunked;
+
+    std::mutex queueMutex;
+    std::condition_variable queueChanged;
+    std::deque<SliceKey> pending;
+    bool stopping;
+    unsigned int generation; // 每次切换体数据加一
+
+    std::mutex workMutex; // 执行一次预取期间持有，切换体数据时借此等待其结束
+    std::thread worker;
+};
+
+#endif // SLICECACHE_H
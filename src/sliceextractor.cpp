@@ -0,0 +1,237 @@
+#include "sliceextractor.h"
+#include "parallelfor.h"
+#include "tracer.h"
+
+#include <vtkMatrix4x4.h>
+#include <vtkPointData.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// 小于这个体素数时单线程完成，避免线程启动开销超过拷贝本身
+const size_t PARALLEL_THRESHOLD = 1 << 18;
+const int ROWS_PER_TASK = 16;
+
+// 定长元素块，使跨步收集按元素大小展开为单条读写
+template <size_t N>
+struct Element {
+    unsigned char bytes[N];
+};
+
+// out[i] = in[i * stride]，i 属于 [begin, end)；四路展开让多次跨步读取同时在途
+template <size_t N>
+void gatherRange(const unsigned char *in, unsigned char *out, size_t begin, size_t end, size_t stride) {
+    const Element<N> *src = reinterpret_cast<const Element<N> *>(in);
+    Element<N> *dst = reinterpret_cast<Element<N> *>(out);
+    size_t i = begin;
+    for (; i + 4 <= end; i += 4) {
+        Element<N> a = src[i * stride];
+        Element<N> b = src[(i + 1) * stride];
+        Element<N> c = src[(i + 2) * stride];
+        Element<N> d = src[(i + 3) * stride];
+        dst[i] = a;
+        dst[i + 1] = b;
+        dst[i + 2] = c;
+        dst[i + 3] = d;
+    }
+    for (; i < end; ++i) {
+        dst[i] = src[i * stride];
+    }
+}
+
+void gatherRangeBytes(const unsigned char *in, unsigned char *out, size_t begin, size_t end,
+                      size_t stride, size_t elementBytes) {
+    switch (elementBytes) {
+        case 1: gatherRange<1>(in, out, begin, end, stride); break;
+        case 2: gatherRange<2>(in, out, begin, end, stride); break;
+        case 4: gatherRange<4>(in, out, begin, end, stride); break;
+        case 8: gatherRange<8>(in, out, begin, end, stride); break;
+        default: // 多分量等非常见大小
+            for (size_t i = begin; i < end; ++i) {
+                std::memcpy(out + i * elementBytes, in + i * stride * elementBytes, elementBytes);
+            }
+            break;
+    }
+}
+
+} // namespace
+
+SliceExtractor::SliceExtractor()
+    : slice(vtkSmartPointer<vtkImageData>::New()), axis(-1), threads(0)
+{
+}
+
+void SliceExtractor::setInput(vtkImageData *input) {
+    volume = input;
+    bricked.reset();
+    chunked.reset();
+    decoded.reset();
+    axis = -1; // 下次提取时重新建立输出
+}
+
+void SliceExtractor::setBrickedVolume(std::shared_ptr<const BrickedVolume> brickedVolume) {
+    bricked = std::move(brickedVolume);
+}
+
+void SliceExtractor::setChunkedVolume(std::shared_ptr<const ChunkedVolume> chunkedVolume) {
+    chunked = std::move(chunkedVolume);
+    axis = -1; // 几何改为取自存储
+}
+
+void SliceExtractor::setDecodedSlices(std::shared_ptr<const DecodedSlices> decodedSlices) {
+    decoded = std::move(decodedSlices);
+}
+
+// 按方向建立输出图像的几何和标量数组；轴状面的数组不分配内存，只在提取时指向体数据
+void SliceExtractor::prepareOutput(int newAxis) {
+    int dims[3];
+    double spacing[3], origin[3];
+    if (chunked) {
+        chunked->levelDimensions(0, dims);
+        chunked->levelGeometry(0, spacing, origin);
+    } else {
+        volume->GetDimensions(dims);
+        volume->GetSpacing(spacing);
+        volume->GetOrigin(origin);
+    }
+
+    // 输出的 (u, v) 轴与 setupReslice 中 ResliceAxes 的前两列相同
+    int u = 0, v = 1;
+    switch (newAxis) {
+        case 0: u = 1; v = 2; break; // 矢状面：Y, Z
+        case 1: u = 0; v = 2; break; // 冠状面：X, Z
+        default: u = 0; v = 1; break; // 轴状面：X, Y
+    }
+
+    slice->SetDimensions(dims[u], dims[v], 1);
+    slice->SetSpacing(spacing[u], spacing[v], spacing[newAxis]);
+    slice->SetOrigin(origin[u], origin[v], 0.0);
+
+    const int components = chunked ? chunked->numberOfComponents() : volume->GetNumberOfScalarComponents();
+    const int type = chunked ? chunked->scalarType() : volume->GetScalarType();
+    scalars = vtkSmartPointer<vtkDataArray>::Take(vtkDataArray::CreateDataArray(type));
+    scalars->SetNumberOfComponents(components);
+    if (newAxis != 2 || chunked) {
+        scalars->SetNumberOfTuples(static_cast<vtkIdType>(dims[u]) * dims[v]);
+    }
+    slice->GetPointData()->SetScalars(scalars);
+
+    axis = newAxis;
+}
+
+vtkImageData *SliceExtractor::extract(int newAxis, int index) {
+    TRACE_SCOPE("SliceExtractor::extract");
+    error.clear();
+    if (!volume || volume->GetScalarType() == VTK_VOID || newAxis < 0 || newAxis > 2) {
+        return nullptr;
+    }
+    if (newAxis != axis) {
+        prepareOutput(newAxis);
+    }
+
+    if (chunked) {
+        int dims[3];
+        chunked->levelDimensions(0, dims);
+        void *out = scalars->GetVoidPointer(0);
+        if (!chunked->extractSlice(axis, std::max(0, std::min(index, dims[axis] - 1)), out, 0, &error)) {
+            // 不能留着上一张切片的像素冒充这一层
+            std::memset(out, 0, static_cast<size_t>(scalars->GetDataSize()) * scalars->GetDataTypeSize());
+            if (error.empty()) {
+                error = "读取核外存储失败";
+            }
+        }
+        scalars->Modified();
+        slice->Modified();
+        return slice;
+    }
+
+    int dims[3];
+    volume->GetDimensions(dims);
+    index = std::max(0, std::min(index, dims[newAxis] - 1));
+
+    const size_t elementBytes = static_cast<size_t>(volume->GetScalarSize()) * volume->GetNumberOfScalarComponents();
+    const size_t nx = dims[0], ny = dims[1], nz = dims[2];
+    unsigned char *in = static_cast<unsigned char *>(volume->GetScalarPointer());
+
+    const bool partial = decoded && !decoded->complete();
+    if (axis == 2 && partial && !decoded->contains(index)) {
+        // 该层仍在解码：换成自有的全零数组，不能在引用体数据的数组上改大小 (会拷贝正在写入的层)
+        scalars = vtkSmartPointer<vtkDataArray>::Take(vtkDataArray::CreateDataArray(volume->GetScalarType()));
+        scalars->SetNumberOfComponents(volume->GetNumberOfScalarComponents());
+        scalars->SetNumberOfTuples(static_cast<vtkIdType>(nx * ny));
+        std::memset(scalars->GetVoidPointer(0), 0, elementBytes * nx * ny);
+        slice->GetPointData()->SetScalars(scalars);
+    } else if (axis == 2) {
+        // 轴状面：直接引用第 index 层，save=1 表示数组不负责释放
+        scalars->SetVoidArray(in + elementBytes * nx * ny * index,
+                              static_cast<vtkIdType>(nx * ny * volume->GetNumberOfScalarComponents()), 1);
+    } else if (bricked) {
+        bricked->extractSlice(axis, index, scalars->GetVoidPointer(0), threads);
+    } else {
+        unsigned char *out = static_cast<unsigned char *>(scalars->GetVoidPointer(0));
+        const size_t outRow = axis == 0 ? ny : nx;     // 输出每行的元素数
+        const int tasks = static_cast<int>((nz + ROWS_PER_TASK - 1) / ROWS_PER_TASK);
+        auto copyRows = [&](int task, int) {
+            const size_t z0 = static_cast<size_t>(task) * ROWS_PER_TASK;
+            const size_t z1 = std::min(nz, z0 + ROWS_PER_TASK);
+            if (partial) {
+                // 渐进加载：已发布的层逐行拷贝，未解码的层填 0
+                for (size_t z = z0; z < z1; ++z) {
+                    unsigned char *row = out + elementBytes * z * outRow;
+                    if (!decoded->contains(static_cast<int>(z))) {
+                        std::memset(row, 0, elementBytes * outRow);
+                    } else if (axis == 1) {
+                        std::memcpy(row, in + elementBytes * ((z * ny + index) * nx), elementBytes * nx);
+                    } else {
+                        gatherRangeBytes(in + elementBytes * (z * ny * nx + index), row, 0, ny, nx, elementBytes);
+                    }
+                }
+            } else if (axis == 1) {
+                // 冠状面：每个z对应体数据中连续的一行
+                for (size_t z = z0; z < z1; ++z) {
+                    std::memcpy(out + elementBytes * z * nx,
+                                in + elementBytes * ((z * ny + index) * nx), elementBytes * nx);
+                }
+            } else {
+                // 矢状面：第 (z, y) 个输出元素位于 ((z*ny + y)*nx + index)，即步长为 nx 的一维收集
+                gatherRangeBytes(in + elementBytes * index, out, z0 * ny, z1 * ny, nx, elementBytes);
+            }
+        };
+        if (outRow * nz < PARALLEL_THRESHOLD) {
+            for (int task = 0; task < tasks; ++task) {
+                copyRows(task, 0);
+            }
+        } else {
+            parallelFor(0, tasks, copyRows, threads);
+        }
+    }
+
+    scalars->Modified();
+    slice->Modified();
+    return slice;
+}
+
+bool isAxisAlignedAxes(vtkMatrix4x4 *axes) {
+    if (!axes) {
+        return true;
+    }
+    for (int row = 0; row < 3; ++row) {
+        int nonZero = 0;
+        for (int col = 0; col < 3; ++col) {
+            double value = axes->GetElement(row, col);
+            if (std::abs(value) > 1e-9) {
+                if (std::abs(value - 1.0) > 1e-9) { // 翻转的轴由 reslice 处理
+                    return false;
+                }
+                ++nonZero;
+            }
+        }
+        if (nonZero != 1) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,60 @@
+#ifndef SLICEEXTRACTOR_H
+#define SLICEEXTRACTOR_H
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+#include <vtkDataArray.h>
+
+#include <memory>
+#include <string>
+
+#include "brickedvolume.h"
+#include "chunkedvolume.h"
+#include "decodedslices.h"
+
+class vtkMatrix4x4;
+
+// 正交切片的快速提取，替代轴对齐平面上的 vtkImageReslice
+// 切片序号总是整数，不需要插值和矩阵变换：
+//   轴状面 (Z) 在内存中连续，输出直接引用体数据中的那一层，不拷贝；
+//   冠状面 (Y) 每个z是一整行，逐行拷贝；
+//   矢状面 (X) 是步长为一行的跨步读取，按z分块多线程收集。
+// 输出的方向、原点和间距与 setupReslice 中对应的 ResliceAxes 一致，可直接替换 reslice 的输出。
+// 设置了分块副本时，矢状面和冠状面改从分块副本提取。
+// 设置了核外存储时，三个方向都从磁盘上的全分辨率块提取，几何取自存储而不是输入的驻留层。
+// 渐进加载时设置已解码的层，只读取已发布的层，其余层在输出中填 0。
+class SliceExtractor {
+public:
+    SliceExtractor();
+
+    void setInput(vtkImageData *volume); // 同时清除分块副本、核外存储和已解码的层
+    void setBrickedVolume(std::shared_ptr<const BrickedVolume> bricked); // 必须由当前输入构建
+    void setChunkedVolume(std::shared_ptr<const ChunkedVolume> chunked);
+    void setDecodedSlices(std::shared_ptr<const DecodedSlices> decoded); // 为空表示体数据已完整
+    void setThreadCount(int count) { threads = count; } // 矢状面、冠状面拷贝的线程数，0 表示硬件并发数
+    // axis 为切片法线方向：0=矢状面(X)，1=冠状面(Y)，2=轴状面(Z)
+    // 每次调用都会标记输出已修改，体数据被原地写入 (渐进加载) 时也能刷新
+    // 从核外存储读取失败时输出全零，failed() 为 true，原因见 errorMessage()
+    vtkImageData *extract(int axis, int index);
+    vtkImageData *output() const { return slice; }
+    bool failed() const { return !error.empty(); } // 最近一次提取是否失败
+    const std::string &errorMessage() const { return error; }
+
+private:
+    void prepareOutput(int axis);
+
+    vtkSmartPointer<vtkImageData> volume;
+    vtkSmartPointer<vtkImageData> slice;
+    vtkSmartPointer<vtkDataArray> scalars;
+    std::shared_ptr<const BrickedVolume> bricked;
+    std::shared_ptr<const ChunkedVolume> chunked;
+    std::shared_ptr<const DecodedSlices> decoded;
+    int axis;
+    int threads;
+    std::string error;
+};
+
+// ResliceAxes 的旋转部分是否只是坐标轴的置换 (平面与体数据轴对齐且不翻转)
+bool isAxisAlignedAxes(vtkMatrix4x4 *axes);
+
+#endif // SLICEEXTRACTOR_H
@@ -0,0 +1,123 @@
+#include "studyworkspace.h"
+#include "cineplayer.h"
+#include "memoryfootprint.h"
+#include "volumeresample.h"
+#include "tracer.h"
+
+#include <QDir>
+
+const qint64 StudyWorkspace::DEFAULT_BUDGET_BYTES = 4LL * 1024 * 1024 * 1024;
+
+StudyWorkspace::StudyWorkspace(qint64 budgetBytes)
+    : budgetBytes(budgetBytes), clock(0)
+{
+}
+
+int StudyWorkspace::find(const QString &dirPath) const {
+    const QString path = QDir::cleanPath(dirPath);
+    for (int i = 0; i < count(); ++i) {
+        if (studies[i].dirPath == path) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int StudyWorkspace::add(const QString &dirPath) {
+    Study study;
+    study.dirPath = QDir::cleanPath(dirPath);
+    study.title = QDir(study.dirPath).dirName();
+    study.lastUsed = ++clock;
+    studies.push_back(study);
+    return count() - 1;
+}
+
+void StudyWorkspace::remove(int index) {
+    studies.erase(studies.begin() + index);
+}
+
+void StudyWorkspace::touch(int index) {
+    studies[index].lastUsed = ++clock;
+}
+
+void StudyWorkspace::setImage(int index, vtkImageData *image, std::shared_ptr<const VolumeHistogram> histogram) {
+    studies[index].image = image;
+    studies[index].lowRes = nullptr;
+    studies[index].chunked = nullptr;
+    studies[index].cine = nullptr;
+    studies[index].histogram = std::move(histogram);
+}
+
+StudyWorkspace::Residency StudyWorkspace::residency(int index) const {
+    if (studies[index].image) {
+        return Resident;
+    }
+    return studies[index].lowRes ? Downsampled : Evicted;
+}
+
+int StudyWorkspace::mostRecent(int exclude) const {
+    int best = -1;
+    for (int i = 0; i < count(); ++i) {
+        if (i != exclude && (best < 0 || studies[i].lastUsed > studies[best].lastUsed)) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+// 每轮在当前检查之外找最久未用、仍占内存的检查：有全分辨率数据的先降级，只剩副本的再释放
+// 核外检查直接释放 (连同块缓存)，切回时重新打开分块存储比抽取副本还快
+std::vector<int> StudyWorkspace::enforceBudget(int active) {
+    TRACE_SCOPE("StudyWorkspace::enforceBudget");
+    std::vector<int> changed;
+    while (totalBytes() > budgetBytes) {
+        int victim = -1;
+        for (int i = 0; i < count(); ++i) {
+            if (i == active || (!studies[i].image && !studies[i].lowRes)) {
+                continue;
+            }
+            if (victim < 0 || studies[i].lastUsed < studies[victim].lastUsed) {
+                victim = i;
+            }
+        }
+        if (victim < 0) {
+            break; // 只剩当前检查
+        }
+
+        Study &study = studies[victim];
+        if (study.chunked) {
+            study.image = nullptr;
+            study.lowRes = nullptr;
+            study.chunked = nullptr;
+        } else if (study.image) {
+            const int factors[3] = {LOW_RES_FACTOR, LOW_RES_FACTOR, LOW_RES_FACTOR};
+            study.lowRes = decimateVolume(study.image, factors);
+            study.image = nullptr;
+            study.cine = nullptr;
+        } else {
+            study.lowRes = nullptr;
+        }
+        if (changed.empty() || changed.back() != victim) {
+            changed.push_back(victim);
+        }
+    }
+    return changed;
+}
+
+qint64 StudyWorkspace::studyBytes(int index) const {
+    const Study &study = studies[index];
+    qint64 bytes = MemoryFootprint::imageBytes(study.image) + MemoryFootprint::imageBytes(study.lowRes)
+        + (study.chunked ? study.chunked->cachedBytes() : 0);
+    if (study.cine) {
+        bytes += study.cine->bytes() - MemoryFootprint::imageBytes(study.image); // 第一个时相已计入
+    }
+    return bytes;
+}
+
+qint64 StudyWorkspace::totalBytes() const {
+    qint64 total = 0;
+    for (int i = 0; i < count(); ++i) {
+        total += studyBytes(i);
+    }
+    return total;
+}
@@ -0,0 +1,79 @@
+#ifndef STUDYWORKSPACE_H
+#define STUDYWORKSPACE_H
+
+#include <QString>
+
+#include <memory>
+#include <vector>
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+
+#include "volumehistogram.h"
+#include "chunkedvolume.h"
+
+struct CineSeries;
+
+// 同时打开的多个检查 (每个对应一个序列目录)
+// 所有检查的体数据共用一个内存预算：超出时先把最久未查看的检查抽取为低分辨率副本，
+// 仍然超出再整个释放；切回这些检查时由调用者在后台重新加载。当前检查不参与淘汰。
+class StudyWorkspace {
+public:
+    enum Residency {
+        Resident,    // 全分辨率体数据在内存中
+        Downsampled, // 只保留低分辨率副本
+        Evicted      // 没有体数据 (已释放或尚未加载完成)
+    };
+
+    struct Study {
+        QString dirPath;
+        QString title;
+        vtkSmartPointer<vtkImageData> image;  // 全分辨率体数据
+        vtkSmartPointer<vtkImageData> lowRes; // 降级后的副本，切回时先显示
+        std::shared_ptr<const VolumeHistogram> histogram; // 全分辨率体数据的直方图，降级后仍保留
+        // 核外模式的分块存储，此时 image 是驻留的金字塔层；切片的层号按存储的全分辨率尺寸计
+        std::shared_ptr<ChunkedVolume> chunked;
+        // 多时相序列预载的全部时相，此时 image 是第一个时相；降级时只保留第一个时相的副本
+        std::shared_ptr<const CineSeries> cine;
+        quint64 lastUsed = 0;
+
+        // 切回时恢复的浏览状态
+        bool hasViewState = false;
+        int slices[3] = {0, 0, 0}; // 矢状、冠状、轴状层号
+        double window = 0.0;
+        double level = 0.0;
+    };
+
+    static const qint64 DEFAULT_BUDGET_BYTES;
+    static const int LOW_RES_FACTOR = 4; // 降级时每个方向的抽取因子
+
+    explicit StudyWorkspace(qint64 budgetBytes = DEFAULT_BUDGET_BYTES);
+
+    int count() const { return static_cast<int>(studies.size()); }
+    int find(const QString &dirPath) const; // 未打开时返回 -1
+    int add(const QString &dirPath);        // 新建一个尚未加载的检查，返回编号
+    void remove(int index);
+    Study &study(int index) { return studies[index]; }
+    const Study &study(int index) const { return studies[index]; }
+
+    void touch(int index);                          // 标记为最近使用
+    // 加载完成，替换低分辨率副本
+    void setImage(int index, vtkImageData *image, std::shared_ptr<const VolumeHistogram> histogram = nullptr);
+    Residency residency(int index) const;
+    int mostRecent(int exclude = -1) const;         // 最近使用的检查，没有时返回 -1
+
+    // 超出预算时降级或释放最久未用的检查，返回状态发生变化的编号
+    std::vector<int> enforceBudget(int active);
+
+    void setBudget(qint64 bytes) { budgetBytes = bytes; }
+    qint64 budget() const { return budgetBytes; }
+    qint64 studyBytes(int index) const; // 全分辨率与低分辨率副本之和，核外检查再加上块缓存，多时相检查再加上其余时相
+    qint64 totalBytes() const;
+
+private:
+    std::vector<Study> studies;
+    qint64 budgetBytes;
+    quint64 clock; // 最近使用计数
+};
+
+#endif // STUDYWORKSPACE_H
@@ -0,0 +1,154 @@
+#include "tracer.h"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+std::atomic<bool> Tracer::active(false);
+
+namespace {
+
+const std::chrono::steady_clock::time_point EPOCH = std::chrono::steady_clock::now();
+
+void writeJsonString(std::ostream &out, const std::string &value) {
+    out << '"';
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out << escaped;
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+} // namespace
+
+Tracer &Tracer::instance() {
+    static Tracer tracer;
+    return tracer;
+}
+
+int64_t Tracer::nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - EPOCH).count();
+}
+
+// 线程编号按第一次使用的顺序分配，比系统线程号短且稳定
+int Tracer::currentThread() {
+    static std::atomic<int> nextThread(1);
+    thread_local int thread = nextThread++;
+    return thread;
+}
+
+void Tracer::setEnabled(bool enabled) {
+    active.store(enabled, std::memory_order_relaxed);
+}
+
+void Tracer::setThreadName(const char *name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    threadNames[currentThread()] = name;
+}
+
+void Tracer::record(const char *name, int64_t startNs, int64_t durationNs) {
+    const int thread = currentThread();
+    std::lock_guard<std::mutex> lock(mutex);
+    if (events.size() >= MAX_EVENTS) {
+        ++dropped;
+        return;
+    }
+    events.push_back(Event{name, startNs, durationNs, thread});
+}
+
+void Tracer::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    events.clear();
+    events.shrink_to_fit();
+    dropped = 0;
+    frameBegin = 0;
+    frameStages.clear();
+}
+
+size_t Tracer::eventCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return events.size();
+}
+
+size_t Tracer::droppedCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return dropped;
+}
+
+// 完整事件 ("ph": "X")，时间单位为微秒
+bool Tracer::writeChromeTrace(const std::string &path, std::string *error) const {
+    std::ofstream out(std::filesystem::u8path(path), std::ios::binary);
+    if (!out) {
+        if (error) *error = "无法写入文件: " + path;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    for (const auto &thread : threadNames) {
+        out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread.first
+            << ",\"args\":{\"name\":";
+        writeJsonString(out, thread.second);
+        out << "}}";
+        first = false;
+    }
+    char number[64];
+    for (const Event &e : events) {
+        out << (first ? "" : ",\n") << "{\"name\":";
+        writeJsonString(out, e.name);
+        std::snprintf(number, sizeof(number), "%.3f", e.startNs / 1000.0);
+        out << ",\"cat\":\"dicomviewer\",\"ph\":\"X\",\"pid\":1,\"tid\":" << e.thread << ",\"ts\":" << number;
+        std::snprintf(number, sizeof(number), "%.3f", e.durationNs / 1000.0);
+        out << ",\"dur\":" << number << "}";
+        first = false;
+    }
+    out << "\n]}\n";
+
+    if (!out) {
+        if (error) *error = "写入失败: " + path;
+        return false;
+    }
+    return true;
+}
+
+void Tracer::beginFrame() {
+    const int thread = currentThread();
+    std::lock_guard<std::mutex> lock(mutex);
+    frameBegin = events.size();
+    frameThread = thread;
+}
+
+void Tracer::endFrame() {
+    std::lock_guard<std::mutex> lock(mutex);
+    frameStages.clear();
+    for (size_t i = frameBegin; i < events.size(); ++i) {
+        const Event &e = events[i];
+        if (e.thread != frameThread) {
+            continue;
+        }
+        const double ms = e.durationNs / 1.0e6;
+        auto it = frameStages.begin();
+        while (it != frameStages.end() && it->first != e.name) {
+            ++it;
+        }
+        if (it == frameStages.end()) {
+            frameStages.emplace_back(e.name, ms);
+        } else {
+            it->second += ms;
+        }
+    }
+}
+
+std::vector<std::pair<std::string, double>> Tracer::lastFrame() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return frameStages;
+}
@@ -0,0 +1,81 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// 热路径分段计时，导出为 Chrome/Perfetto 可打开的 trace JSON
+// 关闭时每个计时段只有一次原子读；事件名必须是字符串字面量 (只保存指针)。
+class Tracer {
+public:
+    static Tracer &instance();
+
+    static bool enabled() { return active.load(std::memory_order_relaxed); }
+    static int64_t nowNs(); // 相对进程内固定起点的单调时间
+
+    void setEnabled(bool enabled);
+    void setThreadName(const char *name); // 当前线程在 trace 中显示的名称
+    void record(const char *name, int64_t startNs, int64_t durationNs);
+    void clear();
+    size_t eventCount() const;
+    size_t droppedCount() const;
+
+    bool writeChromeTrace(const std::string &path, std::string *error = nullptr) const;
+
+    // 帧统计：beginFrame/endFrame 之间当前线程的事件按名称汇总，供叠加层显示
+    void beginFrame();
+    void endFrame();
+    std::vector<std::pair<std::string, double>> lastFrame() const; // (名称, 毫秒)，按首次出现顺序
+
+    static const size_t MAX_EVENTS = 1 << 20; // 约 32 MB，超出后丢弃新事件
+
+private:
+    Tracer() = default;
+
+    struct Event {
+        const char *name;
+        int64_t startNs;
+        int64_t durationNs;
+        int thread;
+    };
+
+    static int currentThread();
+    static std::atomic<bool> active;
+
+    mutable std::mutex mutex;
+    std::vector<Event> events;
+    size_t dropped = 0;
+    std::map<int, std::string> threadNames;
+    size_t frameBegin = 0;
+    int frameThread = -1;
+    std::vector<std::pair<std::string, double>> frameStages;
+};
+
+// 作用域计时：构造时记录开始，析构时写入一个完整事件
+class TraceScope {
+public:
+    explicit TraceScope(const char *name)
+        : name(Tracer::enabled() ? name : nullptr), start(this->name ? Tracer::nowNs() : 0) {}
+    ~TraceScope() {
+        if (name) {
+            Tracer::instance().record(name, start, Tracer::nowNs() - start);
+        }
+    }
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+    const char *name;
+    int64_t start;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope_, __LINE__)(name)
+
+#endif // TRACER_H
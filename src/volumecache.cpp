@@ -0,0 +1,259 @@
+#include "volumecache.h"
+#include "seriesindexcache.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include <vtkDataArray.h>
+#include <vtkPointData.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+const qint64 VolumeCache::DEFAULT_MAX_BYTES = 16LL * 1024 * 1024 * 1024;
+
+namespace {
+
+const char VOLUME_MAGIC[8] = {'D', 'V', 'V', 'O', 'L', 0, 0, 2};
+const qint64 DATA_OFFSET = 4096; // 元数据头占一页，体素数据从页边界开始
+
+// 缓存文件的元数据头
+struct VolumeCacheHeader {
+    char magic[8];
+    quint64 fingerprint;   // 源目录指纹，目录变化后缓存失效
+    qint32 dimensions[3];
+    qint32 scalarType;
+    qint32 components;
+    qint32 reserved;
+    double spacing[3];
+    double origin[3];
+    quint64 dataOffset;
+    quint64 dataBytes;
+    quint64 histogramOffset; // 0 表示没有保存直方图
+    quint64 histogramBytes;
+};
+
+// 已映射文件的登记表：VTK数组释放时通过数据指针找到对应映射并解除
+struct MappedVolume {
+    std::unique_ptr<QFile> file;
+    uchar *base = nullptr;
+};
+
+std::mutex &mappingMutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+std::unordered_map<void *, MappedVolume> &mappings() {
+    static std::unordered_map<void *, MappedVolume> table;
+    return table;
+}
+
+void releaseMapping(void *data) {
+    MappedVolume mapped;
+    {
+        std::lock_guard<std::mutex> lock(mappingMutex());
+        auto it = mappings().find(data);
+        if (it == mappings().end()) {
+            return;
+        }
+        mapped = std::move(it->second);
+        mappings().erase(it);
+    }
+    mapped.file->unmap(mapped.base);
+    mapped.file->close();
+}
+
+bool isMapped(const QString &path) {
+    std::lock_guard<std::mutex> lock(mappingMutex());
+    for (const auto &item : mappings()) {
+        if (QFileInfo(item.second.file->fileName()) == QFileInfo(path)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+VolumeCache::VolumeCache(const QString &cacheDir, qint64 maxBytes)
+    : cacheDir(cacheDir), maxBytes(maxBytes)
+{
+}
+
+QString VolumeCache::cacheFilePath(const QString &dirPath) const {
+    QByteArray key = QCryptographicHash::hash(QDir::cleanPath(dirPath).toUtf8(), QCryptographicHash::Sha1).toHex();
+    return QDir(cacheDir).filePath(QString::fromLatin1(key.left(16)) + ".vol");
+}
+
+vtkSmartPointer<vtkImageData> VolumeCache::open(const QString &dirPath, VolumeHistogram *histogram) const {
+    // 键和指纹都按规范化后的路径计算，"a/b/" 与 "a/b" 命中同一条目且指纹一致
+    const QString cleanDir = QDir::cleanPath(dirPath);
+    const QString path = cacheFilePath(cleanDir);
+    std::unique_ptr<QFile> file(new QFile(path));
+    if (!file->open(QIODevice::ReadOnly)) {
+        return nullptr;
+    }
+    // 损坏或已过期 (目录内容变了) 的条目不会再命中，直接删除，不让它占着缓存空间
+    auto discard = [&file, &path]() -> vtkSmartPointer<vtkImageData> {
+        file->close();
+        QFile::remove(path);
+        return nullptr;
+    };
+
+    VolumeCacheHeader header;
+    if (file->read(reinterpret_cast<char *>(&header), sizeof(header)) != static_cast<qint64>(sizeof(header))
+        || std::memcmp(header.magic, VOLUME_MAGIC, sizeof(VOLUME_MAGIC)) != 0
+        || header.fingerprint != directoryFingerprint(cleanDir.toStdString())
+        || static_cast<qint64>(header.dataOffset + header.dataBytes) > file->size()) {
+        return discard();
+    }
+
+    vtkSmartPointer<vtkDataArray> scalars = vtkSmartPointer<vtkDataArray>::Take(
+        vtkDataArray::CreateDataArray(header.scalarType));
+    const vtkIdType values = static_cast<vtkIdType>(header.dimensions[0]) * header.dimensions[1]
+        * header.dimensions[2] * header.components;
+    if (!scalars || static_cast<quint64>(values) * scalars->GetDataTypeSize() != header.dataBytes) {
+        return discard();
+    }
+
+    if (histogram) {
+        *histogram = VolumeHistogram();
+        if (header.histogramBytes > 0
+            && static_cast<qint64>(header.histogramOffset + header.histogramBytes) <= file->size()
+            && file->seek(static_cast<qint64>(header.histogramOffset))) {
+            const QByteArray bytes = file->read(static_cast<qint64>(header.histogramBytes));
+            if (!histogram->deserialize(bytes.constData(), static_cast<size_t>(bytes.size()))) {
+                *histogram = VolumeHistogram();
+            }
+        }
+    }
+
+    // 写时复制映射：下游即使误写也不会破坏缓存文件
+    uchar *base = file->map(0, static_cast<qint64>(header.dataOffset + header.dataBytes), QFileDevice::MapPrivateOption);
+    if (!base) {
+        return nullptr;
+    }
+    // 校验通过后才更新修改时间作为最近使用时间，供LRU淘汰
+    std::error_code ec;
+    std::filesystem::last_write_time(std::filesystem::u8path(path.toStdString()),
+                                     std::filesystem::file_time_type::clock::now(), ec);
+    void *data = base + header.dataOffset;
+    {
+        std::lock_guard<std::mutex> lock(mappingMutex());
+        mappings()[data] = MappedVolume{std::move(file), base};
+    }
+
+    // 直接把映射内存交给VTK数组，数组释放时解除映射
+    scalars->SetNumberOfComponents(header.components);
+    scalars->SetVoidArray(data, values, 0, vtkAbstractArray::VTK_DATA_ARRAY_USER_DEFINED);
+    scalars->SetArrayFreeFunction(releaseMapping);
+
+    vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+    image->SetDimensions(header.dimensions[0], header.dimensions[1], header.dimensions[2]);
+    image->SetSpacing(header.spacing);
+    image->SetOrigin(header.origin);
+    image->GetPointData()->SetScalars(scalars);
+    return image;
+}
+
+bool VolumeCache::store(const QString &dirPath, vtkImageData *image, const VolumeHistogram *histogram) const {
+    if (!image || !image->GetPointData()->GetScalars()) {
+        return false;
+    }
+    QDir().mkpath(cacheDir);
+    const QString cleanDir = QDir::cleanPath(dirPath);
+
+    VolumeCacheHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, VOLUME_MAGIC, sizeof(VOLUME_MAGIC));
+    header.fingerprint = directoryFingerprint(cleanDir.toStdString());
+    int *dims = image->GetDimensions();
+    std::copy(dims, dims + 3, header.dimensions);
+    header.scalarType = image->GetScalarType();
+    header.components = image->GetNumberOfScalarComponents();
+    image->GetSpacing(header.spacing);
+    image->GetOrigin(header.origin);
+    header.dataOffset = DATA_OFFSET;
+    header.dataBytes = static_cast<quint64>(image->GetNumberOfPoints()) * header.components * image->GetScalarSize();
+    const std::string histogramBytes = histogram && !histogram->empty() ? histogram->serialize() : std::string();
+    if (!histogramBytes.empty()) {
+        header.histogramOffset = header.dataOffset + header.dataBytes;
+        header.histogramBytes = histogramBytes.size();
+    }
+
+    const QString path = cacheFilePath(cleanDir);
+    QSaveFile out(path);
+    if (!out.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    QByteArray page(DATA_OFFSET, '\0');
+    std::memcpy(page.data(), &header, sizeof(header));
+    if (out.write(page) != page.size()) {
+        out.cancelWriting();
+        return false;
+    }
+
+    // 分块写入，避免单次写入超过底层API限制
+    const char *data = static_cast<const char *>(image->GetScalarPointer());
+    const qint64 chunk = 64LL * 1024 * 1024;
+    for (qint64 written = 0; written < static_cast<qint64>(header.dataBytes); written += chunk) {
+        qint64 size = std::min(chunk, static_cast<qint64>(header.dataBytes) - written);
+        if (out.write(data + written, size) != size) {
+            out.cancelWriting();
+            return false;
+        }
+    }
+    if (!histogramBytes.empty()
+        && out.write(histogramBytes.data(), static_cast<qint64>(histogramBytes.size())) != static_cast<qint64>(histogramBytes.size())) {
+        out.cancelWriting();
+        return false;
+    }
+    if (!out.commit()) {
+        return false;
+    }
+
+    evict(path);
+    return true;
+}
+
+// 按最近使用时间从新到旧累计，超出上限的旧文件被删除；正在映射的文件跳过
+void VolumeCache::evict(const QString &keepFile) const {
+    QDir dir(cacheDir);
+    const QFileInfoList files = dir.entryInfoList(QStringList() << "*.vol", QDir::Files, QDir::Time);
+    qint64 total = 0;
+    for (const QFileInfo &info : files) {
+        total += info.size();
+        if (total <= maxBytes || info.absoluteFilePath() == QFileInfo(keepFile).absoluteFilePath()
+            || isMapped(info.absoluteFilePath())) {
+            continue;
+        }
+        if (QFile::remove(info.absoluteFilePath())) {
+            total -= info.size();
+        }
+    }
+}
+
+void VolumeCache::clear() const {
+    QDir dir(cacheDir);
+    for (const QFileInfo &info : dir.entryInfoList(QStringList() << "*.vol", QDir::Files)) {
+        if (!isMapped(info.absoluteFilePath())) {
+            QFile::remove(info.absoluteFilePath());
+        }
+    }
+}
+
+qint64 VolumeCache::totalBytes() const {
+    qint64 total = 0;
+    for (const QFileInfo &info : QDir(cacheDir).entryInfoList(QStringList() << "*.vol", QDir::Files)) {
+        total += info.size();
+    }
+    return total;
+}
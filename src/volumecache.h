@@ -0,0 +1,39 @@
+#ifndef VOLUMECACHE_H
+#define VOLUMECACHE_H
+
+#include <QString>
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+
+#include "volumehistogram.h"
+
+// 解码后体数据的磁盘缓存
+// 每个序列目录保存为一个原始体数据文件：一页大小的元数据头 + 页对齐的体素数据。
+// 再次打开时直接内存映射该文件并包装成 vtkImageData，不做拷贝，读取开销只剩缺页中断。
+// 体数据的灰度直方图跟在体素数据之后，命中时不必重新统计。
+// 缓存总大小超过上限时按最近使用时间淘汰。
+class VolumeCache {
+public:
+    VolumeCache(const QString &cacheDir, qint64 maxBytes);
+
+    // 命中且目录未变化时返回映射的体数据，否则返回nullptr
+    // histogram 非空时读出保存的直方图，文件中没有直方图时将其清空
+    vtkSmartPointer<vtkImageData> open(const QString &dirPath, VolumeHistogram *histogram = nullptr) const;
+    // 保存体数据 (及其直方图) 并按上限淘汰旧文件
+    bool store(const QString &dirPath, vtkImageData *image, const VolumeHistogram *histogram = nullptr) const;
+
+    void evict(const QString &keepFile = QString()) const;
+    void clear() const;
+    qint64 totalBytes() const;
+
+    QString cacheFilePath(const QString &dirPath) const;
+
+    static const qint64 DEFAULT_MAX_BYTES;
+
+private:
+    QString cacheDir;
+    qint64 maxBytes;
+};
+
+#endif // VOLUMECACHE_H
@@ -0,0 +1,215 @@
+#include "volumehistogram.h"
+
+#include <vtkSetGet.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+
+namespace {
+
+const char HISTOGRAM_MAGIC[8] = {'D', 'V', 'H', 'I', 'S', 'T', 0, 1};
+
+struct SerializedHeader {
+    char magic[8];
+    double lower;
+    double binWidth;
+    double minValue;
+    double maxValue;
+    int64_t totalCount;
+    int32_t bins;
+    int32_t integral;
+};
+
+template <typename T>
+void countValues(const T *in, size_t count, double lower, double scale, VolumeHistogram::Partial &partial) {
+    int64_t *bins = partial.counts.data();
+    const int last = static_cast<int>(partial.counts.size()) - 1;
+    T lo = in[0], hi = in[0];
+    // 不超过 16 位的整数且每个灰度一个区间：整数减法直接得到区间号，不经过浮点换算
+    const bool direct = std::is_integral<T>::value && sizeof(T) <= 2 && scale == 1.0;
+    if (direct) {
+        const int offset = static_cast<int>(lower);
+        for (size_t i = 0; i < count; ++i) {
+            const T v = in[i];
+            lo = v < lo ? v : lo;
+            hi = v > hi ? v : hi;
+            const int bin = static_cast<int>(v) - offset;
+            ++bins[bin < 0 ? 0 : (bin > last ? last : bin)];
+        }
+    } else {
+        for (size_t i = 0; i < count; ++i) {
+            const T v = in[i];
+            lo = v < lo ? v : lo;
+            hi = v > hi ? v : hi;
+            const double d = (static_cast<double>(v) - lower) * scale;
+            const int bin = !(d >= 0.0) ? 0 : (d >= last ? last : static_cast<int>(d));
+            ++bins[bin];
+        }
+    }
+    partial.minValue = partial.empty ? lo : std::min<double>(partial.minValue, lo);
+    partial.maxValue = partial.empty ? hi : std::max<double>(partial.maxValue, hi);
+    partial.empty = false;
+}
+
+} // namespace
+
+void VolumeHistogram::setRange(double lo, double hi, bool integral) {
+    if (hi < lo) {
+        std::swap(lo, hi);
+    }
+    integralBins = integral;
+    if (integral) {
+        lower = std::floor(lo);
+        const double span = std::ceil(hi) - lower + 1.0;
+        binWidth = std::max(1.0, std::ceil(span / MAX_BINS));
+        counts.assign(static_cast<size_t>(std::ceil(span / binWidth)), 0);
+    } else {
+        lower = lo;
+        binWidth = hi > lo ? (hi - lo) / MAX_BINS : 1.0;
+        counts.assign(MAX_BINS, 0);
+    }
+    clear();
+}
+
+void VolumeHistogram::clear() {
+    std::fill(counts.begin(), counts.end(), 0);
+    totalCount = 0;
+    minValue = maxValue = 0.0;
+}
+
+void VolumeHistogram::add(Partial &partial, const void *data, int scalarType, size_t count) const {
+    if (counts.empty() || count == 0) {
+        return;
+    }
+    if (partial.counts.size() != counts.size()) {
+        partial.counts.assign(counts.size(), 0);
+        partial.empty = true;
+    }
+    const double scale = 1.0 / binWidth;
+    switch (scalarType) {
+        vtkTemplateMacro(countValues(static_cast<const VTK_TT *>(data), count, lower, scale, partial));
+        default:
+            break;
+    }
+}
+
+void VolumeHistogram::merge(const Partial &partial) {
+    if (partial.empty || partial.counts.size() != counts.size()) {
+        return;
+    }
+    int64_t added = 0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        counts[i] += partial.counts[i];
+        added += partial.counts[i];
+    }
+    minValue = totalCount > 0 ? std::min(minValue, partial.minValue) : partial.minValue;
+    maxValue = totalCount > 0 ? std::max(maxValue, partial.maxValue) : partial.maxValue;
+    totalCount += added;
+}
+
+bool VolumeHistogram::merge(const VolumeHistogram &other) {
+    if (other.counts.size() != counts.size() || other.lower != lower || other.binWidth != binWidth
+        || other.integralBins != integralBins) {
+        return false;
+    }
+    if (other.totalCount == 0) {
+        return true;
+    }
+    for (size_t i = 0; i < counts.size(); ++i) {
+        counts[i] += other.counts[i];
+    }
+    minValue = totalCount > 0 ? std::min(minValue, other.minValue) : other.minValue;
+    maxValue = totalCount > 0 ? std::max(maxValue, other.maxValue) : other.maxValue;
+    totalCount += other.totalCount;
+    return true;
+}
+
+double VolumeHistogram::percentile(double fraction) const {
+    if (totalCount == 0) {
+        return 0.0;
+    }
+    const double target = std::min(std::max(fraction, 0.0), 1.0) * (totalCount - 1);
+    int64_t cumulative = 0;
+    int bin = static_cast<int>(counts.size()) - 1;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        cumulative += counts[i];
+        if (cumulative > target) {
+            bin = static_cast<int>(i);
+            break;
+        }
+    }
+    // 宽度为 1 的整数区间就是该灰度本身，其余取区间中点
+    const double value = integralBins ? binLower(bin) + std::floor((binWidth - 1.0) / 2.0)
+                                      : binLower(bin) + binWidth / 2.0;
+    return std::min(std::max(value, minValue), maxValue);
+}
+
+void VolumeHistogram::windowLevel(double lowFraction, double highFraction, double &window, double &level) const {
+    const double lo = percentile(lowFraction);
+    const double hi = percentile(highFraction);
+    window = std::max(1.0, hi - lo);
+    level = (hi + lo) / 2.0;
+}
+
+std::vector<int64_t> VolumeHistogram::resample(int bins, double lo, double hi) const {
+    std::vector<int64_t> out(std::max(bins, 1), 0);
+    if (hi <= lo) {
+        return out;
+    }
+    const double scale = out.size() / (hi - lo);
+    for (size_t i = 0; i < counts.size(); ++i) {
+        if (counts[i] == 0) {
+            continue;
+        }
+        const double center = binLower(static_cast<int>(i)) + (integralBins ? (binWidth - 1.0) / 2.0 : binWidth / 2.0);
+        const double d = (center - lo) * scale;
+        if (d < 0.0 || binLower(static_cast<int>(i)) > hi) {
+            continue;
+        }
+        // hi 本身 (通常就是最大值) 落在最后一个区间，而不是越界被丢掉
+        out[std::min(out.size() - 1, static_cast<size_t>(d))] += counts[i];
+    }
+    return out;
+}
+
+std::string VolumeHistogram::serialize() const {
+    SerializedHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, HISTOGRAM_MAGIC, sizeof(HISTOGRAM_MAGIC));
+    header.lower = lower;
+    header.binWidth = binWidth;
+    header.minValue = minValue;
+    header.maxValue = maxValue;
+    header.totalCount = totalCount;
+    header.bins = static_cast<int32_t>(counts.size());
+    header.integral = integralBins ? 1 : 0;
+    std::string out(sizeof(header) + counts.size() * sizeof(int64_t), '\0');
+    std::memcpy(&out[0], &header, sizeof(header));
+    if (!counts.empty()) {
+        std::memcpy(&out[sizeof(header)], counts.data(), counts.size() * sizeof(int64_t));
+    }
+    return out;
+}
+
+bool VolumeHistogram::deserialize(const char *data, size_t size) {
+    SerializedHeader header;
+    if (size < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, HISTOGRAM_MAGIC, sizeof(HISTOGRAM_MAGIC)) != 0 || header.bins <= 0
+        || header.bins > MAX_BINS || size != sizeof(header) + static_cast<size_t>(header.bins) * sizeof(int64_t)) {
+        return false;
+    }
+    lower = header.lower;
+    binWidth = header.binWidth;
+    minValue = header.minValue;
+    maxValue = header.maxValue;
+    totalCount = header.totalCount;
+    integralBins = header.integral != 0;
+    counts.resize(header.bins);
+    std::memcpy(counts.data(), data + sizeof(header), counts.size() * sizeof(int64_t));
+    return true;
+}
@@ -0,0 +1,55 @@
+#ifndef VOLUMEHISTOGRAM_H
+#define VOLUMEHISTOGRAM_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 体数据的灰度直方图，在解码或拷贝体素时顺带统计，不再单独扫描整个体数据
+// 整数体素在取值范围不超过 MAX_BINS 时每个灰度一个区间，百分位数是精确值；其余按等宽区间近似。
+// 每个工作线程累加到自己的 Partial，结束后由调用线程合并。
+class VolumeHistogram {
+public:
+    static const int MAX_BINS = 65536;
+
+    struct Partial {
+        std::vector<int64_t> counts;
+        double minValue = 0.0;
+        double maxValue = 0.0;
+        bool empty = true;
+    };
+
+    // 预期取值范围 [lo, hi]，清空计数；超出范围的值计入两端的区间
+    void setRange(double lo, double hi, bool integral);
+    void clear(); // 保留范围，清空计数
+    void add(Partial &partial, const void *data, int scalarType, size_t count) const;
+    void merge(const Partial &partial);
+    bool merge(const VolumeHistogram &other); // 区间划分不同时不合并，返回 false
+
+    bool empty() const { return totalCount == 0; }
+    int64_t total() const { return totalCount; }
+    double minimum() const { return minValue; } // 实际出现的最小/最大值
+    double maximum() const { return maxValue; }
+    double percentile(double fraction) const;   // fraction 在 [0, 1]
+    // 按百分位数给出默认窗宽窗位，金属、填充值等离群点不会把图像拉灰
+    void windowLevel(double lowFraction, double highFraction, double &window, double &level) const;
+    // 合并成 bins 个覆盖 [lo, hi] 的等宽区间，用于显示
+    std::vector<int64_t> resample(int bins, double lo, double hi) const;
+
+    // 写入体数据缓存的二进制格式
+    std::string serialize() const;
+    bool deserialize(const char *data, size_t size);
+
+private:
+    double binLower(int bin) const { return lower + bin * binWidth; }
+
+    double lower = 0.0;
+    double binWidth = 1.0;
+    bool integralBins = true;
+    std::vector<int64_t> counts;
+    int64_t totalCount = 0;
+    double minValue = 0.0;
+    double maxValue = 0.0;
+};
+
+#endif // VOLUMEHISTOGRAM_H
@@ -0,0 +1,190 @@
+#include "volumelod.h"
+#include "volumeresample.h"
+#include "memoryfootprint.h"
+
+#include <vtkCommand.h>
+#include <vtkInteractorStyle.h>
+#include <vtkRenderWindow.h>
+#include <vtkRenderer.h>
+#include <vtkSmartVolumeMapper.h>
+
+#include <algorithm>
+
+namespace {
+
+// 第0层与 setup3DView 中的静止画质一致
+const VolumeLodController::Level LEVELS[] = {
+    {1, 0.5, true,  "全分辨率"},
+    {1, 1.0, false, "LOD 1 (采样距离 1.0)"},
+    {2, 1.5, false, "LOD 2 (1/2 分辨率)"},
+    {4, 3.0, false, "LOD 3 (1/4 分辨率)"},
+};
+const int LEVEL_COUNT = sizeof(LEVELS) / sizeof(LEVELS[0]);
+
+// 连续多少帧超出/低于目标才切换层次，避免来回跳动
+const int SLOW_FRAMES_TO_COARSEN = 2;
+const int FAST_FRAMES_TO_REFINE = 5;
+
+const int MAX_BASE_FACTOR = 8;
+
+} // namespace
+
+VolumeLodController::VolumeLodController(vtkSmartVolumeMapper *mapper, vtkRenderer *renderer)
+    : mapper(mapper), renderer(renderer), style(nullptr), window(nullptr),
+      startTag(0), endTag(0), renderTag(0),
+      proxyBudgetBytes(0), baseFactor(1),
+      targetMs(50.0), interacting(false), currentLevel(0), interactiveLevel(1),
+      slowFrames(0), fastFrames(0)
+{
+}
+
+VolumeLodController::~VolumeLodController() {
+    if (style) {
+        style->RemoveObserver(startTag);
+        style->RemoveObserver(endTag);
+    }
+    if (window) {
+        window->RemoveObserver(renderTag);
+    }
+}
+
+void VolumeLodController::attach(vtkInteractorStyle *interactorStyle, vtkRenderWindow *renderWindow) {
+    style = interactorStyle;
+    window = renderWindow;
+    startTag = style->AddObserver(vtkCommand::StartInteractionEvent, this, &VolumeLodController::startInteraction);
+    endTag = style->AddObserver(vtkCommand::EndInteractionEvent, this, &VolumeLodController::endInteraction);
+    renderTag = window->AddObserver(vtkCommand::EndEvent, this, &VolumeLodController::frameRendered);
+}
+
+void VolumeLodController::setVolume(vtkImageData *newVolume) {
+    volume = newVolume;
+    externalInput = nullptr;
+    proxies.clear();
+
+    // 超出显存上限时找能放下的最小抽取因子
+    baseFactor = 1;
+    const qint64 gpuBytes = gpuBudgetBytes();
+    const qint64 bytes = MemoryFootprint::imageBytes(volume);
+    if (gpuBytes > 0) {
+        while (baseFactor < MAX_BASE_FACTOR
+               && bytes / (static_cast<qint64>(baseFactor) * baseFactor * baseFactor) > gpuBytes) {
+            baseFactor *= 2;
+        }
+    }
+    if (volume && (interacting || baseFactor > 1)) {
+        applyLevel(currentLevel);
+    }
+}
+
+void VolumeLodController::setExternalInput(vtkImageData *input) {
+    externalInput = input;
+    if (externalInput && mapper->GetInput() != externalInput.GetPointer()) {
+        mapper->SetInputData(externalInput);
+    }
+}
+
+void VolumeLodController::setProxyBudget(qint64 bytes) {
+    proxyBudgetBytes = bytes > 0 ? bytes : 0;
+    proxies.clear();
+    if (volume) {
+        applyLevel(currentLevel);
+    }
+}
+
+qint64 VolumeLodController::gpuBudgetBytes() const {
+    return static_cast<qint64>(mapper->GetMaxMemoryInBytes() * static_cast<double>(mapper->GetMaxMemoryFraction()));
+}
+
+void VolumeLodController::setTargetFrameTime(double ms) {
+    targetMs = ms > 1.0 ? ms : 1.0;
+}
+
+void VolumeLodController::setLevelChangedCallback(std::function<void(int, const QString &)> callback) {
+    levelChanged = std::move(callback);
+}
+
+void VolumeLodController::setRenderCallback(std::function<void()> callback) {
+    requestRender = std::move(callback);
+}
+
+void VolumeLodController::startInteraction() {
+    interacting = true;
+    slowFrames = fastFrames = 0;
+    applyLevel(interactiveLevel);
+}
+
+void VolumeLodController::endInteraction() {
+    interacting = false;
+    applyLevel(0);
+    if (requestRender) {
+        requestRender();
+    }
+}
+
+// 交互中每帧渲染结束后比较耗时与目标帧时间，调整下一帧的层次
+void VolumeLodController::frameRendered() {
+    if (!interacting) {
+        return;
+    }
+    const double frameMs = renderer->GetLastRenderTimeInSeconds() * 1000.0;
+    if (frameMs > targetMs * 1.25) {
+        fastFrames = 0;
+        if (++slowFrames >= SLOW_FRAMES_TO_COARSEN && interactiveLevel < LEVEL_COUNT - 1) {
+            slowFrames = 0;
+            applyLevel(++interactiveLevel);
+        }
+    } else if (frameMs < targetMs * 0.5) {
+        slowFrames = 0;
+        if (++fastFrames >= FAST_FRAMES_TO_REFINE && interactiveLevel > 1) {
+            fastFrames = 0;
+            applyLevel(--interactiveLevel);
+        }
+    } else {
+        slowFrames = fastFrames = 0;
+    }
+}
+
+void VolumeLodController::applyLevel(int level) {
+    const Level &lod = LEVELS[level];
+    mapper->SetSampleDistance(lod.sampleDistance);
+    mapper->SetUseJittering(lod.jitter ? 1 : 0);
+
+    // 没有完整体数据时 (预览阶段) 不替换映射器输入；代理超出预算时退回原始体数据
+    if (externalInput) {
+        if (mapper->GetInput() != externalInput.GetPointer()) {
+            mapper->SetInputData(externalInput);
+        }
+    } else if (volume) {
+        const int factor = std::max(lod.factor, baseFactor);
+        vtkImageData *input = factor > 1 ? proxyVolume(factor) : nullptr;
+        if (!input) {
+            input = volume;
+        }
+        if (mapper->GetInput() != input) {
+            mapper->SetInputData(input);
+        }
+    }
+
+    currentLevel = level;
+    if (levelChanged) {
+        levelChanged(level, QString::fromUtf8(lod.name));
+    }
+}
+
+// 代理体数据在第一次用到时生成；加上已有代理会超出预算时返回 nullptr
+vtkImageData *VolumeLodController::proxyVolume(int factor) {
+    auto it = proxies.find(factor);
+    if (it == proxies.end()) {
+        qint64 used = 0;
+        for (const auto &proxy : proxies) {
+            used += MemoryFootprint::imageBytes(proxy.second);
+        }
+        const qint64 bytes = MemoryFootprint::imageBytes(volume) / (static_cast<qint64>(factor) * factor * factor);
+        if (used + bytes > proxyBudgetBytes) {
+            return nullptr;
+        }
+        const int factors[3] = {factor, factor, factor};
+        it = proxies.emplace(factor, decimateVolume(volume, factors)).first;
+    }
+    return it->second;
+}
@@ -0,0 +1,83 @@
+#ifndef VOLUMELOD_H
+#define VOLUMELOD_H
+
+#include <QString>
+
+#include <functional>
+#include <map>
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+
+class vtkSmartVolumeMapper;
+class vtkRenderer;
+class vtkInteractorStyle;
+class vtkRenderWindow;
+
+// 三维视图交互时的细节层次 (LOD) 控制
+// 旋转、平移、缩放期间换用更大的采样距离，必要时换成抽取后的代理体数据；松开鼠标后恢复全分辨率。
+// 交互中根据每帧实际耗时与目标帧时间比较，自动升降层次，下一次交互从上次的层次开始。
+// 代理体数据是唯一允许的体数据副本，总大小受预算限制 (预算为 0 时不生成，只调整采样距离)；
+// 体数据超出映射器的显存上限时，静止画面也改用代理，而不是由映射器在内部另外重采样一份。
+class VolumeLodController {
+public:
+    struct Level {
+        int factor;            // 代理体数据的抽取因子，1 表示原始体数据
+        double sampleDistance; // 光线采样距离
+        bool jitter;
+        const char *name;
+    };
+
+    VolumeLodController(vtkSmartVolumeMapper *mapper, vtkRenderer *renderer);
+    ~VolumeLodController();
+
+    void attach(vtkInteractorStyle *style, vtkRenderWindow *window);
+    // 完整体数据；传入 nullptr 时 (如显示渐进加载的预览) 只调整采样距离，不替换输入
+    void setVolume(vtkImageData *volume);
+    // 电影回放时由后台线程按 decimationFactor() 准备好的映射器输入：直接交给映射器，不清空代理也不在界面线程重采样，
+    // 交互时只调整采样距离；停止回放后调用 setVolume 换上当前时相并恢复按代理切换
+    void setExternalInput(vtkImageData *input);
+    int decimationFactor() const { return baseFactor; }
+    void setTargetFrameTime(double ms);
+    double targetFrameTime() const { return targetMs; }
+    void setProxyBudget(qint64 bytes); // 清空已生成的代理，按新预算重新生成
+    qint64 proxyBudget() const { return proxyBudgetBytes; }
+    const std::map<int, vtkSmartPointer<vtkImageData>> &proxyVolumes() const { return proxies; }
+    qint64 gpuBudgetBytes() const; // 映射器的显存上限乘以可用比例，未知时为 0
+
+    void setLevelChangedCallback(std::function<void(int level, const QString &description)> callback);
+    void setRenderCallback(std::function<void()> callback); // 交互结束后请求一次全分辨率渲染
+
+    int level() const { return currentLevel; }
+
+private:
+    void startInteraction();
+    void endInteraction();
+    void frameRendered();
+    void applyLevel(int level);
+    vtkImageData *proxyVolume(int factor);
+
+    vtkSmartVolumeMapper *mapper;
+    vtkRenderer *renderer;
+    vtkInteractorStyle *style;
+    vtkRenderWindow *window;
+    unsigned long startTag, endTag, renderTag;
+
+    vtkSmartPointer<vtkImageData> volume;
+    vtkSmartPointer<vtkImageData> externalInput;
+    std::map<int, vtkSmartPointer<vtkImageData>> proxies; // 按抽取因子缓存
+    qint64 proxyBudgetBytes;
+    int baseFactor; // 静止画面的抽取因子，体数据放得进显存时为 1
+
+    double targetMs;
+    bool interacting;
+    int currentLevel;
+    int interactiveLevel; // 交互时使用的层次，跨交互保留
+    int slowFrames;
+    int fastFrames;
+
+    std::function<void(int, const QString &)> levelChanged;
+    std::function<void()> requestRender;
+};
+
+#endif // VOLUMELOD_H
@@ -0,0 +1,38 @@
+#include "volumepreset.h"
+
+#include <vtkColorTransferFunction.h>
+#include <vtkNamedColors.h>
+#include <vtkPiecewiseFunction.h>
+#include <vtkSmartPointer.h>
+#include <vtkVolumeProperty.h>
+
+void setDefaultOpacityPoints(vtkPiecewiseFunction *opacity, double scale) {
+    opacity->RemoveAllPoints();
+    opacity->AddPoint(0,    0.0);         // 完全透明
+    opacity->AddPoint(500,  0.15 * scale); // 软组织开始显现
+    opacity->AddPoint(1000, 0.3 * scale);
+    opacity->AddPoint(1150, 0.5 * scale);  // 骨骼开始显现
+    opacity->AddPoint(2000, 0.8 * scale);
+}
+
+void setupDefaultVolumeProperty(vtkVolumeProperty *property, vtkColorTransferFunction *color,
+                                vtkPiecewiseFunction *opacity) {
+    setDefaultOpacityPoints(opacity);
+
+    vtkSmartPointer<vtkNamedColors> colors = vtkSmartPointer<vtkNamedColors>::New();
+    const vtkColor3d brown = colors->GetColor3d("Brown");
+    const vtkColor3d ivory = colors->GetColor3d("Ivory");
+    color->RemoveAllPoints();
+    color->AddRGBPoint(0, 0.0, 0.0, 0.0); // 完全透明对应黑色
+    color->AddRGBPoint(500, brown.GetRed() * 0.5, brown.GetGreen() * 0.5, brown.GetBlue() * 0.5); // 软组织
+    color->AddRGBPoint(1000, ivory.GetRed() * 0.8, ivory.GetGreen() * 0.8, ivory.GetBlue() * 0.8); // 中等密度组织
+    color->AddRGBPoint(1150, 1.0, 1.0, 1.0); // 骨骼
+
+    property->SetColor(color);
+    property->SetScalarOpacity(opacity);
+    property->SetInterpolationTypeToLinear();
+    property->ShadeOn();
+    property->SetAmbient(0.4);
+    property->SetDiffuse(0.6);
+    property->SetSpecular(0.2);
+}
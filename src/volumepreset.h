@@ -0,0 +1,15 @@
+#ifndef VOLUMEPRESET_H
+#define VOLUMEPRESET_H
+
+class vtkColorTransferFunction;
+class vtkPiecewiseFunction;
+class vtkVolumeProperty;
+
+// 三维视图默认的 CT 传输函数和光照参数，界面、批量导出和性能测试共用
+// 骨骼是高密度值，软组织是中低密度值
+void setupDefaultVolumeProperty(vtkVolumeProperty *property, vtkColorTransferFunction *color,
+                                vtkPiecewiseFunction *opacity);
+// 重新设置不透明度控制点，scale 为不透明度滑块对应的 0-1 因子
+void setDefaultOpacityPoints(vtkPiecewiseFunction *opacity, double scale = 1.0);
+
+#endif // VOLUMEPRESET_H
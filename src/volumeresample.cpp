@@ -0,0 +1,73 @@
+#include "volumeresample.h"
+#include "parallelfor.h"
+#include "tracer.h"
+
+#include <vtkSetGet.h>
+
+namespace {
+
+template <typename T>
+void decimateKernel(const T *in, T *out, const int inDims[3], const int outDims[3],
+                    const int factors[3], int components, int threadCount) {
+    const size_t inRow = static_cast<size_t>(inDims[0]) * components;
+    const size_t inSlice = inRow * inDims[1];
+    const size_t outRow = static_cast<size_t>(outDims[0]) * components;
+    const size_t outSlice = outRow * outDims[1];
+
+    parallelFor(0, outDims[2], [&](int z, int) {
+        const T *src = in + inSlice * (static_cast<size_t>(z) * factors[2]);
+        T *dst = out + outSlice * z;
+        for (int y = 0; y < outDims[1]; ++y) {
+            const T *srcRow = src + inRow * (static_cast<size_t>(y) * factors[1]);
+            T *dstRow = dst + outRow * y;
+            for (int x = 0; x < outDims[0]; ++x) {
+                const T *voxel = srcRow + static_cast<size_t>(x) * factors[0] * components;
+                for (int c = 0; c < components; ++c) {
+                    dstRow[static_cast<size_t>(x) * components + c] = voxel[c];
+                }
+            }
+        }
+    }, threadCount);
+}
+
+} // namespace
+
+vtkSmartPointer<vtkImageData> decimateVolume(vtkImageData *input, const int factors[3], int threadCount) {
+    TRACE_SCOPE("decimateVolume");
+    if (!input || input->GetScalarType() == VTK_VOID) {
+        return nullptr;
+    }
+
+    int inDims[3];
+    input->GetDimensions(inDims);
+    int outDims[3];
+    double spacing[3];
+    input->GetSpacing(spacing);
+    for (int i = 0; i < 3; ++i) {
+        int f = factors[i] > 0 ? factors[i] : 1;
+        outDims[i] = (inDims[i] + f - 1) / f;
+        spacing[i] *= f;
+    }
+
+    vtkSmartPointer<vtkImageData> output = vtkSmartPointer<vtkImageData>::New();
+    output->SetDimensions(outDims);
+    output->SetSpacing(spacing);
+    output->SetOrigin(input->GetOrigin());
+    output->AllocateScalars(input->GetScalarType(), input->GetNumberOfScalarComponents());
+
+    int safeFactors[3] = {
+        factors[0] > 0 ? factors[0] : 1,
+        factors[1] > 0 ? factors[1] : 1,
+        factors[2] > 0 ? factors[2] : 1
+    };
+    const int components = input->GetNumberOfScalarComponents();
+    void *in = input->GetScalarPointer();
+    void *out = output->GetScalarPointer();
+    switch (input->GetScalarType()) {
+        vtkTemplateMacro(decimateKernel(static_cast<const VTK_TT *>(in), static_cast<VTK_TT *>(out),
+                                        inDims, outDims, safeFactors, components, threadCount));
+        default:
+            return nullptr;
+    }
+    return output;
+}
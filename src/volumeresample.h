@@ -0,0 +1,11 @@
+#ifndef VOLUMERESAMPLE_H
+#define VOLUMERESAMPLE_H
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+
+// 按整数因子抽取体素生成低分辨率体数据 (最近邻)，用于渐进加载预览和交互时的代理体数据
+// 输出第 k 层对应输入第 k * factors[2] 层，间距按因子放大，原点不变
+vtkSmartPointer<vtkImageData> decimateVolume(vtkImageData *input, const int factors[3], int threadCount = 0);
+
+#endif // VOLUMERESAMPLE_H
@@ -0,0 +1,128 @@
+#include "windowlevel.h"
+#include "tracer.h"
+
+#include <vtkSetGet.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define WINDOWLEVEL_SSE2 1
+#endif
+
+namespace {
+
+template <typename T>
+void windowLevelKernel(const T *in, unsigned char *out, size_t count, int components, double window, double level) {
+    // 与 vtkImageMapToWindowLevelColors 一致：窗下限以下为0，上限以上为255，中间按比例截断取整
+    const double lower = level - window / 2.0;
+    const double upper = level + window / 2.0;
+    const double shift = window / 2.0 - level;
+    const double scale = 255.0 / window;
+    for (size_t i = 0; i < count; ++i) {
+        const double value = static_cast<double>(in[i * components]);
+        unsigned char gray;
+        if (value <= lower) {
+            gray = 0;
+        } else if (value >= upper) {
+            gray = 255;
+        } else {
+            gray = static_cast<unsigned char>((value + shift) * scale);
+        }
+        out[0] = gray;
+        out[1] = gray;
+        out[2] = gray;
+        out[3] = 255;
+        out += 4;
+    }
+}
+
+// 单分量 int16 的快速路径 (CT数据的常见情况)
+// 用单精度计算 (v + shift) * scale，截断后饱和到 [0, 255]，与上面的双精度公式最多相差1个灰度级。
+// SSE2 每次处理16个像素：两组8个 int16 扩展为 int32 转 float 计算，再压缩成16个灰度字节并展开为RGBA。
+void windowLevelShort(const short *in, unsigned char *out, size_t count, double window, double level) {
+    const float shift = static_cast<float>(window / 2.0 - level);
+    const float scale = static_cast<float>(255.0 / window);
+    size_t i = 0;
+
+#ifdef WINDOWLEVEL_SSE2
+    const __m128 vShift = _mm_set1_ps(shift);
+    const __m128 vScale = _mm_set1_ps(scale);
+    const __m128 vZero = _mm_setzero_ps();
+    const __m128 vMax = _mm_set1_ps(255.0f);
+    const __m128i alpha = _mm_set1_epi8(static_cast<char>(0xFF));
+
+    auto mapFour = [&](__m128i v32) {
+        __m128 f = _mm_mul_ps(_mm_add_ps(_mm_cvtepi32_ps(v32), vShift), vScale);
+        f = _mm_min_ps(_mm_max_ps(f, vZero), vMax);
+        return _mm_cvttps_epi32(f);
+    };
+
+    for (; i + 16 <= count; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i + 8));
+        // int16 -> int32 符号扩展：先放到高16位再算术右移
+        __m128i a0 = _mm_srai_epi32(_mm_unpacklo_epi16(a, a), 16);
+        __m128i a1 = _mm_srai_epi32(_mm_unpackhi_epi16(a, a), 16);
+        __m128i b0 = _mm_srai_epi32(_mm_unpacklo_epi16(b, b), 16);
+        __m128i b1 = _mm_srai_epi32(_mm_unpackhi_epi16(b, b), 16);
+        __m128i ga = _mm_packs_epi32(mapFour(a0), mapFour(a1));
+        __m128i gb = _mm_packs_epi32(mapFour(b0), mapFour(b1));
+        __m128i gray = _mm_packus_epi16(ga, gb); // 16 个灰度字节
+
+        // g -> (g, g, g, 255)
+        __m128i gg0 = _mm_unpacklo_epi8(gray, gray);
+        __m128i gg1 = _mm_unpackhi_epi8(gray, gray);
+        __m128i ga0 = _mm_unpacklo_epi8(gray, alpha);
+        __m128i ga1 = _mm_unpackhi_epi8(gray, alpha);
+        __m128i *dst = reinterpret_cast<__m128i *>(out + i * 4);
+        _mm_storeu_si128(dst, _mm_unpacklo_epi16(gg0, ga0));
+        _mm_storeu_si128(dst + 1, _mm_unpackhi_epi16(gg0, ga0));
+        _mm_storeu_si128(dst + 2, _mm_unpacklo_epi16(gg1, ga1));
+        _mm_storeu_si128(dst + 3, _mm_unpackhi_epi16(gg1, ga1));
+    }
+#endif
+
+    for (; i < count; ++i) {
+        float f = (static_cast<float>(in[i]) + shift) * scale;
+        f = f < 0.0f ? 0.0f : (f > 255.0f ? 255.0f : f);
+        const unsigned char gray = static_cast<unsigned char>(f);
+        unsigned char *pixel = out + i * 4;
+        pixel[0] = gray;
+        pixel[1] = gray;
+        pixel[2] = gray;
+        pixel[3] = 255;
+    }
+}
+
+} // namespace
+
+vtkSmartPointer<vtkImageData> mapWindowLevelToRGBA(vtkImageData *slice, double window, double level) {
+    TRACE_SCOPE("mapWindowLevelToRGBA");
+    if (!slice || slice->GetScalarType() == VTK_VOID) {
+        return nullptr;
+    }
+    if (window == 0.0) {
+        window = 1.0; // 避免除零
+    }
+
+    vtkSmartPointer<vtkImageData> rgba = vtkSmartPointer<vtkImageData>::New();
+    rgba->SetDimensions(slice->GetDimensions());
+    rgba->SetSpacing(slice->GetSpacing());
+    rgba->SetOrigin(slice->GetOrigin());
+    rgba->AllocateScalars(VTK_UNSIGNED_CHAR, 4);
+
+    const size_t count = static_cast<size_t>(slice->GetNumberOfPoints());
+    const int components = slice->GetNumberOfScalarComponents();
+    void *in = slice->GetScalarPointer();
+    unsigned char *out = static_cast<unsigned char *>(rgba->GetScalarPointer());
+    // 负窗宽 (反相) 的边界判定与比例公式不一致，仍走通用路径
+    if (slice->GetScalarType() == VTK_SHORT && components == 1 && window > 0.0) {
+        windowLevelShort(static_cast<const short *>(in), out, count, window, level);
+        return rgba;
+    }
+    switch (slice->GetScalarType()) {
+        vtkTemplateMacro(windowLevelKernel(static_cast<const VTK_TT *>(in), out, count, components, window, level));
+        default:
+            return nullptr;
+    }
+    return rgba;
+}
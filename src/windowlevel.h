@@ -0,0 +1,13 @@
+#ifndef WINDOWLEVEL_H
+#define WINDOWLEVEL_H
+
+#include <vtkSmartPointer.h>
+#include <vtkImageData.h>
+
+// 按窗宽窗位把二维切片映射为不透明的灰度RGBA图像
+// 映射公式与 vtkImageMapToWindowLevelColors 相同，多分量输入只取第一个分量；
+// 单分量 int16 输入走 SIMD 快速路径。
+// 不依赖VTK管线，可在预取线程中调用。
+vtkSmartPointer<vtkImageData> mapWindowLevelToRGBA(vtkImageData *slice, double window, double level);
+
+#endif // WINDOWLEVEL_H
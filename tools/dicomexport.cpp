@@ -0,0 +1,228 @@
+// 无界面批量导出：读取一批序列目录，为每个序列写出选定的轴状/矢状/冠状切片和三维视图 PNG，
+// 用于夜间批量生成缩略图和关键图像。进度逐行输出到标准错误，结束时把吞吐量等统计以JSON输出到标准输出。
+//
+// 用法: dicomexport --output 目录 [--list 文件] [序列目录...] [--axial 0.5,...] [--sagittal ...] [--coronal ...]
+//                   [--no-volume] [--size N] [--window W --level L] [--opacity 0-1] [--azimuth 度] [--elevation 度]
+//                   [--workers N] [--threads N] [--memory-mb N] [--skip-existing] [--report 文件] [--trace 文件]
+// 切片位置是 0-1 的相对层位置，逗号分隔，none 表示不导出该方向。
+
+#include "batchexporter.h"
+#include "memoryfootprint.h"
+#include "tracer.h"
+
+#include <vtkOutputWindow.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Options {
+    BatchExportOptions exporter;
+    std::vector<std::string> dirs;
+    std::string list;   // 每行一个序列目录，# 开头为注释
+    std::string report; // JSON 写入文件而不是标准输出
+    std::string trace;
+};
+
+std::string jsonString(const std::string &value) {
+    std::string out = "\"";
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            out.push_back('\\');
+        }
+        out.push_back(c);
+    }
+    return out + "\"";
+}
+
+bool parsePositions(const char *text, std::vector<double> &positions) {
+    positions.clear();
+    if (std::string(text) == "none") {
+        return true;
+    }
+    std::stringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        char *end = nullptr;
+        const double value = std::strtod(item.c_str(), &end);
+        if (item.empty() || *end != '\0' || value < 0.0 || value > 1.0) {
+            return false;
+        }
+        positions.push_back(value);
+    }
+    return !positions.empty();
+}
+
+bool readList(const std::string &path, std::vector<std::string> &dirs) {
+    std::ifstream in(std::filesystem::u8path(path));
+    if (!in) {
+        return false;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        line.erase(line.find_last_not_of(" \t\r") + 1);
+        line.erase(0, line.find_first_not_of(" \t"));
+        if (!line.empty() && line[0] != '#') {
+            dirs.push_back(line);
+        }
+    }
+    return true;
+}
+
+bool parseArguments(int argc, char *argv[], Options &options) {
+    BatchExportOptions &exporter = options.exporter;
+    for (int axis = 0; axis < 3; ++axis) {
+        exporter.slices[axis].assign(1, 0.5); // 默认导出各方向的中间层
+    }
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto next = [&]() -> const char * { return i + 1 < argc ? argv[++i] : nullptr; };
+        auto nextInt = [&](int &value) {
+            const char *v = next();
+            if (v) value = std::atoi(v);
+            return v != nullptr;
+        };
+        auto nextDouble = [&](double &value) {
+            const char *v = next();
+            if (v) value = std::atof(v);
+            return v != nullptr;
+        };
+        auto nextString = [&](std::string &value) {
+            const char *v = next();
+            if (v) value = v;
+            return v != nullptr;
+        };
+        auto nextPositions = [&](int axis) {
+            const char *v = next();
+            return v && parsePositions(v, exporter.slices[axis]);
+        };
+        bool ok = true;
+        int memoryMb = 0;
+        if (arg == "--output") ok = nextString(exporter.outputDir);
+        else if (arg == "--list") ok = nextString(options.list);
+        else if (arg == "--sagittal") ok = nextPositions(0);
+        else if (arg == "--coronal") ok = nextPositions(1);
+        else if (arg == "--axial") ok = nextPositions(2);
+        else if (arg == "--no-volume") exporter.volume = false;
+        else if (arg == "--size") ok = nextInt(exporter.size);
+        else if (arg == "--window") ok = nextDouble(exporter.window);
+        else if (arg == "--level") ok = nextDouble(exporter.level);
+        else if (arg == "--opacity") ok = nextDouble(exporter.opacity);
+        else if (arg == "--azimuth") ok = nextDouble(exporter.azimuth);
+        else if (arg == "--elevation") ok = nextDouble(exporter.elevation);
+        else if (arg == "--workers") ok = nextInt(exporter.workers);
+        else if (arg == "--threads") ok = nextInt(exporter.threadsPerStudy);
+        else if (arg == "--memory-mb") { ok = nextInt(memoryMb); exporter.memoryLimit = static_cast<int64_t>(memoryMb) << 20; }
+        else if (arg == "--skip-existing") exporter.skipExisting = true;
+        else if (arg == "--report") ok = nextString(options.report);
+        else if (arg == "--trace") ok = nextString(options.trace);
+        else if (arg.compare(0, 2, "--") != 0) options.dirs.push_back(arg);
+        else ok = false;
+        if (!ok) {
+            std::cerr << "无效参数: " << arg << std::endl;
+            return false;
+        }
+    }
+    if (!options.list.empty() && !readList(options.list, options.dirs)) {
+        std::cerr << "无法读取序列列表: " << options.list << std::endl;
+        return false;
+    }
+    if (exporter.outputDir.empty() || options.dirs.empty()) {
+        std::cerr << "需要 --output 目录和至少一个序列目录 (参数或 --list)" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    Options options;
+    if (!parseArguments(argc, argv, options)) {
+        return 2;
+    }
+    vtkOutputWindow::SetGlobalWarningDisplay(0);
+    if (!options.trace.empty()) {
+        Tracer::instance().setThreadName("main");
+        Tracer::instance().setEnabled(true);
+    }
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::u8path(options.exporter.outputDir), ec);
+
+    BatchExporter exporter(options.exporter);
+    exporter.setResultCallback([](const BatchExportResult &result, int finished, int total) {
+        std::cerr << "[" << finished << "/" << total << "] " << result.dirPath << ": ";
+        if (result.skipped) {
+            std::cerr << "已存在，跳过";
+        } else if (result.ok) {
+            std::cerr << result.dimensions[0] << "x" << result.dimensions[1] << "x" << result.dimensions[2]
+                      << " 读取 " << result.loadMs << " ms, 切片 " << result.sliceMs << " ms, 三维 "
+                      << result.volumeMs << " ms";
+        } else {
+            std::cerr << "失败: " << result.error;
+        }
+        std::cerr << std::endl;
+    });
+    const std::vector<BatchExportResult> results = exporter.run(options.dirs);
+
+    int exported = 0, skipped = 0;
+    double loadMs = 0.0, sliceMs = 0.0, volumeMs = 0.0, waitMs = 0.0;
+    int64_t voxelBytes = 0;
+    std::string failures;
+    for (const BatchExportResult &result : results) {
+        if (result.skipped) {
+            ++skipped;
+        } else if (result.ok) {
+            ++exported;
+            loadMs += result.loadMs;
+            sliceMs += result.sliceMs;
+            volumeMs += result.volumeMs;
+            waitMs += result.waitMs;
+            voxelBytes += result.volumeBytes;
+        } else {
+            failures += std::string(failures.empty() ? "" : ", ") + "{\"dir\": " + jsonString(result.dirPath)
+                + ", \"error\": " + jsonString(result.error) + "}";
+        }
+    }
+    const double seconds = exporter.wallSeconds();
+    const int failed = static_cast<int>(results.size()) - exported - skipped;
+    const double perStudy = exported > 0 ? 1.0 / exported : 0.0;
+
+    std::ostringstream json;
+    json << "{\n"
+         << "  \"studies\": " << results.size() << ", \"exported\": " << exported << ", \"skipped\": " << skipped
+         << ", \"failed\": " << failed << ",\n"
+         << "  \"workers\": " << exporter.workerCount() << ", \"threads_per_study\": " << exporter.threadsPerStudy()
+         << ", \"memory_limit_bytes\": " << options.exporter.memoryLimit << ",\n"
+         << "  \"wall_seconds\": " << seconds << ",\n"
+         << "  \"studies_per_minute\": " << (seconds > 0.0 ? (exported + failed) * 60.0 / seconds : 0.0) << ",\n"
+         << "  \"voxel_mb_per_second\": " << (seconds > 0.0 ? voxelBytes / 1048576.0 / seconds : 0.0) << ",\n"
+         << "  \"mean_ms\": {\"load\": " << loadMs * perStudy << ", \"slices\": " << sliceMs * perStudy
+         << ", \"volume\": " << volumeMs * perStudy << ", \"memory_wait\": " << waitMs * perStudy << "},\n"
+         << "  \"peak_bytes\": " << MemoryFootprint::peakResidentBytes() << ",\n"
+         << "  \"failures\": [" << failures << "]\n"
+         << "}\n";
+
+    std::string error;
+    if (!options.trace.empty() && !Tracer::instance().writeChromeTrace(options.trace, &error)) {
+        std::cerr << error << std::endl;
+    }
+    if (options.report.empty()) {
+        std::cout << json.str();
+    } else {
+        std::ofstream out(std::filesystem::u8path(options.report));
+        out << json.str();
+        if (!out) {
+            std::cerr << "无法写入: " << options.report << std::endl;
+            return 1;
+        }
+    }
+    return failed == 0 ? 0 : 1;
+}